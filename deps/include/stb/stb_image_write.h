@@ -151,8 +151,10 @@ LICENSE
 #ifndef INCLUDE_STB_IMAGE_WRITE_H
 #define INCLUDE_STB_IMAGE_WRITE_H
 
-// Added in PhongGrass
+// Added in PhongGrass, the _s functions are only in the MSVC CRT
+#ifdef _MSC_VER
 #define __STDC_LIB_EXT1__
+#endif
 
 #include <stdlib.h>
 
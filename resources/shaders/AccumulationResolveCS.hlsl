@@ -0,0 +1,14 @@
+#include "ShaderResourceRegisters.h"
+
+// Writes the accumulated average of every pixel to the result buffer.
+// Used with adaptive sampling where RaytracerCS only touches the unconverged tiles.
+
+RWTexture2D<unorm float4> resultBuffer : register(RESULT_BUFFER_GPU_REG);
+RWTexture2D<float4> accumulationBuffer : register(ACCUMULATION_BUFFER_GPU_REG);
+
+[numthreads(THREAD_GROUP_SIZE_X, THREAD_GROUP_SIZE_Y, 1)]
+void main(uint3 DTid : SV_DispatchThreadID)
+{
+    float4 accumulated = accumulationBuffer[DTid.xy];
+    resultBuffer[DTid.xy] = accumulated.a > 0.f ? saturate(accumulated / accumulated.a) : float4(0.f, 0.f, 0.f, 1.f);
+}
\ No newline at end of file
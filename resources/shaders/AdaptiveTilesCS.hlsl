@@ -0,0 +1,51 @@
+#include "GPU-Utilities.hlsli"
+#include "ShaderResourceRegisters.h"
+
+/*
+    Finds the tiles that haven't converged yet and appends them to activeTiles.
+    One thread group covers one tile (same size as the thread groups in RaytracerCS).
+    A tile is converged when the relative standard error of every pixel's mean luminance is below the threshold.
+*/
+
+RWTexture2D<float4> accumulationBuffer : register(ACCUMULATION_BUFFER_GPU_REG);
+RWTexture2D<float> secondMomentBuffer : register(SECOND_MOMENT_BUFFER_GPU_REG);
+AppendStructuredBuffer<uint> activeTiles : register(ACTIVE_TILES_APPEND_GPU_REG);
+
+cbuffer RenderDataBuffer : register(RENDER_DATA_GPU_REG)
+{
+    RenderData renderData;
+}
+
+groupshared uint tileMaxError;
+
+[numthreads(THREAD_GROUP_SIZE_X, THREAD_GROUP_SIZE_Y, 1)]
+void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint GIndex : SV_GroupIndex)
+{
+    if (GIndex == 0)
+        tileMaxError = 0;
+    
+    GroupMemoryBarrierWithGroupSync();
+    
+    float4 accumulated = accumulationBuffer[DTid.xy];
+    float numSamples = accumulated.a;
+    
+    // Pixels with too few samples can't be trusted, they keep the tile active
+    float error = FLT_MAX;
+    if (numSamples >= (float)renderData.adaptiveMinSamples && numSamples > 1.f)
+    {
+        float mean = luminance(accumulated.rgb) / numSamples;
+        float variance = max(secondMomentBuffer[DTid.xy] / numSamples - mean * mean, 0.f) * numSamples / (numSamples - 1.f);
+        error = sqrt(variance / numSamples) / (mean + 0.001f);
+    }
+    
+    // Positive floats keep their order when compared as uints
+    InterlockedMax(tileMaxError, asuint(error));
+    
+    GroupMemoryBarrierWithGroupSync();
+    
+    if (GIndex == 0 && asfloat(tileMaxError) > renderData.adaptiveErrorThreshold)
+    {
+        uint numTilesX = renderData.textureDims.x / THREAD_GROUP_SIZE_X;
+        activeTiles.Append(Gid.y * numTilesX + Gid.x);
+    }
+}
\ No newline at end of file
@@ -1,7 +1,7 @@
 #include "GPU-Utilities.hlsli"  
 #include "ShaderResourceRegisters.h"
 
-StructuredBuffer<float3> lineData : register(TRIANGLE_POS_GPU_REG);
+StructuredBuffer<float3> lineData : register(VERTEX_POS_GPU_REG);
 StructuredBuffer<BvhNode> bvhNodes : register(BVH_TREE_GPU_REG);
 StructuredBuffer<OctTreeNode> octTreeNodes : register(OCT_TREE_GPU_REG);
 
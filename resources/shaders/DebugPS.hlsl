@@ -1,21 +1,12 @@
 #include "GPU-Utilities.hlsli"
 #include "ShaderResourceRegisters.h"
-
-
-SamplerState simp : register(s0);
-
-Texture2DArray<unorm float4> textures : register(TEXTURES_GPU_REG);
+#include "TextureAtlas.hlsli"
 
 cbuffer RenderDataBuffer : register(DBG_RENDER_DATA_GPU_REG)
 {
     DBGRenderData renderData;
 }
 
-float3 sampleTexture(uint textureIdx, float2 meshUVs)
-{
-    return textures.SampleLevel(simp, float3(meshUVs, (float) textureIdx), 0.f).rgb;
-}
-
 struct PS_Input
 {
     float4 svPos : SV_Position;
@@ -2,7 +2,8 @@
 #include "GPU-Utilities.hlsli"
 #include "ShaderResourceRegisters.h"
 
-StructuredBuffer<Triangle> triangleData : register(TRIANGLE_POS_GPU_REG);
+StructuredBuffer<float3> vertexPosData : register(VERTEX_POS_GPU_REG);
+StructuredBuffer<uint3> triangleIndices : register(TRIANGLE_INDEX_GPU_REG);
 
 cbuffer RenderDataBuffer : register(DBG_RENDER_DATA_GPU_REG)
 {
@@ -17,8 +18,8 @@ struct Output
 
 Output main(uint vertIdx : SV_VertexID)
 {
-    Triangle tri = triangleData[vertIdx / 3u];
-    float3 pos = tri.position[vertIdx % 3u];
+    uint3 triIndices = triangleIndices[vertIdx / 3u];
+    float3 pos = vertexPosData[triIndices[vertIdx % 3u]];
     
     Output output;
     output.localPos = pos;
@@ -1,8 +1,9 @@
 #include "GPU-Utilities.hlsli"  
 #include "ShaderResourceRegisters.h"
 
-StructuredBuffer<Triangle> trianglePosData : register(TRIANGLE_POS_GPU_REG);
-StructuredBuffer<TriangleInfo> triangleIinfoData : register(TRIANGLE_INFO_GPU_REG);
+StructuredBuffer<float3> vertexPosData : register(VERTEX_POS_GPU_REG);
+StructuredBuffer<PackedVertexInfo> vertexInfoData : register(VERTEX_INFO_GPU_REG);
+StructuredBuffer<uint3> triangleIndices : register(TRIANGLE_INDEX_GPU_REG);
 
 cbuffer RenderDataBuffer : register(DBG_RENDER_DATA_GPU_REG)
 {
@@ -22,14 +23,12 @@ PS_Input main(uint localVertIdx : SV_VertexID)
     PS_Input outData;
 	
     uint vertexIdx = renderData.vertStartIdx + localVertIdx;
-    uint localVertexIdx = vertexIdx % 3;
-    
-    Triangle triPos = trianglePosData[vertexIdx / 3u];
-    TriangleInfo triInfo = triangleIinfoData[vertexIdx / 3u];
+    uint3 triIndices = triangleIndices[vertexIdx / 3u];
+    uint bufferVertexIdx = triIndices[vertexIdx % 3u];
 
-    VertexInfo vertInfo = triInfo.vertexInfo[vertexIdx % 3u];
+    VertexInfo vertInfo = unpackVertexInfo(vertexInfoData[bufferVertexIdx]);
 	
-    outData.position = mul(float4(triPos.position[localVertexIdx], 1.f), renderData.objectWorldMatrix).xyz;
+    outData.position = mul(float4(vertexPosData[bufferVertexIdx], 1.f), renderData.objectWorldMatrix).xyz;
     outData.svPos = mul(float4(outData.position, 1.f), renderData.camViewProjMatrix);
     
     outData.normal = mul(float4(vertInfo.normal, 0.f), renderData.objectWorldMatrix).xyz;
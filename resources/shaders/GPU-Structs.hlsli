@@ -70,6 +70,15 @@ struct Material
     }
 };
 
+// Where a texture was packed into the atlas, in texels. Same layout as TextureAtlasRecord in source/Graphics/TextureAtlas.h
+struct TextureAtlasRecord
+{
+    uint sizeClass;
+    uint page;
+    uint2 offset;
+    uint2 size;
+};
+
 struct AABB
 {
 
@@ -92,11 +101,6 @@ struct Sphere
     float radius;
 };
 
-struct Triangle
-{
-    float3 position[3];
-};
-
 struct VertexInfo
 {
     float3 normal;
@@ -105,9 +109,20 @@ struct VertexInfo
     float3 bitangent;
 };
 
-struct TriangleInfo
+// Precomputed by BvhBuilder::buildHitTriangles, in the same order as the triangle indices
+struct HitTriangle
 {
-    VertexInfo vertexInfo[3];
+    float3 origin; // p2
+    float3 edge1; // p0 - p2
+    float3 edge2; // p1 - p2
+};
+
+// Okay::PackedVertexInfo, decoded with unpackVertexInfo
+struct PackedVertexInfo
+{
+    uint normal; // Octahedral, 2x 16 bit snorm
+    uint tangent; // Octahedral, 2x 16 bit snorm, the lowest bit is the bitangent sign
+    uint uv; // 2x half
 };
 
 struct Mesh
@@ -178,6 +193,56 @@ struct OctTreeNode
     uint numChildren;
 };
 
+struct RenderData
+{
+    uint accumulationEnabled;
+    uint numAccumulationFrames;
+    
+    uint numSpheres;
+    uint numMeshes;
+    
+    uint numDirLights;
+    uint numPointLights;
+    uint numSpotLights;
+    uint debugMode;
+    
+    uint2 textureDims;
+    float2 viewPlaneDims;
+    
+    float4x4 cameraInverseProjectionMatrix;
+    float4x4 cameraInverseViewMatrix;
+    float3 cameraPosition;
+    float cameraNearZ;
+  
+    float3 cameraUpDir;
+    float dofStrength;
+    float3 cameraRightDir;
+    float dofDistance;
+    
+    uint debugMaxCount;
+    uint maxBounces;
+    uint russianRouletteEnabled;
+    uint russianRouletteStartBounce;
+    
+    uint adaptiveSamplingEnabled;
+    uint adaptiveMinSamples;
+    float adaptiveErrorThreshold;
+    uint adaptiveUpdateInterval;
+    
+    uint samplerType;
+    uint motionPixelStride;
+    uint2 motionPixelOffset;
+    
+    float4x4 previousViewProjectionMatrix;
+    float3 previousCameraPosition;
+    float maxHistorySamples;
+    
+    float reprojectionNormalThreshold;
+    float reprojectionDepthTolerance;
+    uint motionFrameIdx;
+    float pad0;
+};
+
 struct DBGRenderData
 {
     float4x4 camViewProjMatrix;
@@ -15,6 +15,33 @@ bool isValidIdx(uint idx)
     return idx != UINT_MAX;
 }
 
+float2 unpackSnorm2x16(uint packed)
+{
+    int2 signExtended = asint(uint2(packed << 16, packed)) >> 16;
+    return max(float2(signExtended) / 32767.f, -1.f);
+}
+
+float3 octahedralDecode(float2 encoded)
+{
+    float3 direction = float3(encoded, 1.f - abs(encoded.x) - abs(encoded.y));
+    float fold = saturate(-direction.z);
+    direction.xy += direction.xy >= 0.f ? -fold : fold;
+    
+    return normalize(direction);
+}
+
+// Matches Okay::unpackVertexInfo
+VertexInfo unpackVertexInfo(PackedVertexInfo packed)
+{
+    VertexInfo vertexInfo;
+    vertexInfo.normal = octahedralDecode(unpackSnorm2x16(packed.normal));
+    vertexInfo.tangent = octahedralDecode(unpackSnorm2x16(packed.tangent));
+    vertexInfo.bitangent = cross(vertexInfo.normal, vertexInfo.tangent) * ((packed.tangent & 1u) ? -1.f : 1.f);
+    vertexInfo.uv = f16tof32(uint2(packed.uv, packed.uv >> 16));
+    
+    return vertexInfo;
+}
+
 uint pcg_hash(inout uint seed)
 {
     // Ty Cherno
@@ -77,6 +104,11 @@ float2 randomPointInCircle(inout uint seed)
     return pointOnCircle * sqrt(randomFloat(seed));
 }
 
+float luminance(float3 colour)
+{
+    return dot(colour, float3(0.2126f, 0.7152f, 0.0722f));
+}
+
 float clampedDot(float3 v, float3 u)
 {
     return max(dot(v, u), 0.f);
@@ -114,14 +146,14 @@ namespace Collision
     }
     
     // Returns distance to hit. -1 if miss
-    float RayAndTriangle(Ray ray, float3 p0, float3 p1, float3 p2, inout float2 baryUVCoord)
+    float RayAndTriangle(Ray ray, HitTriangle tri, inout float2 baryUVCoord)
     {
         static const float EPSILON = 0.000001f;
 
         // Which vectors we use (E1 = (p0 - p2) or (p1 - p0)) will affect the barycentric interpolation later on
         // Doing it this way allows us to pass in the values to barycentric functions nicely
-        // (p0 -> p1 -> p2) instead of: (p1 -> p2 -> p0)
-        float3 E1 = p0 - p2, E2 = p1 - p2;
+        // (p0 -> p1 -> p2) instead of: (p1 -> p2 -> p0). Precomputed by BvhBuilder::buildHitTriangles
+        float3 E1 = tri.edge1, E2 = tri.edge2;
         float3 cross1 = cross(ray.direction, E2);
         float determinant = dot(E1, cross1);
 
@@ -131,7 +163,7 @@ namespace Collision
 
         float inverseDet = 1.f / determinant;
 
-        float3 rayMoved = ray.origin - p2;
+        float3 rayMoved = ray.origin - tri.origin;
         baryUVCoord.x = dot(rayMoved, cross1) * inverseDet;
 
 	    // p is outside the triangle, barycentric coordinates shows: u >= 0
@@ -0,0 +1,111 @@
+#include "GPU-Structs.hlsli"
+#include "ShaderResourceRegisters.h"
+
+/*
+    Fills in the pixels RaytracerCS didn't trace while the camera moves.
+    Texel [x, y] in the motion buffer was traced at pixel [x, y] * motionPixelStride + motionPixelOffset,
+    the offset changes every frame so the traced pixels are interleaved over time.
+    The accumulation holds the last motion frame with alpha = frames since the pixel was traced + 1, the other pixels take it
+    reprojected into this view. Where there is none they're upsampled from the traced pixels, with alpha = 0 so they don't become history.
+    Port of source/Graphics/MotionMode.cpp, which the CPU tracer uses
+*/
+
+RWTexture2D<unorm float4> resultBuffer : register(RESULT_BUFFER_GPU_REG);
+RWTexture2D<float4> accumulationBuffer : register(ACCUMULATION_BUFFER_GPU_REG);
+RWTexture2D<unorm float4> motionBuffer : register(MOTION_BUFFER_GPU_REG);
+RWTexture2D<float4> gBufferNormalDepth : register(GBUFFER_NORMAL_DEPTH_GPU_REG);
+RWTexture2D<float4> gBufferPositionInstance : register(GBUFFER_POSITION_INSTANCE_GPU_REG);
+
+// Copied from the accumulation and G-buffers before RaytracerCS ran
+Texture2D<float4> historyAccumulation : register(HISTORY_ACCUMULATION_GPU_REG);
+Texture2D<float4> prevGBufferNormalDepth : register(PREV_GBUFFER_NORMAL_DEPTH_GPU_REG);
+Texture2D<float4> prevGBufferPositionInstance : register(PREV_GBUFFER_POSITION_INSTANCE_GPU_REG);
+
+cbuffer RenderDataBuffer : register(RENDER_DATA_GPU_REG)
+{
+    RenderData renderData;
+}
+
+bool findHistoryPixel(int2 pixelId, int2 closestPixel, out int2 prevPixel)
+{
+    prevPixel = int2(0, 0);
+
+    // The surface under an untraced pixel isn't known, the closest traced pixel's is the best guess
+    float4 positionInstance = gBufferPositionInstance[closestPixel];
+    if (positionInstance.w < 0.f)
+        return false;
+
+    float4 clip = mul(float4(positionInstance.xyz, 1.f), renderData.previousViewProjectionMatrix);
+    if (clip.w <= 0.f)
+        return false;
+
+    // Its motion is shifted by the distance between the two, the surface test rejects the guess across edges
+    float2 prevPixelPos = float2(clip.x / clip.w + 1.f, 1.f - clip.y / clip.w) * 0.5f * (float2)renderData.textureDims;
+    prevPixel = (int2)floor(prevPixelPos + (float2)(pixelId - closestPixel) + 0.5f);
+    if (any(prevPixel < 0) || any(prevPixel >= (int2)renderData.textureDims))
+        return false;
+
+    float age = historyAccumulation[prevPixel].a;
+    float maxAge = (float)(renderData.motionPixelStride * renderData.motionPixelStride * 2u);
+    if (age <= 0.f || age >= maxAge)
+        return false;
+
+    // The depth is checked against the traced surface's plane, the surfaces are a few pixels apart
+    float3 normal = gBufferNormalDepth[closestPixel].xyz;
+    float4 prevPositionInstance = prevGBufferPositionInstance[prevPixel];
+    float planeDistance = abs(dot(prevPositionInstance.xyz - positionInstance.xyz, normal));
+    float distance = length(positionInstance.xyz - renderData.previousCameraPosition);
+
+    return prevPositionInstance.w == positionInstance.w &&
+        dot(normal, prevGBufferNormalDepth[prevPixel].xyz) >= renderData.reprojectionNormalThreshold &&
+        planeDistance <= renderData.reprojectionDepthTolerance * distance;
+}
+
+[numthreads(THREAD_GROUP_SIZE_X, THREAD_GROUP_SIZE_Y, 1)]
+void main(uint3 DTid : SV_DispatchThreadID)
+{
+    uint stride = renderData.motionPixelStride;
+    uint2 offset = renderData.motionPixelOffset;
+    int2 maxTexel = int2((renderData.textureDims - offset + stride - 1u) / stride) - 1;
+
+    float2 motionPos = ((float2)DTid.xy - (float2)offset) / (float)stride;
+
+    // Traced this frame, RaytracerCS wrote its G-buffers
+    if (all(DTid.xy % stride == offset))
+    {
+        float4 traced = motionBuffer[(int2)motionPos];
+        accumulationBuffer[DTid.xy] = float4(traced.rgb, 1.f);
+        resultBuffer[DTid.xy] = traced;
+        return;
+    }
+
+    int2 closestTexel = clamp((int2)floor(motionPos + 0.5f), 0, maxTexel);
+    int2 closestPixel = closestTexel * (int)stride + (int2)offset;
+
+    int2 prevPixel;
+    if (findHistoryPixel((int2)DTid.xy, closestPixel, prevPixel))
+    {
+        float4 history = historyAccumulation[prevPixel];
+        accumulationBuffer[DTid.xy] = float4(history.rgb, history.a + 1.f);
+        gBufferNormalDepth[DTid.xy] = prevGBufferNormalDepth[prevPixel];
+        gBufferPositionInstance[DTid.xy] = prevGBufferPositionInstance[prevPixel];
+        resultBuffer[DTid.xy] = float4(saturate(history.rgb), 1.f);
+        return;
+    }
+
+    // Bilinear filter between the four closest traced pixels
+    float2 floorPos = floor(motionPos);
+    float2 weight = motionPos - floorPos;
+
+    int2 texel0 = clamp((int2)floorPos, 0, maxTexel);
+    int2 texel1 = clamp((int2)floorPos + 1, 0, maxTexel);
+
+    float4 top = lerp(motionBuffer[int2(texel0.x, texel0.y)], motionBuffer[int2(texel1.x, texel0.y)], weight.x);
+    float4 bottom = lerp(motionBuffer[int2(texel0.x, texel1.y)], motionBuffer[int2(texel1.x, texel1.y)], weight.x);
+    float4 upsampled = lerp(top, bottom, weight.y);
+
+    accumulationBuffer[DTid.xy] = float4(upsampled.rgb, 0.f);
+    gBufferNormalDepth[DTid.xy] = float4(0.f, 0.f, 0.f, -1.f);
+    gBufferPositionInstance[DTid.xy] = float4(0.f, 0.f, 0.f, -1.f);
+    resultBuffer[DTid.xy] = upsampled;
+}
\ No newline at end of file
@@ -1,9 +1,11 @@
 
 #include "GPU-Utilities.hlsli"
 #include "ShaderResourceRegisters.h"
+#include "Sampling.hlsli"
+#include "TextureAtlas.hlsli"
 
 // ---- Defines and constants
-#define NUM_BOUNCES (1)
+#define MIN_SURVIVAL_CHANCE (0.05f)
 
 
 // ---- Structs, specific to RayTracer
@@ -14,51 +16,28 @@ struct Payload
     Material material;
     float3 worldPosition;
     float3 worldNormal;
-};
-
-struct RenderData
-{
-    uint accumulationEnabled;
-    uint numAccumulationFrames;
-    
-    uint numSpheres;
-    uint numMeshes;
-    
-    uint numDirLights;
-    uint numPointLights;
-    uint numSpotLights;
-    uint debugMode;
-    
-    uint2 textureDims;
-    float2 viewPlaneDims;
-    
-    float4x4 cameraInverseProjectionMatrix;
-    float4x4 cameraInverseViewMatrix;
-    float3 cameraPosition;
-    float cameraNearZ;
-  
-    float3 cameraUpDir;
-    float dofStrength;
-    float3 cameraRightDir;
-    float dofDistance;
-    
-    uint debugMaxCount;
-    float3 pad0;
+    uint instanceId; // Spheres first, then meshes
 };
 
 
 // ---- Resources
 
-StructuredBuffer<Triangle> trianglePosData : register(TRIANGLE_POS_GPU_REG);
-StructuredBuffer<TriangleInfo> triangleInfoData : register(TRIANGLE_INFO_GPU_REG);
+StructuredBuffer<PackedVertexInfo> vertexInfoData : register(VERTEX_INFO_GPU_REG);
+StructuredBuffer<uint3> triangleIndices : register(TRIANGLE_INDEX_GPU_REG);
+StructuredBuffer<HitTriangle> hitTriangles : register(HIT_TRIANGLE_GPU_REG);
 StructuredBuffer<BvhNode> bvhNodes : register(BVH_TREE_GPU_REG);
-Texture2DArray<unorm float4> textures : register(TEXTURES_GPU_REG);
 TextureCube environmentMap : register(ENVIRONMENT_MAP_GPU_REG);
 
 SamplerState simp : register(s0);
 
 RWTexture2D<unorm float4> resultBuffer : register(RESULT_BUFFER_GPU_REG);
 RWTexture2D<float4> accumulationBuffer : register(ACCUMULATION_BUFFER_GPU_REG);
+RWTexture2D<float> secondMomentBuffer : register(SECOND_MOMENT_BUFFER_GPU_REG);
+RWTexture2D<unorm float4> motionBuffer : register(MOTION_BUFFER_GPU_REG);
+RWTexture2D<float4> gBufferNormalDepth : register(GBUFFER_NORMAL_DEPTH_GPU_REG);
+RWTexture2D<float4> gBufferPositionInstance : register(GBUFFER_POSITION_INSTANCE_GPU_REG);
+RWTexture2D<float4> gBufferAlbedo : register(GBUFFER_ALBEDO_GPU_REG);
+StructuredBuffer<uint> activeTiles : register(ACTIVE_TILES_GPU_REG);
 StructuredBuffer<Sphere> sphereData : register(SPHERE_DATA_GPU_REG);
 StructuredBuffer<Mesh> meshData : register(MESH_ENTITY_DATA_GPU_REG);
 StructuredBuffer<DirectionalLight> directionalLights : register(DIRECTIONAL_LIGHT_DATA_GPU_REG);
@@ -104,14 +83,14 @@ float reflectance(float cosine, float reflectionIdx)
     return r0 + (1.f + r0) * pow(1.f - cosine, 5.f);
 }
 
-float3 findReflectDirection(float3 direction, float3 normal, float roughness, inout uint seed)
+float3 findReflectDirection(float3 direction, float3 normal, float roughness, inout Sampler generator)
 {
-    float3 diffuseReflection = normalize(normal + getRandomVector(seed));
+    float3 diffuseReflection = normalize(normal + getRandomVector(generator));
     float3 specularReflection = reflect(direction, normal);
     return normalize(lerp(specularReflection, diffuseReflection, roughness));
 }
 
-float3 findTransparencyBounce(float3 direction, float3 normal, float refractionIdx, inout uint seed)
+float3 findTransparencyBounce(float3 direction, float3 normal, float refractionIdx, inout Sampler generator)
 {
     bool hitFrontFace = dot(direction, normal) < 0.f;
     float refractionRatio = hitFrontFace ? AIR_REFRACTION_INDEX / refractionIdx : refractionIdx;
@@ -124,17 +103,12 @@ float3 findTransparencyBounce(float3 direction, float3 normal, float refractionI
     
     bool cannot_refract = refractionRatio * sin_theta > 1.f;
 
-    if (cannot_refract || reflectance(cos_theta, refractionRatio) > randomFloat(seed))
+    if (cannot_refract || reflectance(cos_theta, refractionRatio) > nextSample(generator))
         direction = reflect(direction, normal);
     
     return refract(direction, normal, refractionRatio);
 }
 
-float3 sampleTexture(uint textureIdx, float2 meshUVs)
-{
-    return textures.SampleLevel(simp, float3(meshUVs, (float)textureIdx), 0.f).rgb;
-}
-
 void findMaterialTextureColours(inout Material material, float2 meshUVs)
 {
     if (isValidIdx(material.albedo.textureIdx))
@@ -174,13 +148,13 @@ float3 sampleNormalMap(uint textureIdx, float2 meshUVs, float3 normal, float3 ta
     return normalize(mul(sampledNormal, tbn));
 }
 
-Ray createRay(uint2 pixelId, inout uint seed)
+Ray createRay(uint2 pixelId, inout Sampler generator)
 {
     float3 pos = float3((float) pixelId.x, float(renderData.textureDims.y - pixelId.y), renderData.cameraNearZ);
     
     // Simple AA
-    pos.x += randomFloat(seed) - 0.5f;
-    pos.y += randomFloat(seed) - 0.5f;
+    pos.x += nextSample(generator) - 0.5f;
+    pos.y += nextSample(generator) - 0.5f;
     
     pos.xy /= (float2) renderData.textureDims;
     pos.xy *= 2.f;
@@ -205,9 +179,9 @@ Ray createRay(uint2 pixelId, inout uint seed)
     return ray;
 }
 
-void applyDOF(inout Ray ray, inout uint seed)
+void applyDOF(inout Ray ray, inout Sampler generator)
 {
-    float2 rayJitter = randomPointInCircle(seed) * renderData.dofStrength;
+    float2 rayJitter = randomPointInCircle(generator) * renderData.dofStrength;
     float3 rayOffset = renderData.cameraRightDir * rayJitter.x + renderData.cameraUpDir * rayJitter.y;
     float3 focusPoint = ray.origin + ray.direction * (renderData.dofDistance + renderData.cameraNearZ); // + nearZ enables dofDistance = 0
 
@@ -224,6 +198,7 @@ Payload findClosestHit(Ray ray, inout uint bbCheckCount, inout uint triCheckCoun
     payload.material = Material::create();
     payload.worldPosition = float3(0.f, 0.f, 0.f);
     payload.worldNormal = float3(0.f, 0.f, 0.f);
+    payload.instanceId = UINT_MAX;
     
     uint hitIdx = UINT_MAX;
     uint hitType = 0;
@@ -294,16 +269,12 @@ Payload findClosestHit(Ray ray, inout uint bbCheckCount, inout uint triCheckCoun
                     
                 for (uint j = bvhNode.triStart; j < bvhNode.triEnd; j++)
                 {
-                    Triangle tri = trianglePosData[j];
-        
-                    float3 p0 = tri.position[0];
-                    float3 p1 = tri.position[1];
-                    float3 p2 = tri.position[2];
+                    HitTriangle tri = hitTriangles[j];
         
                     float2 baryUVCoords = float2(0.f, 0.f);
                 
                     triCheckCount += 1;
-                    float distanceToHit = Collision::RayAndTriangle(localRay, p0, p1, p2, baryUVCoords);
+                    float distanceToHit = Collision::RayAndTriangle(localRay, tri, baryUVCoords);
                 
                     if (distanceToHit <= 0.f)
                         continue;
@@ -335,6 +306,7 @@ Payload findClosestHit(Ray ray, inout uint bbCheckCount, inout uint triCheckCoun
     
     payload.hit = hitIdx != UINT_MAX;
     payload.worldPosition = ray.origin + ray.direction * payload.distance;
+    payload.instanceId = hitType == 0 ? hitIdx : renderData.numSpheres + hitIdx;
     
     // TODO: Make better system
     switch (hitType)
@@ -364,10 +336,10 @@ Payload findClosestHit(Ray ray, inout uint bbCheckCount, inout uint triCheckCoun
         case 1: // Mesh
             payload.material = meshData[hitIdx].material;
 
-            TriangleInfo tri = triangleInfoData[triHitIdx];
-            VertexInfo p0 = tri.vertexInfo[0];
-            VertexInfo p1 = tri.vertexInfo[1];
-            VertexInfo p2 = tri.vertexInfo[2];
+            uint3 triIndices = triangleIndices[triHitIdx];
+            VertexInfo p0 = unpackVertexInfo(vertexInfoData[triIndices.x]);
+            VertexInfo p1 = unpackVertexInfo(vertexInfoData[triIndices.y]);
+            VertexInfo p2 = unpackVertexInfo(vertexInfoData[triIndices.z]);
         
             float2 lerpedUV = barycentricInterpolation(hitBaryUVCoords, p0.uv, p1.uv, p2.uv);
             float3 normal = mul(float4(barycentricInterpolation(hitBaryUVCoords, p0.normal, p1.normal, p2.normal), 0.f), meshData[hitIdx].transformMatrix).xyz;
@@ -418,19 +390,39 @@ float3 getLighting(Ray ray, Payload hitPayload, uint bounce, float3 lightPos, fl
 }
 
 // ---- Main part of shader
-[numthreads(16, 9, 1)]
-void main(uint3 DTid : SV_DispatchThreadID)
+[numthreads(THREAD_GROUP_SIZE_X, THREAD_GROUP_SIZE_Y, 1)]
+void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint3 GTid : SV_GroupThreadID)
 {
     /*
         Flip Y-coordinate to convert to worldspace
         [0,0] in D3D11 textures is top left corner, but a higher Y-value should be higher in worldspace
         So it is flipped
     */
+    
+    // With adaptive sampling only the unconverged tiles are dispatched, one thread group per tile
+    // While the camera moves only one pixel per motionPixelStride^2 block is traced, MotionUpsampleCS fills in the rest
+    uint2 pixelId = DTid.xy;
+    if (renderData.motionPixelStride > 1)
+    {
+        pixelId = DTid.xy * renderData.motionPixelStride + renderData.motionPixelOffset;
+        if (pixelId.x >= renderData.textureDims.x || pixelId.y >= renderData.textureDims.y)
+            return;
+    }
+    else if (renderData.accumulationEnabled == 1 && renderData.adaptiveSamplingEnabled == 1)
+    {
+        uint tileIdx = activeTiles[Gid.x];
+        uint numTilesX = renderData.textureDims.x / THREAD_GROUP_SIZE_X;
+        pixelId = uint2(tileIdx % numTilesX, tileIdx / numTilesX) * uint2(THREAD_GROUP_SIZE_X, THREAD_GROUP_SIZE_Y) + GTid.xy;
+    }
      
-    uint seed = DTid.x + (DTid.y + 74813) * renderData.textureDims.x * (renderData.numAccumulationFrames + 1);
+    // Per pixel sample count, adaptive sampling makes it differ between pixels
+    // On motion frames the accumulation alpha is the pixel's age instead, every traced pixel takes the frame index
+    uint sampleIdx = renderData.motionPixelStride > 1 ? renderData.motionFrameIdx :
+        renderData.accumulationEnabled == 1 ? (uint)accumulationBuffer[pixelId].a : renderData.numAccumulationFrames;
+    Sampler generator = createSampler(renderData.samplerType, pixelId, renderData.textureDims.x, sampleIdx);
     
-    Ray ray = createRay(DTid.xy, seed);
-    applyDOF(ray, seed);
+    Ray ray = createRay(pixelId, generator);
+    applyDOF(ray, generator);
 
     float3 light = float3(0.f, 0.f, 0.f);
     float3 contribution = float3(1.f, 1.f, 1.f);
@@ -441,10 +433,18 @@ void main(uint3 DTid : SV_DispatchThreadID)
     uint bbCheckCount = 0;
     uint triCheckCount = 0;
     
-    for (uint i = 0; i <= NUM_BOUNCES; i++)
+    for (uint i = 0; i <= renderData.maxBounces; i++)
     {
         hitData = findClosestHit(ray, bbCheckCount, triCheckCount);
         
+        // First hit G-buffer for reprojection and the denoiser, on motion frames MotionUpsampleCS fills in the untraced pixels
+        if (i == 0)
+        {
+            gBufferNormalDepth[pixelId] = hitData.hit ? float4(hitData.worldNormal, hitData.distance) : float4(0.f, 0.f, 0.f, -1.f);
+            gBufferPositionInstance[pixelId] = hitData.hit ? float4(hitData.worldPosition, (float)hitData.instanceId) : float4(0.f, 0.f, 0.f, -1.f);
+            gBufferAlbedo[pixelId] = hitData.hit ? float4(hitData.material.albedo.colour, 1.f) : float4(1.f, 1.f, 1.f, 1.f);
+        }
+        
         for (uint p = 0u; p < renderData.numPointLights; p++)
         {
             PointLight pointLight = pointLights[p];
@@ -457,7 +457,7 @@ void main(uint3 DTid : SV_DispatchThreadID)
         {
             SpotLight spotLight = spotLights[s];
             
-            float3 rayToLight = normalize((spotLight.position + getRandomVector(seed) * 0.01f) - ray.origin);
+            float3 rayToLight = normalize((spotLight.position + getRandomVector(generator) * 0.01f) - ray.origin);
             float cosTheta = dot(rayToLight, -spotLight.direction);
             if (cosTheta < spotLight.maxAngle)
                 continue;
@@ -496,12 +496,12 @@ void main(uint3 DTid : SV_DispatchThreadID)
         //light = material.albedo.colour;
         //break;
         
-        float metallicFactor = (material.metallic.colour * (1.f - material.roughness.colour)) >= randomFloat(seed);
-        float specularFactor = (material.specular.colour * (1.f - material.roughness.colour)) >= randomFloat(seed);
-        float transparencyFactor = material.transparency >= randomFloat(seed);
+        float metallicFactor = (material.metallic.colour * (1.f - material.roughness.colour)) >= nextSample(generator);
+        float specularFactor = (material.specular.colour * (1.f - material.roughness.colour)) >= nextSample(generator);
+        float transparencyFactor = material.transparency >= nextSample(generator);
         
-        float3 reflectDir = findReflectDirection(ray.direction, hitData.worldNormal, material.roughness.colour * (1.f - specularFactor), seed);
-        float3 refractDir = findTransparencyBounce(ray.direction, hitData.worldNormal, material.indexOfRefraction, seed);
+        float3 reflectDir = findReflectDirection(ray.direction, hitData.worldNormal, material.roughness.colour * (1.f - specularFactor), generator);
+        float3 refractDir = findTransparencyBounce(ray.direction, hitData.worldNormal, material.indexOfRefraction, generator);
         
         float3 bounceDir = normalize(lerp(reflectDir, refractDir, transparencyFactor));
         float3 hitPoint = hitData.worldPosition + bounceDir * 0.001f;
@@ -511,6 +511,17 @@ void main(uint3 DTid : SV_DispatchThreadID)
        
         ray.origin = hitPoint;
         ray.direction = bounceDir;
+        
+        // Russian roulette, paths that can't contribute much are terminated early
+        // Surviving paths are boosted to keep the result unbiased
+        if (renderData.russianRouletteEnabled == 1 && i >= renderData.russianRouletteStartBounce)
+        {
+            float survivalChance = clamp(max(contribution.r, max(contribution.g, contribution.b)), MIN_SURVIVAL_CHANCE, 1.f);
+            if (nextSample(generator) > survivalChance)
+                break;
+            
+            contribution /= survivalChance;
+        }
     }
     
     uint debugModeMaxCount = renderData.debugMaxCount;
@@ -522,16 +533,28 @@ void main(uint3 DTid : SV_DispatchThreadID)
     float gamma = 2.f;
     //light = pow(light, float3(gamma, gamma, gamma));
     
+    if (renderData.motionPixelStride > 1)
+    {
+        motionBuffer[DTid.xy] = float4(saturate(light), 1.f);
+        return;
+    }
+    
     float4 result;
     if (renderData.accumulationEnabled == 1)
     {
-        accumulationBuffer[DTid.xy] += float4(light, 1.f);
-        result = saturate(accumulationBuffer[DTid.xy] / (float) renderData.numAccumulationFrames);
+        // The alpha channel holds the number of samples taken for this pixel
+        float4 accumulated = accumulationBuffer[pixelId] + float4(light, 1.f);
+        accumulationBuffer[pixelId] = accumulated;
+        
+        float lightLuminance = luminance(light);
+        secondMomentBuffer[pixelId] += lightLuminance * lightLuminance;
+        
+        result = saturate(accumulated / accumulated.a);
     }
     else
     {
         result = float4(saturate(light), 1.f);
     }
     
-    resultBuffer[DTid.xy] = result;
+    resultBuffer[pixelId] = result;
 }
\ No newline at end of file
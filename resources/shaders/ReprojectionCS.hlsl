@@ -0,0 +1,82 @@
+#include "GPU-Utilities.hlsli"
+#include "ShaderResourceRegisters.h"
+
+/*
+    Carries the accumulation over to a new camera view instead of throwing it away.
+    Runs after RaytracerCS on frames where the camera moved, so the accumulation only holds this frame's sample.
+    Every pixel looks up where its first hit was in the previous view and adds the history from there,
+    unless the G-buffers show a different surface at that pixel (disocclusion).
+    Port of source/Graphics/Reprojection.cpp, which the CPU tracer uses
+*/
+
+RWTexture2D<unorm float4> resultBuffer : register(RESULT_BUFFER_GPU_REG);
+RWTexture2D<float4> accumulationBuffer : register(ACCUMULATION_BUFFER_GPU_REG);
+RWTexture2D<float> secondMomentBuffer : register(SECOND_MOMENT_BUFFER_GPU_REG);
+RWTexture2D<float4> gBufferNormalDepth : register(GBUFFER_NORMAL_DEPTH_GPU_REG);
+RWTexture2D<float4> gBufferPositionInstance : register(GBUFFER_POSITION_INSTANCE_GPU_REG);
+
+Texture2D<float4> historyAccumulation : register(HISTORY_ACCUMULATION_GPU_REG);
+Texture2D<float> historySecondMoment : register(HISTORY_SECOND_MOMENT_GPU_REG);
+Texture2D<float4> prevGBufferNormalDepth : register(PREV_GBUFFER_NORMAL_DEPTH_GPU_REG);
+Texture2D<float4> prevGBufferPositionInstance : register(PREV_GBUFFER_POSITION_INSTANCE_GPU_REG);
+
+cbuffer RenderDataBuffer : register(RENDER_DATA_GPU_REG)
+{
+    RenderData renderData;
+}
+
+bool worldToPreviousPixel(float3 worldPosition, out float2 pixel)
+{
+    float4 clip = mul(float4(worldPosition, 1.f), renderData.previousViewProjectionMatrix);
+    pixel = float2(clip.x / clip.w + 1.f, 1.f - clip.y / clip.w) * 0.5f * (float2)renderData.textureDims;
+    return clip.w > 0.f;
+}
+
+bool findHistoryPixel(uint2 pixelId, out int2 prevPixel)
+{
+    prevPixel = int2(0, 0);
+
+    // The world position is where the traced ray hit, rebuilding it from the depth would ignore the AA jitter and DOF
+    float4 positionInstance = gBufferPositionInstance[pixelId];
+    if (positionInstance.w < 0.f)
+        return false;
+
+    float2 prevPixelPos;
+    if (!worldToPreviousPixel(positionInstance.xyz, prevPixelPos))
+        return false;
+
+    prevPixel = (int2)floor(prevPixelPos + 0.5f);
+    if (any(prevPixel < 0) || any(prevPixel >= (int2)renderData.textureDims))
+        return false;
+
+    float4 prevPositionInstance = prevGBufferPositionInstance[prevPixel];
+
+    // Both distances are from the previous camera, something in front of the surface means it was occluded
+    float distance = length(positionInstance.xyz - renderData.previousCameraPosition);
+    float prevDistance = length(prevPositionInstance.xyz - renderData.previousCameraPosition);
+
+    return prevPositionInstance.w == positionInstance.w &&
+        dot(gBufferNormalDepth[pixelId].xyz, prevGBufferNormalDepth[prevPixel].xyz) >= renderData.reprojectionNormalThreshold &&
+        abs(prevDistance - distance) <= renderData.reprojectionDepthTolerance * distance;
+}
+
+[numthreads(THREAD_GROUP_SIZE_X, THREAD_GROUP_SIZE_Y, 1)]
+void main(uint3 DTid : SV_DispatchThreadID)
+{
+    uint2 pixelId = DTid.xy;
+    float4 accumulated = accumulationBuffer[pixelId];
+
+    int2 prevPixel;
+    if (findHistoryPixel(pixelId, prevPixel))
+    {
+        // Caps how many samples the history counts as, so shading changes from the new view still come through
+        float4 history = historyAccumulation[prevPixel];
+        float historyWeight = history.a > renderData.maxHistorySamples ? renderData.maxHistorySamples / history.a : 1.f;
+
+        accumulated += history * historyWeight;
+        accumulationBuffer[pixelId] = accumulated;
+        secondMomentBuffer[pixelId] += historySecondMoment[prevPixel] * historyWeight;
+    }
+
+    resultBuffer[pixelId] = accumulated.a > 0.f ? saturate(accumulated / accumulated.a) : float4(0.f, 0.f, 0.f, 1.f);
+}
\ No newline at end of file
@@ -0,0 +1,123 @@
+// GPU side of source/Graphics/Sampler.h, both produce the same sequences
+// Include after GPU-Utilities.hlsli & ShaderResourceRegisters.h
+
+#define SAMPLER_RANDOM 0
+#define SAMPLER_SOBOL 1
+#define SAMPLER_BLUE_NOISE 2
+
+Texture2D<float> blueNoise : register(BLUE_NOISE_GPU_REG);
+
+struct Sampler
+{
+    uint type;
+    uint2 pixel;
+    uint seed;
+    uint sampleIdx;
+    uint dimension;
+};
+
+Sampler createSampler(uint type, uint2 pixel, uint width, uint sampleIdx)
+{
+    Sampler generator;
+    generator.type = type;
+    generator.pixel = pixel;
+    generator.sampleIdx = sampleIdx;
+    generator.dimension = 0u;
+
+    if (type == SAMPLER_RANDOM)
+        generator.seed = pixel.x + (pixel.y + 74813) * width * (sampleIdx + 1);
+    else
+        generator.seed = pcg_hash2(pixel.x + pixel.y * width);
+
+    return generator;
+}
+
+// Ty Burley, "Practical Hash-based Owen Scrambling"
+uint laineKarrasPermutation(uint x, uint seed)
+{
+    x += seed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+    return x;
+}
+
+uint nestedUniformScramble(uint x, uint seed)
+{
+    return reversebits(laineKarrasPermutation(reversebits(x), seed));
+}
+
+// The first Sobol dimension is just reversebits(index), the second one has direction numbers v[i+1] = v[i] ^ (v[i] >> 1)
+uint sobolSecondDimension(uint index)
+{
+    uint result = 0u;
+    uint direction = 1u << 31u;
+
+    for (; index; index >>= 1u)
+    {
+        if (index & 1u)
+            result ^= direction;
+
+        direction ^= direction >> 1u;
+    }
+
+    return result;
+}
+
+float toUnitFloat(uint bits)
+{
+    // Top 24 bits so the result never rounds up to 1
+    return (bits >> 8u) * (1.f / 16777216.f);
+}
+
+// Uniform sample in [0, 1), every call moves on to the next dimension
+float nextSample(inout Sampler generator)
+{
+    float value = 0.f;
+
+    if (generator.type == SAMPLER_SOBOL)
+    {
+        // Every pair of dimensions gets its own shuffled & scrambled 2D Sobol sequence
+        uint component = generator.dimension & 1u;
+        uint pairSeed = pcg_hash2(generator.seed ^ pcg_hash2(generator.dimension >> 1u));
+        uint index = nestedUniformScramble(generator.sampleIdx, pairSeed);
+
+        uint bits = component ? sobolSecondDimension(index) : reversebits(index);
+        bits = nestedUniformScramble(bits, pcg_hash2(pairSeed + component + 1u));
+
+        value = toUnitFloat(bits);
+    }
+    else if (generator.type == SAMPLER_BLUE_NOISE)
+    {
+        // R2 sequence offsets the tile per dimension, golden ratio rotation per sample
+        float2 offset = float2(generator.dimension * 0xC13FA9A9u, generator.dimension * 0x91E10DA5u) * (1.f / 4294967296.f);
+        uint2 texel = (generator.pixel + uint2(offset * BLUE_NOISE_TILE_SIZE)) % BLUE_NOISE_TILE_SIZE;
+
+        float rotation = toUnitFloat(generator.sampleIdx * 0x9E3779B9u);
+        value = frac(blueNoise[texel] + rotation);
+    }
+    else
+    {
+        value = randomFloat(generator.seed);
+    }
+
+    generator.dimension++;
+    return value;
+}
+
+float2 randomPointInCircle(inout Sampler generator)
+{
+    float angle = nextSample(generator) * 2.f * PI;
+    float2 pointOnCircle = float2(cos(angle), sin(angle));
+    return pointOnCircle * sqrt(nextSample(generator));
+}
+
+float3 getRandomVector(inout Sampler generator)
+{
+    // Two dimensions instead of three normal distributions keeps the low discrepancy samplers well stratified
+    float z = 1.f - 2.f * nextSample(generator);
+    float angle = nextSample(generator) * 2.f * PI;
+    float radius = sqrt(max(1.f - z * z, 0.f));
+    return float3(cos(angle) * radius, sin(angle) * radius, z);
+}
\ No newline at end of file
@@ -1,15 +1,26 @@
 
-#define NUM_U_REGISTERS 2u
+#define NUM_U_REGISTERS 8u
 #define NUM_B_REGISTERS 1u
-#define NUM_T_REGISTERS 11u
+#define NUM_T_REGISTERS 24u
+
+// Thread group size of the raytracing shader, also used as the tile size for adaptive sampling
+#define THREAD_GROUP_SIZE_X 16
+#define THREAD_GROUP_SIZE_Y 9
+
+// Width & height of the blue noise texture used by the blue noise sampler
+#define BLUE_NOISE_TILE_SIZE 64u
+
+// Textures are packed into atlas pages of a few size classes, pages of class i are TEXTURE_ATLAS_MIN_PAGE_SIZE << i texels wide & high
+#define NUM_TEXTURE_ATLAS_CLASSES 5u
+#define TEXTURE_ATLAS_MIN_PAGE_SIZE 256u
 
 
 // ---  CPU Slots ---
 // t register
-#define TRIANGLE_POS_SLOT 0
-#define TRIANGLE_INFO_SLOT 1
+#define VERTEX_POS_SLOT 0
+#define VERTEX_INFO_SLOT 1
 #define BVH_TREE_SLOT 2
-#define TEXTURES_SLOT 3
+#define TEXTURE_RECORDS_SLOT 3
 #define ENVIRONMENT_MAP_SLOT 4
 #define OCT_TREE_CPU_SLOT 5
 
@@ -18,6 +29,15 @@
 #define DIRECTIONAL_LIGHT_DATA_SLOT 8
 #define POINT_LIGHT_DATA_SLOT 9
 #define SPOT_LIGHT_DATA_SLOT 10
+#define ACTIVE_TILES_SLOT 11
+#define BLUE_NOISE_SLOT 12
+#define HISTORY_ACCUMULATION_SLOT 13
+#define HISTORY_SECOND_MOMENT_SLOT 14
+#define PREV_GBUFFER_NORMAL_DEPTH_SLOT 15
+#define PREV_GBUFFER_POSITION_INSTANCE_SLOT 16
+#define TRIANGLE_INDEX_SLOT 17
+#define HIT_TRIANGLE_SLOT 18
+#define TEXTURE_ATLAS_SLOT 19 // One per size class, up to 23
 
 
 // b register
@@ -27,14 +47,20 @@
 // u register
 #define RESULT_BUFFER_SLOT 0
 #define ACCUMULATION_BUFFER_SLOT 1
+#define SECOND_MOMENT_BUFFER_SLOT 2
+#define ACTIVE_TILES_APPEND_SLOT 3
+#define MOTION_BUFFER_SLOT 4
+#define GBUFFER_NORMAL_DEPTH_SLOT 5
+#define GBUFFER_POSITION_INSTANCE_SLOT 6
+#define GBUFFER_ALBEDO_SLOT 7
 
 
 // --- GPU Registers ---
 // t register
-#define TRIANGLE_POS_GPU_REG t0 // Writing t[RM_TRIANGLE_DATA_SLOT] compiles and runs, but shows "errors" in RaytracerCS.hlsl
-#define TRIANGLE_INFO_GPU_REG t1
+#define VERTEX_POS_GPU_REG t0 // Writing t[RM_TRIANGLE_DATA_SLOT] compiles and runs, but shows "errors" in RaytracerCS.hlsl
+#define VERTEX_INFO_GPU_REG t1
 #define BVH_TREE_GPU_REG t2
-#define TEXTURES_GPU_REG t3
+#define TEXTURE_RECORDS_GPU_REG t3
 #define ENVIRONMENT_MAP_GPU_REG t4
 #define OCT_TREE_GPU_REG t5
 
@@ -43,6 +69,19 @@
 #define DIRECTIONAL_LIGHT_DATA_GPU_REG t8
 #define POINT_LIGHT_DATA_GPU_REG t9
 #define SPOT_LIGHT_DATA_GPU_REG t10
+#define ACTIVE_TILES_GPU_REG t11
+#define BLUE_NOISE_GPU_REG t12
+#define HISTORY_ACCUMULATION_GPU_REG t13
+#define HISTORY_SECOND_MOMENT_GPU_REG t14
+#define PREV_GBUFFER_NORMAL_DEPTH_GPU_REG t15
+#define PREV_GBUFFER_POSITION_INSTANCE_GPU_REG t16
+#define TRIANGLE_INDEX_GPU_REG t17
+#define HIT_TRIANGLE_GPU_REG t18
+#define TEXTURE_ATLAS_0_GPU_REG t19
+#define TEXTURE_ATLAS_1_GPU_REG t20
+#define TEXTURE_ATLAS_2_GPU_REG t21
+#define TEXTURE_ATLAS_3_GPU_REG t22
+#define TEXTURE_ATLAS_4_GPU_REG t23
 
 // b register
 #define RENDER_DATA_GPU_REG b0
@@ -50,4 +89,10 @@
 
 // u register
 #define RESULT_BUFFER_GPU_REG u0
-#define ACCUMULATION_BUFFER_GPU_REG u1
\ No newline at end of file
+#define ACCUMULATION_BUFFER_GPU_REG u1
+#define SECOND_MOMENT_BUFFER_GPU_REG u2
+#define ACTIVE_TILES_APPEND_GPU_REG u3
+#define MOTION_BUFFER_GPU_REG u4
+#define GBUFFER_NORMAL_DEPTH_GPU_REG u5
+#define GBUFFER_POSITION_INSTANCE_GPU_REG u6
+#define GBUFFER_ALBEDO_GPU_REG u7
\ No newline at end of file
@@ -0,0 +1,45 @@
+// GPU side of source/Graphics/TextureAtlas.h, textures are looked up through their record and sampled out of their size class' pages
+// Include after GPU-Utilities.hlsli & ShaderResourceRegisters.h
+
+StructuredBuffer<TextureAtlasRecord> textureRecords : register(TEXTURE_RECORDS_GPU_REG);
+Texture2DArray<unorm float4> textureAtlas0 : register(TEXTURE_ATLAS_0_GPU_REG);
+Texture2DArray<unorm float4> textureAtlas1 : register(TEXTURE_ATLAS_1_GPU_REG);
+Texture2DArray<unorm float4> textureAtlas2 : register(TEXTURE_ATLAS_2_GPU_REG);
+Texture2DArray<unorm float4> textureAtlas3 : register(TEXTURE_ATLAS_3_GPU_REG);
+Texture2DArray<unorm float4> textureAtlas4 : register(TEXTURE_ATLAS_4_GPU_REG);
+
+float3 loadAtlasBilinear(Texture2DArray<unorm float4> atlas, TextureAtlasRecord record, uint2 texel0, uint2 texel1, float2 weights)
+{
+    float3 topLeft = atlas.Load(int4(record.offset + uint2(texel0.x, texel0.y), record.page, 0)).rgb;
+    float3 topRight = atlas.Load(int4(record.offset + uint2(texel1.x, texel0.y), record.page, 0)).rgb;
+    float3 bottomLeft = atlas.Load(int4(record.offset + uint2(texel0.x, texel1.y), record.page, 0)).rgb;
+    float3 bottomRight = atlas.Load(int4(record.offset + uint2(texel1.x, texel1.y), record.page, 0)).rgb;
+    
+    return lerp(lerp(topLeft, topRight, weights.x), lerp(bottomLeft, bottomRight, weights.x), weights.y);
+}
+
+/*
+    Bilinear with wrapping like the old linear wrap sampler. Done by hand with loads, a sampler would wrap
+    around the whole page and filter in texels of the neighbouring textures.
+*/
+float3 sampleTexture(uint textureIdx, float2 uvs)
+{
+    TextureAtlasRecord record = textureRecords[textureIdx];
+    
+    float2 texelPos = frac(uvs) * float2(record.size) - 0.5f;
+    float2 texelFloor = floor(texelPos);
+    float2 weights = texelPos - texelFloor;
+    
+    // texelFloor is in [-1, size - 1]
+    uint2 texel0 = uint2(int2(texelFloor) + int2(record.size)) % record.size;
+    uint2 texel1 = (texel0 + 1u) % record.size;
+    
+    switch (record.sizeClass)
+    {
+        case 0u: return loadAtlasBilinear(textureAtlas0, record, texel0, texel1, weights);
+        case 1u: return loadAtlasBilinear(textureAtlas1, record, texel0, texel1, weights);
+        case 2u: return loadAtlasBilinear(textureAtlas2, record, texel0, texel1, weights);
+        case 3u: return loadAtlasBilinear(textureAtlas3, record, texel0, texel1, weights);
+        default: return loadAtlasBilinear(textureAtlas4, record, texel0, texel1, weights);
+    }
+}
\ No newline at end of file
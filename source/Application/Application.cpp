@@ -5,13 +5,14 @@
 #include "Scene/Entity.h"
 #include "Input.h"
 
-#define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb/stb_image_write.h"
 
 #include "glm/gtx/quaternion.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 #include "glm/gtc/type_ptr.hpp"
 
+// Completed async loads are held back at most this long while more are still loading, in seconds
+static const float APPLY_LOADS_INTERVAL = 1.f;
 
 Application::Application()
 	:m_accumulationTime(0.f), m_debugSelectedBvhNodeIdx(Okay::INVALID_UINT), m_debugSelectedOctNodeIdx(Okay::INVALID_UINT)
@@ -27,6 +28,11 @@ Application::Application()
 
 	m_target.initiate(1600u, 900u, TextureFormat::F_8X4);
 
+	// Loaded in the background, with the trees built for the settings the tracers rebuild with when they arrive
+	ResourceManager::ImportSettings& importSettings = m_resourceManager.getImportSettings();
+	importSettings.bvhMaxLeafTriangles = m_maxBvhLeafTriangles;
+	importSettings.bvhMaxDepth = m_maxBvhDepth;
+
 	m_resourceManager.loadMesh("resources/meshes/cube.fbx");
 	//m_resourceManager.loadTexture("resources/textures/wood/whnfeb2_2K_Albedo.jpg");
 	//m_resourceManager.loadTexture("resources/textures/wood/whnfeb2_2K_Roughness.jpg");
@@ -108,14 +114,29 @@ void Application::run()
 		m_window.processMessages();
 		Okay::newFrameImGui();
 
+		applyCompletedLoads();
+
 		updateImGui();
 		updateCamera();
 
+		if (m_measuringConvergence)
+			updateConvergenceMeasurement();
+
 		if (m_useRasterizer)
 			m_debugRenderer.render(m_rasterizerDrawObjects);
+		else if (m_useCPURayTracer)
+			m_cpuRayTracer.update();
 		else
 			m_rayTracer.render();
 
+		// Motion frames only hold one sample per pixel and some of it is reprojected, the CPU ones don't count as samples
+		const bool denoiseReady = m_useCPURayTracer ? m_cpuRayTracer.getNumAccumulationFrames() > 0u : !m_rayTracer.isMotionFrame();
+
+		if (m_denoiseEnabled && !m_useRasterizer && denoiseReady)
+			denoiseTarget();
+		else if (m_useCPURayTracer && !m_useRasterizer)
+			uploadToTarget(m_cpuRayTracer.getResolvedPixels());
+
 		if (m_drawNodeGeometry)
 			m_debugRenderer.renderBvhNodeGeometry(m_debugSelectedEntity, m_debugSelectedBvhNodeIdx);
 		if (m_drawBvhNodeBBs)
@@ -130,25 +151,63 @@ void Application::run()
 
 void Application::loadMeshesAsEntities(std::string_view filePath, std::string_view texturesPath, float scale)
 {
-	std::vector<ResourceManager::ObjectDecription> objectDescriptions;
-	bool success = m_resourceManager.importAssets(filePath, objectDescriptions, texturesPath, scale);
-	OKAY_ASSERT(success);
+	// The entities are created by applyCompletedLoads() once the import is done
+	m_resourceManager.importAssetsAsync(filePath, [this](const std::vector<ResourceManager::ObjectDecription>& objectDescriptions)
+		{
+			for (const ResourceManager::ObjectDecription& objectDesc : objectDescriptions)
+			{
+				Entity entity = m_scene.createEntity();
+				MeshComponent& meshComp = entity.addComponent<MeshComponent>();
+				Material& material = meshComp.material;
+
+				meshComp.meshID = objectDesc.meshId;
+				material.albedo.textureId = objectDesc.albedoTextureId;
+				material.roughness.textureId = objectDesc.rougnessTextureId;
+				material.metallic.textureId = objectDesc.metallicTextureId;
+				material.specular.textureId = objectDesc.specularTextureId;
+				material.normalMapIdx = objectDesc.normalTextureId;
+
+				entity.getComponent<Transform>().position = objectDesc.position;
+			}
+		}, texturesPath, scale);
+}
+
+void Application::applyCompletedLoads()
+{
+	if (!m_resourceManager.hasCompletedLoads())
+		return;
+
+	// The tracers only get what was added, but every apply still restarts the accumulation and rebuilds the oct tree.
+	// The loader finishes one request at a time, so instead of applying each as it arrives they're batched until it's idle,
+	// a long queue still shows up every APPLY_LOADS_INTERVAL
+	m_timeSinceAppliedLoads += ImGui::GetIO().DeltaTime;
+	if (m_resourceManager.isLoading() && m_timeSinceAppliedLoads < APPLY_LOADS_INTERVAL)
+		return;
+
+	m_timeSinceAppliedLoads = 0.f;
+
+	// The CPU tracer's workers read the meshes & textures, they're stopped before anything is swapped in
+	m_cpuRayTracer.resetAccumulation();
+
+	const ResourceManager::CompletedLoads completedLoads = m_resourceManager.processCompletedLoads();
 
-	for (uint32_t i = 0; i < (uint32_t)objectDescriptions.size(); i++)
+	// Only the new meshes & textures are uploaded, the replaced placeholders' descriptors and atlas records are patched to point at them.
+	// The new meshes come with prebuilt trees when they were loaded with the tracers' BVH settings
+	if (completedLoads.numMeshes)
 	{
-		ResourceManager::ObjectDecription& objectDesc = objectDescriptions[i];
-
-		Entity entity = m_scene.createEntity();
-		MeshComponent& meshComp = entity.addComponent<MeshComponent>();
-		Material& material = meshComp.material;
-
-		meshComp.meshID = objectDesc.meshId;
-		material.albedo.textureId = objectDesc.albedoTextureId;
-		material.roughness.textureId = objectDesc.rougnessTextureId;
-		material.metallic.textureId = objectDesc.metallicTextureId;
-		material.specular.textureId = objectDesc.specularTextureId;
-		material.normalMapIdx = objectDesc.normalTextureId;
+		m_rayTracer.appendMeshAndBvhData(completedLoads.replacedMeshes);
+
+		if (m_cpuRayTracer.getImageDims() != glm::uvec2(0u))
+			m_cpuRayTracer.appendMeshAndBvhData(completedLoads.replacedMeshes);
 	}
+
+	if (completedLoads.numTextures)
+		m_rayTracer.appendTextureData(completedLoads.replacedTextures);
+
+	// Imports add entities and replaced placeholders change the bounds
+	m_rayTracer.createOctTree(m_scene, m_maxCullingTreeDepth, m_maxCullingTreeLeafEntities);
+	m_rayTracer.resetAccumulation();
+	m_accumulationTime = 0.f;
 }
 
 void Application::displayComponents(Entity entity)
@@ -312,6 +371,7 @@ void Application::displayComponents(Entity entity)
 	if (resetAcu)
 	{
 		m_rayTracer.resetAccumulation();
+		m_cpuRayTracer.resetAccumulation();
 		m_rayTracer.createOctTree(m_scene, m_maxCullingTreeDepth, m_maxCullingTreeLeafEntities);
 		m_accumulationTime = 0.f;
 	}
@@ -372,6 +432,12 @@ void Application::updateImGui()
 		ImGui::Text("FPS: %.3f (%.3f)", avgFpsDisplayValue, fps);
 		ImGui::Text("MS: %.3f (%.3f)", avgMsDisplayValue, ms);
 
+		if (const uint32_t numPendingLoads = m_resourceManager.getNumPendingLoads())
+			ImGui::Text("Loading: %u assets", numPendingLoads);
+
+		const Okay::TextureMemoryStats textureMemory = Okay::getTextureMemoryStats();
+		ImGui::Text("Textures: %.1f MB (%.1f MB reserved)", textureMemory.allocatedBytes / (1024.0 * 1024.0), textureMemory.reservedBytes / (1024.0 * 1024.0));
+
 		ImGui::Separator();
 
 		static const char* resolutionLables[] = { "1024x576", "1600x900", "1920x1080", "3840x2160", "7680x4320" };
@@ -510,12 +576,160 @@ void Application::updateImGui()
 
 			if (ImGui::Button("Reset Accumulation")) resetAcu = true;
 
+			static bool motionMode = false;
+			static int motionPixelStride = 2;
+			if (ImGui::Checkbox("Motion Mode", &motionMode))
+			{
+				m_rayTracer.toggleMotionMode(motionMode);
+			}
+
+			ImGui::BeginDisabled(!motionMode);
+			bool strideChanged = ImGui::RadioButton("1/4 Pixels", &motionPixelStride, 2);
+			ImGui::SameLine();
+			strideChanged |= ImGui::RadioButton("1/16 Pixels", &motionPixelStride, 4);
+			if (strideChanged)
+			{
+				m_rayTracer.setMotionPixelStride((uint32_t)motionPixelStride);
+			}
+			ImGui::EndDisabled();
+
+			static bool reprojection = false;
+			if (ImGui::Checkbox("Temporal Reprojection", &reprojection))
+			{
+				m_rayTracer.toggleReprojection(reprojection);
+			}
+
+			ImGui::BeginDisabled(!reprojection);
+			ImGui::DragFloat("Max History Samples", &m_rayTracer.getMaxHistorySamples(), 0.5f, 1.f, 4096.f);
+			ImGui::DragFloat("Normal Threshold", &m_rayTracer.getReprojectionNormalThreshold(), 0.005f, -1.f, 1.f);
+			ImGui::DragFloat("Depth Tolerance", &m_rayTracer.getReprojectionDepthTolerance(), 0.001f, 0.f, 1.f);
+			ImGui::EndDisabled();
+
+			ImGui::Separator();
+
+			static bool adaptiveSampling = false;
+			if (ImGui::Checkbox("Adaptive Sampling", &adaptiveSampling))
+			{
+				m_rayTracer.toggleAdaptiveSampling(adaptiveSampling);
+				resetAcu = true;
+			}
+
+			ImGui::BeginDisabled(!adaptiveSampling);
+			ImGui::DragInt("Min Samples", (int*)&m_rayTracer.getAdaptiveMinSamples(), 0.2f, 2, 4096);
+			ImGui::DragFloat("Error Threshold", &m_rayTracer.getAdaptiveErrorThreshold(), 0.0005f, 0.f, 1.f, "%.4f");
+			ImGui::DragInt("Tile Update Interval", (int*)&m_rayTracer.getAdaptiveUpdateInterval(), 0.1f, 1, 256);
+			ImGui::EndDisabled();
+
+			ImGui::Separator();
+
+			static const char* samplerLabels[] = { "Random", "Sobol", "Blue Noise" };
+			static int samplerType = Sampler::Type::Random;
+			if (ImGui::Combo("Sampler", &samplerType, samplerLabels, IM_ARRAYSIZE(samplerLabels)))
+			{
+				m_rayTracer.setSamplerType(Sampler::Type(samplerType));
+				resetAcu = true;
+			}
+
+			if (ImGui::Button("Capture Reference"))
+			{
+				m_rayTracer.readAccumulation(m_convergenceReference);
+				m_convergenceReferenceSamples = m_rayTracer.getNumAccumulationFrames();
+				printf("Captured convergence reference with %u samples\n", m_convergenceReferenceSamples);
+			}
+
+			ImGui::SameLine();
+			ImGui::BeginDisabled(m_convergenceReference.empty());
+			if (ImGui::Button(m_measuringConvergence ? "Stop Measuring" : "Measure RMSE"))
+			{
+				m_measuringConvergence = !m_measuringConvergence;
+				m_convergenceLog2RMSE.clear();
+				resetAcu = true;
+			}
+			ImGui::EndDisabled();
+
+			if (m_convergenceLog2RMSE.size())
+				ImGui::PlotLines("RMSE (log2)", m_convergenceLog2RMSE.data(), (int)m_convergenceLog2RMSE.size());
+
+			ImGui::Separator();
+
+			Denoiser::Settings& denoiseSettings = m_denoiser.getSettings();
+			ImGui::Checkbox("Denoise (CPU)", &m_denoiseEnabled);
+
+			ImGui::BeginDisabled(!m_denoiseEnabled);
+			ImGui::DragInt("Filter Iterations", (int*)&denoiseSettings.numIterations, 0.05f, 1, 8);
+			ImGui::DragFloat("Colour Sigma", &denoiseSettings.colourSigma, 0.005f, 0.001f, 10.f);
+			ImGui::DragFloat("Normal Power", &denoiseSettings.normalPower, 0.5f, 0.f, 256.f);
+			ImGui::DragFloat("Depth Sigma", &denoiseSettings.depthSigma, 0.001f, 0.001f, 1.f);
+			ImGui::Text("Denoise MS: %.3f", m_denoiser.getLastDenoiseTime());
+			ImGui::EndDisabled();
+
+			if (ImGui::Button("Benchmark Denoiser"))
+			{
+				benchmarkDenoiser(20u);
+			}
+
+			ImGui::Separator();
+
+			static bool russianRoulette = true;
+			if (ImGui::DragInt("Max Bounces", (int*)&m_rayTracer.getMaxBounces(), 0.1f, 0, 64)) resetAcu = true;
+			if (ImGui::Checkbox("Russian Roulette", &russianRoulette))
+			{
+				m_rayTracer.toggleRussianRoulette(russianRoulette);
+				resetAcu = true;
+			}
+
+			ImGui::BeginDisabled(!russianRoulette);
+			if (ImGui::DragInt("RR Start Bounce", (int*)&m_rayTracer.getRussianRouletteStartBounce(), 0.1f, 0, 64)) resetAcu = true;
+			ImGui::EndDisabled();
+
 			ImGui::Separator();
 
 			if (ImGui::DragFloat("DOF Strength", &m_rayTracer.getDOFStrength(), 0.05f, 0.f, 10.f)) resetAcu = true;
 			if (ImGui::DragFloat("DOF Distance", &m_rayTracer.getDOFDistance(), 0.05f, 0.f, 1000.f)) resetAcu = true;
 
 			ImGui::Separator();
+
+			// The CPU tracer uses the same settings as the GPU one
+			if (ImGui::Checkbox("CPU Reference", &m_useCPURayTracer))
+			{
+				if (m_useCPURayTracer && m_cpuRayTracer.getImageDims() == glm::uvec2(0u))
+				{
+					m_cpuRayTracer.initiate(m_resourceManager, m_target.getDimensions(), "resources/environmentMaps/Skybox2.jpg");
+					m_cpuRayTracer.setScene(m_scene);
+				}
+				resetAcu = true;
+			}
+
+			CPURayTracer::Settings& cpuSettings = m_cpuRayTracer.getSettings();
+			cpuSettings.maxBounces = m_rayTracer.getMaxBounces();
+			cpuSettings.russianRouletteEnabled = russianRoulette;
+			cpuSettings.russianRouletteStartBounce = m_rayTracer.getRussianRouletteStartBounce();
+			cpuSettings.dofStrength = m_rayTracer.getDOFStrength();
+			cpuSettings.dofDistance = m_rayTracer.getDOFDistance();
+			cpuSettings.samplerType = Sampler::Type(samplerType);
+			cpuSettings.adaptiveSamplingEnabled = adaptiveSampling;
+			cpuSettings.adaptiveMinSamples = m_rayTracer.getAdaptiveMinSamples();
+			cpuSettings.adaptiveErrorThreshold = m_rayTracer.getAdaptiveErrorThreshold();
+			cpuSettings.adaptiveUpdateInterval = m_rayTracer.getAdaptiveUpdateInterval();
+			cpuSettings.reprojectionEnabled = reprojection;
+			cpuSettings.reprojection.maxHistorySamples = m_rayTracer.getMaxHistorySamples();
+			cpuSettings.reprojection.normalThreshold = m_rayTracer.getReprojectionNormalThreshold();
+			cpuSettings.reprojection.depthTolerance = m_rayTracer.getReprojectionDepthTolerance();
+			cpuSettings.motionModeEnabled = motionMode;
+			cpuSettings.motionPixelStride = (uint32_t)motionPixelStride;
+
+			ImGui::BeginDisabled(!m_useCPURayTracer);
+			const CPURayTracer::FrameStats& cpuStats = m_cpuRayTracer.getLastFrameStats();
+			ImGui::Text("CPU Samples: %u", m_cpuRayTracer.getNumAccumulationFrames());
+			ImGui::Text("CPU Frame MS: %.3f (%u workers)", cpuStats.frameTime, m_cpuRayTracer.getScheduler().getNumWorkers());
+			ImGui::Text("Rays: %llu (%.2f MRays/s)", (unsigned long long)cpuStats.numRays, cpuStats.frameTime > 0.f ? cpuStats.numRays / (cpuStats.frameTime * 1000.f) : 0.f);
+			ImGui::Text("Stolen Tiles: %u / %u", cpuStats.numStolenTiles, cpuStats.numTiles);
+			ImGui::Text("Active Tiles: %u / %u", cpuStats.numActiveTiles, cpuStats.numTiles);
+			ImGui::Text("Reprojected Pixels: %u", cpuStats.numReprojectedPixels);
+			ImGui::Text("Slowest Tile MS: %.3f", cpuStats.slowestTileTime);
+			ImGui::EndDisabled();
+
+			ImGui::Separator();
 		}
 
 		ImGui::PopItemWidth();
@@ -580,6 +794,7 @@ void Application::updateImGui()
 	if (resetAcu)
 	{
 		m_rayTracer.resetAccumulation();
+		m_cpuRayTracer.resetAccumulation();
 		m_rayTracer.createOctTree(m_scene, m_maxCullingTreeDepth, m_maxCullingTreeLeafEntities);
 		m_accumulationTime = 0.f;
 	}
@@ -610,9 +825,9 @@ void Application::updateCamera()
 
 		ImGui::PopItemWidth();
 
+		// The raytracer notices camera changes itself, so it can reproject the accumulation instead of resetting it
 		if (resetAcu)
 		{
-			m_rayTracer.resetAccumulation();
 			m_rayTracer.createOctTree(m_scene, m_maxCullingTreeDepth, m_maxCullingTreeLeafEntities);
 			m_accumulationTime = 0.f;
 		}
@@ -653,11 +868,117 @@ void Application::updateCamera()
 
 	if (xInput || yInput || zInput || mouseDelta.x || mouseDelta.y)
 	{
-		m_rayTracer.resetAccumulation();
 		m_accumulationTime = 0.f;
 	}
 }
 
+static float calculateRMSE(const std::vector<glm::vec4>& pixels, const std::vector<glm::vec4>& reference)
+{
+	double errorSum = 0.0;
+	for (size_t i = 0; i < pixels.size(); i++)
+	{
+		glm::vec3 error = glm::vec3(pixels[i] - reference[i]);
+		errorSum += (double)glm::dot(error, error);
+	}
+
+	return (float)glm::sqrt(errorSum / (pixels.size() * 3.0));
+}
+
+void Application::updateConvergenceMeasurement()
+{
+	// Only measured at powers of two, so the curves of different samplers line up
+	const uint32_t numSamples = m_rayTracer.getNumAccumulationFrames();
+	if (!numSamples || (numSamples & (numSamples - 1u)) || m_convergenceLog2RMSE.size() != (size_t)glm::log2((float)numSamples))
+		return;
+
+	std::vector<glm::vec4> pixels;
+	m_rayTracer.readAccumulation(pixels);
+
+	if (pixels.size() != m_convergenceReference.size())
+	{
+		printf("Convergence reference has a different resolution, capture a new one\n");
+		m_measuringConvergence = false;
+		return;
+	}
+
+	const float rmse = calculateRMSE(pixels, m_convergenceReference);
+	m_convergenceLog2RMSE.emplace_back(glm::log2(rmse));
+	printf("Convergence %u samples: RMSE %.6f\n", numSamples, rmse);
+
+	// Past a quarter of the reference's samples its own noise starts to dominate the error
+	if (numSamples * 4u >= m_convergenceReferenceSamples)
+		m_measuringConvergence = false;
+}
+
+void Application::uploadToTarget(const std::vector<glm::vec4>& pixels)
+{
+	const glm::uvec2 dims = m_target.getDimensions();
+	OKAY_ASSERT(pixels.size() == (size_t)dims.x * dims.y);
+
+	// m_target is 8 bit unorm, same clamp as RaytracerCS
+	std::vector<uint32_t> packedPixels(pixels.size());
+	for (size_t i = 0; i < pixels.size(); i++)
+	{
+		const glm::uvec4 colour = glm::uvec4(glm::clamp(pixels[i], 0.f, 1.f) * 255.f + 0.5f);
+		packedPixels[i] = colour.x | (colour.y << 8u) | (colour.z << 16u) | (colour.w << 24u);
+	}
+
+	Okay::getDeviceContext()->UpdateSubresource(*m_target.getBuffer(), 0u, nullptr, packedPixels.data(), dims.x * sizeof(uint32_t), 0u);
+}
+
+void Application::readDenoiseInputs()
+{
+	if (m_useCPURayTracer)
+	{
+		// The auxiliary buffers are only written by the first sample, so they're complete once it's done
+		m_denoiseColour = m_cpuRayTracer.getResolvedPixels();
+		m_denoiseAlbedo = m_cpuRayTracer.getAlbedoBuffer();
+		m_denoiseNormalDepth = m_cpuRayTracer.getNormalDepthBuffer();
+	}
+	else
+	{
+		m_rayTracer.readAccumulation(m_denoiseColour);
+		m_rayTracer.readAuxiliaryBuffers(m_denoiseAlbedo, m_denoiseNormalDepth);
+	}
+}
+
+void Application::denoiseTarget()
+{
+	readDenoiseInputs();
+
+	const glm::uvec2 dims = m_target.getDimensions();
+	m_denoiser.denoise(m_denoiseColour.data(), m_denoiseAlbedo.data(), m_denoiseNormalDepth.data(), dims.x, dims.y, m_denoisedPixels);
+
+	uploadToTarget(m_denoisedPixels);
+}
+
+void Application::benchmarkDenoiser(uint32_t numRuns)
+{
+	readDenoiseInputs();
+
+	const glm::uvec2 dims = m_target.getDimensions();
+	const uint32_t numSamples = m_useCPURayTracer ? m_cpuRayTracer.getNumAccumulationFrames() : m_rayTracer.getNumAccumulationFrames();
+
+	float totalTime = 0.f;
+	for (uint32_t i = 0; i < numRuns; i++)
+	{
+		m_denoiser.denoise(m_denoiseColour.data(), m_denoiseAlbedo.data(), m_denoiseNormalDepth.data(), dims.x, dims.y, m_denoisedPixels);
+		totalTime += m_denoiser.getLastDenoiseTime();
+	}
+
+	printf("\nDenoiser %ux%u, %u samples: %.3fms average over %u runs\n", dims.x, dims.y, numSamples, totalTime / (float)numRuns, numRuns);
+
+	// Quality against the captured reference, same metric as the convergence measurement
+	if (m_convergenceReference.size() != m_denoisedPixels.size())
+	{
+		printf("No convergence reference at this resolution, capture one (e.g. at 4096 samples) to measure RMSE\n");
+		return;
+	}
+
+	printf("RMSE vs %u sample reference: noisy %.6f, denoised %.6f\n", m_convergenceReferenceSamples,
+		calculateRMSE(m_denoiseColour, m_convergenceReference), calculateRMSE(m_denoisedPixels, m_convergenceReference));
+}
+
 void Application::saveScreenshot()
 {
 	ID3D11Texture2D* sourceBuffer = *m_target.getBuffer();
@@ -671,4 +992,4 @@ void Application::saveScreenshot()
 	stbi_write_png("render.png", (int)desc.Width, (int)desc.Height, 4, textureData, desc.Width * 4);
 
 	OKAY_DELETE_ARRAY(textureData);
-}
+}
\ No newline at end of file
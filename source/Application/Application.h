@@ -1,8 +1,10 @@
 #pragma once
 #include "Window.h"
 #include "Graphics/RayTracer.h"
+#include "Graphics/CPURayTracer.h"
 #include "Graphics/DebugRenderer.h"
 #include "Graphics/ResourceManager.h"
+#include "Graphics/Denoiser.h"
 #include "Scene/Scene.h"
 
 #include "ImGuiHelper.h"
@@ -16,19 +18,25 @@ public:
 	void run();
 
 private:
-	void loadMeshesAsEntities(std::string_view filePath, std::string_view texturesPath = "", float scale = 1.f);
+	void loadMeshesAsEntities(std::string_view filePath, std::string_view texturesPath = "", float scale = 1.f); // Async, see applyCompletedLoads()
+
+	// Called at the start of every frame, swaps in the finished async loads and updates the tracers' data
+	void applyCompletedLoads();
+	float m_timeSinceAppliedLoads = 0.f;
 
 	Window m_window;
 	RayTracer m_rayTracer;
+	CPURayTracer m_cpuRayTracer; // Initiated the first time it's enabled
+	bool m_useCPURayTracer = false;
 	Scene m_scene;
 	ResourceManager m_resourceManager;
 	RenderTexture m_target;
 
-	uint32_t m_maxBvhLeafTriangles = 5u;
-	uint32_t m_maxBvhDepth = 10u;
+	uint32_t m_maxBvhLeafTriangles = DEFAULT_BVH_MAX_LEAF_TRIANGLES;
+	uint32_t m_maxBvhDepth = DEFAULT_BVH_MAX_DEPTH;
 
-	uint32_t m_maxCullingTreeLeafEntities = 50u;
-	uint32_t m_maxCullingTreeDepth = 2u;
+	uint32_t m_maxCullingTreeLeafEntities = DEFAULT_OCT_TREE_MAX_LEAF_ENTITIES;
+	uint32_t m_maxCullingTreeDepth = DEFAULT_OCT_TREE_MAX_DEPTH;
 
 	DebugRenderer m_debugRenderer;
 	bool m_useRasterizer = false;
@@ -45,6 +53,27 @@ private:
 	void updateCamera();
 	void saveScreenshot();
 
+	// Compares the accumulation against m_convergenceReference at every power of two sample count
+	void updateConvergenceMeasurement();
+	std::vector<glm::vec4> m_convergenceReference;
+	uint32_t m_convergenceReferenceSamples = 0u;
+	std::vector<float> m_convergenceLog2RMSE;
+	bool m_measuringConvergence = false;
+
+	// Packs the pixels to 8 bit and writes them to m_target
+	void uploadToTarget(const std::vector<glm::vec4>& pixels);
+
+	// Denoises the averaged accumulation on the CPU and writes it to m_target
+	void denoiseTarget();
+	void benchmarkDenoiser(uint32_t numRuns);
+	void readDenoiseInputs(); // From the tracer on screen, into m_denoiseColour, m_denoiseAlbedo & m_denoiseNormalDepth
+	Denoiser m_denoiser;
+	bool m_denoiseEnabled = false;
+	std::vector<glm::vec4> m_denoiseColour;
+	std::vector<glm::vec4> m_denoiseAlbedo;
+	std::vector<glm::vec4> m_denoiseNormalDepth;
+	std::vector<glm::vec4> m_denoisedPixels;
+
 	void displayComponents(Entity entity);
 	Entity m_selectedEntity;
 
@@ -0,0 +1,1607 @@
+#include "Graphics/BvhBuilder.h"
+#include "Graphics/CPURayTracer.h"
+#include "Graphics/Denoiser.h"
+#include "Graphics/Importer.h"
+#include "Graphics/OctTree.h"
+#include "Graphics/ResourceManager.h"
+#include "Graphics/TextureAtlas.h"
+#include "Scene/Scene.h"
+#include "Scene/Entity.h"
+#include "Scene/Components.h"
+#include "Threading.h"
+
+#include "glm/gtc/constants.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <random>
+#include <regex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+	Benchmarks for the core: asset import (and the OBJ parser against assimp), BVH building, the instance oct tree (the TLAS),
+	CPU traversal, russian roulette, adaptive sampling, denoising, vertex packing, texture decoding and texture atlas packing.
+	Results are written as JSON in the same layout as Google Benchmark's --benchmark_out, so its
+	tools (e.g. compare.py) can diff two runs. Run from the repository root like the application.
+
+	Not covered: the scaling of textures too large for the atlas is done on the GPU by the DX11 RayTracer,
+	the CPU tracer samples textures at their own size.
+*/
+
+struct BenchmarkOptions
+{
+	std::string outputPath = "benchmark.json";
+	std::string filter = ".*";
+	std::string label;
+	std::string resourcesPath = "resources";
+	float minTime = 0.5f; // Seconds per benchmark
+	bool verbose = false; // Keep the importer's timing prints, they otherwise end up between the results
+};
+
+struct BenchmarkResult
+{
+	std::string name;
+	uint32_t iterations = 0u;
+	double realTime = 0.0; // Milliseconds per iteration
+	std::vector<std::pair<std::string, double>> counters;
+	std::string errorMessage;
+};
+
+class BenchmarkRunner
+{
+public:
+	BenchmarkRunner(const BenchmarkOptions& options)
+		:m_filter(options.filter), m_minTime(options.minTime)
+	{ }
+
+	inline bool isEnabled(const std::string& name) const { return std::regex_search(name, m_filter); }
+
+	// Calls function until minTime has passed, at least once. The function returns false to report an error
+	// Returns nullptr if the benchmark was filtered out or failed, otherwise counters can be added to the result
+	template<typename Function>
+	BenchmarkResult* run(const std::string& name, Function function)
+	{
+		static const uint32_t MAX_ITERATIONS = 1000u;
+
+		if (!isEnabled(name))
+			return nullptr;
+
+		BenchmarkResult result;
+		result.name = name;
+
+		std::chrono::duration<double> totalDuration(0.0);
+		while (result.iterations < MAX_ITERATIONS && (!result.iterations || totalDuration.count() < m_minTime))
+		{
+			result.counters.clear();
+
+			auto startTime = std::chrono::steady_clock::now();
+			const bool success = function(result);
+			totalDuration += std::chrono::steady_clock::now() - startTime;
+
+			if (!success)
+			{
+				if (result.errorMessage.empty())
+					result.errorMessage = "Failed";
+
+				printf("%-56s %s\n", name.c_str(), result.errorMessage.c_str());
+				m_results.emplace_back(std::move(result));
+				return nullptr;
+			}
+
+			result.iterations++;
+		}
+
+		result.realTime = totalDuration.count() * 1000.0 / result.iterations;
+		m_results.emplace_back(std::move(result));
+		return &m_results.back();
+	}
+
+	void printResult(const BenchmarkResult& result) const
+	{
+		printf("%-56s %12.3fms %8u ", result.name.c_str(), result.realTime, result.iterations);
+		for (const auto& [counterName, value] : result.counters)
+			printf(" %s=%.6g", counterName.c_str(), value);
+
+		printf("\n");
+	}
+
+	bool writeJson(const BenchmarkOptions& options, const char* pExecutable) const;
+
+	// Failed to run or failed their own checks, e.g. an error bound
+	inline uint32_t getNumFailed() const
+	{
+		return (uint32_t)std::count_if(m_results.begin(), m_results.end(), [](const BenchmarkResult& result) { return !result.errorMessage.empty(); });
+	}
+
+private:
+	std::regex m_filter;
+	float m_minTime;
+	std::vector<BenchmarkResult> m_results;
+};
+
+static void writeJsonString(FILE* pFile, std::string_view text)
+{
+	fputc('"', pFile);
+	for (char character : text)
+	{
+		if (character == '"' || character == '\\')
+			fputc('\\', pFile);
+
+		if ((unsigned char)character < 0x20)
+			fprintf(pFile, "\\u%04x", character);
+		else
+			fputc(character, pFile);
+	}
+	fputc('"', pFile);
+}
+
+bool BenchmarkRunner::writeJson(const BenchmarkOptions& options, const char* pExecutable) const
+{
+	FILE* pFile = fopen(options.outputPath.c_str(), "w");
+	if (!pFile)
+		return false;
+
+	char date[32]{};
+	const time_t now = time(nullptr);
+	strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+
+	fprintf(pFile, "{\n  \"context\": {\n    \"date\": ");
+	writeJsonString(pFile, date);
+	fprintf(pFile, ",\n    \"executable\": ");
+	writeJsonString(pFile, pExecutable);
+	fprintf(pFile, ",\n    \"label\": ");
+	writeJsonString(pFile, options.label);
+	fprintf(pFile, ",\n    \"num_cpus\": %u,\n", std::thread::hardware_concurrency());
+#ifdef NDEBUG
+	fprintf(pFile, "    \"library_build_type\": \"release\"\n  },\n");
+#else
+	fprintf(pFile, "    \"library_build_type\": \"debug\"\n  },\n");
+#endif
+
+	fprintf(pFile, "  \"benchmarks\": [");
+	for (size_t i = 0; i < m_results.size(); i++)
+	{
+		const BenchmarkResult& result = m_results[i];
+
+		fprintf(pFile, i ? ",\n    {\n      \"name\": " : "\n    {\n      \"name\": ");
+		writeJsonString(pFile, result.name);
+		fprintf(pFile, ",\n      \"run_name\": ");
+		writeJsonString(pFile, result.name);
+		fprintf(pFile, ",\n      \"run_type\": \"iteration\",\n      \"iterations\": %u,\n", result.iterations);
+
+		if (!result.errorMessage.empty())
+		{
+			fprintf(pFile, "      \"error_occurred\": true,\n      \"error_message\": ");
+			writeJsonString(pFile, result.errorMessage);
+			fprintf(pFile, "\n    }");
+			continue;
+		}
+
+		fprintf(pFile, "      \"real_time\": %.6f,\n      \"time_unit\": \"ms\"", result.realTime);
+		for (const auto& [counterName, value] : result.counters)
+		{
+			fprintf(pFile, ",\n      ");
+			writeJsonString(pFile, counterName);
+			fprintf(pFile, ": %.6g", value);
+		}
+		fprintf(pFile, "\n    }");
+	}
+	fprintf(pFile, "\n  ]\n}\n");
+
+	return !fclose(pFile);
+}
+
+// ---- Canonical scenes, built in code so they don't depend on the importer
+
+static uint32_t addVertex(MeshData& meshData, const glm::vec3& position, const glm::vec3& normal)
+{
+	Okay::VertexInfo vertexInfo;
+	vertexInfo.normal = normal;
+
+	meshData.positions.emplace_back(position);
+	meshData.vertexInfo.emplace_back(Okay::packVertexInfo(vertexInfo));
+	meshData.boundingBox.growTo(position);
+
+	return (uint32_t)meshData.positions.size() - 1u;
+}
+
+// Flat shaded, the triangle gets its own three vertices
+static void addTriangle(MeshData& meshData, const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2)
+{
+	const glm::vec3 edgeCross = glm::cross(p1 - p0, p2 - p0);
+	const glm::vec3 normal = glm::dot(edgeCross, edgeCross) > 0.f ? glm::normalize(edgeCross) : glm::vec3(0.f, 1.f, 0.f);
+
+	const uint32_t i0 = addVertex(meshData, p0, normal);
+	const uint32_t i1 = addVertex(meshData, p1, normal);
+	const uint32_t i2 = addVertex(meshData, p2, normal);
+	meshData.triangles.emplace_back(i0, i1, i2);
+}
+
+// UV sphere of radius 10 at the origin, enclosed by an inward facing box so every diffuse bounce hits something
+static void createSphereScene(MeshData& meshData)
+{
+	static const uint32_t NUM_SLICES = 256u;
+	static const uint32_t NUM_STACKS = 64u;
+	static const float RADIUS = 10.f;
+
+	// Smooth shaded, neighbouring triangles share their vertices
+	for (uint32_t stack = 0; stack <= NUM_STACKS; stack++)
+	{
+		for (uint32_t slice = 0; slice < NUM_SLICES; slice++)
+		{
+			const float theta = glm::two_pi<float>() * slice / (float)NUM_SLICES;
+			const float phi = glm::pi<float>() * stack / (float)NUM_STACKS;
+			const glm::vec3 normal = glm::vec3(glm::sin(phi) * glm::cos(theta), glm::cos(phi), glm::sin(phi) * glm::sin(theta));
+
+			addVertex(meshData, normal * RADIUS, normal);
+		}
+	}
+
+	auto vertexIdx = [](uint32_t slice, uint32_t stack)
+		{
+			return stack * NUM_SLICES + slice % NUM_SLICES;
+		};
+
+	for (uint32_t stack = 0; stack < NUM_STACKS; stack++)
+	{
+		for (uint32_t slice = 0; slice < NUM_SLICES; slice++)
+		{
+			const uint32_t i00 = vertexIdx(slice, stack), i10 = vertexIdx(slice + 1u, stack);
+			const uint32_t i01 = vertexIdx(slice, stack + 1u), i11 = vertexIdx(slice + 1u, stack + 1u);
+
+			if (stack != 0u)
+				meshData.triangles.emplace_back(i00, i10, i11);
+
+			if (stack != NUM_STACKS - 1u)
+				meshData.triangles.emplace_back(i00, i11, i01);
+		}
+	}
+
+	static const float BOX_SIZE = 50.f;
+	const glm::vec3 corners[8] =
+	{
+		glm::vec3(-BOX_SIZE, -BOX_SIZE, -BOX_SIZE), glm::vec3(BOX_SIZE, -BOX_SIZE, -BOX_SIZE),
+		glm::vec3(-BOX_SIZE, BOX_SIZE, -BOX_SIZE), glm::vec3(BOX_SIZE, BOX_SIZE, -BOX_SIZE),
+		glm::vec3(-BOX_SIZE, -BOX_SIZE, BOX_SIZE), glm::vec3(BOX_SIZE, -BOX_SIZE, BOX_SIZE),
+		glm::vec3(-BOX_SIZE, BOX_SIZE, BOX_SIZE), glm::vec3(BOX_SIZE, BOX_SIZE, BOX_SIZE),
+	};
+
+	const uint32_t faces[6][4] = { { 0, 1, 3, 2 }, { 4, 6, 7, 5 }, { 0, 2, 6, 4 }, { 1, 5, 7, 3 }, { 0, 4, 5, 1 }, { 2, 3, 7, 6 } };
+	for (const uint32_t* pFace : faces)
+	{
+		addTriangle(meshData, corners[pFace[0]], corners[pFace[1]], corners[pFace[2]]);
+		addTriangle(meshData, corners[pFace[0]], corners[pFace[2]], corners[pFace[3]]);
+	}
+}
+
+// Randomly placed and rotated small triangles filling a 20 unit cube, a lot of overlap for the builder to deal with
+static void createSoupScene(MeshData& meshData)
+{
+	static const uint32_t NUM_TRIANGLES = 32768u;
+
+	std::mt19937 generator(1234u);
+	std::uniform_real_distribution<float> centerDistribution(-10.f, 10.f);
+	std::uniform_real_distribution<float> offsetDistribution(-0.5f, 0.5f);
+
+	auto randomVec3 = [&](std::uniform_real_distribution<float>& distribution)
+		{
+			return glm::vec3(distribution(generator), distribution(generator), distribution(generator));
+		};
+
+	for (uint32_t i = 0; i < NUM_TRIANGLES; i++)
+	{
+		const glm::vec3 center = randomVec3(centerDistribution);
+		addTriangle(meshData, center + randomVec3(offsetDistribution), center + randomVec3(offsetDistribution), center + randomVec3(offsetDistribution));
+	}
+}
+
+struct CanonicalScene
+{
+	std::string name;
+	ResourceManager resourceManager;
+	uint32_t numTriangles = 0u;
+	glm::vec3 cameraPosition = glm::vec3(0.f); // Looks towards -x, like the application's default camera
+};
+
+static void addCanonicalScene(std::vector<CanonicalScene>& scenes, std::string_view name, void (*createFunction)(MeshData&), const glm::vec3& cameraPosition)
+{
+	MeshData meshData;
+	createFunction(meshData);
+
+	CanonicalScene& scene = scenes.emplace_back();
+	scene.name = name;
+	scene.numTriangles = (uint32_t)meshData.triangles.size();
+	scene.cameraPosition = cameraPosition;
+	scene.resourceManager.addMesh(std::move(meshData), name);
+}
+
+static std::vector<std::filesystem::path> findFiles(const std::filesystem::path& directory, const std::vector<std::string_view>& fileEndings)
+{
+	std::vector<std::filesystem::path> files;
+
+	std::error_code errorCode;
+	for (const auto& entry : std::filesystem::recursive_directory_iterator(directory, errorCode))
+	{
+		if (!entry.is_regular_file())
+			continue;
+
+		std::string fileEnding = entry.path().extension().string();
+		for (char& character : fileEnding)
+			character = (char)tolower(character);
+
+		for (std::string_view ending : fileEndings)
+		{
+			if (fileEnding == ending)
+				files.emplace_back(entry.path());
+		}
+	}
+
+	std::sort(files.begin(), files.end());
+	return files;
+}
+
+// ---- Benchmarks
+
+static void benchmarkImport(BenchmarkRunner& runner, const BenchmarkOptions& options, std::vector<CanonicalScene>& scenes)
+{
+	const std::filesystem::path meshesPath = std::filesystem::path(options.resourcesPath) / "meshes";
+
+	for (const std::filesystem::path& path : findFiles(meshesPath, { ".fbx", ".obj", ".gltf", ".glb" }))
+	{
+		const std::string name = "import/" + path.filename().string();
+		const std::string pathStr = path.string();
+		uint32_t numTriangles = 0u;
+
+		BenchmarkResult* pResult = runner.run(name, [&](BenchmarkResult& result)
+			{
+				ResourceManager resourceManager;
+				std::vector<ResourceManager::ObjectDecription> objectDescriptions;
+
+				// Textures are left out, they're measured by texture_decode
+				if (!resourceManager.importAssets(pathStr, objectDescriptions, "", 1.f))
+				{
+					result.errorMessage = "Import failed";
+					return false;
+				}
+
+				numTriangles = 0u;
+				for (const Mesh& mesh : resourceManager.getAll<Mesh>())
+					numTriangles += mesh.getNumTriangles();
+
+				return true;
+			});
+
+		if (!pResult)
+			continue;
+
+		pResult->counters.emplace_back("triangles", numTriangles);
+		pResult->counters.emplace_back("mtriangles_per_second", numTriangles / (pResult->realTime * 1000.0));
+		runner.printResult(*pResult);
+
+		// Reused as a canonical scene for the BVH and traversal benchmarks, viewed from outside its bounds
+		CanonicalScene& scene = scenes.emplace_back();
+		std::vector<ResourceManager::ObjectDecription> objectDescriptions;
+		scene.name = path.filename().string();
+
+		// Every object keeps its own mesh, the traversal benchmark places one instance per mesh at the origin
+		scene.resourceManager.getImportSettings().deduplicateMeshes = false;
+		scene.resourceManager.importAssets(pathStr, objectDescriptions, "", 1.f);
+
+		Okay::AABB sceneBounds;
+		for (const Mesh& mesh : scene.resourceManager.getAll<Mesh>())
+		{
+			scene.numTriangles += mesh.getNumTriangles();
+			sceneBounds.growTo(mesh.getBoundingBox().min);
+			sceneBounds.growTo(mesh.getBoundingBox().max);
+		}
+
+		const glm::vec3 sceneCenter = (sceneBounds.min + sceneBounds.max) * 0.5f;
+		scene.cameraPosition = glm::vec3(sceneBounds.max.x + (sceneBounds.max.y - sceneBounds.min.y), sceneCenter.y, sceneCenter.z);
+	}
+}
+
+// A grid of quads per object with positions, UVs and normals, a mix of quads and triangles like exported models have
+static bool writeGridObj(const std::filesystem::path& path, uint32_t numObjects, uint32_t gridSize)
+{
+	FILE* pFile = fopen(path.string().c_str(), "w");
+	if (!pFile)
+		return false;
+
+	std::mt19937 generator(1234u);
+	std::uniform_real_distribution<float> heightDistribution(0.f, 0.05f);
+
+	uint32_t numWrittenVerticies = 0u;
+	for (uint32_t object = 0; object < numObjects; object++)
+	{
+		fprintf(pFile, "o grid_%u\n", object);
+
+		for (uint32_t y = 0; y <= gridSize; y++)
+		{
+			for (uint32_t x = 0; x <= gridSize; x++)
+			{
+				fprintf(pFile, "v %.6f %.6f %.6f\n", x * 0.1f, heightDistribution(generator), y * 0.1f + object * gridSize * 0.1f);
+				fprintf(pFile, "vt %.6f %.6f\n", x / (float)gridSize, y / (float)gridSize);
+				fprintf(pFile, "vn 0.000000 1.000000 0.000000\n");
+			}
+		}
+
+		auto vertexIdx = [&](uint32_t x, uint32_t y)
+			{
+				return numWrittenVerticies + y * (gridSize + 1u) + x + 1u;
+			};
+
+		for (uint32_t y = 0; y < gridSize; y++)
+		{
+			for (uint32_t x = 0; x < gridSize; x++)
+			{
+				const uint32_t i0 = vertexIdx(x, y), i1 = vertexIdx(x + 1u, y), i2 = vertexIdx(x + 1u, y + 1u), i3 = vertexIdx(x, y + 1u);
+
+				if ((x + y) % 2u)
+					fprintf(pFile, "f %u/%u/%u %u/%u/%u %u/%u/%u %u/%u/%u\n", i0, i0, i0, i1, i1, i1, i2, i2, i2, i3, i3, i3);
+				else
+					fprintf(pFile, "f %u/%u/%u %u/%u/%u %u/%u/%u\nf %u/%u/%u %u/%u/%u %u/%u/%u\n", i0, i0, i0, i1, i1, i1, i2, i2, i2, i0, i0, i0, i2, i2, i2, i3, i3, i3);
+			}
+		}
+
+		numWrittenVerticies += (gridSize + 1u) * (gridSize + 1u);
+	}
+
+	return !fclose(pFile);
+}
+
+// The built in OBJ parser against assimp on every .obj in the resources and a generated one large enough to spread over the threads
+static void benchmarkObjImport(BenchmarkRunner& runner, const BenchmarkOptions& options)
+{
+	static const uint32_t GRID_OBJECTS = 4u;
+	static const uint32_t GRID_SIZE = 256u;
+
+	struct ObjImporter
+	{
+		const char* pName;
+		bool (*loadFunction)(std::string_view, std::vector<Importer::ObjectDecriptionStr>&, float);
+	};
+
+	static const ObjImporter IMPORTERS[] = { { "builtin", Importer::loadObj }, { "assimp", Importer::loadObjectsAssimp } };
+
+	bool anyEnabled = false;
+	for (const ObjImporter& importer : IMPORTERS)
+		anyEnabled |= runner.isEnabled(std::string("obj_import/generated_grid/") + importer.pName);
+
+	std::vector<std::pair<std::string, std::filesystem::path>> files;
+	for (const std::filesystem::path& path : findFiles(options.resourcesPath, { ".obj" }))
+		files.emplace_back(path.lexically_relative(options.resourcesPath).generic_string(), path);
+
+	const std::filesystem::path gridPath = std::filesystem::temp_directory_path() / "okay_benchmark_grid.obj";
+	if (anyEnabled && writeGridObj(gridPath, GRID_OBJECTS, GRID_SIZE))
+		files.emplace_back("generated_grid", gridPath);
+
+	for (const auto& [fileName, path] : files)
+	{
+		const std::string pathStr = path.string();
+
+		for (const ObjImporter& importer : IMPORTERS)
+		{
+			uint32_t numTriangles = 0u;
+			uint32_t numVerticies = 0u;
+
+			BenchmarkResult* pResult = runner.run("obj_import/" + fileName + "/" + importer.pName, [&](BenchmarkResult& result)
+				{
+					std::vector<Importer::ObjectDecriptionStr> objects;
+					if (!importer.loadFunction(pathStr, objects, 1.f))
+					{
+						result.errorMessage = "Import failed";
+						return false;
+					}
+
+					numTriangles = 0u;
+					numVerticies = 0u;
+					for (const Importer::ObjectDecriptionStr& object : objects)
+					{
+						numTriangles += (uint32_t)object.meshData.triangles.size();
+						numVerticies += (uint32_t)object.meshData.positions.size();
+					}
+
+					return true;
+				});
+
+			if (!pResult)
+				continue;
+
+			pResult->counters.emplace_back("triangles", numTriangles);
+			pResult->counters.emplace_back("verticies", numVerticies);
+			pResult->counters.emplace_back("mtriangles_per_second", numTriangles / (pResult->realTime * 1000.0));
+			pResult->counters.emplace_back("threads", Okay::getNumWorkerThreads());
+			runner.printResult(*pResult);
+		}
+	}
+
+	std::error_code errorCode;
+	std::filesystem::remove(gridPath, errorCode);
+}
+
+// Expected cost of tracing a ray that hits the root box, every node visited costs 1 and every triangle tested costs 1
+static double calculateSAHCost(const std::vector<GPUNode>& nodes, const MeshDesc& meshDesc)
+{
+	static const double NODE_COST = 1.0;
+	static const double TRIANGLE_COST = 1.0;
+
+	const double rootArea = nodes[meshDesc.bvhTreeStartIdx].boundingBox.getArea();
+	if (rootArea <= 0.0)
+		return 0.0;
+
+	double cost = 0.0;
+	for (uint32_t i = meshDesc.bvhTreeStartIdx; i < meshDesc.bvhTreeStartIdx + meshDesc.numBvhNodes; i++)
+	{
+		const GPUNode& node = nodes[i];
+		const double hitChance = node.boundingBox.getArea() / rootArea;
+
+		cost += node.firstChildIdx == Okay::INVALID_UINT ? hitChance * (node.triEnd - node.triStart) * TRIANGLE_COST : hitChance * NODE_COST;
+	}
+
+	return cost;
+}
+
+static void benchmarkBvhBuild(BenchmarkRunner& runner, const std::vector<CanonicalScene>& scenes)
+{
+	// The builder's settings, the first is what both tracers use
+	static const uint32_t MAX_DEPTH = DEFAULT_BVH_MAX_DEPTH;
+	static const uint32_t MAX_LEAF_TRIANGLES[] = { DEFAULT_BVH_MAX_LEAF_TRIANGLES, 2u, 16u };
+
+	for (const CanonicalScene& scene : scenes)
+	{
+		for (uint32_t maxLeafTriangles : MAX_LEAF_TRIANGLES)
+		{
+			std::vector<MeshDesc> meshDescs;
+			std::vector<GPUNode> nodes;
+			std::vector<glm::vec3> vertexPositions;
+			std::vector<Okay::PackedVertexInfo> vertexInfo;
+			std::vector<glm::uvec3> triangles;
+
+			BenchmarkResult* pResult = runner.run("bvh_build/" + scene.name + "/sah_leaf:" + std::to_string(maxLeafTriangles), [&](BenchmarkResult&)
+				{
+					BvhBuilder bvhBuilder(maxLeafTriangles, MAX_DEPTH);
+					bvhBuilder.buildMeshTrees(scene.resourceManager.getAll<Mesh>(), meshDescs, nodes, vertexPositions, vertexInfo, triangles);
+					return true;
+				});
+
+			if (!pResult)
+				continue;
+
+			double sahCost = 0.0;
+			for (const MeshDesc& meshDesc : meshDescs)
+				sahCost += calculateSAHCost(nodes, meshDesc);
+
+			pResult->counters.emplace_back("triangles", scene.numTriangles);
+			pResult->counters.emplace_back("nodes", (double)nodes.size());
+			pResult->counters.emplace_back("geometry_bytes", (double)(vertexPositions.size() * sizeof(glm::vec3) +
+				vertexInfo.size() * sizeof(Okay::PackedVertexInfo) + triangles.size() * sizeof(glm::uvec3)));
+			pResult->counters.emplace_back("sah_cost", sahCost);
+			runner.printResult(*pResult);
+		}
+	}
+}
+
+/*
+	Building and refitting the instance oct tree with the application's settings, over randomly placed, rotated and scaled
+	instances of the sphere scene's mesh. The refit follows every instance moving a little, the way a scene is edited.
+*/
+static void benchmarkOctTree(BenchmarkRunner& runner, const std::vector<CanonicalScene>& scenes)
+{
+	static const uint32_t NUM_INSTANCES[] = { 5000u, 50000u };
+
+	auto sceneIt = std::find_if(scenes.begin(), scenes.end(), [](const CanonicalScene& scene) { return scene.name == "sphere"; });
+	if (sceneIt == scenes.end())
+		return;
+
+	const ResourceManager& resourceManager = sceneIt->resourceManager;
+
+	for (uint32_t numInstances : NUM_INSTANCES)
+	{
+		const std::string buildName = "oct_tree/build/instances:" + std::to_string(numInstances);
+		const std::string refitName = "oct_tree/refit/instances:" + std::to_string(numInstances);
+		if (!runner.isEnabled(buildName) && !runner.isEnabled(refitName))
+			continue;
+
+		// The same density at every count
+		const float sceneExtents = 40.f * std::cbrt((float)numInstances);
+
+		std::mt19937 generator(numInstances);
+		std::uniform_real_distribution<float> positionDistribution(-sceneExtents, sceneExtents);
+		std::uniform_real_distribution<float> rotationDistribution(0.f, 360.f);
+		std::uniform_real_distribution<float> scaleDistribution(0.25f, 2.f);
+		std::uniform_real_distribution<float> moveDistribution(-1.f, 1.f);
+
+		Scene scene;
+		for (uint32_t i = 0; i < numInstances; i++)
+		{
+			Entity entity = scene.createEntity();
+			entity.addComponent<MeshComponent>().meshID = 0u;
+
+			Transform& transform = entity.getComponent<Transform>();
+			transform.position = glm::vec3(positionDistribution(generator), positionDistribution(generator), positionDistribution(generator));
+			transform.rotation = glm::vec3(rotationDistribution(generator), rotationDistribution(generator), rotationDistribution(generator));
+			transform.scale = glm::vec3(scaleDistribution(generator));
+		}
+
+		std::vector<OctTreeNode> nodes;
+		BenchmarkResult* pResult = runner.run(buildName, [&](BenchmarkResult&)
+			{
+				OctTree::build(scene, resourceManager, DEFAULT_OCT_TREE_MAX_DEPTH, DEFAULT_OCT_TREE_MAX_LEAF_ENTITIES, nodes);
+				return true;
+			});
+
+		if (pResult)
+		{
+			size_t maxNodeEntities = 0u;
+			for (const OctTreeNode& node : nodes)
+				maxNodeEntities = std::max(maxNodeEntities, node.entities.size());
+
+			pResult->counters.emplace_back("instances", numInstances);
+			pResult->counters.emplace_back("nodes", (double)nodes.size());
+			pResult->counters.emplace_back("max_node_entities", (double)maxNodeEntities);
+			runner.printResult(*pResult);
+		}
+
+		if (!runner.isEnabled(refitName))
+			continue;
+
+		OctTree::build(scene, resourceManager, DEFAULT_OCT_TREE_MAX_DEPTH, DEFAULT_OCT_TREE_MAX_LEAF_ENTITIES, nodes);
+
+		auto transformView = scene.getRegistry().view<Transform>();
+		for (entt::entity entity : transformView)
+			transformView.get<Transform>(entity).position += glm::vec3(moveDistribution(generator), moveDistribution(generator), moveDistribution(generator));
+
+		pResult = runner.run(refitName, [&](BenchmarkResult&)
+			{
+				OctTree::refit(scene, resourceManager, nodes);
+				return true;
+			});
+
+		if (!pResult)
+			continue;
+
+		pResult->counters.emplace_back("instances", numInstances);
+		pResult->counters.emplace_back("nodes", (double)nodes.size());
+		runner.printResult(*pResult);
+	}
+}
+
+static void benchmarkTraversal(BenchmarkRunner& runner, const std::vector<CanonicalScene>& scenes)
+{
+	static const glm::uvec2 RESOLUTION = glm::uvec2(320u, 180u);
+
+	struct TraversalMode
+	{
+		const char* pName;
+		uint32_t maxBounces;
+	};
+
+	// Russian roulette is off so every path is the same length, benchmarkRussianRoulette covers it
+	static const TraversalMode MODES[] = { { "primary", 0u }, { "diffuse", 3u } };
+
+	for (const CanonicalScene& canonicalScene : scenes)
+	{
+		bool anyEnabled = false;
+		for (const TraversalMode& mode : MODES)
+			anyEnabled |= runner.isEnabled(std::string("traversal/") + mode.pName + "/" + canonicalScene.name);
+
+		if (!anyEnabled)
+			continue;
+
+		Scene scene;
+		for (uint32_t i = 0; i < canonicalScene.resourceManager.getCount<Mesh>(); i++)
+			scene.createEntity().addComponent<MeshComponent>().meshID = i;
+
+		Entity camera = scene.createEntity();
+		camera.addComponent<Camera>(90.f, 0.1f);
+		camera.getComponent<Transform>().position = canonicalScene.cameraPosition;
+		camera.getComponent<Transform>().rotation = glm::vec3(0.f, -90.f, 0.f);
+
+		CPURayTracer rayTracer;
+		rayTracer.initiate(canonicalScene.resourceManager, RESOLUTION);
+		rayTracer.setScene(scene);
+
+		for (const TraversalMode& mode : MODES)
+		{
+			rayTracer.getSettings().maxBounces = mode.maxBounces;
+			rayTracer.getSettings().russianRouletteEnabled = false;
+			rayTracer.resetAccumulation();
+
+			uint64_t numRays = 0u;
+			BenchmarkResult* pResult = runner.run(std::string("traversal/") + mode.pName + "/" + canonicalScene.name, [&](BenchmarkResult&)
+				{
+					rayTracer.renderSamples(1u);
+					numRays = rayTracer.getLastFrameStats().numRays;
+					return true;
+				});
+
+			if (!pResult)
+				continue;
+
+			pResult->counters.emplace_back("rays", (double)numRays);
+			pResult->counters.emplace_back("mrays_per_second", numRays / (pResult->realTime * 1000.0));
+			pResult->counters.emplace_back("threads", rayTracer.getScheduler().getNumWorkers());
+			runner.printResult(*pResult);
+		}
+	}
+}
+
+/*
+	Samples per second against the variance of a single sample, for every bounce depth with and without russian roulette.
+	Roulette ends paths early at the cost of noisier samples, samples_per_variance (samples per second / variance) is what it has to win on.
+	The soup is grey and lit by an environment map so paths keep bouncing between its triangles.
+*/
+static void benchmarkRussianRoulette(BenchmarkRunner& runner, const BenchmarkOptions& options, const std::vector<CanonicalScene>& scenes)
+{
+	static const glm::uvec2 RESOLUTION = glm::uvec2(64u, 36u);
+	static const uint32_t MAX_DEPTH = 16u;
+	static const uint32_t NUM_SAMPLES = 8u; // Per pixel, per iteration
+	static const float ALBEDO = 0.7f;
+
+	auto getName = [](uint32_t depth, bool russianRoulette)
+		{
+			return "russian_roulette/depth:" + std::to_string(depth) + (russianRoulette ? "" : "/disabled");
+		};
+
+	bool anyEnabled = false;
+	for (uint32_t depth = 1u; depth <= MAX_DEPTH; depth++)
+		anyEnabled |= runner.isEnabled(getName(depth, true)) || runner.isEnabled(getName(depth, false));
+
+	const std::filesystem::path environmentMapPath = std::filesystem::path(options.resourcesPath) / "environmentMaps" / "SkyBox1.png";
+	auto sceneIt = std::find_if(scenes.begin(), scenes.end(), [](const CanonicalScene& scene) { return scene.name == "soup"; });
+
+	std::error_code errorCode;
+	if (!anyEnabled || sceneIt == scenes.end() || !std::filesystem::exists(environmentMapPath, errorCode))
+		return;
+
+	const CanonicalScene& canonicalScene = *sceneIt;
+
+	Scene scene;
+	MeshComponent& meshComponent = scene.createEntity().addComponent<MeshComponent>();
+	meshComponent.material.albedo.colour = glm::vec3(ALBEDO);
+
+	Entity camera = scene.createEntity();
+	camera.addComponent<Camera>(90.f, 0.1f);
+	camera.getComponent<Transform>().position = canonicalScene.cameraPosition;
+	camera.getComponent<Transform>().rotation = glm::vec3(0.f, -90.f, 0.f);
+
+	CPURayTracer rayTracer;
+	rayTracer.initiate(canonicalScene.resourceManager, RESOLUTION, environmentMapPath.string());
+	rayTracer.setScene(scene);
+
+	const uint32_t numPixels = RESOLUTION.x * RESOLUTION.y;
+	std::vector<float> previousMeans(numPixels);
+	std::vector<double> squaredSums(numPixels);
+
+	for (uint32_t depth = 1u; depth <= MAX_DEPTH; depth++)
+	{
+		for (bool russianRoulette : { true, false })
+		{
+			rayTracer.getSettings().maxBounces = depth;
+			rayTracer.getSettings().russianRouletteEnabled = russianRoulette;
+
+			uint64_t numRays = 0u;
+			double variance = 0.0;
+
+			// The tracer only keeps the running mean, every sample is recovered from how much it moved
+			BenchmarkResult* pResult = runner.run(getName(depth, russianRoulette), [&](BenchmarkResult&)
+				{
+					rayTracer.resetAccumulation();
+					std::fill(previousMeans.begin(), previousMeans.end(), 0.f);
+					std::fill(squaredSums.begin(), squaredSums.end(), 0.0);
+					numRays = 0u;
+
+					for (uint32_t i = 1u; i <= NUM_SAMPLES; i++)
+					{
+						rayTracer.renderSamples(1u);
+						numRays += rayTracer.getLastFrameStats().numRays;
+
+						const std::vector<glm::vec4>& means = rayTracer.getResolvedPixels();
+						for (uint32_t j = 0; j < numPixels; j++)
+						{
+							const float mean = glm::dot(glm::vec3(means[j]), glm::vec3(0.2126f, 0.7152f, 0.0722f));
+							const double sample = (double)mean * i - (double)previousMeans[j] * (i - 1u);
+
+							squaredSums[j] += sample * sample;
+							previousMeans[j] = mean;
+						}
+					}
+
+					variance = 0.0;
+					for (uint32_t j = 0; j < numPixels; j++)
+					{
+						const double mean = previousMeans[j];
+						variance += (squaredSums[j] - NUM_SAMPLES * mean * mean) / (NUM_SAMPLES - 1u);
+					}
+
+					variance /= numPixels;
+					return true;
+				});
+
+			if (!pResult)
+				continue;
+
+			const double samplesPerSecond = (double)numPixels * NUM_SAMPLES / (pResult->realTime / 1000.0);
+
+			pResult->counters.emplace_back("samples_per_second", samplesPerSecond);
+			pResult->counters.emplace_back("variance", variance);
+			pResult->counters.emplace_back("samples_per_variance", variance > 0.0 ? samplesPerSecond / variance : 0.0);
+			pResult->counters.emplace_back("rays_per_sample", (double)numRays / ((double)numPixels * NUM_SAMPLES));
+			runner.printResult(*pResult);
+		}
+	}
+}
+
+// References are rendered from these sample indices on, so their noise isn't the same as the first samples of the run measured against them
+static const uint32_t REFERENCE_SAMPLE_INDEX_OFFSET = 1u << 20u;
+
+static float calculateRMSE(const std::vector<glm::vec4>& pixels, const std::vector<glm::vec4>& reference)
+{
+	double errorSum = 0.0;
+	for (size_t i = 0; i < pixels.size(); i++)
+	{
+		const glm::vec3 error = glm::vec3(pixels[i] - reference[i]);
+		errorSum += (double)glm::dot(error, error);
+	}
+
+	return (float)glm::sqrt(errorSum / (pixels.size() * 3.0));
+}
+
+/*
+	Time until the CPU tracer's image is within TARGET_RMSE of a high sample count reference, with and without adaptive sampling.
+	Same scene as benchmarkRussianRoulette: the environment seen past the soup converges within a few samples, the soup doesn't.
+	Fails if the target isn't reached within MAX_SAMPLES.
+*/
+static void benchmarkAdaptiveSampling(BenchmarkRunner& runner, const BenchmarkOptions& options, const std::vector<CanonicalScene>& scenes)
+{
+	static const glm::uvec2 RESOLUTION = glm::uvec2(64u, 36u);
+	static const uint32_t MAX_BOUNCES = 3u;
+	static const uint32_t REFERENCE_SAMPLES = 512u;
+	static const uint32_t MAX_SAMPLES = 256u;
+	static const float TARGET_RMSE = 0.01f;
+	static const float ALBEDO = 0.7f;
+
+	if (!runner.isEnabled("adaptive_sampling/enabled") && !runner.isEnabled("adaptive_sampling/disabled"))
+		return;
+
+	const std::filesystem::path environmentMapPath = std::filesystem::path(options.resourcesPath) / "environmentMaps" / "SkyBox1.png";
+	auto sceneIt = std::find_if(scenes.begin(), scenes.end(), [](const CanonicalScene& scene) { return scene.name == "soup"; });
+
+	std::error_code errorCode;
+	if (sceneIt == scenes.end() || !std::filesystem::exists(environmentMapPath, errorCode))
+		return;
+
+	const CanonicalScene& canonicalScene = *sceneIt;
+
+	Scene scene;
+	MeshComponent& meshComponent = scene.createEntity().addComponent<MeshComponent>();
+	meshComponent.material.albedo.colour = glm::vec3(ALBEDO);
+
+	Entity camera = scene.createEntity();
+	camera.addComponent<Camera>(90.f, 0.1f);
+	camera.getComponent<Transform>().position = canonicalScene.cameraPosition;
+	camera.getComponent<Transform>().rotation = glm::vec3(0.f, -90.f, 0.f);
+
+	CPURayTracer rayTracer;
+	rayTracer.initiate(canonicalScene.resourceManager, RESOLUTION, environmentMapPath.string());
+	rayTracer.setScene(scene);
+
+	CPURayTracer::Settings& settings = rayTracer.getSettings();
+	settings.maxBounces = MAX_BOUNCES;
+	settings.adaptiveSamplingEnabled = false;
+	settings.sampleIndexOffset = REFERENCE_SAMPLE_INDEX_OFFSET;
+
+	rayTracer.resetAccumulation();
+	rayTracer.renderSamples(REFERENCE_SAMPLES);
+	const std::vector<glm::vec4> reference = rayTracer.getResolvedPixels();
+
+	settings.sampleIndexOffset = 0u;
+
+	for (bool adaptiveSampling : { true, false })
+	{
+		settings.adaptiveSamplingEnabled = adaptiveSampling;
+
+		uint32_t numSamples = 0u;
+		uint64_t numRays = 0u;
+		float rmse = 0.f;
+
+		BenchmarkResult* pResult = runner.run(adaptiveSampling ? "adaptive_sampling/enabled" : "adaptive_sampling/disabled", [&](BenchmarkResult& result)
+			{
+				rayTracer.resetAccumulation();
+				numRays = 0u;
+
+				for (numSamples = 1u; numSamples <= MAX_SAMPLES; numSamples++)
+				{
+					rayTracer.renderSamples(1u);
+					numRays += rayTracer.getLastFrameStats().numRays;
+
+					rmse = calculateRMSE(rayTracer.getResolvedPixels(), reference);
+					if (rmse <= TARGET_RMSE)
+						return true;
+				}
+
+				result.errorMessage = "RMSE " + std::to_string(rmse) + " after " + std::to_string(MAX_SAMPLES) + " samples";
+				return false;
+			});
+
+		if (!pResult)
+			continue;
+
+		pResult->counters.emplace_back("samples", numSamples);
+		pResult->counters.emplace_back("rays", (double)numRays);
+		pResult->counters.emplace_back("rmse", rmse);
+		pResult->counters.emplace_back("active_tiles", rayTracer.getLastFrameStats().numActiveTiles);
+		runner.printResult(*pResult);
+	}
+}
+
+/*
+	The denoiser at 1080p on a few samples of the soup scene, both traced by the CPU tracer. Reports the time per frame and the RMSE
+	of the noisy and the denoised image against a reference with REFERENCE_SAMPLES, whose own noise is the floor of what can be measured.
+*/
+static void benchmarkDenoiser(BenchmarkRunner& runner, const BenchmarkOptions& options, const std::vector<CanonicalScene>& scenes)
+{
+	static const glm::uvec2 RESOLUTION = glm::uvec2(1920u, 1080u);
+	static const uint32_t MAX_BOUNCES = 1u;
+	static const uint32_t NOISY_SAMPLES = 4u;
+	static const uint32_t REFERENCE_SAMPLES = 64u;
+	static const float ALBEDO = 0.7f;
+
+	if (!runner.isEnabled("denoise/1080p"))
+		return;
+
+	const std::filesystem::path environmentMapPath = std::filesystem::path(options.resourcesPath) / "environmentMaps" / "SkyBox1.png";
+	auto sceneIt = std::find_if(scenes.begin(), scenes.end(), [](const CanonicalScene& scene) { return scene.name == "soup"; });
+
+	std::error_code errorCode;
+	if (sceneIt == scenes.end() || !std::filesystem::exists(environmentMapPath, errorCode))
+		return;
+
+	const CanonicalScene& canonicalScene = *sceneIt;
+
+	Scene scene;
+	MeshComponent& meshComponent = scene.createEntity().addComponent<MeshComponent>();
+	meshComponent.material.albedo.colour = glm::vec3(ALBEDO);
+
+	Entity camera = scene.createEntity();
+	camera.addComponent<Camera>(90.f, 0.1f);
+	camera.getComponent<Transform>().position = canonicalScene.cameraPosition;
+	camera.getComponent<Transform>().rotation = glm::vec3(0.f, -90.f, 0.f);
+
+	CPURayTracer rayTracer;
+	rayTracer.initiate(canonicalScene.resourceManager, RESOLUTION, environmentMapPath.string());
+	rayTracer.setScene(scene);
+
+	CPURayTracer::Settings& settings = rayTracer.getSettings();
+	settings.maxBounces = MAX_BOUNCES;
+	settings.sampleIndexOffset = REFERENCE_SAMPLE_INDEX_OFFSET;
+
+	rayTracer.renderSamples(REFERENCE_SAMPLES);
+	const std::vector<glm::vec4> reference = rayTracer.getResolvedPixels();
+
+	settings.sampleIndexOffset = 0u;
+	rayTracer.resetAccumulation();
+	rayTracer.renderSamples(NOISY_SAMPLES);
+
+	// The auxiliary buffers are the first sample's first hits, the same as the application denoises with
+	const std::vector<glm::vec4>& noisyPixels = rayTracer.getResolvedPixels();
+	const std::vector<glm::vec4>& albedo = rayTracer.getAlbedoBuffer();
+	const std::vector<glm::vec4>& normalDepth = rayTracer.getNormalDepthBuffer();
+
+	Denoiser denoiser;
+	std::vector<glm::vec4> denoisedPixels;
+
+	BenchmarkResult* pResult = runner.run("denoise/1080p", [&](BenchmarkResult&)
+		{
+			denoiser.denoise(noisyPixels.data(), albedo.data(), normalDepth.data(), RESOLUTION.x, RESOLUTION.y, denoisedPixels);
+			return true;
+		});
+
+	if (!pResult)
+		return;
+
+	pResult->counters.emplace_back("samples", NOISY_SAMPLES);
+	pResult->counters.emplace_back("reference_samples", REFERENCE_SAMPLES);
+	pResult->counters.emplace_back("rmse_noisy", calculateRMSE(noisyPixels, reference));
+	pResult->counters.emplace_back("rmse_denoised", calculateRMSE(denoisedPixels, reference));
+	runner.printResult(*pResult);
+}
+
+// Every traced first hit has to project back into the pixel it was traced through, up to the AA jitter of half a pixel
+// MAX_ERROR_PIXELS is for the float error of createRay's inverse matrices, a few thousandths of a pixel towards the edges
+static void benchmarkReprojectionRoundTrip(BenchmarkRunner& runner, const std::vector<CanonicalScene>& scenes)
+{
+	static const glm::uvec2 RESOLUTION = glm::uvec2(320u, 180u);
+	static const float MAX_ERROR_PIXELS = 0.01f;
+
+	auto sceneIt = std::find_if(scenes.begin(), scenes.end(), [](const CanonicalScene& scene) { return scene.name == "sphere"; });
+	if (!runner.isEnabled("reprojection/round_trip") || sceneIt == scenes.end())
+		return;
+
+	const CanonicalScene& canonicalScene = *sceneIt;
+
+	Scene scene;
+	scene.createEntity().addComponent<MeshComponent>();
+
+	Entity camera = scene.createEntity();
+	camera.addComponent<Camera>(90.f, 0.1f);
+	camera.getComponent<Transform>().position = canonicalScene.cameraPosition;
+	camera.getComponent<Transform>().rotation = glm::vec3(0.f, -90.f, 0.f);
+
+	// The G-buffer is the first hit of the first sample, AA jitter included
+	CPURayTracer rayTracer;
+	rayTracer.initiate(canonicalScene.resourceManager, RESOLUTION);
+	rayTracer.setScene(scene);
+	rayTracer.getSettings().maxBounces = 0u;
+	rayTracer.renderSamples(1u);
+
+	const std::vector<Reprojection::Surface>& surfaces = rayTracer.getSurfaceBuffer();
+	const glm::mat4& viewProjection = rayTracer.getViewProjectionMatrix();
+
+	uint32_t numHits = 0u;
+	uint32_t numMismatches = 0u;
+	float maxOffset = 0.f; // From the pixel's center
+
+	BenchmarkResult* pResult = runner.run("reprojection/round_trip", [&](BenchmarkResult& result)
+		{
+			numHits = 0u;
+			numMismatches = 0u;
+			maxOffset = 0.f;
+
+			for (uint32_t y = 0; y < RESOLUTION.y; y++)
+			{
+				for (uint32_t x = 0; x < RESOLUTION.x; x++)
+				{
+					const Reprojection::Surface& surface = surfaces[y * RESOLUTION.x + x];
+					if (surface.instanceId < 0.f)
+						continue;
+
+					numHits++;
+
+					glm::vec2 pixel;
+					if (!Reprojection::worldToPixel(viewProjection, surface.worldPosition, RESOLUTION, pixel))
+					{
+						numMismatches++;
+						continue;
+					}
+
+					const glm::vec2 offset = glm::abs(pixel - glm::vec2((float)x, (float)y));
+					maxOffset = glm::max(maxOffset, glm::max(offset.x, offset.y));
+
+					if (glm::max(offset.x, offset.y) > 0.5f + MAX_ERROR_PIXELS)
+						numMismatches++;
+				}
+			}
+
+			if (!numHits || numMismatches)
+			{
+				result.errorMessage = std::to_string(numMismatches) + " of " + std::to_string(numHits) + " hits projected to another pixel, max offset " + std::to_string(maxOffset);
+				return false;
+			}
+
+			return true;
+		});
+
+	if (!pResult)
+		return;
+
+	pResult->counters.emplace_back("hits", numHits);
+	pResult->counters.emplace_back("max_offset_pixels", maxOffset);
+	runner.printResult(*pResult);
+}
+
+/*
+	Image error right after a camera move, with the accumulation reprojected against starting over from one sample.
+	The history is HISTORY_SAMPLES deep, both are compared to a reference traced from the new view.
+	The sphere and its box are lit by a large point light that only bounced paths find, so single samples are noisy.
+	Fails if reprojecting makes the error larger, which would mean the history is added to the wrong pixels.
+*/
+static void benchmarkReprojectionCameraMove(BenchmarkRunner& runner, const std::vector<CanonicalScene>& scenes)
+{
+	static const glm::uvec2 RESOLUTION = glm::uvec2(64u, 36u);
+	static const uint32_t MAX_BOUNCES = 3u;
+	static const uint32_t HISTORY_SAMPLES = 32u;
+	static const uint32_t REFERENCE_SAMPLES = 512u;
+	static const float ALBEDO = 0.7f;
+	static const glm::vec3 LIGHT_POSITION = glm::vec3(0.f, 35.f, 0.f);
+	static const float LIGHT_RADIUS = 10.f;
+	static const glm::vec3 CAMERA_ROTATION = glm::vec3(0.f, -90.f, 0.f);
+	static const glm::vec3 MOVED_CAMERA_OFFSET = glm::vec3(0.f, 0.5f, 1.f);
+	static const glm::vec3 MOVED_CAMERA_ROTATION = glm::vec3(2.f, -88.f, 0.f);
+
+	auto sceneIt = std::find_if(scenes.begin(), scenes.end(), [](const CanonicalScene& scene) { return scene.name == "sphere"; });
+	if (!runner.isEnabled("reprojection/camera_move") || sceneIt == scenes.end())
+		return;
+
+	const CanonicalScene& canonicalScene = *sceneIt;
+
+	Scene scene;
+	MeshComponent& meshComponent = scene.createEntity().addComponent<MeshComponent>();
+	meshComponent.material.albedo.colour = glm::vec3(ALBEDO);
+
+	Entity light = scene.createEntity();
+	light.addComponent<PointLight>().radius = LIGHT_RADIUS;
+	light.getComponent<Transform>().position = LIGHT_POSITION;
+
+	Entity camera = scene.createEntity();
+	camera.addComponent<Camera>(90.f, 0.1f);
+	Transform& cameraTransform = camera.getComponent<Transform>();
+
+	CPURayTracer rayTracer;
+	rayTracer.initiate(canonicalScene.resourceManager, RESOLUTION);
+	rayTracer.setScene(scene);
+
+	CPURayTracer::Settings& settings = rayTracer.getSettings();
+	settings.maxBounces = MAX_BOUNCES;
+
+	cameraTransform.position = canonicalScene.cameraPosition + MOVED_CAMERA_OFFSET;
+	cameraTransform.rotation = MOVED_CAMERA_ROTATION;
+	settings.sampleIndexOffset = REFERENCE_SAMPLE_INDEX_OFFSET;
+	rayTracer.renderSamples(REFERENCE_SAMPLES);
+	const std::vector<glm::vec4> reference = rayTracer.getResolvedPixels();
+	settings.sampleIndexOffset = 0u;
+
+	float resetRMSE = 0.f;
+	float reprojectedRMSE = 0.f;
+	uint32_t numReprojectedPixels = 0u;
+
+	BenchmarkResult* pResult = runner.run("reprojection/camera_move", [&](BenchmarkResult& result)
+		{
+			for (bool reprojection : { false, true })
+			{
+				// Only the move to the new view may keep history
+				settings.reprojectionEnabled = false;
+				cameraTransform.position = canonicalScene.cameraPosition;
+				cameraTransform.rotation = CAMERA_ROTATION;
+				rayTracer.renderSamples(HISTORY_SAMPLES);
+
+				settings.reprojectionEnabled = reprojection;
+				cameraTransform.position = canonicalScene.cameraPosition + MOVED_CAMERA_OFFSET;
+				cameraTransform.rotation = MOVED_CAMERA_ROTATION;
+				rayTracer.renderSamples(1u);
+
+				(reprojection ? reprojectedRMSE : resetRMSE) = calculateRMSE(rayTracer.getResolvedPixels(), reference);
+				numReprojectedPixels = rayTracer.getLastFrameStats().numReprojectedPixels;
+			}
+
+			if (reprojectedRMSE >= resetRMSE)
+			{
+				result.errorMessage = "Reprojected RMSE " + std::to_string(reprojectedRMSE) + " isn't below " + std::to_string(resetRMSE) + " without reprojection";
+				return false;
+			}
+
+			return true;
+		});
+
+	if (!pResult)
+		return;
+
+	pResult->counters.emplace_back("reprojected_pixels", numReprojectedPixels);
+	pResult->counters.emplace_back("reprojected_fraction", numReprojectedPixels / (double)(RESOLUTION.x * RESOLUTION.y));
+	pResult->counters.emplace_back("rmse_reprojected", reprojectedRMSE);
+	pResult->counters.emplace_back("rmse_reset", resetRMSE);
+	runner.printResult(*pResult);
+}
+
+/*
+	Motion mode on the CPU tracer, the camera moves a little every frame for two rounds through the stride x stride block.
+	The last motion frame is compared to a full resolution reference from the same view, against a single motion frame from that view
+	which only has its own pixels to upsample. Only emission is traced, the sphere is seen against a glowing copy of its mesh so the edges are sharp.
+	Fails if the interleaved offsets don't cover every pixel of the block once, or if the interleaved frames don't bring the error down
+*/
+static void benchmarkMotionMode(BenchmarkRunner& runner, const std::vector<CanonicalScene>& scenes)
+{
+	static const glm::uvec2 RESOLUTION = glm::uvec2(64u, 36u);
+	static const uint32_t REFERENCE_SAMPLES = 64u;
+	static const float EMISSION = 0.2f;
+	static const float GLOWING_EMISSION = 1.f;
+	static const glm::vec3 GLOWING_POSITION = glm::vec3(-30.f, 0.f, 20.f);
+	static const glm::vec3 GLOWING_SCALE = glm::vec3(0.2f);
+	static const glm::vec3 CAMERA_ROTATION = glm::vec3(0.f, -90.f, 0.f);
+	static const glm::vec3 CAMERA_VELOCITY = glm::vec3(0.f, 0.f, 0.05f); // Per frame
+	static const glm::vec3 CAMERA_ANGULAR_VELOCITY = glm::vec3(0.f, 0.1f, 0.f); // Degrees per frame
+
+	auto getName = [](uint32_t stride)
+		{
+			return "motion/stride:" + std::to_string(stride);
+		};
+
+	auto sceneIt = std::find_if(scenes.begin(), scenes.end(), [](const CanonicalScene& scene) { return scene.name == "sphere"; });
+	if ((!runner.isEnabled(getName(2u)) && !runner.isEnabled(getName(4u))) || sceneIt == scenes.end())
+		return;
+
+	const CanonicalScene& canonicalScene = *sceneIt;
+
+	// The tracer scales emission by the albedo
+	Scene scene;
+	Material& material = scene.createEntity().addComponent<MeshComponent>().material;
+	material.albedo.colour = glm::vec3(1.f);
+	material.emissionPower = EMISSION;
+
+	// Half hidden behind the sphere, its box is a small glowing cube
+	Entity glowing = scene.createEntity();
+	Material& glowingMaterial = glowing.addComponent<MeshComponent>().material;
+	glowingMaterial.albedo.colour = glm::vec3(1.f);
+	glowingMaterial.emissionPower = GLOWING_EMISSION;
+	glowing.getComponent<Transform>().position = GLOWING_POSITION;
+	glowing.getComponent<Transform>().scale = GLOWING_SCALE;
+
+	Entity camera = scene.createEntity();
+	camera.addComponent<Camera>(90.f, 0.1f);
+	Transform& cameraTransform = camera.getComponent<Transform>();
+
+	CPURayTracer rayTracer;
+	rayTracer.initiate(canonicalScene.resourceManager, RESOLUTION);
+	rayTracer.setScene(scene);
+
+	CPURayTracer::Settings& settings = rayTracer.getSettings();
+	settings.maxBounces = 0u;
+
+	auto moveCamera = [&](uint32_t frameIdx)
+		{
+			cameraTransform.position = canonicalScene.cameraPosition + CAMERA_VELOCITY * (float)frameIdx;
+			cameraTransform.rotation = CAMERA_ROTATION + CAMERA_ANGULAR_VELOCITY * (float)frameIdx;
+		};
+
+	for (uint32_t stride : { 2u, 4u })
+	{
+		if (!runner.isEnabled(getName(stride)))
+			continue;
+
+		// Two rounds through the block, so the last frame has history for every pixel
+		const uint32_t numMotionFrames = stride * stride * 2u;
+
+		settings.motionModeEnabled = false;
+		settings.motionPixelStride = stride;
+		moveCamera(numMotionFrames);
+		settings.sampleIndexOffset = REFERENCE_SAMPLE_INDEX_OFFSET;
+		rayTracer.renderSamples(REFERENCE_SAMPLES);
+		const std::vector<glm::vec4> reference = rayTracer.getResolvedPixels();
+		settings.sampleIndexOffset = 0u;
+
+		// A full resolution frame, to compare the number of rays with
+		rayTracer.renderSamples(1u);
+		const uint64_t numFullFrameRays = rayTracer.getLastFrameStats().numRays;
+
+		uint64_t numMotionRays = 0u;
+		uint32_t numReprojectedPixels = 0u;
+		float upsampledRMSE = 0.f;
+		float motionRMSE = 0.f;
+
+		BenchmarkResult* pResult = runner.run(getName(stride), [&](BenchmarkResult& result)
+			{
+				// Every pixel of the block is traced once per stride * stride frames, starting from any frame
+				std::vector<uint32_t> numTraced(stride * stride);
+				for (uint32_t firstFrame : { 0u, 1u })
+				{
+					std::fill(numTraced.begin(), numTraced.end(), 0u);
+					for (uint32_t i = 0; i < stride * stride; i++)
+					{
+						const glm::uvec2 offset = MotionMode::getInterleavedPixelOffset(firstFrame + i, stride);
+						numTraced[offset.y * stride + offset.x]++;
+					}
+
+					if (std::any_of(numTraced.begin(), numTraced.end(), [](uint32_t count) { return count != 1u; }))
+					{
+						result.errorMessage = "The interleaved offsets don't cover the block once per " + std::to_string(stride * stride) + " frames";
+						return false;
+					}
+				}
+
+				// Motion mode starts with the first move after a still frame, so the first motion frame has no history
+				settings.motionModeEnabled = false;
+				moveCamera(numMotionFrames - 1u);
+				rayTracer.renderSamples(1u);
+
+				settings.motionModeEnabled = true;
+				moveCamera(numMotionFrames);
+				rayTracer.renderSamples(1u);
+				upsampledRMSE = calculateRMSE(rayTracer.getResolvedPixels(), reference);
+
+				settings.motionModeEnabled = false;
+				moveCamera(0u);
+				rayTracer.renderSamples(1u);
+
+				settings.motionModeEnabled = true;
+				numMotionRays = 0u;
+
+				for (uint32_t i = 1u; i <= numMotionFrames; i++)
+				{
+					moveCamera(i);
+					rayTracer.renderSamples(1u);
+
+					if (!rayTracer.isMotionFrame())
+					{
+						result.errorMessage = "Frame " + std::to_string(i) + " after the camera moved wasn't a motion frame";
+						return false;
+					}
+
+					numMotionRays += rayTracer.getLastFrameStats().numRays;
+				}
+
+				numReprojectedPixels = rayTracer.getLastFrameStats().numReprojectedPixels;
+				motionRMSE = calculateRMSE(rayTracer.getResolvedPixels(), reference);
+
+				if (motionRMSE >= upsampledRMSE)
+				{
+					result.errorMessage = "RMSE " + std::to_string(motionRMSE) + " after " + std::to_string(numMotionFrames) + " motion frames isn't below " +
+						std::to_string(upsampledRMSE) + " of upsampling a single one";
+					return false;
+				}
+
+				return true;
+			});
+
+		if (!pResult)
+			continue;
+
+		pResult->counters.emplace_back("traced_fraction", numMotionRays / (double)(numFullFrameRays * numMotionFrames));
+		pResult->counters.emplace_back("reprojected_fraction", numReprojectedPixels / (double)(RESOLUTION.x * RESOLUTION.y));
+		pResult->counters.emplace_back("rmse_motion", motionRMSE);
+		pResult->counters.emplace_back("rmse_upsampled", upsampledRMSE);
+		runner.printResult(*pResult);
+	}
+}
+
+// Round trips random vertices through Okay::PackedVertexInfo, fails if the error goes past the bounds documented with it
+static void benchmarkVertexPacking(BenchmarkRunner& runner)
+{
+	static const uint32_t NUM_VERTICIES = 65536u;
+	static const float MAX_DIRECTION_ERROR_DEGREES = 0.02f;
+	static const float MAX_UV_RELATIVE_ERROR = 1.f / 2048.f;
+
+	std::mt19937 generator(1234u);
+	std::normal_distribution<float> normalDistribution(0.f, 1.f);
+	std::uniform_real_distribution<float> uvDistribution(-4.f, 4.f);
+
+	auto randomDirection = [&]()
+		{
+			glm::vec3 direction;
+			do
+			{
+				direction = glm::vec3(normalDistribution(generator), normalDistribution(generator), normalDistribution(generator));
+			} while (glm::dot(direction, direction) < 1e-6f);
+
+			return glm::normalize(direction);
+		};
+
+	// Orthonormal like assimp's tangent spaces, the bitangent handedness is random
+	std::vector<Okay::VertexInfo> vertices(NUM_VERTICIES);
+	for (Okay::VertexInfo& vertex : vertices)
+	{
+		vertex.normal = randomDirection();
+		vertex.tangent = glm::normalize(glm::cross(vertex.normal, randomDirection()));
+		vertex.bitangent = glm::cross(vertex.normal, vertex.tangent) * (generator() & 1u ? -1.f : 1.f);
+		vertex.uv = glm::vec2(uvDistribution(generator), uvDistribution(generator));
+	}
+
+	float maxDirectionError = 0.f;
+	float maxUVRelativeError = 0.f;
+
+	// atan2 instead of acos, acos of a float dot product can't resolve angles this small
+	auto angleDegrees = [](const glm::vec3& a, const glm::vec3& b)
+		{
+			return glm::degrees(glm::atan(glm::length(glm::cross(a, b)), glm::dot(a, b)));
+		};
+
+	BenchmarkResult* pResult = runner.run("vertex_packing/random", [&](BenchmarkResult& result)
+		{
+			maxDirectionError = 0.f;
+			maxUVRelativeError = 0.f;
+
+			for (const Okay::VertexInfo& vertex : vertices)
+			{
+				const Okay::VertexInfo decoded = Okay::unpackVertexInfo(Okay::packVertexInfo(vertex));
+
+				maxDirectionError = glm::max(maxDirectionError, angleDegrees(vertex.normal, decoded.normal));
+				maxDirectionError = glm::max(maxDirectionError, angleDegrees(vertex.tangent, decoded.tangent));
+				maxDirectionError = glm::max(maxDirectionError, angleDegrees(vertex.bitangent, decoded.bitangent));
+
+				const glm::vec2 uvError = glm::abs(decoded.uv - vertex.uv) / glm::max(glm::abs(vertex.uv), glm::vec2(1.f / 16384.f));
+				maxUVRelativeError = glm::max(maxUVRelativeError, glm::max(uvError.x, uvError.y));
+			}
+
+			if (maxDirectionError > MAX_DIRECTION_ERROR_DEGREES || maxUVRelativeError > MAX_UV_RELATIVE_ERROR)
+			{
+				result.errorMessage = "Error bound exceeded, directions: " + std::to_string(maxDirectionError) + " degrees, uvs: " + std::to_string(maxUVRelativeError);
+				return false;
+			}
+
+			return true;
+		});
+
+	if (!pResult)
+		return;
+
+	pResult->counters.emplace_back("verticies", NUM_VERTICIES);
+	pResult->counters.emplace_back("bytes_per_vertex", sizeof(Okay::PackedVertexInfo));
+	pResult->counters.emplace_back("max_direction_error_degrees", maxDirectionError);
+	pResult->counters.emplace_back("max_uv_relative_error", maxUVRelativeError);
+	runner.printResult(*pResult);
+}
+
+static void benchmarkTextureDecode(BenchmarkRunner& runner, const BenchmarkOptions& options)
+{
+	const std::filesystem::path texturesPath = std::filesystem::path(options.resourcesPath) / "textures";
+
+	for (const std::filesystem::path& path : findFiles(texturesPath, { ".png", ".jpg", ".jpeg", ".tga", ".bmp", ".hdr" }))
+	{
+		const std::string pathStr = path.string();
+		uint64_t numPixels = 0u;
+
+		BenchmarkResult* pResult = runner.run("texture_decode/" + path.lexically_relative(texturesPath).generic_string(), [&](BenchmarkResult&)
+			{
+				ResourceManager resourceManager;
+				const Texture& texture = resourceManager.getAsset<Texture>(resourceManager.loadTexture(pathStr));
+				numPixels = (uint64_t)texture.getWidth() * texture.getHeight();
+				return true;
+			});
+
+		if (!pResult)
+			continue;
+
+		pResult->counters.emplace_back("pixels", (double)numPixels);
+		pResult->counters.emplace_back("mpixels_per_second", numPixels / (pResult->realTime * 1000.0));
+		runner.printResult(*pResult);
+	}
+}
+
+static void benchmarkTextureAtlas(BenchmarkRunner& runner, const BenchmarkOptions& options)
+{
+	if (!runner.isEnabled("texture_atlas"))
+		return;
+
+	const std::filesystem::path texturesPath = std::filesystem::path(options.resourcesPath) / "textures";
+
+	ResourceManager resourceManager;
+	for (const std::filesystem::path& path : findFiles(texturesPath, { ".png", ".jpg", ".jpeg", ".tga", ".bmp", ".hdr" }))
+		resourceManager.loadTexture(path.string());
+
+	// Textures larger than the biggest pages are scaled down on the GPU first, they're left out
+	std::vector<const Texture*> textures;
+	uint64_t textureBytes = 0u;
+
+	for (const Texture& texture : resourceManager.getAll<Texture>())
+	{
+		if (texture.getWidth() > TEXTURE_ATLAS_MAX_PAGE_SIZE || texture.getHeight() > TEXTURE_ATLAS_MAX_PAGE_SIZE)
+			continue;
+
+		textures.emplace_back(&texture);
+		textureBytes += texture.getByteSize();
+	}
+
+	if (textures.empty())
+		return;
+
+	TextureAtlas atlas;
+	BenchmarkResult* pResult = runner.run("texture_atlas", [&](BenchmarkResult&)
+		{
+			buildTextureAtlas(textures, atlas);
+			return true;
+		});
+
+	if (!pResult)
+		return;
+
+	pResult->counters.emplace_back("textures", (double)textures.size());
+	pResult->counters.emplace_back("pages", (double)atlas.getNumPages());
+	pResult->counters.emplace_back("texture_mb", textureBytes / (1024.0 * 1024.0));
+	pResult->counters.emplace_back("atlas_mb", atlas.getByteSize() / (1024.0 * 1024.0));
+	runner.printResult(*pResult);
+}
+
+static void printUsage()
+{
+	printf("Usage: GPU-Raytracer-Benchmark [options]\n"
+		"  --out <file>         JSON output (benchmark.json)\n"
+		"  --filter <regex>     Only run benchmarks whose name matches (.*)\n"
+		"  --min-time <s>       Minimum time per benchmark in seconds (0.5)\n"
+		"  --label <text>       Stored in the JSON context, e.g. the commit\n"
+		"  --resources <dir>    Resource directory (resources)\n"
+		"  --verbose            Print the importer's timings as well\n"
+		"Exits with 1 if a benchmark failed, the JSON is written either way\n");
+}
+
+static bool parseOptions(int argc, char** argv, BenchmarkOptions& outOptions)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		const char* pArg = argv[i];
+		const char* pValue = i + 1 < argc ? argv[i + 1] : nullptr;
+
+		if (!strcmp(pArg, "--help") || !strcmp(pArg, "-h"))
+			return false;
+
+		if (!strcmp(pArg, "--verbose"))
+		{
+			outOptions.verbose = true;
+			continue;
+		}
+
+		if (!pValue)
+		{
+			printf("Missing value for '%s'\n", pArg);
+			return false;
+		}
+
+		i++;
+
+		if (!strcmp(pArg, "--out"))
+			outOptions.outputPath = pValue;
+		else if (!strcmp(pArg, "--filter"))
+			outOptions.filter = pValue;
+		else if (!strcmp(pArg, "--min-time"))
+			outOptions.minTime = (float)atof(pValue);
+		else if (!strcmp(pArg, "--label"))
+			outOptions.label = pValue;
+		else if (!strcmp(pArg, "--resources"))
+			outOptions.resourcesPath = pValue;
+		else
+		{
+			printf("Unknown option '%s'\n", pArg);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	BenchmarkOptions options;
+	if (!parseOptions(argc, argv, options))
+	{
+		printUsage();
+		return 1;
+	}
+
+	Importer::setQuiet(!options.verbose);
+
+	BenchmarkRunner runner(options);
+
+	std::vector<CanonicalScene> scenes;
+	addCanonicalScene(scenes, "sphere", createSphereScene, glm::vec3(30.f, 0.f, 0.f));
+	addCanonicalScene(scenes, "soup", createSoupScene, glm::vec3(30.f, 0.f, 0.f));
+
+	printf("%-56s %14s %8s\n", "Benchmark", "Time", "Iters");
+
+	benchmarkImport(runner, options, scenes);
+	benchmarkObjImport(runner, options);
+	benchmarkBvhBuild(runner, scenes);
+	benchmarkOctTree(runner, scenes);
+	benchmarkTraversal(runner, scenes);
+	benchmarkRussianRoulette(runner, options, scenes);
+	benchmarkAdaptiveSampling(runner, options, scenes);
+	benchmarkDenoiser(runner, options, scenes);
+	benchmarkReprojectionRoundTrip(runner, scenes);
+	benchmarkReprojectionCameraMove(runner, scenes);
+	benchmarkMotionMode(runner, scenes);
+	benchmarkVertexPacking(runner);
+	benchmarkTextureDecode(runner, options);
+	benchmarkTextureAtlas(runner, options);
+
+	if (!runner.writeJson(options, argv[0]))
+	{
+		printf("Failed to write '%s'\n", options.outputPath.c_str());
+		return 1;
+	}
+
+	printf("Wrote '%s'\n", options.outputPath.c_str());
+
+	const uint32_t numFailed = runner.getNumFailed();
+	if (numFailed)
+	{
+		printf("%u benchmark(s) failed\n", numFailed);
+		return 1;
+	}
+
+	return 0;
+}
\ No newline at end of file
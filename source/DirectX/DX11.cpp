@@ -101,12 +101,12 @@ namespace Okay
 		return *ppSwapChain;
 	}
 
-	bool createStructuredBuffer(ID3D11Buffer** ppBuffer, ID3D11ShaderResourceView** ppSRV, const void* pData, uint32_t eleByteSize, uint32_t numElements, bool immutable)
+	bool createStructuredBuffer(ID3D11Buffer** ppBuffer, ID3D11ShaderResourceView** ppSRV, const void* pData, uint32_t eleByteSize, uint32_t numElements, D3D11_USAGE usage)
 	{
 		D3D11_BUFFER_DESC bufferDesc{};
 		bufferDesc.ByteWidth = eleByteSize * numElements;
-		bufferDesc.CPUAccessFlags = immutable ? 0 : D3D11_CPU_ACCESS_WRITE;
-		bufferDesc.Usage = immutable ? D3D11_USAGE_IMMUTABLE : D3D11_USAGE_DYNAMIC;
+		bufferDesc.CPUAccessFlags = usage == D3D11_USAGE_DYNAMIC ? D3D11_CPU_ACCESS_WRITE : 0;
+		bufferDesc.Usage = usage;
 		bufferDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
 		bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
 		bufferDesc.StructureByteStride = eleByteSize;
@@ -129,6 +129,54 @@ namespace Okay
 
 	}
 
+	bool createRWStructuredBuffer(ID3D11Buffer** ppBuffer, ID3D11ShaderResourceView** ppSRV, ID3D11UnorderedAccessView** ppUAV, uint32_t eleByteSize, uint32_t numElements, bool appendable)
+	{
+		D3D11_BUFFER_DESC bufferDesc{};
+		bufferDesc.ByteWidth = eleByteSize * numElements;
+		bufferDesc.CPUAccessFlags = 0u;
+		bufferDesc.Usage = D3D11_USAGE_DEFAULT;
+		bufferDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS;
+		bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+		bufferDesc.StructureByteStride = eleByteSize;
+
+		HRESULT hr = dx11.pDevice->CreateBuffer(&bufferDesc, nullptr, ppBuffer);
+		if (FAILED(hr))
+			return false;
+
+		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc{};
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+		srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+		srvDesc.Buffer.FirstElement = 0;
+		srvDesc.Buffer.NumElements = numElements;
+
+		if (FAILED(dx11.pDevice->CreateShaderResourceView(*ppBuffer, &srvDesc, ppSRV)))
+			return false;
+
+		D3D11_UNORDERED_ACCESS_VIEW_DESC uavDesc{};
+		uavDesc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
+		uavDesc.Format = DXGI_FORMAT_UNKNOWN;
+		uavDesc.Buffer.FirstElement = 0;
+		uavDesc.Buffer.NumElements = numElements;
+		uavDesc.Buffer.Flags = appendable ? D3D11_BUFFER_UAV_FLAG_APPEND : 0u;
+
+		return SUCCEEDED(dx11.pDevice->CreateUnorderedAccessView(*ppBuffer, &uavDesc, ppUAV));
+	}
+
+	bool createIndirectArgsBuffer(ID3D11Buffer** ppBuffer, const void* pData, uint32_t byteSize)
+	{
+		D3D11_BUFFER_DESC desc{};
+		desc.ByteWidth = byteSize;
+		desc.CPUAccessFlags = 0u;
+		desc.Usage = D3D11_USAGE_DEFAULT;
+		desc.BindFlags = 0u;
+		desc.MiscFlags = D3D11_RESOURCE_MISC_DRAWINDIRECT_ARGS;
+		desc.StructureByteStride = 0u;
+		D3D11_SUBRESOURCE_DATA inData{};
+		inData.pSysMem = pData;
+		inData.SysMemPitch = inData.SysMemSlicePitch = 0;
+		return SUCCEEDED(dx11.pDevice->CreateBuffer(&desc, pData ? &inData : nullptr, ppBuffer));
+	}
+
 	bool createConstantBuffer(ID3D11Buffer** ppBuffer, const void* pData, size_t byteSize, bool immutable)
 	{
 		D3D11_BUFFER_DESC desc{};
@@ -193,10 +241,26 @@ namespace Okay
 		return success;
 	}
 
-	void getCPUTextureData(ID3D11Texture2D* pSourceTexture, void** ppOutData)
+	static uint32_t getBytesPerPixel(DXGI_FORMAT format)
+	{
+		switch (format)
+		{
+		case DXGI_FORMAT_R32G32B32A32_FLOAT:
+			return 16u;
+
+		case DXGI_FORMAT_R16G16B16A16_FLOAT:
+			return 8u;
+
+		default: // R8G8B8A8 & R32
+			return 4u;
+		}
+	}
+
+	// Writes the texture tightly packed into pOutData, which has to fit width * height * bytes per pixel
+	static void readTextureData(ID3D11Texture2D* pSourceTexture, unsigned char* pOutData)
 	{
 		OKAY_ASSERT(pSourceTexture);
-		OKAY_ASSERT(ppOutData);
+		OKAY_ASSERT(pOutData);
 
 		D3D11_TEXTURE2D_DESC desc{};
 		pSourceTexture->GetDesc(&desc);
@@ -213,27 +277,35 @@ namespace Okay
 		D3D11_MAPPED_SUBRESOURCE sub{};
 		dx11.pDeviceContext->Map(stagingBuffer, 0u, D3D11_MAP_READ, 0u, &sub);
 
-		uint32_t byteSize = sub.RowPitch * desc.Height;
-		(*ppOutData) = new unsigned char[byteSize] {};
+		const uint32_t rowByteSize = desc.Width * getBytesPerPixel(desc.Format);
 
 		// Need to copy row by row to account for potential padding between rows
 		// https://learn.microsoft.com/en-us/windows/win32/api/d3d11/ns-d3d11-d3d11_mapped_subresource#remarks
 		for (uint32_t y = 0; y < desc.Height; y++)
 		{
-			uint32_t targetOffset = y * desc.Width * 4;
+			uint32_t targetOffset = y * rowByteSize;
 			uint32_t sourceOffset = y * sub.RowPitch;
-			memcpy((unsigned char*)(*ppOutData) + targetOffset, (unsigned char*)sub.pData + sourceOffset, sub.RowPitch);
+			memcpy(pOutData + targetOffset, (unsigned char*)sub.pData + sourceOffset, rowByteSize);
 		}
 
 		dx11.pDeviceContext->Unmap(stagingBuffer, 0u);
 		DX11_RELEASE(stagingBuffer);
 	}
 
-	void scaleTexture(Texture& texture, uint32_t newWidth, uint32_t newHeight) // Move to ResourceManager?
+	void getCPUTextureData(ID3D11Texture2D* pSourceTexture, void** ppOutData)
 	{
-		if (texture.getWidth() == newWidth && texture.getHeight() == newHeight)
-			return;
+		OKAY_ASSERT(pSourceTexture);
+		OKAY_ASSERT(ppOutData);
+
+		D3D11_TEXTURE2D_DESC desc{};
+		pSourceTexture->GetDesc(&desc);
 
+		(*ppOutData) = new unsigned char[desc.Width * getBytesPerPixel(desc.Format) * desc.Height] {};
+		readTextureData(pSourceTexture, (unsigned char*)(*ppOutData));
+	}
+
+	Texture scaleTexture(const Texture& texture, uint32_t newWidth, uint32_t newHeight) // Move to ResourceManager?
+	{
 		ID3D11ShaderResourceView* pSRV = nullptr;
 		bool success = createSRVFromTextureData(&pSRV, texture);
 		OKAY_ASSERT(success);
@@ -261,16 +333,16 @@ namespace Okay
 
 		DX11_RELEASE(pSRV);
 
-		unsigned char* pNewTextureData = nullptr;
-		getCPUTextureData(*target.getBuffer(), (void**)&pNewTextureData);
+		PixelBuffer scaledPixels((uint64_t)newWidth * newHeight * 4u);
+		readTextureData(*target.getBuffer(), scaledPixels.getData());
 
-		texture = std::move(Texture(pNewTextureData, newWidth, newHeight, texture.getName()));
+		return Texture(std::move(scaledPixels), newWidth, newHeight, texture.getName());
 	}
 
-	void createTextureArray(ID3D11ShaderResourceView** ppSRV, const std::vector<Texture>& textures, uint32_t width, uint32_t height)
+	void createTextureArray(ID3D11ShaderResourceView** ppSRV, std::span<const unsigned char* const> pSlices, uint32_t width, uint32_t height, D3D11_USAGE usage)
 	{
 		OKAY_ASSERT(ppSRV);
-		OKAY_ASSERT(textures.size());
+		OKAY_ASSERT(pSlices.size());
 		OKAY_ASSERT(width);
 		OKAY_ASSERT(height);
 
@@ -282,12 +354,12 @@ namespace Okay
 		desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
 		desc.MipLevels = 1u;
 
-		desc.Usage = D3D11_USAGE_IMMUTABLE;
+		desc.Usage = usage;
 		desc.CPUAccessFlags = 0u;
 		desc.SampleDesc.Count = 1u;
 		desc.SampleDesc.Quality = 0u;
 
-		desc.ArraySize = (uint32_t)textures.size();
+		desc.ArraySize = (uint32_t)pSlices.size();
 		desc.MiscFlags = 0u;
 
 		std::vector<D3D11_SUBRESOURCE_DATA> textureDatas(desc.ArraySize);
@@ -296,7 +368,7 @@ namespace Okay
 		{
 			D3D11_SUBRESOURCE_DATA& resourceData = textureDatas[i];
 
-			resourceData.pSysMem = textures[i].getTextureData();
+			resourceData.pSysMem = pSlices[i];
 			resourceData.SysMemPitch = desc.Width * 4u;
 			resourceData.SysMemSlicePitch = 0u;
 		}
@@ -312,6 +384,51 @@ namespace Okay
 		OKAY_ASSERT(success);
 	}
 
+	void resizeTextureArray(ID3D11ShaderResourceView** ppSRV, uint32_t width, uint32_t height, uint32_t numSlices)
+	{
+		OKAY_ASSERT(ppSRV);
+		OKAY_ASSERT(numSlices);
+
+		D3D11_TEXTURE2D_DESC desc{};
+		desc.Width = width;
+		desc.Height = height;
+
+		desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+		desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		desc.MipLevels = 1u;
+
+		desc.Usage = D3D11_USAGE_DEFAULT;
+		desc.CPUAccessFlags = 0u;
+		desc.SampleDesc.Count = 1u;
+		desc.SampleDesc.Quality = 0u;
+
+		desc.ArraySize = numSlices;
+		desc.MiscFlags = 0u;
+
+		ID3D11Texture2D* pTextureArray = nullptr;
+		bool success = SUCCEEDED(dx11.pDevice->CreateTexture2D(&desc, nullptr, &pTextureArray));
+		OKAY_ASSERT(success);
+
+		if (*ppSRV)
+		{
+			ID3D11Resource* pOldTextureArray = nullptr;
+			(*ppSRV)->GetResource(&pOldTextureArray);
+
+			D3D11_TEXTURE2D_DESC oldDesc{};
+			((ID3D11Texture2D*)pOldTextureArray)->GetDesc(&oldDesc);
+
+			for (uint32_t i = 0; i < oldDesc.ArraySize && i < numSlices; i++)
+				dx11.pDeviceContext->CopySubresourceRegion(pTextureArray, D3D11CalcSubresource(0u, i, 1u), 0u, 0u, 0u, pOldTextureArray, D3D11CalcSubresource(0u, i, 1u), nullptr);
+
+			DX11_RELEASE(pOldTextureArray);
+			DX11_RELEASE(*ppSRV);
+		}
+
+		success = SUCCEEDED(dx11.pDevice->CreateShaderResourceView(pTextureArray, nullptr, ppSRV));
+		DX11_RELEASE(pTextureArray);
+		OKAY_ASSERT(success);
+	}
+
 	class IncludeReader : public ID3DInclude
 	{
 	public:
@@ -1,5 +1,6 @@
 #pragma once
 #include <d3d11.h>
+#include <span>
 #include <string>
 #include <vector>
 
@@ -21,7 +22,14 @@ namespace Okay
 	template<typename ShaderType>
 	void reloadShader(std::string_view path, ShaderType** ppShader);
 
-	bool createStructuredBuffer(ID3D11Buffer** ppBuffer, ID3D11ShaderResourceView** ppSRV, const void* pData, uint32_t eleByteSize, uint32_t numElements, bool immutable = false);
+	// Dynamic buffers are written with Map, default usage ones with UpdateSubresource
+	bool createStructuredBuffer(ID3D11Buffer** ppBuffer, ID3D11ShaderResourceView** ppSRV, const void* pData, uint32_t eleByteSize, uint32_t numElements, D3D11_USAGE usage = D3D11_USAGE_DYNAMIC);
+
+	// Default usage structured buffer that can be written to by shaders. The UAV gets an append/consume counter if appendable is true
+	bool createRWStructuredBuffer(ID3D11Buffer** ppBuffer, ID3D11ShaderResourceView** ppSRV, ID3D11UnorderedAccessView** ppUAV, uint32_t eleByteSize, uint32_t numElements, bool appendable = false);
+
+	// Buffer holding the arguments for DispatchIndirect/DrawInstancedIndirect etc.
+	bool createIndirectArgsBuffer(ID3D11Buffer** ppBuffer, const void* pData, uint32_t byteSize);
 
 	bool createConstantBuffer(ID3D11Buffer** ppBuffer, const void* pData, size_t byteSize, bool immutable = false);
 	void updateBuffer(ID3D11Buffer* pBuffer, const void* pData, size_t byteWidth);
@@ -31,7 +39,12 @@ namespace Okay
 
 	void getCPUTextureData(ID3D11Texture2D* pSourceTexture, void** ppOutData);
 
-	void scaleTexture(Texture& texture, uint32_t newWidth, uint32_t newHeight);
+	// Resampled copy of texture, the pixels are read back into the texture arena
+	Texture scaleTexture(const Texture& texture, uint32_t newWidth, uint32_t newHeight);
+
+	// One slice per entry of pSlices, each width * height RGBA8 texels
+	void createTextureArray(ID3D11ShaderResourceView** ppSRV, std::span<const unsigned char* const> pSlices, uint32_t width, uint32_t height, D3D11_USAGE usage = D3D11_USAGE_IMMUTABLE);
 
-	void createTextureArray(ID3D11ShaderResourceView** ppSRV, const std::vector<Texture>& textures, uint32_t width, uint32_t height);
+	// Replaces *ppSRV (which can be null) with a default usage array of numSlices, the slices it had are copied over on the GPU and the new ones are uninitialized
+	void resizeTextureArray(ID3D11ShaderResourceView** ppSRV, uint32_t width, uint32_t height, uint32_t numSlices);
 }
\ No newline at end of file
@@ -18,6 +18,7 @@ enum TextureFormat : uint32_t
 	INVALID = 0u,
 	F_8X1 = DXGI_FORMAT_R8_UNORM,
 	F_8X4 = DXGI_FORMAT_R8G8B8A8_UNORM,
+	F_32X1 = DXGI_FORMAT_R32_FLOAT,
 	F_32X4 = DXGI_FORMAT_R32G32B32A32_FLOAT,
 };
 
@@ -2,10 +2,12 @@
 
 #include "SMath.h"
 
+#include <cstring>
+#include <numeric>
 #include <stack>
 
 BvhBuilder::BvhBuilder(uint32_t maxLeafTriangles, uint32_t maxDepth)
-	:m_maxLeafTriangles(maxLeafTriangles), m_maxDepth(maxDepth), m_pMeshTris(nullptr)
+	:m_maxLeafTriangles(maxLeafTriangles), m_maxDepth(maxDepth), m_pPositions(nullptr), m_pTriangles(nullptr), m_numTriangles(0u)
 {
 }
 
@@ -13,8 +15,10 @@ void BvhBuilder::buildTree(const Mesh& mesh)
 {
 	reset();
 
-	m_pMeshTris = &mesh.getTrianglesPos();
-	size_t numTotalTriangles = m_pMeshTris->size();
+	m_pPositions = mesh.getPositions().data();
+	m_pTriangles = mesh.getTriangles().data();
+	m_numTriangles = mesh.getNumTriangles();
+	size_t numTotalTriangles = m_numTriangles;
 	// Assert numTotalTriangles?
 
 	// TODO: Calculate rough number of nodes based on numTriangles to reserve memory before starting
@@ -48,21 +52,20 @@ float BvhBuilder::evaluateSAH(BvhNode& node, uint32_t axis, float pos)
 		triIndex = node.triIndicies[i];
 
 		const glm::vec3& middle = m_triMiddles[triIndex];
-		const Okay::Triangle& triangle = (*m_pMeshTris)[triIndex];
 
 		if (middle[axis] < pos)
 		{
 			leftCount++;
-			leftBox.growTo(triangle.position[0]);
-			leftBox.growTo(triangle.position[1]);
-			leftBox.growTo(triangle.position[2]);
+			leftBox.growTo(getTriangleVertex(triIndex, 0u));
+			leftBox.growTo(getTriangleVertex(triIndex, 1u));
+			leftBox.growTo(getTriangleVertex(triIndex, 2u));
 		}
 		else
 		{
 			rightCount++;
-			rightBox.growTo(triangle.position[0]);
-			rightBox.growTo(triangle.position[1]);
-			rightBox.growTo(triangle.position[2]);
+			rightBox.growTo(getTriangleVertex(triIndex, 0u));
+			rightBox.growTo(getTriangleVertex(triIndex, 1u));
+			rightBox.growTo(getTriangleVertex(triIndex, 2u));
 		}
 	}
 	float cost = leftCount * leftBox.getArea() + rightCount * rightBox.getArea();
@@ -111,11 +114,10 @@ void BvhBuilder::buildTreeInternal()
 	};
 
 	// Precalculate the middle of all triangles
-	uint32_t numMeshTris = (uint32_t)m_pMeshTris->size();
-	m_triMiddles.resize(numMeshTris);
-	for (uint32_t i = 0; i < numMeshTris; i++)
+	m_triMiddles.resize(m_numTriangles);
+	for (uint32_t i = 0; i < m_numTriangles; i++)
 	{
-		m_triMiddles[i] = OkayMath::getMiddle((*m_pMeshTris)[i]);
+		m_triMiddles[i] = (getTriangleVertex(i, 0u) + getTriangleVertex(i, 1u) + getTriangleVertex(i, 2u)) * (1.f / 3.f);
 	}
 
 	// Root node
@@ -160,7 +162,6 @@ void BvhBuilder::buildTreeInternal()
 			triIndex = pCurrentNode->triIndicies[i];
 
 			const glm::vec3& middle = m_triMiddles[triIndex];
-			const Okay::Triangle& triangle = (*m_pMeshTris)[triIndex];
 
 			if (middle[axis] < splitPos)
 			{
@@ -211,10 +212,9 @@ void BvhBuilder::findAABB(BvhNode& node)
 	uint32_t numTriIndicies = (uint32_t)node.triIndicies.size();
 	for (uint32_t i = 0; i < numTriIndicies; i++)
 	{
-		const Okay::Triangle& currentTri = (*m_pMeshTris)[node.triIndicies[i]];
 		for (uint32_t k = 0; k < 3u; k++)
 		{
-			const glm::vec3& point = currentTri.position[k];
+			const glm::vec3& point = getTriangleVertex(node.triIndicies[i], k);
 
 			node.boundingBox.min = glm::min(point, node.boundingBox.min);
 			node.boundingBox.max = glm::max(point, node.boundingBox.max);
@@ -226,5 +226,168 @@ void BvhBuilder::reset()
 {
 	m_triMiddles.clear();
 	m_nodes.clear();
-	m_pMeshTris = nullptr;
+	m_pPositions = nullptr;
+	m_pTriangles = nullptr;
+	m_numTriangles = 0u;
+}
+
+void BvhBuilder::buildMeshTrees(const std::vector<Mesh>& meshes, std::vector<MeshDesc>& outMeshDescs, std::vector<GPUNode>& outNodes,
+	std::vector<glm::vec3>& outVertexPositions, std::vector<Okay::PackedVertexInfo>& outVertexInfo, std::vector<glm::uvec3>& outTriangles)
+{
+	std::vector<uint32_t> meshIndices(meshes.size());
+	std::iota(meshIndices.begin(), meshIndices.end(), 0u);
+
+	outNodes.clear();
+	outNodes.shrink_to_fit();
+
+	appendMeshTrees(meshes, meshIndices, 0u, 0u, 0u, outMeshDescs, outNodes, outVertexPositions, outVertexInfo, outTriangles);
+}
+
+void BvhBuilder::appendMeshTrees(const std::vector<Mesh>& meshes, std::span<const uint32_t> meshIndices, uint32_t numVertices, uint32_t numTriangles, uint32_t numNodes,
+	std::vector<MeshDesc>& outMeshDescs, std::vector<GPUNode>& outNodes, std::vector<glm::vec3>& outVertexPositions, std::vector<Okay::PackedVertexInfo>& outVertexInfo,
+	std::vector<glm::uvec3>& outTriangles)
+{
+	auto tryOffsetIdx = [](uint32_t idx, uint32_t offset)
+		{
+			return idx == Okay::INVALID_UINT ? idx : idx + offset;
+		};
+
+	if (outMeshDescs.size() < meshes.size())
+		outMeshDescs.resize(meshes.size());
+
+	uint32_t numNewTriangles = 0u;
+	uint32_t numNewVerticies = 0u;
+	for (uint32_t meshIdx : meshIndices)
+	{
+		numNewTriangles += meshes[meshIdx].getNumTriangles();
+		numNewVerticies += (uint32_t)meshes[meshIdx].getPositions().size();
+	}
+
+	uint32_t triBufferCurStartIdx = numTriangles;
+	outVertexPositions.clear();
+	outVertexInfo.clear();
+	outTriangles.clear();
+	outNodes.clear();
+	outVertexPositions.reserve(numNewVerticies);
+	outVertexInfo.reserve(numNewVerticies);
+	outTriangles.reserve(numNewTriangles);
+
+	for (uint32_t i : meshIndices)
+	{
+		const Mesh& mesh = meshes[i];
+		const std::span<const glm::uvec3> meshTriangles = mesh.getTriangles();
+
+		// The vertices keep their order, only the triangles are reordered into the leaves
+		const glm::uvec3 vertexOffset = glm::uvec3(numVertices + (uint32_t)outVertexPositions.size());
+		outVertexPositions.insert(outVertexPositions.end(), mesh.getPositions().begin(), mesh.getPositions().end());
+		outVertexInfo.insert(outVertexInfo.end(), mesh.getVertexInfo().begin(), mesh.getVertexInfo().end());
+
+		outMeshDescs[i].bvhTreeStartIdx = numNodes + (uint32_t)outNodes.size();
+		outMeshDescs[i].startIdx = triBufferCurStartIdx;
+		outMeshDescs[i].endIdx = triBufferCurStartIdx + (uint32_t)meshTriangles.size();
+
+		// The triangles of a prebuilt tree are already in leaf order, only the indices need offsetting
+		const std::span<const GPUNode> prebuiltNodes = mesh.getPrebuiltBvh(m_maxLeafTriangles, m_maxDepth);
+		if (!prebuiltNodes.empty())
+		{
+			const uint32_t gpuNodesPrevSize = numNodes + (uint32_t)outNodes.size();
+
+			for (const GPUNode& prebuiltNode : prebuiltNodes)
+			{
+				GPUNode& gpuNode = outNodes.emplace_back(prebuiltNode);
+				gpuNode.firstChildIdx = tryOffsetIdx(prebuiltNode.firstChildIdx, gpuNodesPrevSize);
+				gpuNode.triStart = tryOffsetIdx(prebuiltNode.triStart, triBufferCurStartIdx);
+				gpuNode.triEnd = tryOffsetIdx(prebuiltNode.triEnd, triBufferCurStartIdx);
+			}
+
+			for (const glm::uvec3& triangle : meshTriangles)
+				outTriangles.emplace_back(triangle + vertexOffset);
+
+			outMeshDescs[i].numBvhNodes = (uint32_t)prebuiltNodes.size();
+			triBufferCurStartIdx += (uint32_t)meshTriangles.size();
+			continue;
+		}
+
+		buildTree(mesh);
+
+		const uint32_t numMeshNodes = (uint32_t)m_nodes.size();
+		const uint32_t gpuNodesPrevSize = (uint32_t)outNodes.size();
+
+		outNodes.resize(gpuNodesPrevSize + numMeshNodes);
+
+		uint32_t localTriStart = 0u;
+		for (uint32_t k = 0; k < numMeshNodes; k++)
+		{
+			GPUNode& gpuNode = outNodes[gpuNodesPrevSize + k];
+			const BvhNode& bvhNode = m_nodes[k];
+
+			const uint32_t numTriIndicies = (uint32_t)bvhNode.triIndicies.size();
+
+			gpuNode.boundingBox = bvhNode.boundingBox;
+			gpuNode.firstChildIdx = tryOffsetIdx(bvhNode.firstChildIdx, numNodes + gpuNodesPrevSize);
+
+			if (!bvhNode.isLeaf())
+				continue;
+
+			gpuNode.triStart = triBufferCurStartIdx + localTriStart;
+			gpuNode.triEnd = gpuNode.triStart + numTriIndicies;
+
+			localTriStart += numTriIndicies;
+
+			for (uint32_t j = 0; j < numTriIndicies; j++)
+			{
+				outTriangles.emplace_back(meshTriangles[bvhNode.triIndicies[j]] + vertexOffset);
+			}
+		}
+
+		outMeshDescs[i].numBvhNodes = numMeshNodes;
+
+		triBufferCurStartIdx += (uint32_t)meshTriangles.size();
+	}
+}
+
+// Owns what the view of a prebuilt mesh points into
+struct PrebuiltMeshStorage
+{
+	MeshData meshData;
+	std::vector<GPUNode> nodes;
+};
+
+Mesh BvhBuilder::buildPrebuiltMesh(const Mesh& mesh)
+{
+	if (!mesh.getNumTriangles())
+		return mesh;
+
+	// A lone mesh keeps its vertex indices
+	std::shared_ptr<PrebuiltMeshStorage> pStorage = std::make_shared<PrebuiltMeshStorage>();
+	std::vector<MeshDesc> meshDescs;
+
+	buildMeshTrees({ mesh }, meshDescs, pStorage->nodes, pStorage->meshData.positions, pStorage->meshData.vertexInfo, pStorage->meshData.triangles);
+	pStorage->meshData.boundingBox = mesh.getBoundingBox();
+
+	MeshView view;
+	view.positions = pStorage->meshData.positions;
+	view.vertexInfo = pStorage->meshData.vertexInfo;
+	view.triangles = pStorage->meshData.triangles;
+	view.boundingBox = pStorage->meshData.boundingBox;
+	view.bvhNodes = pStorage->nodes;
+	view.bvhMaxLeafTriangles = m_maxLeafTriangles;
+	view.bvhMaxDepth = m_maxDepth;
+
+	return Mesh(std::move(pStorage), view, mesh.getName());
+}
+
+void BvhBuilder::buildHitTriangles(const std::vector<glm::vec3>& vertexPositions, const std::vector<glm::uvec3>& triangles, std::vector<HitTriangle>& outHitTriangles, uint32_t firstVertexIdx)
+{
+	outHitTriangles.resize(triangles.size());
+
+	for (size_t i = 0; i < triangles.size(); i++)
+	{
+		const glm::uvec3 triangle = triangles[i] - glm::uvec3(firstVertexIdx);
+		HitTriangle& hitTriangle = outHitTriangles[i];
+
+		hitTriangle.origin = vertexPositions[triangle.z];
+		hitTriangle.edge1 = vertexPositions[triangle.x] - hitTriangle.origin;
+		hitTriangle.edge2 = vertexPositions[triangle.y] - hitTriangle.origin;
+	}
 }
\ No newline at end of file
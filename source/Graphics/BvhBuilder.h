@@ -19,6 +19,28 @@ struct BvhNode
 	uint32_t firstChildIdx = Okay::INVALID_UINT;
 };
 
+// Defines the start & end triangle index for a mesh in the vertex buffer, as well as the index of the root node in m_bvhTree
+struct MeshDesc
+{
+	uint32_t startIdx;
+	uint32_t endIdx;
+	uint32_t bvhTreeStartIdx;
+	uint32_t numBvhNodes;
+};
+
+// What the intersection tests need from a triangle, precomputed so they don't fetch the vertices through the indices
+// edge1 = p0 - p2, edge2 = p1 - p2, the same as the tests computed them before
+struct HitTriangle
+{
+	glm::vec3 origin; // p2
+	glm::vec3 edge1;
+	glm::vec3 edge2;
+};
+
+// What both tracers build with when they are initiated, and the defaults of every tool that takes BVH settings
+static const uint32_t DEFAULT_BVH_MAX_LEAF_TRIANGLES = 5u;
+static const uint32_t DEFAULT_BVH_MAX_DEPTH = 30u;
+
 constexpr uint32_t ads = sizeof(std::vector<uint32_t>);
 constexpr uint32_t ads2 = sizeof(BvhNode);
 
@@ -34,14 +56,39 @@ public:
 	void buildTree(const Mesh& mesh);
 	inline const std::vector<BvhNode>& getTree() const;
 
+	// Builds the tree of every mesh and flattens them into one node list, used by both the GPU and the CPU tracer
+	// The triangles are reordered so each leaf covers the range [triStart, triEnd), the vertices are appended mesh by mesh
+	// and outTriangles holds vertex indices into the combined vertex arrays. Meshes with a tree prebuilt for these settings reuse it
+	void buildMeshTrees(const std::vector<Mesh>& meshes, std::vector<MeshDesc>& outMeshDescs, std::vector<GPUNode>& outNodes,
+		std::vector<glm::vec3>& outVertexPositions, std::vector<Okay::PackedVertexInfo>& outVertexInfo, std::vector<glm::uvec3>& outTriangles);
+
+	// buildMeshTrees for meshes[meshIndices] only, to add them after combined arrays that already hold numVertices, numTriangles & numNodes.
+	// The outputs get just the new part, with indices that point past the existing one. The descriptors of meshIndices are rewritten,
+	// a mesh that is already in the arrays (a replaced placeholder) gets a new range and its old one is left unused
+	void appendMeshTrees(const std::vector<Mesh>& meshes, std::span<const uint32_t> meshIndices, uint32_t numVertices, uint32_t numTriangles, uint32_t numNodes,
+		std::vector<MeshDesc>& outMeshDescs, std::vector<GPUNode>& outNodes, std::vector<glm::vec3>& outVertexPositions, std::vector<Okay::PackedVertexInfo>& outVertexInfo,
+		std::vector<glm::uvec3>& outTriangles);
+
+	// A copy of the mesh with its tree built in, the way .okm files store them. Meshes without triangles are returned as they are
+	Mesh buildPrebuiltMesh(const Mesh& mesh);
+
+	// One per triangle in outTriangles' order, so GPUNode::triStart & triEnd index both.
+	// vertexPositions[0] is vertex firstVertexIdx, for the new part of appendMeshTrees
+	static void buildHitTriangles(const std::vector<glm::vec3>& vertexPositions, const std::vector<glm::uvec3>& triangles, std::vector<HitTriangle>& outHitTriangles,
+		uint32_t firstVertexIdx = 0u);
+
 private:
 	uint32_t m_maxLeafTriangles;
 	uint32_t m_maxDepth;
 
-	const std::vector<Okay::Triangle>* m_pMeshTris;
+	const glm::vec3* m_pPositions;
+	const glm::uvec3* m_pTriangles;
+	uint32_t m_numTriangles;
 	std::vector<BvhNode> m_nodes;
 	std::vector<glm::vec3> m_triMiddles;
 
+	inline const glm::vec3& getTriangleVertex(uint32_t triIdx, uint32_t localVertexIdx) const;
+
 	void findAABB(BvhNode& node);
 	void reset();
 
@@ -57,3 +104,8 @@ inline void BvhBuilder::setMaxDepth(uint32_t maxDepth)					{ m_maxDepth = maxDep
 
 inline const std::vector<BvhNode>& BvhBuilder::getTree() const	{ return m_nodes; }
 
+inline const glm::vec3& BvhBuilder::getTriangleVertex(uint32_t triIdx, uint32_t localVertexIdx) const
+{
+	return m_pPositions[m_pTriangles[triIdx][localVertexIdx]];
+}
+
@@ -0,0 +1,1180 @@
+#include "CPURayTracer.h"
+#include "ResourceManager.h"
+#include "Scene/Scene.h"
+#include "shaders/ShaderResourceRegisters.h"
+#include "Threading.h"
+
+#include "glm/gtc/matrix_transform.hpp"
+#include "glm/gtc/constants.hpp"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb/stb_image.h"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstring>
+
+#define MIN_SURVIVAL_CHANCE (0.05f)
+#define AIR_REFRACTION_INDEX (1.f)
+#define BVH_MAX_STACK_SIZE 64u
+#define OCT_MAX_STACK_SIZE 64u
+
+// ---- Ports of GPU-Utilities.hlsli
+
+static float clampedDot(const glm::vec3& v, const glm::vec3& u)
+{
+	return glm::max(glm::dot(v, u), 0.f);
+}
+
+static float luminance(const glm::vec3& colour)
+{
+	return glm::dot(colour, glm::vec3(0.2126f, 0.7152f, 0.0722f));
+}
+
+static glm::vec3 refract(const glm::vec3& direction, const glm::vec3& normal, float refractionRatio)
+{
+	float cosTheta = glm::min(glm::dot(-direction, normal), 1.f);
+	glm::vec3 rayOutPerpendicular = refractionRatio * (direction + cosTheta * normal);
+	float ropLengthSqrd = glm::dot(rayOutPerpendicular, rayOutPerpendicular);
+
+	glm::vec3 rayOutParallel = -glm::sqrt(glm::abs(1.f - ropLengthSqrd)) * normal;
+	return rayOutPerpendicular + rayOutParallel;
+}
+
+static float reflectance(float cosine, float reflectionIdx)
+{
+	float r0 = (1.f - reflectionIdx) / (1.f + reflectionIdx);
+	r0 *= r0;
+	return r0 + (1.f + r0) * glm::pow(1.f - cosine, 5.f);
+}
+
+static glm::vec3 findReflectDirection(const glm::vec3& direction, const glm::vec3& normal, float roughness, Sampler& generator)
+{
+	glm::vec3 diffuseReflection = glm::normalize(normal + generator.unitVector());
+	glm::vec3 specularReflection = glm::reflect(direction, normal);
+	return glm::normalize(glm::mix(specularReflection, diffuseReflection, roughness));
+}
+
+static glm::vec3 findTransparencyBounce(glm::vec3 direction, glm::vec3 normal, float refractionIdx, Sampler& generator)
+{
+	bool hitFrontFace = glm::dot(direction, normal) < 0.f;
+	float refractionRatio = hitFrontFace ? AIR_REFRACTION_INDEX / refractionIdx : refractionIdx;
+
+	if (!hitFrontFace)
+		normal *= -1.f;
+
+	float cosTheta = glm::dot(-direction, normal);
+	float sinTheta = glm::sqrt(1.f - cosTheta * cosTheta);
+
+	bool cannotRefract = refractionRatio * sinTheta > 1.f;
+
+	if (cannotRefract || reflectance(cosTheta, refractionRatio) > generator.next())
+		direction = glm::reflect(direction, normal);
+
+	return refract(direction, normal, refractionRatio);
+}
+
+template<typename T>
+static T barycentricInterpolation(const glm::vec3& uvw, const T& value0, const T& value1, const T& value2)
+{
+	return value0 * uvw.x + value1 * uvw.y + value2 * uvw.z;
+}
+
+// Returns distance to hit. -1 if miss
+static float rayAndSphere(const glm::vec3& rayOrigin, const glm::vec3& rayDirection, const glm::vec3& spherePos, float sphereRadius)
+{
+	glm::vec3 rayToSphere = spherePos - rayOrigin;
+	float distToClosestPoint = glm::dot(rayToSphere, rayDirection);
+	float rayToSphereMagSqrd = glm::dot(rayToSphere, rayToSphere);
+	float sphereRadiusSqrd = sphereRadius * sphereRadius;
+
+	if (distToClosestPoint < 0.f && rayToSphereMagSqrd > sphereRadiusSqrd)
+		return -1.f;
+
+	float sideA = rayToSphereMagSqrd - distToClosestPoint * distToClosestPoint;
+	if (sideA > sphereRadiusSqrd)
+		return -1.f;
+
+	float sideB = glm::sqrt(sphereRadiusSqrd - sideA);
+	return rayToSphereMagSqrd > sphereRadiusSqrd ? distToClosestPoint - sideB : distToClosestPoint + sideB;
+}
+
+// Möller-Trumbore against every lane, the same operations as Collision::RayAndTriangle in the shaders but without branches
+// Returns a mask of the lanes that were hit, outDistances & outBaryUVCoords are only valid for those
+static uint32_t rayAndTrianglePacket(const glm::vec3& rayOrigin, const glm::vec3& rayDirection, const TrianglePacket& packet,
+	float* pOutDistances, glm::vec2* pOutBaryUVCoords)
+{
+	static const float EPSILON = 0.000001f;
+
+	bool hits[TrianglePacket::WIDTH];
+	float baryU[TrianglePacket::WIDTH], baryV[TrianglePacket::WIDTH];
+
+	for (uint32_t i = 0; i < TrianglePacket::WIDTH; i++)
+	{
+		const glm::vec3 E1 = glm::vec3(packet.edge1X[i], packet.edge1Y[i], packet.edge1Z[i]);
+		const glm::vec3 E2 = glm::vec3(packet.edge2X[i], packet.edge2Y[i], packet.edge2Z[i]);
+
+		const glm::vec3 cross1 = glm::cross(rayDirection, E2);
+		const float determinant = glm::dot(E1, cross1);
+		const float inverseDet = 1.f / determinant;
+
+		const glm::vec3 rayMoved = rayOrigin - glm::vec3(packet.originX[i], packet.originY[i], packet.originZ[i]);
+		baryU[i] = glm::dot(rayMoved, cross1) * inverseDet;
+
+		const glm::vec3 cross2 = glm::cross(rayMoved, E1);
+		baryV[i] = glm::dot(rayDirection, cross2) * inverseDet;
+
+		pOutDistances[i] = glm::dot(E2, cross2) * inverseDet;
+
+		hits[i] = !(determinant < EPSILON && determinant > -EPSILON) && baryU[i] >= -EPSILON &&
+			baryV[i] >= -EPSILON && baryU[i] + baryV[i] <= 1.f && pOutDistances[i] >= -EPSILON;
+	}
+
+	uint32_t hitMask = 0u;
+	for (uint32_t i = 0; i < TrianglePacket::WIDTH; i++)
+	{
+		pOutBaryUVCoords[i] = glm::vec2(baryU[i], baryV[i]);
+		hitMask |= hits[i] ? 1u << i : 0u;
+	}
+
+	return hitMask;
+}
+
+static float rayAndAABBDist(const glm::vec3& rayOrigin, const glm::vec3& inverseRayDir, const Okay::AABB& aabb)
+{
+	glm::vec3 tMin = (aabb.min - rayOrigin) * inverseRayDir;
+	glm::vec3 tMax = (aabb.max - rayOrigin) * inverseRayDir;
+	glm::vec3 t1 = glm::min(tMin, tMax);
+	glm::vec3 t2 = glm::max(tMin, tMax);
+
+	float distFar = glm::min(glm::min(t2.x, t2.y), t2.z);
+	float distNear = glm::max(glm::max(t1.x, t1.y), t1.z);
+
+	bool didHit = distFar >= distNear && distFar > 0.f;
+	return didHit ? distNear : FLT_MAX;
+}
+
+// Bilinear filtering with the texel centers at (i + 0.5) / size, the same as the GPU sampler
+template<typename FetchFunction>
+static glm::vec4 sampleBilinear(glm::vec2 texelCoord, FetchFunction fetch)
+{
+	texelCoord -= 0.5f;
+	const glm::vec2 base = glm::floor(texelCoord);
+	const glm::vec2 frac = texelCoord - base;
+	const int x = (int)base.x, y = (int)base.y;
+
+	const glm::vec4 top = glm::mix(fetch(x, y), fetch(x + 1, y), frac.x);
+	const glm::vec4 bottom = glm::mix(fetch(x, y + 1), fetch(x + 1, y + 1), frac.x);
+	return glm::mix(top, bottom, frac.y);
+}
+
+
+CPURayTracer::CPURayTracer(uint32_t numWorkers)
+	:m_pScene(nullptr), m_pResourceManager(nullptr), m_scheduler(numWorkers), m_imageDims(0u),
+	m_numAccumulationFrames(0u), m_frameInFlight(false), m_reprojectHistory(false),
+	m_motionFrame(false), m_motionFrameIdx(0u), m_motionPixelOffset(0u), m_pRayRecording(nullptr), m_bvhMaxDepth(DEFAULT_BVH_MAX_DEPTH),
+	m_bvhMaxLeafTriangles(DEFAULT_BVH_MAX_LEAF_TRIANGLES), m_environmentMapDims(0u), m_environmentMapIsCross(false)
+{
+}
+
+CPURayTracer::~CPURayTracer()
+{
+	m_scheduler.cancel();
+}
+
+void CPURayTracer::initiate(const ResourceManager& resourceManager, glm::uvec2 imageDims, std::string_view environmentMapPath)
+{
+	m_pResourceManager = &resourceManager;
+
+	Sampler::generateBlueNoise(BLUE_NOISE_TILE_SIZE, m_blueNoise);
+	loadEnvironmentMap(environmentMapPath);
+	loadMeshAndBvhData(DEFAULT_BVH_MAX_DEPTH, DEFAULT_BVH_MAX_LEAF_TRIANGLES);
+
+	resize(imageDims);
+}
+
+void CPURayTracer::loadMeshAndBvhData(uint32_t maxDepth, uint32_t maxLeafTriangles)
+{
+	m_scheduler.cancel();
+
+	auto startTime = std::chrono::system_clock::now();
+
+	m_bvhMaxDepth = maxDepth;
+	m_bvhMaxLeafTriangles = maxLeafTriangles;
+
+	std::vector<glm::vec3> vertexPositions;
+	std::vector<HitTriangle> hitTriangles;
+
+	BvhBuilder bvhBuilder(maxLeafTriangles, maxDepth);
+	bvhBuilder.buildMeshTrees(m_pResourceManager->getAll<Mesh>(), m_meshDescs, m_bvhNodes, vertexPositions, m_vertexInfo, m_triangles);
+	BvhBuilder::buildHitTriangles(vertexPositions, m_triangles, hitTriangles);
+
+	m_trianglePackets.clear();
+	m_nodePacketStarts.clear();
+	addTrianglePackets(0u, hitTriangles, 0u);
+
+	std::chrono::duration<float> duration = std::chrono::system_clock::now() - startTime;
+	printf("\nCPU tracer Bvh Tree build: %.3fms (%zu nodes, %zu triangles, %zu packets)\n", duration.count() * 1000.f, m_bvhNodes.size(), m_triangles.size(), m_trianglePackets.size());
+
+	resetAccumulation();
+}
+
+void CPURayTracer::appendMeshAndBvhData(std::span<const AssetID> replacedMeshes)
+{
+	const std::vector<Mesh>& meshes = m_pResourceManager->getAll<Mesh>();
+	const uint32_t numLoadedMeshes = (uint32_t)m_meshDescs.size();
+
+	std::vector<uint32_t> meshIndices;
+	for (AssetID meshId : replacedMeshes)
+	{
+		if ((uint32_t)meshId < numLoadedMeshes)
+			meshIndices.emplace_back(meshId);
+	}
+
+	for (uint32_t i = numLoadedMeshes; i < (uint32_t)meshes.size(); i++)
+		meshIndices.emplace_back(i);
+
+	if (meshIndices.empty())
+		return;
+
+	m_scheduler.cancel();
+
+	auto startTime = std::chrono::system_clock::now();
+
+	const uint32_t firstNodeIdx = (uint32_t)m_bvhNodes.size();
+	const uint32_t firstTriangleIdx = (uint32_t)m_triangles.size();
+	const uint32_t firstVertexIdx = (uint32_t)m_vertexInfo.size();
+
+	std::vector<GPUNode> nodes;
+	std::vector<glm::vec3> vertexPositions;
+	std::vector<Okay::PackedVertexInfo> vertexInfo;
+	std::vector<glm::uvec3> triangles;
+	std::vector<HitTriangle> hitTriangles;
+
+	BvhBuilder bvhBuilder(m_bvhMaxLeafTriangles, m_bvhMaxDepth);
+	bvhBuilder.appendMeshTrees(meshes, meshIndices, firstVertexIdx, firstTriangleIdx, firstNodeIdx, m_meshDescs, nodes, vertexPositions, vertexInfo, triangles);
+	BvhBuilder::buildHitTriangles(vertexPositions, triangles, hitTriangles, firstVertexIdx);
+
+	m_bvhNodes.insert(m_bvhNodes.end(), nodes.begin(), nodes.end());
+	m_vertexInfo.insert(m_vertexInfo.end(), vertexInfo.begin(), vertexInfo.end());
+	m_triangles.insert(m_triangles.end(), triangles.begin(), triangles.end());
+	addTrianglePackets(firstNodeIdx, hitTriangles, firstTriangleIdx);
+
+	std::chrono::duration<float> duration = std::chrono::system_clock::now() - startTime;
+	printf("\nCPU tracer Bvh Tree append: %u meshes: %.3fms (%zu nodes, %zu triangles, %zu packets)\n", (uint32_t)meshIndices.size(), duration.count() * 1000.f,
+		nodes.size(), triangles.size(), m_trianglePackets.size());
+
+	resetAccumulation();
+}
+
+void CPURayTracer::addTrianglePackets(uint32_t firstNodeIdx, const std::vector<HitTriangle>& hitTriangles, uint32_t firstTriangleIdx)
+{
+	m_nodePacketStarts.resize(m_bvhNodes.size(), Okay::INVALID_UINT);
+
+	for (uint32_t i = firstNodeIdx; i < (uint32_t)m_bvhNodes.size(); i++)
+	{
+		const GPUNode& node = m_bvhNodes[i];
+		if (node.firstChildIdx != Okay::INVALID_UINT)
+			continue;
+
+		m_nodePacketStarts[i] = (uint32_t)m_trianglePackets.size();
+
+		for (uint32_t triIdx = node.triStart; triIdx < node.triEnd; triIdx += TrianglePacket::WIDTH)
+		{
+			TrianglePacket& packet = m_trianglePackets.emplace_back();
+			memset(&packet, 0, sizeof(TrianglePacket));
+
+			for (uint32_t lane = 0; lane < TrianglePacket::WIDTH && triIdx + lane < node.triEnd; lane++)
+			{
+				const HitTriangle& hitTriangle = hitTriangles[triIdx + lane - firstTriangleIdx];
+				packet.originX[lane] = hitTriangle.origin.x;
+				packet.originY[lane] = hitTriangle.origin.y;
+				packet.originZ[lane] = hitTriangle.origin.z;
+				packet.edge1X[lane] = hitTriangle.edge1.x;
+				packet.edge1Y[lane] = hitTriangle.edge1.y;
+				packet.edge1Z[lane] = hitTriangle.edge1.z;
+				packet.edge2X[lane] = hitTriangle.edge2.x;
+				packet.edge2Y[lane] = hitTriangle.edge2.y;
+				packet.edge2Z[lane] = hitTriangle.edge2.z;
+			}
+		}
+	}
+}
+
+bool CPURayTracer::update()
+{
+	OKAY_ASSERT(m_pScene);
+
+	bool frameFinished = false;
+
+	// Moving the camera cancels the frame in flight
+	const bool cameraMoved = handleCameraMovement();
+
+	if (!cameraMoved && m_scheduler.isRunning())
+	{
+		return false;
+	}
+	else if (!cameraMoved && m_frameInFlight)
+	{
+		finishFrame();
+		resolveAccumulation();
+		frameFinished = true;
+	}
+
+	startFrame();
+	return frameFinished;
+}
+
+void CPURayTracer::renderSamples(uint32_t numSamples)
+{
+	OKAY_ASSERT(m_pScene);
+
+	m_scheduler.wait();
+	if (m_frameInFlight)
+		finishFrame();
+
+	handleCameraMovement();
+
+	for (uint32_t i = 0; i < numSamples; i++)
+	{
+		startFrame();
+		m_scheduler.wait();
+		finishFrame();
+	}
+
+	resolveAccumulation();
+}
+
+void CPURayTracer::resize(glm::uvec2 imageDims)
+{
+	m_scheduler.cancel();
+
+	m_imageDims = imageDims;
+
+	const size_t numPixels = (size_t)imageDims.x * imageDims.y;
+	m_resolvedPixels.assign(numPixels, glm::vec4(0.f, 0.f, 0.f, 1.f));
+	m_albedoBuffer.assign(numPixels, glm::vec4(1.f));
+	m_normalDepthBuffer.assign(numPixels, glm::vec4(0.f, 0.f, 0.f, -1.f));
+	m_surfaceBuffer.assign(numPixels, Reprojection::Surface());
+
+	resetAccumulation();
+}
+
+void CPURayTracer::resetAccumulation()
+{
+	m_scheduler.cancel();
+
+	m_frameInFlight = false;
+	m_reprojectHistory = false;
+	m_numAccumulationFrames = 0u;
+	m_accumulation.assign((size_t)m_imageDims.x * m_imageDims.y, glm::vec4(0.f));
+	m_secondMoment.assign((size_t)m_imageDims.x * m_imageDims.y, 0.f);
+
+	const glm::uvec2 numTiles = TileScheduler::calculateNumTiles(m_imageDims);
+	m_activeTiles.assign((size_t)numTiles.x * numTiles.y, 1u);
+}
+
+void CPURayTracer::setRayRecording(RayRecording* pRecording)
+{
+	m_scheduler.wait();
+	if (m_frameInFlight)
+		finishFrame();
+
+	m_pRayRecording = pRecording;
+}
+
+bool CPURayTracer::replayRays(const RayRecording& recording, std::vector<RayHit>& outHits)
+{
+	static const uint32_t RAYS_PER_JOB = 1024u;
+
+	OKAY_ASSERT(m_pScene);
+
+	resetAccumulation();
+	copySceneData();
+
+	if (recording.numInstances != (uint32_t)m_meshInstances.size() || recording.numTriangles != (uint32_t)m_triangles.size())
+	{
+		printf("The recording has %u instances and %u triangles, the scene has %zu and %zu\n",
+			recording.numInstances, recording.numTriangles, m_meshInstances.size(), m_triangles.size());
+		return false;
+	}
+
+	const uint32_t numRays = (uint32_t)recording.rays.size();
+	outHits.resize(numRays);
+
+	Okay::parallelFor((numRays + RAYS_PER_JOB - 1u) / RAYS_PER_JOB, [&](uint32_t jobIdx)
+		{
+			const uint32_t endIdx = glm::min((jobIdx + 1u) * RAYS_PER_JOB, numRays);
+			for (uint32_t i = jobIdx * RAYS_PER_JOB; i < endIdx; i++)
+			{
+				const RecordedRay& recordedRay = recording.rays[i];
+				RayHit& hit = outHits[i];
+
+				const TraversalResult result = traverseScene(Ray{ recordedRay.origin, recordedRay.direction }, recordedRay.tMax, hit.counters);
+				hit.distance = result.distance;
+				hit.instanceIdx = result.instanceIdx;
+			}
+		});
+
+	return true;
+}
+
+CPURayTracer::CameraData CPURayTracer::calculateCameraData() const
+{
+	// Same as RayTracer::calculateProjectionData(), without the transposes
+	const Entity camera = m_pScene->getFirstCamera();
+	OKAY_ASSERT(camera.isValid());
+
+	const Camera& camData = camera.getComponent<Camera>();
+	const Transform& camTra = camera.getComponent<Transform>();
+
+	const glm::mat4 projectionMatrix = glm::perspectiveFovLH(glm::radians(camData.fov), (float)m_imageDims.x, (float)m_imageDims.y, camData.nearZ, camData.farZ);
+	const glm::mat4 viewMatrix = glm::lookAtLH(camTra.position, camTra.position + camTra.getForwardVec(), glm::vec3(0.f, 1.f, 0.f));
+
+	CameraData cameraData;
+	cameraData.inverseProjectionMatrix = glm::inverse(projectionMatrix);
+	cameraData.inverseViewMatrix = glm::inverse(viewMatrix);
+	cameraData.viewProjectionMatrix = projectionMatrix * viewMatrix;
+	cameraData.position = camTra.position;
+	cameraData.rightDir = camTra.getRightVec();
+	cameraData.upDir = camTra.getUpVec();
+	cameraData.nearZ = camData.nearZ;
+
+	return cameraData;
+}
+
+bool CPURayTracer::handleCameraMovement()
+{
+	if (calculateCameraData().viewProjectionMatrix == m_camera.viewProjectionMatrix)
+		return false;
+
+	m_scheduler.cancel();
+
+	// Without a traced frame there is no G-buffer for the last view, a history that is still waiting is kept instead
+	// Motion frames reproject the last motion frame instead
+	const bool reprojectHistory = m_settings.reprojectionEnabled && !m_settings.motionModeEnabled && (m_numAccumulationFrames || m_reprojectHistory);
+	if (reprojectHistory && m_numAccumulationFrames)
+		storeHistory();
+
+	resetAccumulation();
+	m_reprojectHistory = reprojectHistory;
+
+	return true;
+}
+
+// The accumulation is swapped out, resetAccumulation() reallocates it
+void CPURayTracer::storeHistory()
+{
+	m_history.viewProjection = m_camera.viewProjectionMatrix;
+	m_history.cameraPosition = m_camera.position;
+	m_history.textureDims = m_imageDims;
+
+	m_history.accumulation.swap(m_accumulation);
+	m_history.secondMoment.swap(m_secondMoment);
+	m_history.surfaces = m_surfaceBuffer;
+}
+
+void CPURayTracer::copySceneData()
+{
+	const entt::registry& reg = m_pScene->getRegistry();
+
+	auto meshView = reg.view<MeshComponent, Transform>();
+
+	// The same entities OctTree::build() takes
+	const uint32_t numMeshes = m_pResourceManager->getCount<Mesh>();
+	uint32_t numMeshEntities = 0u;
+	for (entt::entity entity : meshView)
+		numMeshEntities += (uint32_t)meshView.get<const MeshComponent>(entity).meshID < numMeshes;
+
+	// The same settings as the application's GPU tree, the stack (OCT_MAX_STACK_SIZE) would fit a deeper one
+	if (m_octTree.empty() || numMeshEntities != (uint32_t)m_octTreeMeshEntities.size() || !OctTree::refit(*m_pScene, *m_pResourceManager, m_octTree))
+		OctTree::build(*m_pScene, *m_pResourceManager, DEFAULT_OCT_TREE_MAX_DEPTH, DEFAULT_OCT_TREE_MAX_LEAF_ENTITIES, m_octTree);
+
+	OctTree::flatten(*m_pScene, m_octTree, m_octTreeNodes, m_octTreeMeshEntities);
+
+	m_meshInstances.clear();
+	m_meshInstances.reserve(m_octTreeMeshEntities.size());
+	for (GPU_OctTreeNode& octNode : m_octTreeNodes)
+	{
+		const uint32_t entitiesStartIdx = octNode.meshesStartIdx;
+		const uint32_t entitiesEndIdx = octNode.meshesEndIdx;
+
+		octNode.meshesStartIdx = (uint32_t)m_meshInstances.size();
+		for (uint32_t i = entitiesStartIdx; i < entitiesEndIdx; i++)
+		{
+			auto [meshComp, transform] = meshView[m_octTreeMeshEntities[i]];
+
+			// Meshes loaded since the last loadMeshAndBvhData() or appendMeshAndBvhData() have no BVH here yet
+			if ((uint32_t)meshComp.meshID >= (uint32_t)m_meshDescs.size())
+				continue;
+
+			MeshInstance& instance = m_meshInstances.emplace_back();
+			instance.transformMatrix = transform.calculateMatrix();
+			instance.inverseTransformMatrix = glm::inverse(instance.transformMatrix);
+			instance.material = meshComp.material;
+			instance.bvhNodeStartIdx = m_meshDescs[meshComp.meshID].bvhTreeStartIdx;
+
+			// The world box of the root node lets most instances of an oct tree node be skipped without transforming the ray
+			instance.worldBoundingBox = OctTree::calculateWorldBox(m_bvhNodes[instance.bvhNodeStartIdx].boundingBox, instance.transformMatrix);
+		}
+		octNode.meshesEndIdx = (uint32_t)m_meshInstances.size();
+	}
+
+	m_directionalLights.clear();
+	auto dirLightView = reg.view<DirectionalLight, Transform>();
+	for (entt::entity entity : dirLightView)
+	{
+		auto [dirLight, transform] = dirLightView[entity];
+
+		GPU_DirectionalLight& light = m_directionalLights.emplace_back();
+		light.light = dirLight;
+		light.light.effectiveAngle = glm::cos(glm::radians(dirLight.effectiveAngle));
+		light.direction = transform.getForwardVec();
+	}
+
+	m_pointLights.clear();
+	auto pointLightView = reg.view<PointLight, Transform>();
+	for (entt::entity entity : pointLightView)
+	{
+		auto [pointLight, transform] = pointLightView[entity];
+
+		GPU_PointLight& light = m_pointLights.emplace_back();
+		light.light = pointLight;
+		light.position = transform.position;
+	}
+
+	m_spotLights.clear();
+	auto spotLightView = reg.view<SpotLight, Transform>();
+	for (entt::entity entity : spotLightView)
+	{
+		auto [spotLight, transform] = spotLightView[entity];
+
+		GPU_SpotLight& light = m_spotLights.emplace_back();
+		light.light = spotLight;
+		light.light.maxAngle = glm::cos(glm::radians(spotLight.maxAngle));
+		light.position = transform.position;
+		light.direction = transform.getForwardVec();
+	}
+}
+
+void CPURayTracer::startFrame()
+{
+	const CameraData camera = calculateCameraData();
+
+	// The first frame has no camera to have moved from
+	const bool cameraMoved = m_camera.viewProjectionMatrix != glm::mat4(0.f) && camera.viewProjectionMatrix != m_camera.viewProjectionMatrix;
+	const bool motionFrame = m_settings.motionModeEnabled && m_settings.motionPixelStride > 1u && cameraMoved;
+
+	// Camera stopped, refine from a clean full resolution accumulation
+	if (m_motionFrame && !motionFrame)
+		resetAccumulation();
+	else if (motionFrame && !m_motionFrame)
+		m_motionHistory = Reprojection::History();
+
+	if (motionFrame)
+		m_motionPixelOffset = MotionMode::getInterleavedPixelOffset(m_motionFrameIdx++, m_settings.motionPixelStride);
+
+	m_motionFrame = motionFrame;
+	m_camera = camera;
+	copySceneData();
+	m_frameSettings = m_settings;
+
+	if (m_pRayRecording)
+	{
+		const glm::uvec2 numTiles = TileScheduler::calculateNumTiles(m_imageDims);
+		m_tileRecordedRays.resize((size_t)numTiles.x * numTiles.y);
+
+		for (std::vector<RecordedRay>& tileRays : m_tileRecordedRays)
+			tileRays.clear();
+	}
+	else
+	{
+		m_tileRecordedRays.clear();
+	}
+
+	m_frameInFlight = true;
+	m_scheduler.start(m_imageDims, [&](const TileScheduler::Tile& tile, TileScheduler::TileStats& stats)
+		{
+			traceTile(tile, stats);
+		}, m_frameSettings.adaptiveSamplingEnabled && !m_motionFrame ? std::span<const uint8_t>(m_activeTiles) : std::span<const uint8_t>());
+}
+
+void CPURayTracer::finishFrame()
+{
+	m_frameInFlight = false;
+	if (!m_motionFrame)
+		m_numAccumulationFrames++;
+
+	const std::vector<TileScheduler::TileStats>& tileStats = m_scheduler.getTileStats();
+
+	m_lastFrameStats.frameTime = m_scheduler.getLastFrameTime();
+	m_lastFrameStats.numRays = m_scheduler.getTotalRays();
+	m_lastFrameStats.numTiles = (uint32_t)tileStats.size();
+	m_lastFrameStats.numActiveTiles = m_frameSettings.adaptiveSamplingEnabled && !m_motionFrame ?
+		(uint32_t)std::count(m_activeTiles.begin(), m_activeTiles.end(), (uint8_t)1u) : (uint32_t)tileStats.size();
+	m_lastFrameStats.numStolenTiles = m_scheduler.getNumStolenTiles();
+	m_lastFrameStats.slowestTileTime = 0.f;
+	m_lastFrameStats.numReprojectedPixels = 0u;
+
+	for (const TileScheduler::TileStats& stats : tileStats)
+		m_lastFrameStats.slowestTileTime = glm::max(m_lastFrameStats.slowestTileTime, stats.renderTime);
+
+	if (m_pRayRecording && !m_tileRecordedRays.empty())
+	{
+		m_pRayRecording->imageDims = m_imageDims;
+		m_pRayRecording->numInstances = (uint32_t)m_meshInstances.size();
+		m_pRayRecording->numTriangles = (uint32_t)m_triangles.size();
+
+		for (const std::vector<RecordedRay>& tileRays : m_tileRecordedRays)
+			m_pRayRecording->rays.insert(m_pRayRecording->rays.end(), tileRays.begin(), tileRays.end());
+	}
+
+	if (m_motionFrame)
+	{
+		m_lastFrameStats.numReprojectedPixels = MotionMode::resolveFrame(m_motionHistory, m_frameSettings.reprojection, m_frameSettings.motionPixelStride,
+			m_motionPixelOffset, m_imageDims, m_surfaceBuffer, m_accumulation);
+
+		// The next motion frame reprojects this one
+		m_motionHistory.viewProjection = m_camera.viewProjectionMatrix;
+		m_motionHistory.cameraPosition = m_camera.position;
+		m_motionHistory.textureDims = m_imageDims;
+		m_motionHistory.accumulation = m_accumulation;
+		m_motionHistory.surfaces = m_surfaceBuffer;
+		return;
+	}
+
+	// Only the first frame after the camera moved has this view's G-buffer and nothing more than its own sample
+	if (m_reprojectHistory)
+	{
+		m_lastFrameStats.numReprojectedPixels = Reprojection::reprojectAccumulation(m_history, m_surfaceBuffer, m_frameSettings.reprojection, m_accumulation, m_secondMoment);
+		m_reprojectHistory = false;
+	}
+
+	const uint32_t updateInterval = glm::max(m_frameSettings.adaptiveUpdateInterval, 1u);
+	if (m_frameSettings.adaptiveSamplingEnabled && m_numAccumulationFrames % updateInterval == 0u)
+		updateActiveTiles();
+}
+
+void CPURayTracer::resolveAccumulation()
+{
+	// Motion frames hold one colour per pixel, the alpha channel is its age
+	if (m_motionFrame)
+	{
+		for (size_t i = 0; i < m_accumulation.size(); i++)
+			m_resolvedPixels[i] = glm::vec4(glm::vec3(m_accumulation[i]), 1.f);
+
+		return;
+	}
+
+	for (size_t i = 0; i < m_accumulation.size(); i++)
+	{
+		const glm::vec4& accumulated = m_accumulation[i];
+		m_resolvedPixels[i] = accumulated.w > 0.f ? glm::vec4(glm::vec3(accumulated) / accumulated.w, 1.f) : glm::vec4(0.f, 0.f, 0.f, 1.f);
+	}
+}
+
+// Port of AdaptiveTilesCS, a tile stays active while any of its pixels is above the error threshold
+void CPURayTracer::updateActiveTiles()
+{
+	const glm::uvec2 numTiles = TileScheduler::calculateNumTiles(m_imageDims);
+	const glm::uvec2 tileSize(THREAD_GROUP_SIZE_X, THREAD_GROUP_SIZE_Y);
+
+	Okay::parallelFor(numTiles.x * numTiles.y, [&](uint32_t tileIdx)
+		{
+			const glm::uvec2 tileMin = glm::uvec2(tileIdx % numTiles.x, tileIdx / numTiles.x) * tileSize;
+			const glm::uvec2 tileMax = glm::min(tileMin + tileSize, m_imageDims);
+
+			float maxError = 0.f;
+			for (uint32_t y = tileMin.y; y < tileMax.y && maxError <= m_frameSettings.adaptiveErrorThreshold; y++)
+			{
+				for (uint32_t x = tileMin.x; x < tileMax.x; x++)
+				{
+					const size_t pixelIdx = (size_t)y * m_imageDims.x + x;
+					const glm::vec4& accumulated = m_accumulation[pixelIdx];
+					const float numSamples = accumulated.w;
+
+					// Pixels with too few samples can't be trusted, they keep the tile active
+					if (numSamples < (float)m_frameSettings.adaptiveMinSamples || numSamples <= 1.f)
+					{
+						maxError = FLT_MAX;
+						break;
+					}
+
+					const float mean = luminance(glm::vec3(accumulated)) / numSamples;
+					const float variance = glm::max(m_secondMoment[pixelIdx] / numSamples - mean * mean, 0.f) * numSamples / (numSamples - 1.f);
+					maxError = glm::max(maxError, glm::sqrt(variance / numSamples) / (mean + 0.001f));
+				}
+			}
+
+			m_activeTiles[tileIdx] = maxError > m_frameSettings.adaptiveErrorThreshold ? 1u : 0u;
+		});
+}
+
+void CPURayTracer::traceTile(const TileScheduler::Tile& tile, TileScheduler::TileStats& stats)
+{
+	const bool writeAuxiliaryBuffers = m_motionFrame || m_numAccumulationFrames == 0u;
+	std::vector<RecordedRay>* pRecordedRays = m_tileRecordedRays.empty() ? nullptr : &m_tileRecordedRays[tile.idx];
+
+	for (uint32_t y = tile.min.y; y < tile.max.y; y++)
+	{
+		// Cancelled rows are left as they are, the accumulation is reset before the next frame anyway
+		if (m_scheduler.isCancelled())
+			return;
+
+		for (uint32_t x = tile.min.x; x < tile.max.x; x++)
+		{
+			if (m_motionFrame && !MotionMode::isTracedPixel(glm::uvec2(x, y), m_frameSettings.motionPixelStride, m_motionPixelOffset))
+				continue;
+
+			const size_t pixelIdx = (size_t)y * m_imageDims.x + x;
+
+			// The pixel's own sample count like RaytracerCS, with adaptive sampling or reprojection it isn't the frame count
+			const uint32_t sampleIdx = (m_motionFrame ? m_motionFrameIdx : (uint32_t)m_accumulation[pixelIdx].w) + m_frameSettings.sampleIndexOffset;
+
+			HitInfo firstHit;
+			const glm::vec3 light = tracePath(glm::uvec2(x, y), sampleIdx, stats.numRays, firstHit, pRecordedRays);
+
+			// Motion frames keep only the newest colour, MotionMode::resolveFrame() fills in the untraced pixels
+			if (m_motionFrame)
+			{
+				m_accumulation[pixelIdx] = glm::vec4(light, 1.f);
+			}
+			else
+			{
+				const float lightLuminance = luminance(light);
+				m_accumulation[pixelIdx] += glm::vec4(light, 1.f);
+				m_secondMoment[pixelIdx] += lightLuminance * lightLuminance;
+			}
+
+			if (writeAuxiliaryBuffers)
+			{
+				m_albedoBuffer[pixelIdx] = firstHit.hit ? glm::vec4(firstHit.material.albedo.colour, 1.f) : glm::vec4(1.f);
+				m_normalDepthBuffer[pixelIdx] = firstHit.hit ? glm::vec4(firstHit.worldNormal, firstHit.distance) : glm::vec4(0.f, 0.f, 0.f, -1.f);
+				m_surfaceBuffer[pixelIdx] = firstHit.hit ? Reprojection::Surface{ firstHit.worldPosition, firstHit.worldNormal, (float)firstHit.instanceIdx } : Reprojection::Surface();
+			}
+		}
+	}
+}
+
+glm::vec3 CPURayTracer::tracePath(glm::uvec2 pixel, uint32_t sampleIdx, uint64_t& numRays, HitInfo& outFirstHit, std::vector<RecordedRay>* pRecordedRays) const
+{
+	Sampler generator(m_frameSettings.samplerType, pixel, m_imageDims.x, sampleIdx, m_blueNoise.data());
+
+	Ray ray = createRay(pixel, generator);
+	applyDOF(ray, generator);
+
+	glm::vec3 light = glm::vec3(0.f);
+	glm::vec3 contribution = glm::vec3(1.f);
+
+	for (uint32_t i = 0; i <= m_frameSettings.maxBounces; i++)
+	{
+		TraversalCounters counters;
+		const HitInfo hitInfo = findClosestHit(ray, counters);
+		numRays++;
+
+		if (pRecordedRays)
+		{
+			RecordedRay& recordedRay = pRecordedRays->emplace_back();
+			recordedRay.origin = ray.origin;
+			recordedRay.direction = ray.direction;
+			recordedRay.pixelIdx = pixel.y * m_imageDims.x + pixel.x;
+			recordedRay.bounce = i;
+			recordedRay.hit.distance = hitInfo.distance;
+			recordedRay.hit.instanceIdx = hitInfo.instanceIdx;
+			recordedRay.hit.counters = counters;
+		}
+
+		if (i == 0u)
+			outFirstHit = hitInfo;
+
+		for (const GPU_PointLight& pointLight : m_pointLights)
+		{
+			light += getLighting(ray, hitInfo, pointLight.position, pointLight.light.radius, pointLight.light.colour, pointLight.light.intensity) * contribution;
+		}
+
+		for (const GPU_SpotLight& spotLight : m_spotLights)
+		{
+			glm::vec3 rayToLight = glm::normalize((spotLight.position + generator.unitVector() * 0.01f) - ray.origin);
+			float cosTheta = glm::dot(rayToLight, -spotLight.direction);
+			if (cosTheta < spotLight.light.maxAngle)
+				continue;
+
+			light += getLighting(ray, hitInfo, spotLight.position, spotLight.light.radius, spotLight.light.colour, spotLight.light.intensity) * contribution;
+		}
+
+		for (const GPU_DirectionalLight& dirLight : m_directionalLights)
+		{
+			if (clampedDot(ray.direction, -dirLight.direction) < dirLight.light.effectiveAngle)
+				continue;
+
+			float lightStrengthModifier = 1.f;
+			if (hitInfo.hit && i)
+				lightStrengthModifier *= hitInfo.material.transparency * clampedDot(ray.direction, -hitInfo.worldNormal);
+			else if (!i)
+				lightStrengthModifier = 0.f;
+
+			light += dirLight.light.colour * dirLight.light.intensity * contribution * lightStrengthModifier;
+		}
+
+		if (!hitInfo.hit)
+		{
+			light += getEnvironmentLight(ray.direction) * contribution;
+			break;
+		}
+
+		const Material& material = hitInfo.material;
+
+		float metallicFactor = (material.metallic.colour * (1.f - material.roughness.colour)) >= generator.next() ? 1.f : 0.f;
+		float specularFactor = (material.specular.colour * (1.f - material.roughness.colour)) >= generator.next() ? 1.f : 0.f;
+		float transparencyFactor = material.transparency >= generator.next() ? 1.f : 0.f;
+
+		glm::vec3 reflectDir = findReflectDirection(ray.direction, hitInfo.worldNormal, material.roughness.colour * (1.f - specularFactor), generator);
+		glm::vec3 refractDir = findTransparencyBounce(ray.direction, hitInfo.worldNormal, material.indexOfRefraction, generator);
+
+		glm::vec3 bounceDir = glm::normalize(glm::mix(reflectDir, refractDir, transparencyFactor));
+
+		contribution *= glm::mix(material.albedo.colour, glm::vec3(1.f), metallicFactor);
+		light += material.emissionColour * material.emissionPower * contribution * (1.f - transparencyFactor);
+
+		ray.origin = hitInfo.worldPosition + bounceDir * 0.001f;
+		ray.direction = bounceDir;
+
+		if (m_frameSettings.russianRouletteEnabled && i >= m_frameSettings.russianRouletteStartBounce)
+		{
+			float survivalChance = glm::clamp(glm::max(contribution.x, glm::max(contribution.y, contribution.z)), MIN_SURVIVAL_CHANCE, 1.f);
+			if (generator.next() > survivalChance)
+				break;
+
+			contribution /= survivalChance;
+		}
+	}
+
+	return light;
+}
+
+CPURayTracer::Ray CPURayTracer::createRay(glm::uvec2 pixel, Sampler& generator) const
+{
+	glm::vec3 pos((float)pixel.x, (float)(m_imageDims.y - pixel.y), m_camera.nearZ);
+
+	pos.x += generator.next() - 0.5f;
+	pos.y += generator.next() - 0.5f;
+
+	pos.x = pos.x / (float)m_imageDims.x * 2.f - 1.f;
+	pos.y = pos.y / (float)m_imageDims.y * 2.f - 1.f;
+
+	glm::vec4 target = m_camera.inverseProjectionMatrix * glm::vec4(pos, 1.f);
+
+	Ray ray;
+	ray.origin = m_camera.position;
+	ray.direction = glm::vec3(m_camera.inverseViewMatrix * glm::vec4(glm::normalize(glm::vec3(target) / target.z), 0.f));
+
+	return ray;
+}
+
+void CPURayTracer::applyDOF(Ray& ray, Sampler& generator) const
+{
+	glm::vec2 rayJitter = generator.pointInCircle() * m_frameSettings.dofStrength;
+	glm::vec3 rayOffset = m_camera.rightDir * rayJitter.x + m_camera.upDir * rayJitter.y;
+	glm::vec3 focusPoint = ray.origin + ray.direction * (m_frameSettings.dofDistance + m_camera.nearZ);
+
+	ray.origin += rayOffset;
+	ray.direction = glm::normalize(focusPoint - ray.origin);
+}
+
+CPURayTracer::TraversalResult CPURayTracer::traverseScene(const Ray& ray, float tMax, TraversalCounters& counters) const
+{
+	TraversalResult result;
+	result.distance = tMax;
+
+	uint32_t octStack[OCT_MAX_STACK_SIZE];
+	uint32_t bvhStack[BVH_MAX_STACK_SIZE];
+	const glm::vec3 inverseRayDir = 1.f / ray.direction;
+
+	uint32_t octStackSize = m_octTreeNodes.empty() ? 0u : 1u;
+	octStack[0] = 0u;
+
+	while (octStackSize > 0u)
+	{
+		const GPU_OctTreeNode& octNode = m_octTreeNodes[octStack[--octStackSize]];
+
+		counters.numBoxTests++;
+		if (rayAndAABBDist(ray.origin, inverseRayDir, octNode.boundingBox) >= result.distance)
+			continue;
+
+		OKAY_ASSERT(octStackSize + octNode.numChildren <= OCT_MAX_STACK_SIZE);
+		for (uint32_t i = 0; i < octNode.numChildren; i++)
+			octStack[octStackSize++] = octNode.firstChildIdx + i;
+
+		for (uint32_t instanceIdx = octNode.meshesStartIdx; instanceIdx < octNode.meshesEndIdx; instanceIdx++)
+		{
+			const MeshInstance& instance = m_meshInstances[instanceIdx];
+
+			counters.numBoxTests++;
+			if (rayAndAABBDist(ray.origin, inverseRayDir, instance.worldBoundingBox) >= result.distance)
+				continue;
+
+			const glm::vec3 localOrigin = instance.inverseTransformMatrix * glm::vec4(ray.origin, 1.f);
+			const glm::vec3 localDirection = glm::normalize(glm::vec3(instance.inverseTransformMatrix * glm::vec4(ray.direction, 0.f)));
+			const glm::vec3 localInverseDir = 1.f / localDirection;
+
+			// Converts local distances to world space, the same for every hit on this instance
+			const float localToWorldScale = glm::length(glm::vec3(instance.transformMatrix * glm::vec4(localDirection, 0.f)));
+
+			uint32_t bvhStackSize = 1u;
+			bvhStack[0] = instance.bvhNodeStartIdx;
+
+			while (bvhStackSize > 0u)
+			{
+				const uint32_t nodeIdx = bvhStack[--bvhStackSize];
+				const GPUNode& node = m_bvhNodes[nodeIdx];
+
+				counters.numBoxTests++;
+				if (rayAndAABBDist(localOrigin, localInverseDir, node.boundingBox) * localToWorldScale >= result.distance)
+					continue;
+
+				if (node.firstChildIdx != Okay::INVALID_UINT)
+				{
+					OKAY_ASSERT(bvhStackSize + 2u <= BVH_MAX_STACK_SIZE);
+					bvhStack[bvhStackSize++] = node.firstChildIdx;
+					bvhStack[bvhStackSize++] = node.firstChildIdx + 1u;
+					continue;
+				}
+
+				const uint32_t numNodeTriangles = node.triEnd - node.triStart;
+				const TrianglePacket* pPackets = &m_trianglePackets[m_nodePacketStarts[nodeIdx]];
+
+				counters.numTriangleTests += numNodeTriangles;
+
+				for (uint32_t packetIdx = 0; packetIdx * TrianglePacket::WIDTH < numNodeTriangles; packetIdx++)
+				{
+					float distances[TrianglePacket::WIDTH];
+					glm::vec2 baryUVCoords[TrianglePacket::WIDTH];
+
+					uint32_t hitMask = rayAndTrianglePacket(localOrigin, localDirection, pPackets[packetIdx], distances, baryUVCoords);
+
+					// In lane order, so the first of two equally distant triangles wins like in the shader
+					while (hitMask)
+					{
+						const uint32_t lane = std::countr_zero(hitMask);
+						hitMask &= hitMask - 1u;
+
+						float distanceToHit = distances[lane];
+						if (distanceToHit <= 0.f)
+							continue;
+
+						distanceToHit *= localToWorldScale;
+						if (distanceToHit < result.distance)
+						{
+							result.distance = distanceToHit;
+							result.instanceIdx = instanceIdx;
+							result.triangleIdx = node.triStart + packetIdx * TrianglePacket::WIDTH + lane;
+
+							result.baryCoords = glm::vec3(baryUVCoords[lane], 1.f - (baryUVCoords[lane].x + baryUVCoords[lane].y));
+						}
+					}
+				}
+			}
+		}
+
+	}
+	return result;
+}
+
+CPURayTracer::HitInfo CPURayTracer::findClosestHit(const Ray& ray, TraversalCounters& counters) const
+{
+	const TraversalResult result = traverseScene(ray, FLT_MAX, counters);
+
+	HitInfo hitInfo;
+	if (result.instanceIdx == Okay::INVALID_UINT)
+		return hitInfo;
+
+	const MeshInstance* pHitInstance = &m_meshInstances[result.instanceIdx];
+	const uint32_t triHitIdx = result.triangleIdx;
+	const glm::vec3& hitBaryUVCoords = result.baryCoords;
+
+	hitInfo.hit = true;
+	hitInfo.distance = result.distance;
+	hitInfo.instanceIdx = result.instanceIdx;
+	hitInfo.worldPosition = ray.origin + ray.direction * hitInfo.distance;
+	hitInfo.material = pHitInstance->material;
+
+	const glm::uvec3& triangle = m_triangles[triHitIdx];
+	const Okay::VertexInfo p0 = Okay::unpackVertexInfo(m_vertexInfo[triangle.x]);
+	const Okay::VertexInfo p1 = Okay::unpackVertexInfo(m_vertexInfo[triangle.y]);
+	const Okay::VertexInfo p2 = Okay::unpackVertexInfo(m_vertexInfo[triangle.z]);
+
+	const glm::mat4& traMatrix = pHitInstance->transformMatrix;
+	const glm::vec2 lerpedUV = barycentricInterpolation(hitBaryUVCoords, p0.uv, p1.uv, p2.uv);
+	const glm::vec3 normal = glm::normalize(glm::vec3(traMatrix * glm::vec4(barycentricInterpolation(hitBaryUVCoords, p0.normal, p1.normal, p2.normal), 0.f)));
+
+	if (hitInfo.material.normalMapIdx)
+	{
+		const glm::vec3 tangent = glm::normalize(glm::vec3(traMatrix * glm::vec4(barycentricInterpolation(hitBaryUVCoords, p0.tangent, p1.tangent, p2.tangent), 0.f)));
+		const glm::vec3 bitangent = glm::normalize(glm::vec3(traMatrix * glm::vec4(barycentricInterpolation(hitBaryUVCoords, p0.bitangent, p1.bitangent, p2.bitangent), 0.f)));
+
+		const glm::vec3 sampledNormal = sampleTexture(hitInfo.material.normalMapIdx, lerpedUV) * 2.f - 1.f;
+		hitInfo.worldNormal = glm::normalize(sampledNormal.x * tangent + sampledNormal.y * bitangent + sampledNormal.z * normal);
+	}
+	else
+	{
+		hitInfo.worldNormal = normal;
+	}
+
+	findMaterialTextureColours(hitInfo.material, lerpedUV);
+
+	return hitInfo;
+}
+
+glm::vec3 CPURayTracer::getLighting(const Ray& ray, const HitInfo& hitInfo, const glm::vec3& lightPos, float lightRadius, const glm::vec3& lightColour, float lightIntensity) const
+{
+	float dist = rayAndSphere(ray.origin, ray.direction, lightPos, lightRadius);
+	if (dist < 0.f)
+		return glm::vec3(0.f);
+
+	float lightStrengthModifier = 1.f;
+	if (hitInfo.hit && hitInfo.distance > dist)
+		lightStrengthModifier *= clampedDot(ray.direction, -hitInfo.worldNormal);
+	else if (hitInfo.hit && hitInfo.distance < dist)
+		lightStrengthModifier *= hitInfo.material.transparency * clampedDot(ray.direction, -hitInfo.worldNormal);
+
+	return lightColour * lightIntensity * lightStrengthModifier;
+}
+
+glm::vec3 CPURayTracer::sampleTexture(uint32_t textureIdx, glm::vec2 uv) const
+{
+	const Texture& texture = m_pResourceManager->getAll<Texture>()[textureIdx];
+	const uint32_t* pTexels = (const uint32_t*)texture.getTextureData();
+	const int width = (int)texture.getWidth();
+	const int height = (int)texture.getHeight();
+
+	// Wrap addressing, RGBA8 unorm
+	const glm::vec4 colour = sampleBilinear(uv * glm::vec2((float)width, (float)height), [&](int x, int y)
+		{
+			x = (x % width + width) % width;
+			y = (y % height + height) % height;
+
+			const uint32_t texel = pTexels[(size_t)y * width + x];
+			return glm::vec4(float(texel & 0xff), float((texel >> 8u) & 0xff), float((texel >> 16u) & 0xff), float(texel >> 24u)) / 255.f;
+		});
+
+	return glm::vec3(colour);
+}
+
+void CPURayTracer::findMaterialTextureColours(Material& material, glm::vec2 uv) const
+{
+	if (material.albedo.textureId)
+		material.albedo.colour = sampleTexture(material.albedo.textureId, uv);
+
+	if (material.roughness.textureId)
+		material.roughness.colour = glm::clamp(sampleTexture(material.roughness.textureId, uv).x, material.roughness.colour, 1.f);
+
+	if (material.metallic.textureId)
+		material.metallic.colour = glm::clamp(sampleTexture(material.metallic.textureId, uv).x, material.metallic.colour, 1.f);
+
+	if (material.specular.textureId)
+		material.specular.colour = glm::clamp(sampleTexture(material.specular.textureId, uv).x, material.specular.colour, 1.f);
+}
+
+void CPURayTracer::loadEnvironmentMap(std::string_view path)
+{
+	m_environmentMap.clear();
+	m_environmentMapDims = glm::uvec2(0u);
+
+	if (path.empty())
+		return;
+
+	int imgWidth, imgHeight;
+	m_environmentMapIsCross = !stbi_is_hdr(path.data());
+
+	if (m_environmentMapIsCross)
+	{
+		unsigned char* pImageData = stbi_load(path.data(), &imgWidth, &imgHeight, nullptr, STBI_rgb_alpha);
+		if (!pImageData)
+			return;
+
+		m_environmentMap.resize((size_t)imgWidth * imgHeight);
+		for (size_t i = 0; i < m_environmentMap.size(); i++)
+		{
+			const unsigned char* pTexel = pImageData + i * 4u;
+			m_environmentMap[i] = glm::vec4(pTexel[0], pTexel[1], pTexel[2], pTexel[3]) / 255.f;
+		}
+
+		stbi_image_free(pImageData);
+	}
+	else
+	{
+		float* pImageData = stbi_loadf(path.data(), &imgWidth, &imgHeight, nullptr, STBI_rgb_alpha);
+		if (!pImageData)
+			return;
+
+		m_environmentMap.assign((const glm::vec4*)pImageData, (const glm::vec4*)pImageData + (size_t)imgWidth * imgHeight);
+		stbi_image_free(pImageData);
+	}
+
+	m_environmentMapDims = glm::uvec2((uint32_t)imgWidth, (uint32_t)imgHeight);
+}
+
+glm::vec3 CPURayTracer::getEnvironmentLight(const glm::vec3& direction) const
+{
+	// An unbound cube map samples as black on the GPU
+	if (m_environmentMap.empty())
+		return glm::vec3(0.f);
+
+	const int imgWidth = (int)m_environmentMapDims.x;
+	const int imgHeight = (int)m_environmentMapDims.y;
+
+	if (!m_environmentMapIsCross)
+	{
+		const glm::vec2 uv(glm::atan(direction.x, direction.z) / glm::two_pi<float>() + 0.5f, glm::acos(glm::clamp(direction.y, -1.f, 1.f)) / glm::pi<float>());
+
+		return sampleBilinear(uv * glm::vec2((float)imgWidth, (float)imgHeight), [&](int x, int y)
+			{
+				x = (x % imgWidth + imgWidth) % imgWidth;	// Wrap horizontally
+				y = glm::clamp(y, 0, imgHeight - 1);		// Clamp at the poles
+				return m_environmentMap[(size_t)y * imgWidth + x];
+			});
+	}
+
+	// D3D11 cube face selection, the faces are read straight out of the 4x3 cross like RayTracer::loadEnvironmentMap()
+	static const glm::ivec2 FACE_CROSS_OFFSET[6] = { {2, 1}, {0, 1}, {1, 0}, {1, 2}, {1, 1}, {3, 1} };
+
+	const glm::vec3 absDir = glm::abs(direction);
+	uint32_t face = 0u;
+	float s = 0.f, t = 0.f, majorAxis = 0.f;
+
+	if (absDir.x >= absDir.y && absDir.x >= absDir.z)
+	{
+		face = direction.x > 0.f ? 0u : 1u;
+		s = direction.x > 0.f ? -direction.z : direction.z;
+		t = -direction.y;
+		majorAxis = absDir.x;
+	}
+	else if (absDir.y >= absDir.z)
+	{
+		face = direction.y > 0.f ? 2u : 3u;
+		s = direction.x;
+		t = direction.y > 0.f ? direction.z : -direction.z;
+		majorAxis = absDir.y;
+	}
+	else
+	{
+		face = direction.z > 0.f ? 4u : 5u;
+		s = direction.z > 0.f ? direction.x : -direction.x;
+		t = -direction.y;
+		majorAxis = absDir.z;
+	}
+
+	const int faceWidth = imgWidth / 4;
+	const int faceHeight = imgHeight / 3;
+	const glm::ivec2 faceOffset = FACE_CROSS_OFFSET[face] * glm::ivec2(faceWidth, faceHeight);
+	const glm::vec2 faceUV = (glm::vec2(s, t) / majorAxis + 1.f) * 0.5f;
+
+	// Clamped to the face, the GPU blends across the seams but it's not noticeable at these sizes
+	return sampleBilinear(faceUV * glm::vec2((float)faceWidth, (float)faceHeight), [&](int x, int y)
+		{
+			x = glm::clamp(x, 0, faceWidth - 1) + faceOffset.x;
+			y = glm::clamp(y, 0, faceHeight - 1) + faceOffset.y;
+			return m_environmentMap[(size_t)y * imgWidth + x];
+		});
+}
\ No newline at end of file
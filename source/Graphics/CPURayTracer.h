@@ -0,0 +1,276 @@
+#pragma once
+#include "Utilities.h"
+#include "BvhBuilder.h"
+#include "OctTree.h"
+#include "RayRecording.h"
+#include "MotionMode.h"
+#include "Reprojection.h"
+#include "Sampler.h"
+#include "TileScheduler.h"
+#include "Scene/Components.h"
+
+#include <span>
+#include <string_view>
+#include <vector>
+
+class Scene;
+class ResourceManager;
+
+// HitTriangles of one BVH leaf as structure of arrays, intersected a packet at a time so the lanes can be vectorized
+// A leaf gets ceil(numTriangles / 4) packets, the unused lanes have zero edges and never hit
+struct TrianglePacket
+{
+	static constexpr uint32_t WIDTH = 4u;
+
+	float originX[WIDTH], originY[WIDTH], originZ[WIDTH];
+	float edge1X[WIDTH], edge1Y[WIDTH], edge1Z[WIDTH];
+	float edge2X[WIDTH], edge2Y[WIDTH], edge2Z[WIDTH];
+};
+
+/*
+	Path tracer running on the CPU, a port of resources/shaders/RaytracerCS.hlsl.
+	Used as a reference for the GPU path and for rendering without a GPU.
+	Every frame traces one sample per pixel on a TileScheduler and adds it to the accumulation.
+	The scene is copied when a frame starts so it can be edited while the workers are tracing,
+	if the camera moves the frame in flight is cancelled and the accumulation starts over.
+	With reprojection the old accumulation is kept and added into the new view once its first frame is traced.
+	With motion mode frames traced while the camera moves only trace some of the pixels, see MotionMode.h.
+*/
+class CPURayTracer
+{
+public:
+	struct Settings
+	{
+		uint32_t maxBounces = 1u;
+		bool russianRouletteEnabled = true;
+		uint32_t russianRouletteStartBounce = 2u;
+
+		float dofStrength = 0.f;
+		float dofDistance = 0.f;
+
+		Sampler::Type samplerType = Sampler::Type::Random;
+		uint32_t sampleIndexOffset = 0u; // Added to every sample index, a reference rendered with another offset has noise independent of the run it's compared to
+
+		// Same as the GPU tracer's, tiles stop being traced once the relative standard error of every pixel's mean luminance is
+		// below the threshold. Checked every adaptiveUpdateInterval frames, pixels with fewer than adaptiveMinSamples keep their tile going
+		bool adaptiveSamplingEnabled = false;
+		uint32_t adaptiveMinSamples = 16u;
+		float adaptiveErrorThreshold = 0.02f;
+		uint32_t adaptiveUpdateInterval = 8u;
+
+		bool reprojectionEnabled = false;
+		Reprojection::Settings reprojection; // Also the surface test of motion mode
+
+		// While the camera moves one pixel per motionPixelStride x motionPixelStride block is traced, 2 = 1/4 and 4 = 1/16 of the pixels
+		bool motionModeEnabled = false;
+		uint32_t motionPixelStride = 2u;
+	};
+
+	// Copied from the TileScheduler when a frame finishes, so it can be read while the next one runs
+	struct FrameStats
+	{
+		float frameTime = 0.f; // Milliseconds
+		uint64_t numRays = 0u;
+		uint32_t numTiles = 0u;
+		uint32_t numActiveTiles = 0u; // Traced, the others had converged
+		uint32_t numStolenTiles = 0u;
+		uint32_t numReprojectedPixels = 0u; // Kept their history after the camera moved, or took it on a motion frame
+		float slowestTileTime = 0.f; // Milliseconds
+	};
+
+public:
+	CPURayTracer(uint32_t numWorkers = 0u); // 0 = one per hardware thread
+	~CPURayTracer();
+
+	void initiate(const ResourceManager& resourceManager, glm::uvec2 imageDims, std::string_view environmentMapPath = "");
+	void loadMeshAndBvhData(uint32_t maxDepth, uint32_t maxLeafTriangles);
+
+	// Adds the meshes added to the ResourceManager since the last load and the placeholders in replacedMeshes, with the last load's BVH settings.
+	// The meshes that were already added are left as they are
+	void appendMeshAndBvhData(std::span<const AssetID> replacedMeshes);
+
+	inline void setScene(const Scene& scene);
+
+	// Non-blocking, call once per application frame. Starts the next frame when the last one is done
+	// Returns true if a frame finished since the last call, getResolvedPixels() is updated when it does
+	bool update();
+
+	// Blocking, adds numSamples samples per pixel
+	// Restarts the accumulation first if the camera moved
+	void renderSamples(uint32_t numSamples);
+
+	void resize(glm::uvec2 imageDims);
+	void resetAccumulation(); // Cancels the frame in flight
+
+	// While set, every ray of every finished frame is appended to the recording. nullptr stops recording
+	void setRayRecording(RayRecording* pRecording);
+
+	// Traces the recorded rays against the current scene and BVH without any shading, resets the accumulation
+	// Returns false if the recording was made in a different scene
+	bool replayRays(const RayRecording& recording, std::vector<RayHit>& outHits);
+
+	// Averaged accumulation as of the last finished frame
+	inline const std::vector<glm::vec4>& getResolvedPixels() const;
+
+	// First hit of the first sample, same layout as the GPU G-buffers. Distance <= 0 and white albedo on miss
+	inline const std::vector<glm::vec4>& getAlbedoBuffer() const;
+	inline const std::vector<glm::vec4>& getNormalDepthBuffer() const;
+	inline const std::vector<Reprojection::Surface>& getSurfaceBuffer() const;
+
+	inline Settings& getSettings();
+	inline uint32_t getNumAccumulationFrames() const; // Stays 0 on motion frames
+	inline bool isMotionFrame() const; // The last frame that was started
+	inline glm::uvec2 getImageDims() const;
+	inline const TileScheduler& getScheduler() const;
+	inline const FrameStats& getLastFrameStats() const;
+	inline const glm::mat4& getViewProjectionMatrix() const; // Of the last frame that was started
+
+private:
+	struct Ray
+	{
+		glm::vec3 origin;
+		glm::vec3 direction;
+	};
+
+	struct HitInfo
+	{
+		bool hit = false;
+		float distance = FLT_MAX;
+		Material material;
+		glm::vec3 worldPosition = glm::vec3(0.f);
+		glm::vec3 worldNormal = glm::vec3(0.f);
+		uint32_t instanceIdx = Okay::INVALID_UINT;
+	};
+
+	struct CameraData
+	{
+		glm::mat4 inverseProjectionMatrix = glm::mat4(1.f);
+		glm::mat4 inverseViewMatrix = glm::mat4(1.f);
+		glm::mat4 viewProjectionMatrix = glm::mat4(0.f);
+		glm::vec3 position = glm::vec3(0.f);
+		glm::vec3 rightDir = glm::vec3(0.f);
+		glm::vec3 upDir = glm::vec3(0.f);
+		float nearZ = 0.f;
+	};
+
+	struct TraversalResult
+	{
+		float distance = FLT_MAX;
+		uint32_t instanceIdx = Okay::INVALID_UINT;
+		uint32_t triangleIdx = Okay::INVALID_UINT;
+		glm::vec3 baryCoords = glm::vec3(0.f);
+	};
+
+	struct MeshInstance
+	{
+		glm::mat4 transformMatrix;
+		glm::mat4 inverseTransformMatrix;
+		Okay::AABB worldBoundingBox;
+		Material material;
+		uint32_t bvhNodeStartIdx;
+	};
+
+	CameraData calculateCameraData() const;
+	bool handleCameraMovement();
+	void storeHistory();
+	void copySceneData();
+	void startFrame();
+	void finishFrame();
+	void resolveAccumulation();
+	void updateActiveTiles();
+
+	void traceTile(const TileScheduler::Tile& tile, TileScheduler::TileStats& stats);
+	glm::vec3 tracePath(glm::uvec2 pixel, uint32_t sampleIdx, uint64_t& numRays, HitInfo& outFirstHit, std::vector<RecordedRay>* pRecordedRays) const;
+
+	Ray createRay(glm::uvec2 pixel, Sampler& generator) const;
+	void applyDOF(Ray& ray, Sampler& generator) const;
+	TraversalResult traverseScene(const Ray& ray, float tMax, TraversalCounters& counters) const;
+	HitInfo findClosestHit(const Ray& ray, TraversalCounters& counters) const;
+	glm::vec3 getLighting(const Ray& ray, const HitInfo& hitInfo, const glm::vec3& lightPos, float lightRadius, const glm::vec3& lightColour, float lightIntensity) const;
+
+	glm::vec3 sampleTexture(uint32_t textureIdx, glm::vec2 uv) const;
+	void findMaterialTextureColours(Material& material, glm::vec2 uv) const;
+
+	void loadEnvironmentMap(std::string_view path);
+	void addTrianglePackets(uint32_t firstNodeIdx, const std::vector<HitTriangle>& hitTriangles, uint32_t firstTriangleIdx); // hitTriangles[0] is triangle firstTriangleIdx
+	glm::vec3 getEnvironmentLight(const glm::vec3& direction) const;
+
+	const Scene* m_pScene;
+	const ResourceManager* m_pResourceManager;
+
+	TileScheduler m_scheduler;
+	Settings m_settings;
+	Settings m_frameSettings; // Copy for the frame in flight
+
+	glm::uvec2 m_imageDims;
+	std::vector<glm::vec4> m_accumulation; // The alpha channel holds the number of samples
+	std::vector<float> m_secondMoment; // Sum of squared luminance per pixel, for the variance in adaptive sampling
+	std::vector<uint8_t> m_activeTiles; // Per tile, row major. Only read while adaptive sampling is enabled
+	std::vector<glm::vec4> m_resolvedPixels;
+	std::vector<glm::vec4> m_albedoBuffer;
+	std::vector<glm::vec4> m_normalDepthBuffer;
+	std::vector<Reprojection::Surface> m_surfaceBuffer;
+	uint32_t m_numAccumulationFrames;
+	bool m_frameInFlight;
+	FrameStats m_lastFrameStats;
+
+	Reprojection::History m_history;
+	bool m_reprojectHistory; // Set until the first frame after the camera moved has been traced
+
+	// While the camera moves the accumulation holds one colour per pixel, the alpha channel is its age. See MotionMode::resolveFrame()
+	Reprojection::History m_motionHistory; // The last finished motion frame
+	bool m_motionFrame;
+	uint32_t m_motionFrameIdx;
+	glm::uvec2 m_motionPixelOffset;
+
+	RayRecording* m_pRayRecording;
+	std::vector<std::vector<RecordedRay>> m_tileRecordedRays; // Merged in tile order when the frame finishes
+
+private: // Scene copy, only written between frames
+	CameraData m_camera;
+	std::vector<MeshInstance> m_meshInstances; // In oct tree order, a node's instances are [meshesStartIdx, meshesEndIdx)
+	std::vector<OctTreeNode> m_octTree; // Refitted every frame, rebuilt when instances are added or removed
+	std::vector<GPU_OctTreeNode> m_octTreeNodes;
+	std::vector<entt::entity> m_octTreeMeshEntities;
+	std::vector<GPU_DirectionalLight> m_directionalLights;
+	std::vector<GPU_PointLight> m_pointLights;
+	std::vector<GPU_SpotLight> m_spotLights;
+
+private: // Static data
+	uint32_t m_bvhMaxDepth;
+	uint32_t m_bvhMaxLeafTriangles;
+	std::vector<MeshDesc> m_meshDescs;
+	std::vector<GPUNode> m_bvhNodes;
+	std::vector<TrianglePacket> m_trianglePackets; // Only touched while traversing
+	std::vector<uint32_t> m_nodePacketStarts; // Per node, a leaf's triangle triStart + i is lane i % 4 of packet start + i / 4
+
+	// Only touched for the closest hit
+	std::vector<Okay::PackedVertexInfo> m_vertexInfo;
+	std::vector<glm::uvec3> m_triangles; // Vertex indices, in BVH leaf order
+
+	std::vector<float> m_blueNoise;
+
+	// HDR maps are equirectangular, others a 4x3 cube cross like the GPU loader expects
+	std::vector<glm::vec4> m_environmentMap;
+	glm::uvec2 m_environmentMapDims;
+	bool m_environmentMapIsCross;
+};
+
+inline void CPURayTracer::setScene(const Scene& scene)
+{
+	m_pScene = &scene;
+	m_octTree.clear(); // Built by the next copySceneData()
+}
+
+inline const std::vector<glm::vec4>& CPURayTracer::getResolvedPixels() const		{ return m_resolvedPixels; }
+inline const std::vector<glm::vec4>& CPURayTracer::getAlbedoBuffer() const		{ return m_albedoBuffer; }
+inline const std::vector<glm::vec4>& CPURayTracer::getNormalDepthBuffer() const	{ return m_normalDepthBuffer; }
+inline const std::vector<Reprojection::Surface>& CPURayTracer::getSurfaceBuffer() const { return m_surfaceBuffer; }
+
+inline CPURayTracer::Settings& CPURayTracer::getSettings()			{ return m_settings; }
+inline uint32_t CPURayTracer::getNumAccumulationFrames() const		{ return m_numAccumulationFrames; }
+inline bool CPURayTracer::isMotionFrame() const						{ return m_motionFrame; }
+inline glm::uvec2 CPURayTracer::getImageDims() const				{ return m_imageDims; }
+inline const TileScheduler& CPURayTracer::getScheduler() const		{ return m_scheduler; }
+inline const CPURayTracer::FrameStats& CPURayTracer::getLastFrameStats() const { return m_lastFrameStats; }
+inline const glm::mat4& CPURayTracer::getViewProjectionMatrix() const { return m_camera.viewProjectionMatrix; }
\ No newline at end of file
@@ -11,6 +11,15 @@ constexpr glm::vec3 BVH_NODE_COLOUR = glm::vec3(0.9f, 0.7f, 0.5f);
 constexpr glm::vec3 BVH_NODE_GEOMETRY_COLOUR = glm::vec3(0.4f, 0.6f, 0.8f);
 constexpr glm::vec3 OCT_NODE_COLOUR = glm::vec3(0.4f, 0.7f, 0.4f);
 
+// The vertex shaders read the geometry through the triangle indices, the slots aren't next to each other
+static void bindMeshBuffers(ID3D11ShaderResourceView* pPositions, ID3D11ShaderResourceView* pVertexInfo, ID3D11ShaderResourceView* pTriangleIndices)
+{
+	ID3D11DeviceContext* pDevCon = Okay::getDeviceContext();
+	pDevCon->VSSetShaderResources(VERTEX_POS_SLOT, 1u, &pPositions);
+	pDevCon->VSSetShaderResources(VERTEX_INFO_SLOT, 1u, &pVertexInfo);
+	pDevCon->VSSetShaderResources(TRIANGLE_INDEX_SLOT, 1u, &pTriangleIndices);
+}
+
 DebugRenderer::DebugRenderer()
 {
 }
@@ -31,8 +40,11 @@ void DebugRenderer::shutdown()
 	m_pRayTracer = nullptr;
 	m_pResourceManager = nullptr;
 
-	m_sphereTriData.shutdown();
-	m_cubeTriData.shutdown();
+	m_sphereVertexData.shutdown();
+	m_sphereVertexInfo.shutdown();
+	m_sphereIndexData.shutdown();
+	m_cubeVertexData.shutdown();
+	m_cubeIndexData.shutdown();
 
 	DX11_RELEASE(m_pRenderDataBuffer);
 	DX11_RELEASE(m_pVS);
@@ -78,9 +90,10 @@ void DebugRenderer::initiate(const RenderTexture& target, const RayTracer& rayTr
 	success = Importer::loadMesh("resources/meshes/sphere.fbx", sphereData);
 	OKAY_ASSERT(success);
 
-	Mesh sphereMesh(sphereData, "");
-	const std::vector<Okay::Triangle>& sphereTris = sphereMesh.getTrianglesPos();
-	m_sphereTriData.initiate((uint32_t)sizeof(Okay::Triangle), (uint32_t)sphereTris.size(), sphereTris.data());
+	Mesh sphereMesh(std::move(sphereData), "");
+	m_sphereVertexData.initiate((uint32_t)sizeof(glm::vec3), (uint32_t)sphereMesh.getPositions().size(), sphereMesh.getPositions().data());
+	m_sphereVertexInfo.initiate((uint32_t)sizeof(Okay::PackedVertexInfo), (uint32_t)sphereMesh.getVertexInfo().size(), sphereMesh.getVertexInfo().data());
+	m_sphereIndexData.initiate((uint32_t)sizeof(glm::uvec3), sphereMesh.getNumTriangles(), sphereMesh.getTriangles().data());
 
 	// BVH Tree Rendering
 	success = Okay::createShader(SHADER_PATH "DebugBBVS.hlsl", &m_pBoundingBoxVS);
@@ -150,9 +163,9 @@ void DebugRenderer::initiate(const RenderTexture& target, const RayTracer& rayTr
 	success = Importer::loadMesh("resources/meshes/cube.fbx", cubeData);
 	OKAY_ASSERT(success);
 
-	Mesh cubeMesh(cubeData, "");
-	const std::vector<Okay::Triangle>& cubeTris = cubeMesh.getTrianglesPos();
-	m_cubeTriData.initiate((uint32_t)sizeof(Okay::Triangle), (uint32_t)cubeTris.size(), cubeTris.data());
+	Mesh cubeMesh(std::move(cubeData), "");
+	m_cubeVertexData.initiate((uint32_t)sizeof(glm::vec3), (uint32_t)cubeMesh.getPositions().size(), cubeMesh.getPositions().data());
+	m_cubeIndexData.initiate((uint32_t)sizeof(glm::uvec3), cubeMesh.getNumTriangles(), cubeMesh.getTriangles().data());
 
 	D3D11_RASTERIZER_DESC noCullRSDesc{};
 	noCullRSDesc.FillMode = D3D11_FILL_SOLID;
@@ -197,12 +210,11 @@ void DebugRenderer::render(bool includeObjects)
 	updateCameraData();
 
 	// Skybox
-	ID3D11ShaderResourceView* pCubeTriBuffer = m_cubeTriData.getSRV();
-	uint32_t cubeNumVerticies = m_cubeTriData.getCapacity() * 3u;
+	uint32_t cubeNumVerticies = m_cubeIndexData.getCapacity() * 3u;
 
 	Okay::updateBuffer(m_pRenderDataBuffer, &m_renderData, sizeof(RenderData));
 	pDevCon->VSSetShader(m_pSkyboxVS, nullptr, 0u);
-	pDevCon->VSSetShaderResources(TRIANGLE_POS_SLOT, 1u, &pCubeTriBuffer);
+	bindMeshBuffers(m_cubeVertexData.getSRV(), nullptr, m_cubeIndexData.getSRV());
 	pDevCon->RSSetState(m_noCullRS);
 	pDevCon->PSSetShader(m_pSkyboxPS, nullptr, 0u);
 	pDevCon->OMSetDepthStencilState(m_pLessEqualDSS, 0u);
@@ -215,13 +227,17 @@ void DebugRenderer::render(bool includeObjects)
 	if (!includeObjects)
 		return;
 
-	ID3D11ShaderResourceView* pSphereTriBuffer = m_sphereTriData.getSRV();
-	uint32_t sphereNumVerticies = m_sphereTriData.getCapacity() * 3u;
+	uint32_t sphereNumVerticies = m_sphereIndexData.getCapacity() * 3u;
 
 	pDevCon->VSSetShader(m_pVS, nullptr, 0u);
-	pDevCon->VSSetShaderResources(TRIANGLE_POS_SLOT, 1u, &pSphereTriBuffer);
+	bindMeshBuffers(m_sphereVertexData.getSRV(), m_sphereVertexInfo.getSRV(), m_sphereIndexData.getSRV());
 	pDevCon->PSSetShader(m_pPS, nullptr, 0u);
 
+	// Albedo textures are sampled out of the ray tracer's atlas
+	ID3D11ShaderResourceView* pTextureRecords = m_pRayTracer->getTextureRecords().getSRV();
+	pDevCon->PSSetShaderResources(TEXTURE_RECORDS_SLOT, 1u, &pTextureRecords);
+	pDevCon->PSSetShaderResources(TEXTURE_ATLAS_SLOT, NUM_TEXTURE_ATLAS_CLASSES, m_pRayTracer->getTextureAtlasSRVs());
+
 	const entt::registry& reg = m_pScene->getRegistry();
 	auto sphereView = reg.view<Sphere, Transform>();
 	for (entt::entity entity : sphereView) // Draw Spheres
@@ -240,8 +256,7 @@ void DebugRenderer::render(bool includeObjects)
 		pDevCon->Draw(sphereNumVerticies, 0u);
 	}
 
-	ID3D11ShaderResourceView* pOrigTriangleBuffer = m_pRayTracer->getTrianglesPos().getSRV();
-	pDevCon->VSSetShaderResources(TRIANGLE_POS_SLOT, 1u, &pOrigTriangleBuffer);
+	bindMeshBuffers(m_pRayTracer->getVertexPositions().getSRV(), m_pRayTracer->getVertexInfo().getSRV(), m_pRayTracer->getTriangleIndices().getSRV());
 
 	const std::vector<MeshDesc>& meshDescs = m_pRayTracer->getMeshDescriptors();
 	auto meshView = reg.view<MeshComponent, Transform>();
@@ -282,7 +297,7 @@ void DebugRenderer::renderBvhNodeBBs(Entity entity, uint32_t localNodeIdx)
 
 	pDevCon->VSSetShader(m_pBoundingBoxVS, nullptr, 0u);
 	pDevCon->VSSetConstantBuffers(DBG_RENDER_DATA_SLOT, 1u, &m_pRenderDataBuffer);
-	pDevCon->VSSetShaderResources(TRIANGLE_POS_SLOT, 1u, &m_pBvhNodeBuffer);
+	pDevCon->VSSetShaderResources(VERTEX_POS_SLOT, 1u, &m_pBvhNodeBuffer);
 
 	pDevCon->RSSetViewports(1u, &m_viewport);
 
@@ -298,8 +313,8 @@ void DebugRenderer::renderBvhNodeBBs(Entity entity, uint32_t localNodeIdx)
 	uint32_t globalNodeIdx = m_pRayTracer->getGlobalNodeIdx(*pMeshComp, localNodeIdx);
 	executeDrawMode(m_bvhDrawMode, m_pRayTracer->getBvhTreeNodes(), globalNodeIdx, 2, &DebugRenderer::drawNodeBoundingBox);
 
-	ID3D11ShaderResourceView* pOrigTriangleSRV = m_pRayTracer->getTrianglesPos().getSRV();
-	pDevCon->VSSetShaderResources(TRIANGLE_POS_SLOT, 1u, &pOrigTriangleSRV);
+	ID3D11ShaderResourceView* pOrigTriangleSRV = m_pRayTracer->getVertexPositions().getSRV();
+	pDevCon->VSSetShaderResources(VERTEX_POS_SLOT, 1u, &pOrigTriangleSRV);
 }
 
 void DebugRenderer::renderBvhNodeGeometry(Entity entity, uint32_t localNodeIdx)
@@ -317,13 +332,11 @@ void DebugRenderer::renderBvhNodeGeometry(Entity entity, uint32_t localNodeIdx)
 	bindGeometryPipeline(false);
 	updateCameraData();
 
-	ID3D11ShaderResourceView* pTriangleBufferSRV = m_pRayTracer->getTrianglesPos().getSRV();
-
 	const Transform& transformComp = entity.getComponent<Transform>();
 	m_renderData.objectWorldMatrix = glm::transpose(transformComp.calculateMatrix());
 
 	ID3D11DeviceContext* pDevCon = Okay::getDeviceContext();
-	pDevCon->VSSetShaderResources(TRIANGLE_POS_SLOT, 1u, &pTriangleBufferSRV);
+	bindMeshBuffers(m_pRayTracer->getVertexPositions().getSRV(), m_pRayTracer->getVertexInfo().getSRV(), m_pRayTracer->getTriangleIndices().getSRV());
 	pDevCon->RSSetState(m_pDoubleSideRS);
 
 	uint32_t globalNodeIdx = m_pRayTracer->getGlobalNodeIdx(*pMeshComp, localNodeIdx);
@@ -346,7 +359,7 @@ void DebugRenderer::renderOctTreeNodeBBs(uint32_t nodeIdx)
 
 	pDevCon->VSSetShader(m_pBoundingBoxVS, nullptr, 0u);
 	pDevCon->VSSetConstantBuffers(DBG_RENDER_DATA_SLOT, 1u, &m_pRenderDataBuffer);
-	pDevCon->VSSetShaderResources(TRIANGLE_POS_SLOT, 1u, &m_pBvhNodeBuffer);
+	pDevCon->VSSetShaderResources(VERTEX_POS_SLOT, 1u, &m_pBvhNodeBuffer);
 
 	pDevCon->RSSetViewports(1u, &m_viewport);
 
@@ -359,8 +372,8 @@ void DebugRenderer::renderOctTreeNodeBBs(uint32_t nodeIdx)
 	uint32_t numChildren = octTreeNodes[nodeIdx].numChildren;
 	executeDrawMode(m_octTreeDrawMode, octTreeNodes, nodeIdx, numChildren, &DebugRenderer::drawOctTreeNodeBoundingBox);
 
-	ID3D11ShaderResourceView* pOrigTriangleSRV = m_pRayTracer->getTrianglesPos().getSRV();
-	pDevCon->VSSetShaderResources(TRIANGLE_POS_SLOT, 1u, &pOrigTriangleSRV);
+	ID3D11ShaderResourceView* pOrigTriangleSRV = m_pRayTracer->getVertexPositions().getSRV();
+	pDevCon->VSSetShaderResources(VERTEX_POS_SLOT, 1u, &pOrigTriangleSRV);
 }
 
 void DebugRenderer::updateCameraData()
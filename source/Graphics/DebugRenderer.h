@@ -90,7 +90,9 @@ private: // Pipeline
 	D3D11_VIEWPORT m_viewport = D3D11_VIEWPORT{};
 	ID3D11PixelShader* m_pPS = nullptr;
 
-	GPUStorage m_sphereTriData;
+	GPUStorage m_sphereVertexData;
+	GPUStorage m_sphereVertexInfo;
+	GPUStorage m_sphereIndexData;
 
 	// Bvh pipeline
 	bool m_renderBvhTree = false;
@@ -104,7 +106,8 @@ private: // Pipeline
 	// Skybox
 	ID3D11VertexShader* m_pSkyboxVS = nullptr;
 	ID3D11PixelShader* m_pSkyboxPS = nullptr;
-	GPUStorage m_cubeTriData;
+	GPUStorage m_cubeVertexData;
+	GPUStorage m_cubeIndexData;
 	ID3D11RasterizerState* m_noCullRS = nullptr;
 	ID3D11DepthStencilState* m_pLessEqualDSS = nullptr;
 };
@@ -0,0 +1,292 @@
+#include "Denoiser.h"
+#include "Threading.h"
+
+#include <bit>
+#include <chrono>
+#include <cmath>
+
+// Interior pixels are filtered four at a time where SSE2 is available, everything else goes through the scalar filterPixel
+#if defined(__SSE2__) || defined(_M_X64)
+#define DENOISER_SSE2
+#include <emmintrin.h>
+#endif
+
+// B3 spline, the 5x5 kernel is KERNEL[|x|] * KERNEL[|y|]
+static const float KERNEL[3] = { 3.f / 8.f, 1.f / 4.f, 1.f / 16.f };
+
+// Taps with a larger exponent than this contribute less than exp(-10) and are skipped
+static const float MAX_WEIGHT_EXPONENT = 10.f;
+
+struct FilterParams
+{
+	const glm::vec4* pSource; // Illumination in xyz, its luminance in w
+	glm::vec4* pTarget;
+	const glm::vec4* pNormalDepth;
+	uint32_t width;
+	uint32_t height;
+	int stepSize;
+
+	float normalPower;
+	float inverseColourSigma;
+	float inverseDepthSigma;
+};
+
+static float luminance(const glm::vec3& colour)
+{
+	return colour.x * 0.2126f + colour.y * 0.7152f + colour.z * 0.0722f;
+}
+
+#ifdef DENOISER_SSE2
+
+// exp(-x) for x in [0, MAX_WEIGHT_EXPONENT], 2^-x split into an exponent and a cubic for the fraction. Relative error < 0.1%
+// The scalar version is the same approximation so border pixels weigh exactly like the SSE lanes
+static float negativeExp(float x)
+{
+	const float power = x * 1.442695f; // log2(e)
+	const float whole = (float)(int)power;
+	const float fraction = power - whole;
+
+	const float fractionExp = 1.f + fraction * (-0.6930321f + fraction * (0.2357470f - fraction * 0.0427149f)); // 2^-fraction
+	return fractionExp * std::bit_cast<float>((127 - (int)whole) << 23);
+}
+
+static __m128 negativeExp(__m128 x)
+{
+	const __m128 power = _mm_mul_ps(x, _mm_set1_ps(1.442695f));
+	const __m128i whole = _mm_cvttps_epi32(power);
+	const __m128 fraction = _mm_sub_ps(power, _mm_cvtepi32_ps(whole));
+
+	__m128 fractionExp = _mm_sub_ps(_mm_set1_ps(0.2357470f), _mm_mul_ps(fraction, _mm_set1_ps(0.0427149f)));
+	fractionExp = _mm_add_ps(_mm_set1_ps(-0.6930321f), _mm_mul_ps(fraction, fractionExp));
+	fractionExp = _mm_add_ps(_mm_set1_ps(1.f), _mm_mul_ps(fraction, fractionExp));
+
+	const __m128i exponentBits = _mm_slli_epi32(_mm_sub_epi32(_mm_set1_epi32(127), whole), 23);
+	return _mm_mul_ps(fractionExp, _mm_castsi128_ps(exponentBits));
+}
+
+static __m128 absolute(__m128 value)
+{
+	return _mm_and_ps(value, _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff)));
+}
+
+#else
+
+static float negativeExp(float x)
+{
+	return std::exp(-x);
+}
+
+#endif
+
+// Edge stopping, exp(normalPower * (dot - 1)) stands in for pow(dot, normalPower) so one exp covers all three terms
+static void filterPixel(const FilterParams& params, uint32_t x, uint32_t y, int minKy, int maxKy)
+{
+	const uint32_t centreIdx = y * params.width + x;
+	const glm::vec4& centreNormalDepth = params.pNormalDepth[centreIdx];
+
+	if (centreNormalDepth.w <= 0.f)
+	{
+		params.pTarget[centreIdx] = params.pSource[centreIdx];
+		return;
+	}
+
+	const glm::vec3 centreNormal = glm::vec3(centreNormalDepth);
+	const float centreLuminance = params.pSource[centreIdx].w;
+	const float depthScale = params.inverseDepthSigma / centreNormalDepth.w;
+
+	const int step = params.stepSize;
+	const int minKx = glm::max(-2, -(int)x / step);
+	const int maxKx = glm::min(2, ((int)params.width - 1 - (int)x) / step);
+
+	glm::vec4 colourSum = glm::vec4(0.f);
+	float weightSum = 0.f;
+
+	for (int ky = minKy; ky <= maxKy; ky++)
+	{
+		const int rowIdx = (int)centreIdx + ky * step * (int)params.width;
+
+		for (int kx = minKx; kx <= maxKx; kx++)
+		{
+			const uint32_t sampleIdx = (uint32_t)(rowIdx + kx * step);
+			const glm::vec4& sampleNormalDepth = params.pNormalDepth[sampleIdx];
+			if (sampleNormalDepth.w <= 0.f)
+				continue;
+
+			const float normalTerm = params.normalPower * (1.f - glm::dot(centreNormal, glm::vec3(sampleNormalDepth)));
+			const float depthTerm = glm::abs(centreNormalDepth.w - sampleNormalDepth.w) * depthScale;
+			const float colourTerm = glm::abs(centreLuminance - params.pSource[sampleIdx].w) * params.inverseColourSigma;
+
+			const float exponent = normalTerm + depthTerm + colourTerm;
+			if (exponent > MAX_WEIGHT_EXPONENT)
+				continue;
+
+			const float weight = KERNEL[glm::abs(kx)] * KERNEL[glm::abs(ky)] * negativeExp(exponent);
+
+			colourSum += params.pSource[sampleIdx] * weight;
+			weightSum += weight;
+		}
+	}
+
+	// The centre tap always has a weight, so weightSum is never 0
+	params.pTarget[centreIdx] = colourSum / weightSum;
+}
+
+#ifdef DENOISER_SSE2
+
+// Same as filterPixel for the 4 pixels starting at x, one per SSE lane. All their taps have to be inside the image horizontally
+static void filterFourPixels(const FilterParams& params, uint32_t x, uint32_t y, int minKy, int maxKy)
+{
+	const uint32_t centreIdx = y * params.width + x;
+	const int step = params.stepSize;
+
+	__m128 centreNormalX = _mm_loadu_ps(&params.pNormalDepth[centreIdx].x);
+	__m128 centreNormalY = _mm_loadu_ps(&params.pNormalDepth[centreIdx + 1u].x);
+	__m128 centreNormalZ = _mm_loadu_ps(&params.pNormalDepth[centreIdx + 2u].x);
+	__m128 centreDepth = _mm_loadu_ps(&params.pNormalDepth[centreIdx + 3u].x);
+	_MM_TRANSPOSE4_PS(centreNormalX, centreNormalY, centreNormalZ, centreDepth);
+
+	const __m128 centreLuminance = _mm_setr_ps(params.pSource[centreIdx].w, params.pSource[centreIdx + 1u].w,
+		params.pSource[centreIdx + 2u].w, params.pSource[centreIdx + 3u].w);
+
+	// Misses are passed through after the loop, the max only keeps their lanes from dividing by 0
+	const __m128 depthScale = _mm_div_ps(_mm_set1_ps(params.inverseDepthSigma), _mm_max_ps(centreDepth, _mm_set1_ps(1e-6f)));
+	const __m128 normalPower = _mm_set1_ps(params.normalPower);
+	const __m128 inverseColourSigma = _mm_set1_ps(params.inverseColourSigma);
+	const __m128 maxExponent = _mm_set1_ps(MAX_WEIGHT_EXPONENT);
+
+	__m128 colourSums[4] = { _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps() };
+	__m128 weightSum = _mm_setzero_ps();
+
+	for (int ky = minKy; ky <= maxKy; ky++)
+	{
+		const int rowIdx = (int)centreIdx + ky * step * (int)params.width;
+
+		for (int kx = -2; kx <= 2; kx++)
+		{
+			const uint32_t sampleIdx = (uint32_t)(rowIdx + kx * step);
+			const glm::vec4* pSampleNormalDepth = params.pNormalDepth + sampleIdx;
+			const glm::vec4* pSampleColour = params.pSource + sampleIdx;
+
+			__m128 normalX = _mm_loadu_ps(&pSampleNormalDepth[0].x);
+			__m128 normalY = _mm_loadu_ps(&pSampleNormalDepth[1].x);
+			__m128 normalZ = _mm_loadu_ps(&pSampleNormalDepth[2].x);
+			__m128 depth = _mm_loadu_ps(&pSampleNormalDepth[3].x);
+			_MM_TRANSPOSE4_PS(normalX, normalY, normalZ, depth);
+
+			const __m128 colours[4] = { _mm_loadu_ps(&pSampleColour[0].x), _mm_loadu_ps(&pSampleColour[1].x),
+				_mm_loadu_ps(&pSampleColour[2].x), _mm_loadu_ps(&pSampleColour[3].x) };
+
+			const __m128 sampleLuminance = _mm_setr_ps(pSampleColour[0].w, pSampleColour[1].w, pSampleColour[2].w, pSampleColour[3].w);
+
+			__m128 normalDot = _mm_mul_ps(centreNormalX, normalX);
+			normalDot = _mm_add_ps(normalDot, _mm_mul_ps(centreNormalY, normalY));
+			normalDot = _mm_add_ps(normalDot, _mm_mul_ps(centreNormalZ, normalZ));
+
+			__m128 exponent = _mm_mul_ps(normalPower, _mm_sub_ps(_mm_set1_ps(1.f), normalDot));
+			exponent = _mm_add_ps(exponent, _mm_mul_ps(absolute(_mm_sub_ps(centreDepth, depth)), depthScale));
+			exponent = _mm_add_ps(exponent, _mm_mul_ps(absolute(_mm_sub_ps(centreLuminance, sampleLuminance)), inverseColourSigma));
+
+			const __m128 validMask = _mm_and_ps(_mm_cmpgt_ps(depth, _mm_setzero_ps()), _mm_cmple_ps(exponent, maxExponent));
+			if (!_mm_movemask_ps(validMask))
+				continue;
+
+			__m128 weight = negativeExp(_mm_min_ps(_mm_max_ps(exponent, _mm_setzero_ps()), maxExponent));
+			weight = _mm_and_ps(_mm_mul_ps(weight, _mm_set1_ps(KERNEL[glm::abs(kx)] * KERNEL[glm::abs(ky)])), validMask);
+
+			weightSum = _mm_add_ps(weightSum, weight);
+			colourSums[0] = _mm_add_ps(colourSums[0], _mm_mul_ps(colours[0], _mm_shuffle_ps(weight, weight, _MM_SHUFFLE(0, 0, 0, 0))));
+			colourSums[1] = _mm_add_ps(colourSums[1], _mm_mul_ps(colours[1], _mm_shuffle_ps(weight, weight, _MM_SHUFFLE(1, 1, 1, 1))));
+			colourSums[2] = _mm_add_ps(colourSums[2], _mm_mul_ps(colours[2], _mm_shuffle_ps(weight, weight, _MM_SHUFFLE(2, 2, 2, 2))));
+			colourSums[3] = _mm_add_ps(colourSums[3], _mm_mul_ps(colours[3], _mm_shuffle_ps(weight, weight, _MM_SHUFFLE(3, 3, 3, 3))));
+		}
+	}
+
+	alignas(16) float centreDepths[4];
+	alignas(16) float weightSums[4];
+	_mm_store_ps(centreDepths, centreDepth);
+	_mm_store_ps(weightSums, weightSum);
+
+	for (uint32_t i = 0; i < 4u; i++)
+	{
+		if (centreDepths[i] <= 0.f)
+			params.pTarget[centreIdx + i] = params.pSource[centreIdx + i];
+		else
+			_mm_storeu_ps(&params.pTarget[centreIdx + i].x, _mm_div_ps(colourSums[i], _mm_set1_ps(weightSums[i])));
+	}
+}
+
+#endif
+
+void Denoiser::denoise(const glm::vec4* pColour, const glm::vec4* pAlbedo, const glm::vec4* pNormalDepth,
+	uint32_t width, uint32_t height, std::vector<glm::vec4>& outPixels)
+{
+	auto startTime = std::chrono::system_clock::now();
+
+	const uint32_t numPixels = width * height;
+	m_illumination[0].resize(numPixels);
+	m_illumination[1].resize(numPixels);
+	outPixels.resize(numPixels);
+
+	// Demodulate, only the lighting gets filtered
+	// The luminance goes in w, it's filtered with the same weights as the colour so it stays the luminance of xyz
+	Okay::parallelFor(height, [&](uint32_t y)
+		{
+			for (uint32_t i = y * width; i < (y + 1u) * width; i++)
+			{
+				const glm::vec3 illumination = glm::vec3(pColour[i]) / glm::max(glm::vec3(pAlbedo[i]), glm::vec3(0.001f));
+				m_illumination[0][i] = glm::vec4(illumination, luminance(illumination));
+			}
+		});
+
+	uint32_t sourceIdx = 0u;
+	for (uint32_t i = 0; i < m_settings.numIterations; i++)
+	{
+		filterIteration(m_illumination[sourceIdx].data(), m_illumination[1u - sourceIdx].data(), pNormalDepth, width, height, 1u << i);
+		sourceIdx = 1u - sourceIdx;
+	}
+
+	Okay::parallelFor(height, [&](uint32_t y)
+		{
+			for (uint32_t i = y * width; i < (y + 1u) * width; i++)
+				outPixels[i] = glm::vec4(glm::vec3(m_illumination[sourceIdx][i]) * glm::vec3(pAlbedo[i]), 1.f);
+		});
+
+	std::chrono::duration<float> duration = std::chrono::system_clock::now() - startTime;
+	m_lastDenoiseTime = duration.count() * 1000.f;
+}
+
+void Denoiser::filterIteration(const glm::vec4* pSource, glm::vec4* pTarget, const glm::vec4* pNormalDepth,
+	uint32_t width, uint32_t height, uint32_t stepSize) const
+{
+	FilterParams params{};
+	params.pSource = pSource;
+	params.pTarget = pTarget;
+	params.pNormalDepth = pNormalDepth;
+	params.width = width;
+	params.height = height;
+	params.stepSize = (int)stepSize;
+	params.normalPower = m_settings.normalPower;
+	params.inverseColourSigma = 1.f / m_settings.colourSigma;
+	params.inverseDepthSigma = 1.f / (m_settings.depthSigma * (float)stepSize);
+
+	// Pixels closer than 2 steps to the left or right edge have taps outside the image and go through filterPixel
+	const uint32_t borderSize = 2u * stepSize;
+
+	Okay::parallelFor(height, [&](uint32_t y)
+		{
+			const int minKy = glm::max(-2, -(int)y / params.stepSize);
+			const int maxKy = glm::min(2, ((int)height - 1 - (int)y) / params.stepSize);
+
+			uint32_t x = 0;
+			for (; x < width && x < borderSize; x++)
+				filterPixel(params, x, y, minKy, maxKy);
+
+#ifdef DENOISER_SSE2
+			for (; x + 3u + borderSize < width; x += 4u)
+				filterFourPixels(params, x, y, minKy, maxKy);
+#endif
+
+			for (; x < width; x++)
+				filterPixel(params, x, y, minKy, maxKy);
+		});
+}
\ No newline at end of file
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "glm/glm.hpp"
+
+#include <stdint.h>
+#include <vector>
+
+// Edge-avoiding à-trous wavelet filter (Dammertz et al. 2010), runs on the CPU
+// The colour is divided by the albedo before filtering so textures don't get blurred, and multiplied back after
+class Denoiser
+{
+public:
+	struct Settings
+	{
+		uint32_t numIterations = 5u; // Filter footprint doubles every iteration
+		float colourSigma = 0.5f;	 // Luminance difference falloff
+		float normalPower = 64.f;	 // dot(n0, n1)^normalPower
+		float depthSigma = 0.02f;	 // Relative depth difference falloff, grows with the step size
+	};
+
+public:
+	Denoiser() = default;
+	~Denoiser() = default;
+
+	// pNormalDepth holds the first hit normal in xyz and the distance in w, pixels with w <= 0 missed and are passed through
+	void denoise(const glm::vec4* pColour, const glm::vec4* pAlbedo, const glm::vec4* pNormalDepth,
+		uint32_t width, uint32_t height, std::vector<glm::vec4>& outPixels);
+
+	inline Settings& getSettings();
+	inline float getLastDenoiseTime() const; // Milliseconds
+
+private:
+	void filterIteration(const glm::vec4* pSource, glm::vec4* pTarget, const glm::vec4* pNormalDepth,
+		uint32_t width, uint32_t height, uint32_t stepSize) const;
+
+	Settings m_settings;
+	float m_lastDenoiseTime = 0.f;
+
+	std::vector<glm::vec4> m_illumination[2];
+};
+
+inline Denoiser::Settings& Denoiser::getSettings() { return m_settings; }
+inline float Denoiser::getLastDenoiseTime() const { return m_lastDenoiseTime; }
\ No newline at end of file
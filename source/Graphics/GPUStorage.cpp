@@ -2,13 +2,14 @@
 #include "Utilities.h"
 
 GPUStorage::GPUStorage()
-	:m_pBuffer(nullptr), m_pSRV(nullptr), m_capacity(0u), m_elementByteWidth(0u)
+	:m_pBuffer(nullptr), m_pSRV(nullptr), m_capacity(0u), m_elementByteWidth(0u), m_usage(D3D11_USAGE_DYNAMIC)
 {
 }
 
-GPUStorage::GPUStorage(uint32_t elementByteWidth, uint32_t capacity, const void* pData)
+GPUStorage::GPUStorage(uint32_t elementByteWidth, uint32_t capacity, const void* pData, D3D11_USAGE usage)
+	:m_pBuffer(nullptr), m_pSRV(nullptr), m_capacity(0u), m_elementByteWidth(0u), m_usage(usage)
 {
-	initiate(elementByteWidth, capacity, pData);
+	initiate(elementByteWidth, capacity, pData, usage);
 }
 
 GPUStorage::~GPUStorage()
@@ -25,7 +26,7 @@ void GPUStorage::shutdown()
 	m_elementByteWidth = 0u;
 }
 
-void GPUStorage::initiate(uint32_t elementByteWidth, uint32_t capacity, const void* pData)
+void GPUStorage::initiate(uint32_t elementByteWidth, uint32_t capacity, const void* pData, D3D11_USAGE usage)
 {
 	OKAY_ASSERT(elementByteWidth);
 	OKAY_ASSERT(capacity);
@@ -34,8 +35,9 @@ void GPUStorage::initiate(uint32_t elementByteWidth, uint32_t capacity, const vo
 
 	m_elementByteWidth = elementByteWidth;
 	m_capacity = capacity;
+	m_usage = usage;
 
-	bool success = Okay::createStructuredBuffer(&m_pBuffer, &m_pSRV, pData, elementByteWidth, capacity);
+	bool success = Okay::createStructuredBuffer(&m_pBuffer, &m_pSRV, pData, elementByteWidth, capacity, usage);
 	OKAY_ASSERT(success);
 }
 
@@ -43,9 +45,41 @@ void GPUStorage::updateRaw(uint32_t newCapacity, const void* pData)
 {
 	OKAY_ASSERT(pData);
 	OKAY_ASSERT(newCapacity);
+	OKAY_ASSERT(m_usage == D3D11_USAGE_DYNAMIC);
 
 	if (m_capacity != newCapacity && newCapacity)
 		initiate(m_elementByteWidth, newCapacity, pData);
 
 	Okay::updateBuffer(m_pBuffer, pData, (size_t)m_elementByteWidth * newCapacity);
+}
+
+void GPUStorage::write(uint32_t firstElement, uint32_t numElements, const void* pData)
+{
+	OKAY_ASSERT(m_pBuffer);
+	OKAY_ASSERT(m_usage == D3D11_USAGE_DEFAULT);
+
+	if (!numElements)
+		return;
+
+	ID3D11DeviceContext* pDevCon = Okay::getDeviceContext();
+
+	const uint32_t endElement = firstElement + numElements;
+	if (endElement > m_capacity)
+	{
+		ID3D11Buffer* pOldBuffer = m_pBuffer;
+		m_pBuffer = nullptr;
+		DX11_RELEASE(m_pSRV);
+
+		const uint32_t oldCapacity = m_capacity;
+		m_capacity = glm::max(endElement, oldCapacity + oldCapacity / 2u);
+
+		bool success = Okay::createStructuredBuffer(&m_pBuffer, &m_pSRV, nullptr, m_elementByteWidth, m_capacity, D3D11_USAGE_DEFAULT);
+		OKAY_ASSERT(success);
+
+		pDevCon->CopySubresourceRegion(m_pBuffer, 0u, 0u, 0u, 0u, pOldBuffer, 0u, nullptr);
+		DX11_RELEASE(pOldBuffer);
+	}
+
+	const D3D11_BOX box{ firstElement * m_elementByteWidth, 0u, 0u, endElement * m_elementByteWidth, 1u, 1u };
+	pDevCon->UpdateSubresource(m_pBuffer, 0u, &box, pData, 0u, 0u);
 }
\ No newline at end of file
@@ -6,16 +6,21 @@ class GPUStorage
 {
 public:
 	GPUStorage();
-	GPUStorage(uint32_t elementByteWidth, uint32_t capacity, const void* pData);
+	GPUStorage(uint32_t elementByteWidth, uint32_t capacity, const void* pData, D3D11_USAGE usage = D3D11_USAGE_DYNAMIC);
 	~GPUStorage();
 
 	void shutdown();
-	void initiate(uint32_t elementByteWidth, uint32_t capacity, const void* pData);
+	void initiate(uint32_t elementByteWidth, uint32_t capacity, const void* pData, D3D11_USAGE usage = D3D11_USAGE_DYNAMIC);
 
+	// Dynamic storages only, everything is written again
 	template<typename UpdateFunction>
 	void update(uint32_t newCapacity, UpdateFunction function);
 	void updateRaw(uint32_t newCapacity, const void* pData);
 
+	// Default usage storages only, writes [firstElement, firstElement + numElements) and keeps the rest.
+	// Writing past the end grows the storage by at least half, the old elements are copied over on the GPU
+	void write(uint32_t firstElement, uint32_t numElements, const void* pData);
+
 	inline ID3D11ShaderResourceView* getSRV() const;
 	inline uint32_t getCapacity() const;
 
@@ -25,6 +30,7 @@ private:
 
 	uint32_t m_capacity;
 	uint32_t m_elementByteWidth;
+	D3D11_USAGE m_usage;
 };
 
 inline ID3D11ShaderResourceView* GPUStorage::getSRV() const { return m_pSRV; }
@@ -0,0 +1,135 @@
+#include "ImageWriter.h"
+#include "Utilities.h"
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb/stb_image_write.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+template<typename T>
+static void writeValue(std::ofstream& writer, const T& value)
+{
+	writer.write((const char*)&value, sizeof(T));
+}
+
+static void writeAttributeHeader(std::ofstream& writer, std::string_view name, std::string_view type, int32_t size)
+{
+	writer.write(name.data(), name.size() + 1u);
+	writer.write(type.data(), type.size() + 1u);
+	writeValue(writer, size);
+}
+
+namespace ImageWriter
+{
+	bool writePNG(std::string_view path, const glm::vec4* pPixels, uint32_t width, uint32_t height)
+	{
+		std::vector<uint32_t> packedPixels((size_t)width * height);
+		for (size_t i = 0; i < packedPixels.size(); i++)
+		{
+			const glm::uvec4 colour = glm::uvec4(glm::clamp(pPixels[i], 0.f, 1.f) * 255.f + 0.5f);
+			packedPixels[i] = colour.x | (colour.y << 8u) | (colour.z << 16u) | (colour.w << 24u);
+		}
+
+		return stbi_write_png(path.data(), (int)width, (int)height, 4, packedPixels.data(), (int)width * 4);
+	}
+
+	bool writeEXR(std::string_view path, const glm::vec4* pPixels, uint32_t width, uint32_t height)
+	{
+		// OpenEXR 2.0 single part scanline file, see "The OpenEXR File Layout". Assumes a little endian host like the format
+		static const char CHANNEL_NAMES[4] = { 'A', 'B', 'G', 'R' }; // Must be sorted
+		static const uint32_t CHANNEL_INDICES[4] = { 3u, 2u, 1u, 0u };
+		static const int32_t PIXEL_TYPE_FLOAT = 2;
+
+		std::ofstream writer(path.data(), std::ios::binary);
+		if (!writer)
+			return false;
+
+		writeValue(writer, 20000630); // Magic number
+		writeValue(writer, 2);		  // Version 2, no flags
+
+		writeAttributeHeader(writer, "channels", "chlist", 4 * 18 + 1);
+		for (char channelName : CHANNEL_NAMES)
+		{
+			const char name[2] = { channelName, '\0' };
+			const uint8_t pLinearAndReserved[4] = { 0u, 0u, 0u, 0u };
+
+			writer.write(name, 2);
+			writeValue(writer, PIXEL_TYPE_FLOAT);
+			writer.write((const char*)pLinearAndReserved, 4);
+			writeValue(writer, 1); // x sampling
+			writeValue(writer, 1); // y sampling
+		}
+		writer.put('\0');
+
+		const int32_t window[4] = { 0, 0, (int32_t)width - 1, (int32_t)height - 1 };
+
+		writeAttributeHeader(writer, "compression", "compression", 1);
+		writer.put('\0'); // NO_COMPRESSION
+
+		writeAttributeHeader(writer, "dataWindow", "box2i", 16);
+		writer.write((const char*)window, sizeof(window));
+
+		writeAttributeHeader(writer, "displayWindow", "box2i", 16);
+		writer.write((const char*)window, sizeof(window));
+
+		writeAttributeHeader(writer, "lineOrder", "lineOrder", 1);
+		writer.put('\0'); // INCREASING_Y
+
+		writeAttributeHeader(writer, "pixelAspectRatio", "float", 4);
+		writeValue(writer, 1.f);
+
+		writeAttributeHeader(writer, "screenWindowCenter", "v2f", 8);
+		writeValue(writer, glm::vec2(0.f));
+
+		writeAttributeHeader(writer, "screenWindowWidth", "float", 4);
+		writeValue(writer, 1.f);
+
+		writer.put('\0'); // End of header
+
+		// Offset table, every scanline is a y coordinate, its data size and then one row per channel
+		const int32_t scanlineDataSize = (int32_t)(width * 4u * sizeof(float));
+		const uint64_t scanlineBlockSize = sizeof(int32_t) * 2u + scanlineDataSize;
+		const uint64_t firstScanlineOffset = (uint64_t)writer.tellp() + sizeof(uint64_t) * height;
+
+		for (uint32_t y = 0; y < height; y++)
+			writeValue(writer, firstScanlineOffset + scanlineBlockSize * y);
+
+		std::vector<float> scanline((size_t)width * 4u);
+		for (uint32_t y = 0; y < height; y++)
+		{
+			const glm::vec4* pRow = pPixels + (size_t)y * width;
+
+			for (uint32_t c = 0; c < 4u; c++)
+			{
+				for (uint32_t x = 0; x < width; x++)
+					scanline[(size_t)c * width + x] = pRow[x][CHANNEL_INDICES[c]];
+			}
+
+			writeValue(writer, (int32_t)y);
+			writeValue(writer, scanlineDataSize);
+			writer.write((const char*)scanline.data(), scanlineDataSize);
+		}
+
+		return writer.good();
+	}
+
+	bool write(std::string_view path, const glm::vec4* pPixels, uint32_t width, uint32_t height)
+	{
+		const size_t dotPos = path.find_last_of('.');
+		std::string fileEnding(dotPos != std::string_view::npos ? path.substr(dotPos) : "");
+
+		for (char& character : fileEnding)
+			character = (char)tolower(character);
+
+		if (fileEnding == ".exr")
+			return writeEXR(path, pPixels, width, height);
+
+		if (fileEnding == ".png")
+			return writePNG(path, pPixels, width, height);
+
+		printf("Unsupported image format '%s', use .png or .exr\n", fileEnding.c_str());
+		return false;
+	}
+}
\ No newline at end of file
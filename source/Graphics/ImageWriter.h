@@ -0,0 +1,19 @@
+#pragma once
+
+#include "glm/glm.hpp"
+
+#include <stdint.h>
+#include <string_view>
+
+// Writes linear float4 pixels to disk, rows top to bottom
+namespace ImageWriter
+{
+	// Clamped to [0, 1] and stored as 8 bit RGBA, same as the render target
+	bool writePNG(std::string_view path, const glm::vec4* pPixels, uint32_t width, uint32_t height);
+
+	// Uncompressed 32 bit float RGBA scanlines, keeps the full range of the accumulation
+	bool writeEXR(std::string_view path, const glm::vec4* pPixels, uint32_t width, uint32_t height);
+
+	// Picks the format from the file ending, .exr or .png
+	bool write(std::string_view path, const glm::vec4* pPixels, uint32_t width, uint32_t height);
+}
\ No newline at end of file
@@ -1,10 +1,66 @@
 #include "Importer.h"
 #include "Mesh.h"
 
-#include "assimp/importer.hpp"
+#include <atomic>
+
+// Read from the async loader's thread as well
+static std::atomic<bool> quietImports = false;
+
+namespace Importer
+{
+	void setQuiet(bool quiet)
+	{
+		quietImports = quiet;
+	}
+
+	bool isQuiet()
+	{
+		return quietImports;
+	}
+
+	bool loadObjects(std::string_view filePath, std::vector<ObjectDecriptionStr>& outObjects, float scale)
+	{
+		const size_t dotPos = filePath.find_last_of('.');
+		std::string fileEnding(dotPos != std::string_view::npos ? filePath.substr(dotPos) : "");
+
+		for (char& character : fileEnding)
+			character = (char)tolower(character);
+
+		if (fileEnding == ".obj")
+			return loadObj(filePath, outObjects, scale);
+
+		return loadObjectsAssimp(filePath, outObjects, scale);
+	}
+}
+
+#ifdef OKAY_NO_ASSIMP
+
+// Built without assimp (see CMakeLists.txt), only .obj files can be imported
+namespace Importer
+{
+	bool loadMesh(std::string_view filePath, MeshData& outData, std::string* pOutname)
+	{
+		printf("Can't import '%s', built without assimp\n", filePath.data());
+		return false;
+	}
+
+	bool loadObjectsAssimp(std::string_view filePath, std::vector<ObjectDecriptionStr>& outObjects, float scale)
+	{
+		printf("Can't import '%s', built without assimp\n", filePath.data());
+		return false;
+	}
+}
+
+#else
+
+#include "Threading.h"
+
+#include "assimp/Importer.hpp"
 #include "assimp/postprocess.h"
 #include "assimp/scene.h"
 
+#include <chrono>
+
 namespace Importer
 {
 	glm::vec3 assimpToGlmVec3(const aiVector3D& vector)
@@ -17,41 +73,42 @@ namespace Importer
 		outData.boundingBox.min = glm::vec3(FLT_MAX);
 		outData.boundingBox.max = glm::vec3(-FLT_MAX);
 
-		uint32_t numVerticies = pAiMesh->mNumFaces * 3u;
+		// assimp already shares the vertices between faces, copy them as is and keep the faces as indices
+		// The attributes are packed on the way, the Mesh takes over these vectors without touching them again
+		uint32_t numVerticies = pAiMesh->mNumVertices;
 		outData.positions.resize(numVerticies);
-		outData.normals.resize(numVerticies);
-		outData.uvs.resize(numVerticies);
-		outData.tangents.resize(numVerticies);
-		outData.bitangents.resize(numVerticies);
+		outData.vertexInfo.resize(numVerticies);
 
 		bool hasUV = pAiMesh->HasTextureCoords(0u);
 		bool hasTangent = pAiMesh->HasTangentsAndBitangents();
 
+		for (uint32_t i = 0; i < numVerticies; i++)
+		{
+			glm::vec3 position = assimpToGlmVec3(pAiMesh->mVertices[i]) * scale;
+			outData.positions[i] = position;
+
+			Okay::VertexInfo vertexInfo;
+			vertexInfo.normal = assimpToGlmVec3(pAiMesh->mNormals[i]);
+			vertexInfo.uv = hasUV ? assimpToGlmVec3(pAiMesh->mTextureCoords[0][i]) : glm::vec2(0.f);
+			vertexInfo.tangent = hasTangent ? assimpToGlmVec3(pAiMesh->mTangents[i]) : glm::vec3(0.f);
+			vertexInfo.bitangent = hasTangent ? assimpToGlmVec3(pAiMesh->mBitangents[i]) : glm::vec3(0.f);
+			outData.vertexInfo[i] = Okay::packVertexInfo(vertexInfo);
+
+			// Perhaps not the best way but works
+			outData.boundingBox.min = glm::min(position, outData.boundingBox.min);
+			outData.boundingBox.max = glm::max(position, outData.boundingBox.max);
+		}
+
+		outData.triangles.clear();
+		outData.triangles.reserve(pAiMesh->mNumFaces);
+
 		for (uint32_t i = 0; i < pAiMesh->mNumFaces; i++)
 		{
-			uint32_t vertex0Idx = i * 3;
-			uint32_t* aiIndices = pAiMesh->mFaces[i].mIndices;
+			const aiFace& face = pAiMesh->mFaces[i];
+			if (face.mNumIndices != 3u) // Points and lines survive aiProcess_Triangulate
+				continue;
 
-			for (uint32_t j = 0; j < 3; j++)
-			{
-				glm::vec3 position = assimpToGlmVec3(pAiMesh->mVertices[aiIndices[j]]) * scale;
-				glm::vec3 normal = assimpToGlmVec3(pAiMesh->mNormals[aiIndices[j]]);
-				glm::vec2 uv = hasUV ? assimpToGlmVec3(pAiMesh->mTextureCoords[0][aiIndices[j]]) : glm::vec2(0.f);
-				glm::vec3 tangent = hasTangent ? assimpToGlmVec3(pAiMesh->mTangents[aiIndices[j]]) : glm::vec3(0.f);
-				glm::vec3 bitangent = hasTangent ? assimpToGlmVec3(pAiMesh->mBitangents[aiIndices[j]]) : glm::vec3(0.f);
-
-				uint32_t vertexIdx = vertex0Idx + j;
-
-				outData.positions[vertexIdx] = position;
-				outData.normals[vertexIdx] = normal;
-				outData.uvs[vertexIdx] = uv;
-				outData.tangents[vertexIdx] = tangent;
-				outData.bitangents[vertexIdx] = bitangent;
-
-				// Perhaps not the best way but works
-				outData.boundingBox.min = glm::min(position, outData.boundingBox.min);
-				outData.boundingBox.max = glm::max(position, outData.boundingBox.max);
-			}
+			outData.triangles.emplace_back(face.mIndices[0], face.mIndices[1], face.mIndices[2]);
 		}
 	}
 
@@ -74,16 +131,20 @@ namespace Importer
 		return true;
 	}
 
-	bool loadObjects(std::string_view filePath, std::vector<ObjectDecriptionStr>& outObjects, float scale)
+	bool loadObjectsAssimp(std::string_view filePath, std::vector<ObjectDecriptionStr>& outObjects, float scale)
 	{
 		Assimp::Importer importer;
 
+		auto parseStart = std::chrono::system_clock::now();
+
 		const aiScene* pAiScene = importer.ReadFile(filePath.data(),
 			aiProcess_Triangulate | aiProcess_ConvertToLeftHanded | aiProcess_CalcTangentSpace); // aiProcess_OptimizeMeshes
 
 		if (!pAiScene)
 			return false;
 
+		std::chrono::duration<float> parseDuration = std::chrono::system_clock::now() - parseStart;
+
 		outObjects.resize(pAiScene->mNumMeshes);
 
 		for (uint32_t i = 0; i < pAiScene->mNumMeshes; i++)
@@ -112,10 +173,26 @@ namespace Importer
 				objectDesc.normalTexturePath = textureStr.C_Str();
 			else if (pAiMaterial->GetTexture(aiTextureType_DISPLACEMENT, 0u, &textureStr) == aiReturn_SUCCESS)
 				objectDesc.normalTexturePath = textureStr.C_Str();
+		}
+
+		// The scene is only read from here on, each mesh converts on its own thread and writes only its own slot
+		auto conversionStart = std::chrono::system_clock::now();
 
-			aiMeshToMeshData(pAiMesh, objectDesc.meshData, scale);
+		Okay::parallelFor(pAiScene->mNumMeshes, [&](uint32_t i)
+			{
+				aiMeshToMeshData(pAiScene->mMeshes[i], outObjects[i].meshData, scale);
+			});
+
+		std::chrono::duration<float> conversionDuration = std::chrono::system_clock::now() - conversionStart;
+
+		if (!isQuiet())
+		{
+			printf("Imported '%s', %u meshes\n", filePath.data(), pAiScene->mNumMeshes);
+			printf("Assimp parse: %.3fms\nMesh conversion: %.3fms\n", parseDuration.count() * 1000.f, conversionDuration.count() * 1000.f);
 		}
 
 		return true;
 	}
-}
\ No newline at end of file
+}
+
+#endif // OKAY_NO_ASSIMP
\ No newline at end of file
@@ -19,5 +19,15 @@ namespace Importer
 
 	bool loadMesh(std::string_view filePath, MeshData& outMeshData, std::string* pOutname = nullptr);
 
+	// .obj files go through loadObj, everything else through assimp
 	bool loadObjects(std::string_view filePath, std::vector<ObjectDecriptionStr>& outObjects, float scale = 1.f);
+
+	bool loadObjectsAssimp(std::string_view filePath, std::vector<ObjectDecriptionStr>& outObjects, float scale = 1.f);
+
+	// The built in OBJ/MTL parser, see ObjImporter.cpp. Works without assimp
+	bool loadObj(std::string_view filePath, std::vector<ObjectDecriptionStr>& outObjects, float scale = 1.f);
+
+	// Quiet imports don't print their timings, here or in ResourceManager. Failures and skipped data are still printed
+	void setQuiet(bool quiet);
+	bool isQuiet();
 }
\ No newline at end of file
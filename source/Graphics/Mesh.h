@@ -1,59 +1,112 @@
 #pragma once
 #include "Utilities.h"
 
+#include <memory>
+#include <span>
 #include <vector>
 
+// A flattened BVH node, also the layout of the trees prebuilt into .okm files
+struct GPUNode
+{
+	Okay::AABB boundingBox;
+	uint32_t triStart = Okay::INVALID_UINT;
+	uint32_t triEnd = Okay::INVALID_UINT;
+	uint32_t firstChildIdx = Okay::INVALID_UINT;
+};
+
+// The storage of a Mesh, filled in by the importer (or by code) and moved into the Mesh without another pass
 struct MeshData
 {
+	// Per vertex
 	std::vector<glm::vec3> positions;
-	std::vector<glm::vec3> normals;
-	std::vector<glm::vec2> uvs;
-	std::vector<glm::vec3> tangents;
-	std::vector<glm::vec3> bitangents;
+	std::vector<Okay::PackedVertexInfo> vertexInfo;
+
+	// Vertex indices
+	std::vector<glm::uvec3> triangles;
 
 	Okay::AABB boundingBox;
 };
 
+// Geometry owned by something else, like a memory mapped .okm file
+struct MeshView
+{
+	std::span<const glm::vec3> positions;
+	std::span<const Okay::PackedVertexInfo> vertexInfo;
+	std::span<const glm::uvec3> triangles;
+	Okay::AABB boundingBox;
+
+	// Optional, a tree built ahead of time. The triangles are then already in its leaf order and triStart & triEnd are local to the mesh
+	std::span<const GPUNode> bvhNodes;
+	uint32_t bvhMaxLeafTriangles = 0u;
+	uint32_t bvhMaxDepth = 0u;
+};
+
+// Immutable once built, copies share the storage
 class Mesh
 {
 public:
 	Mesh(const MeshData& meshData, const std::string& name)
-		:m_name(name), m_boundingBox(meshData.boundingBox)
+		:Mesh(MeshData(meshData), name)
+	{ }
+
+	Mesh(MeshData&& meshData, const std::string& name)
+		:m_name(name)
 	{
-		const uint32_t numVerticies = (uint32_t)meshData.positions.size();
-		m_trianglesPos.resize(numVerticies / 3);
-		m_trianglesInfo.resize(numVerticies / 3);
-
-		for (uint32_t i = 0; i < numVerticies; i++)
-		{
-			const uint32_t triangleIdx = i / 3;
-			const uint32_t localVertexIdx = i % 3;
-
-			m_trianglesPos[triangleIdx].position[localVertexIdx] = meshData.positions[i];
-
-			Okay::VertexInfo& localVertexInfo = m_trianglesInfo[triangleIdx].vertexInfo[localVertexIdx];
-			localVertexInfo.normal = meshData.normals[i];
-			localVertexInfo.uv = meshData.uvs[i];
-			localVertexInfo.tangent = meshData.tangents[i];
-			localVertexInfo.bitangent = meshData.bitangents[i];
-		}
+		std::shared_ptr<MeshData> pData = std::make_shared<MeshData>(std::move(meshData));
+
+		m_view.positions = pData->positions;
+		m_view.vertexInfo = pData->vertexInfo;
+		m_view.triangles = pData->triangles;
+		m_view.boundingBox = pData->boundingBox;
+
+		m_pStorage = std::move(pData);
 	}
 
+	// pStorage keeps the memory the view points into alive
+	Mesh(std::shared_ptr<const void> pStorage, const MeshView& view, const std::string& name)
+		:m_name(name), m_pStorage(std::move(pStorage)), m_view(view)
+	{ }
+
 	~Mesh() = default;
 
-	inline const std::vector<Okay::Triangle>& getTrianglesPos() const;
-	inline const std::vector<Okay::TriangleInfo>& getTrianglesInfo() const;
+	inline const std::string& getName() const;
+	inline std::span<const glm::vec3> getPositions() const;
+	inline std::span<const Okay::PackedVertexInfo> getVertexInfo() const;
+	inline std::span<const glm::uvec3> getTriangles() const;
+	inline uint32_t getNumTriangles() const;
 	inline const Okay::AABB& getBoundingBox() const;
 
+	// Empty unless the mesh was loaded with a tree built for exactly these settings
+	inline std::span<const GPUNode> getPrebuiltBvh(uint32_t maxLeafTriangles, uint32_t maxDepth) const;
+	inline const MeshView& getView() const;
+
+	// Bytes of vertex and index data, for comparing against the old 168 bytes per triangle
+	inline size_t getGeometrySize() const;
+
 private:
 	std::string m_name;
-
-	std::vector<Okay::Triangle> m_trianglesPos;
-	std::vector<Okay::TriangleInfo> m_trianglesInfo;
-	Okay::AABB m_boundingBox;
+	std::shared_ptr<const void> m_pStorage;
+	MeshView m_view;
 };
 
-inline const std::vector<Okay::Triangle>& Mesh::getTrianglesPos() const			{ return m_trianglesPos; }
-inline const std::vector<Okay::TriangleInfo>& Mesh::getTrianglesInfo() const	{ return m_trianglesInfo; }
+inline const std::string& Mesh::getName() const									{ return m_name; }
+inline std::span<const glm::vec3> Mesh::getPositions() const					{ return m_view.positions; }
+inline std::span<const Okay::PackedVertexInfo> Mesh::getVertexInfo() const		{ return m_view.vertexInfo; }
+inline std::span<const glm::uvec3> Mesh::getTriangles() const					{ return m_view.triangles; }
+inline uint32_t Mesh::getNumTriangles() const									{ return (uint32_t)m_view.triangles.size(); }
 
-inline const Okay::AABB& Mesh::getBoundingBox() const	{ return m_boundingBox; }
\ No newline at end of file
+inline const Okay::AABB& Mesh::getBoundingBox() const	{ return m_view.boundingBox; }
+inline const MeshView& Mesh::getView() const			{ return m_view; }
+
+inline std::span<const GPUNode> Mesh::getPrebuiltBvh(uint32_t maxLeafTriangles, uint32_t maxDepth) const
+{
+	if (m_view.bvhMaxLeafTriangles != maxLeafTriangles || m_view.bvhMaxDepth != maxDepth)
+		return {};
+
+	return m_view.bvhNodes;
+}
+
+inline size_t Mesh::getGeometrySize() const
+{
+	return m_view.positions.size_bytes() + m_view.vertexInfo.size_bytes() + m_view.triangles.size_bytes();
+}
\ No newline at end of file
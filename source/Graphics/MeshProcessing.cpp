@@ -0,0 +1,177 @@
+#include "MeshProcessing.h"
+
+#include <cstring>
+#include <unordered_map>
+
+// Relative to the largest coordinate, a few float ulps of slack for copies that were translated before being written out
+static const float TRANSLATED_COPY_TOLERANCE = 1e-5f;
+
+static uint64_t hashBytes(const void* pData, size_t numBytes, uint64_t hash)
+{
+	const uint8_t* pBytes = (const uint8_t*)pData;
+
+	size_t i = 0;
+	for (; i + sizeof(uint64_t) <= numBytes; i += sizeof(uint64_t))
+	{
+		uint64_t word;
+		memcpy(&word, pBytes + i, sizeof(uint64_t));
+
+		hash = (hash ^ word) * 0x9E3779B97F4A7C15ull;
+		hash ^= hash >> 29u;
+	}
+
+	for (; i < numBytes; i++)
+		hash = (hash ^ pBytes[i]) * 0x100000001B3ull;
+
+	return hash;
+}
+
+static uint64_t hashCell(const glm::ivec3& cell)
+{
+	return (uint64_t)(uint32_t)cell.x * 0x9E3779B97F4A7C15ull ^ (uint64_t)(uint32_t)cell.y * 0xC2B2AE3D27D4EB4Full ^ (uint64_t)(uint32_t)cell.z * 0x165667B19E3779F9ull;
+}
+
+static bool isSameVertexInfo(const Okay::PackedVertexInfo& a, const Okay::PackedVertexInfo& b)
+{
+	return a.normal == b.normal && a.tangent == b.tangent && a.uv == b.uv;
+}
+
+namespace MeshProcessing
+{
+	uint32_t weldVertices(MeshData& meshData, float epsilon)
+	{
+		const uint32_t numVerticies = (uint32_t)meshData.positions.size();
+
+		// Vertices go into cells epsilon wide, a match can then only be in the same or a neighbouring cell.
+		// Exact welding hashes the position itself. Cells that hash the same only cost an extra comparison
+		auto getCell = [&](const glm::vec3& position)
+			{
+				if (epsilon > 0.f)
+					return glm::ivec3(glm::floor(position / epsilon));
+
+				glm::ivec3 bits;
+				memcpy(&bits, &position, sizeof(glm::vec3));
+				return bits;
+			};
+
+		const int32_t searchRadius = epsilon > 0.f ? 1 : 0;
+		const float epsilonSquared = epsilon * epsilon;
+
+		std::unordered_map<uint64_t, uint32_t> cellHeads; // Latest vertex kept in the cell
+		cellHeads.reserve(numVerticies);
+
+		std::vector<uint32_t> nextInCell(numVerticies, Okay::INVALID_UINT);
+		std::vector<uint32_t> remap(numVerticies);
+		uint32_t numKept = 0u;
+
+		for (uint32_t i = 0; i < numVerticies; i++)
+		{
+			const glm::vec3& position = meshData.positions[i];
+			const Okay::PackedVertexInfo& vertexInfo = meshData.vertexInfo[i];
+			const glm::ivec3 cell = getCell(position);
+
+			uint32_t match = Okay::INVALID_UINT;
+			for (int32_t z = -searchRadius; z <= searchRadius && match == Okay::INVALID_UINT; z++)
+			{
+				for (int32_t y = -searchRadius; y <= searchRadius && match == Okay::INVALID_UINT; y++)
+				{
+					for (int32_t x = -searchRadius; x <= searchRadius && match == Okay::INVALID_UINT; x++)
+					{
+						auto iterator = cellHeads.find(hashCell(cell + glm::ivec3(x, y, z)));
+						if (iterator == cellHeads.end())
+							continue;
+
+						// Kept vertices are already compacted, indices in the chain point into the compacted arrays
+						for (uint32_t candidate = iterator->second; candidate != Okay::INVALID_UINT; candidate = nextInCell[candidate])
+						{
+							const glm::vec3 offset = meshData.positions[candidate] - position;
+							const bool isClose = epsilon > 0.f ? glm::dot(offset, offset) <= epsilonSquared : meshData.positions[candidate] == position;
+
+							if (isClose && isSameVertexInfo(meshData.vertexInfo[candidate], vertexInfo))
+							{
+								match = candidate;
+								break;
+							}
+						}
+					}
+				}
+			}
+
+			if (match != Okay::INVALID_UINT)
+			{
+				remap[i] = match;
+				continue;
+			}
+
+			// Compacted in place, every earlier vertex is already done with
+			meshData.positions[numKept] = position;
+			meshData.vertexInfo[numKept] = vertexInfo;
+			remap[i] = numKept;
+
+			uint32_t& cellHead = cellHeads.try_emplace(hashCell(cell), Okay::INVALID_UINT).first->second;
+			nextInCell[numKept] = cellHead;
+			cellHead = numKept;
+
+			numKept++;
+		}
+
+		meshData.positions.resize(numKept);
+		meshData.vertexInfo.resize(numKept);
+
+		size_t numTriangles = 0u;
+		for (const glm::uvec3& triangle : meshData.triangles)
+		{
+			const glm::uvec3 welded = glm::uvec3(remap[triangle.x], remap[triangle.y], remap[triangle.z]);
+			if (welded.x != welded.y && welded.y != welded.z && welded.z != welded.x)
+				meshData.triangles[numTriangles++] = welded;
+		}
+		meshData.triangles.resize(numTriangles);
+
+		// Merged vertices can move the bounds by up to epsilon
+		meshData.boundingBox = Okay::AABB();
+		for (const glm::vec3& position : meshData.positions)
+			meshData.boundingBox.growTo(position);
+
+		return numVerticies - numKept;
+	}
+
+	uint64_t hashGeometry(const Mesh& mesh)
+	{
+		uint64_t hash = 0xCBF29CE484222325ull;
+		hash = hashBytes(mesh.getTriangles().data(), mesh.getTriangles().size_bytes(), hash);
+		hash = hashBytes(mesh.getVertexInfo().data(), mesh.getVertexInfo().size_bytes(), hash);
+
+		const uint64_t numVerticies = mesh.getPositions().size();
+		return hashBytes(&numVerticies, sizeof(numVerticies), hash);
+	}
+
+	bool isTranslatedCopy(const Mesh& original, const Mesh& copy, glm::vec3& outTranslation)
+	{
+		const std::span<const glm::vec3> originalPositions = original.getPositions();
+		const std::span<const glm::vec3> copyPositions = copy.getPositions();
+
+		if (originalPositions.size() != copyPositions.size() || original.getNumTriangles() != copy.getNumTriangles() || originalPositions.empty())
+			return false;
+
+		if (memcmp(original.getTriangles().data(), copy.getTriangles().data(), original.getTriangles().size_bytes()) ||
+			memcmp(original.getVertexInfo().data(), copy.getVertexInfo().data(), original.getVertexInfo().size_bytes()))
+			return false;
+
+		const Okay::AABB& originalBounds = original.getBoundingBox();
+		const Okay::AABB& copyBounds = copy.getBoundingBox();
+		outTranslation = (copyBounds.min + copyBounds.max - originalBounds.min - originalBounds.max) * 0.5f;
+
+		const glm::vec3 largestCoordinates = glm::max(glm::max(glm::abs(originalBounds.min), glm::abs(originalBounds.max)),
+			glm::max(glm::abs(copyBounds.min), glm::abs(copyBounds.max)));
+		const float tolerance = TRANSLATED_COPY_TOLERANCE * glm::max(glm::max(largestCoordinates.x, largestCoordinates.y), glm::max(largestCoordinates.z, 1.f));
+
+		for (size_t i = 0; i < originalPositions.size(); i++)
+		{
+			const glm::vec3 difference = glm::abs(originalPositions[i] + outTranslation - copyPositions[i]);
+			if (glm::max(glm::max(difference.x, difference.y), difference.z) > tolerance)
+				return false;
+		}
+
+		return true;
+	}
+}
\ No newline at end of file
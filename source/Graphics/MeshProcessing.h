@@ -0,0 +1,18 @@
+#pragma once
+
+#include "Mesh.h"
+
+// Geometry clean up done at import, before the meshes are built
+namespace MeshProcessing
+{
+	// Merges every vertex closer than epsilon to an earlier one with the same packed attributes into it, 0 only merges exact duplicates.
+	// Triangles left with a repeated vertex are removed. Returns the number of removed vertices
+	uint32_t weldVertices(MeshData& meshData, float epsilon);
+
+	// Equal for meshes that are translated copies of each other, the positions aren't part of it
+	uint64_t hashGeometry(const Mesh& mesh);
+
+	// True if copy is original moved by outTranslation, with the same triangles and attributes.
+	// The positions may differ by float rounding, copies baked into a model at different places don't compare exactly
+	bool isTranslatedCopy(const Mesh& original, const Mesh& copy, glm::vec3& outTranslation);
+}
\ No newline at end of file
@@ -0,0 +1,110 @@
+#include "MotionMode.h"
+#include "Threading.h"
+
+namespace MotionMode
+{
+	glm::uvec2 getInterleavedPixelOffset(uint32_t frameIdx, uint32_t stride)
+	{
+		static const glm::uvec2 BAYER_ORDER[4] = { {0u, 0u}, {1u, 1u}, {1u, 0u}, {0u, 1u} };
+
+		glm::uvec2 offset(0u);
+		uint32_t idx = frameIdx % (stride * stride);
+
+		for (uint32_t scale = stride / 2u; scale; scale /= 2u)
+		{
+			offset += BAYER_ORDER[idx % 4u] * scale;
+			idx /= 4u;
+		}
+
+		return offset;
+	}
+
+	uint32_t resolveFrame(const Reprojection::History& history, const Reprojection::Settings& settings, uint32_t stride, glm::uvec2 offset,
+		glm::uvec2 textureDims, std::span<Reprojection::Surface> surfaces, std::span<glm::vec4> pixels)
+	{
+		const size_t numPixels = (size_t)textureDims.x * textureDims.y;
+		if (surfaces.size() != numPixels || pixels.size() != numPixels || offset.x >= textureDims.x || offset.y >= textureDims.y)
+			return 0u;
+
+		// The first motion frame has nothing to reproject
+		const bool historyValid = history.textureDims == textureDims && history.accumulation.size() == numPixels && history.surfaces.size() == numPixels;
+		const float maxHistoryAge = getMaxHistoryAge(stride);
+
+		// Texel [x, y] of the traced pixels is at pixel [x, y] * stride + offset
+		const glm::ivec2 maxTexel = glm::ivec2((textureDims - offset + stride - 1u) / stride) - 1;
+		auto getTracedIdx = [&](glm::ivec2 texel)
+			{
+				const glm::uvec2 pixel = glm::uvec2(glm::clamp(texel, glm::ivec2(0), maxTexel)) * stride + offset;
+				return (size_t)pixel.y * textureDims.x + pixel.x;
+			};
+
+		// Counted per row so the rows don't share a counter
+		std::vector<uint32_t> rowNumReprojected(textureDims.y, 0u);
+
+		// Only the traced pixels are read and only the others are written, so the rows don't depend on each other
+		Okay::parallelFor(textureDims.y, [&](uint32_t y)
+			{
+				for (uint32_t x = 0; x < textureDims.x; x++)
+				{
+					const glm::uvec2 pixel(x, y);
+					if (isTracedPixel(pixel, stride, offset))
+						continue;
+
+					const size_t pixelIdx = (size_t)y * textureDims.x + x;
+					const glm::vec2 tracedPos = (glm::vec2(pixel) - glm::vec2(offset)) / (float)stride;
+
+					// The surface under an untraced pixel isn't known, the closest traced pixel's is the best guess
+					// Its motion is shifted by the distance between the two, the surface test below rejects the guess across edges
+					const glm::ivec2 closestTexel = glm::clamp(glm::ivec2(glm::floor(tracedPos + 0.5f)), glm::ivec2(0), maxTexel);
+					const glm::ivec2 closestPixel = closestTexel * (int)stride + glm::ivec2(offset);
+					const Reprojection::Surface& surface = surfaces[(size_t)closestPixel.y * textureDims.x + closestPixel.x];
+
+					glm::vec2 historyPos;
+					if (historyValid && surface.instanceId >= 0.f && Reprojection::worldToPixel(history.viewProjection, surface.worldPosition, textureDims, historyPos))
+					{
+						const glm::vec2 historyPixel = glm::floor(historyPos + glm::vec2(glm::ivec2(pixel) - closestPixel) + 0.5f);
+						if (historyPixel.x >= 0.f && historyPixel.y >= 0.f && historyPixel.x < (float)textureDims.x && historyPixel.y < (float)textureDims.y)
+						{
+							const size_t historyIdx = (size_t)historyPixel.y * textureDims.x + (size_t)historyPixel.x;
+							const glm::vec4& historyPixelValue = history.accumulation[historyIdx];
+							const Reprojection::Surface& historySurface = history.surfaces[historyIdx];
+
+							// Like Reprojection::findHistoryPixel(), except the depth is checked against the traced surface's plane
+							// The surfaces are a few pixels apart, their distances to the camera differ a lot on slanted surfaces
+							const float planeDistance = glm::abs(glm::dot(historySurface.worldPosition - surface.worldPosition, surface.normal));
+							const float distance = glm::length(surface.worldPosition - history.cameraPosition);
+
+							if (historyPixelValue.w > 0.f && historyPixelValue.w < maxHistoryAge &&
+								historySurface.instanceId == surface.instanceId &&
+								glm::dot(surface.normal, historySurface.normal) >= settings.normalThreshold &&
+								planeDistance <= settings.depthTolerance * distance)
+							{
+								pixels[pixelIdx] = glm::vec4(glm::vec3(historyPixelValue), historyPixelValue.w + 1.f);
+								surfaces[pixelIdx] = historySurface;
+								rowNumReprojected[y]++;
+								continue;
+							}
+						}
+					}
+
+					// Bilinear filter between the four closest traced pixels
+					const glm::vec2 floorPos = glm::floor(tracedPos);
+					const glm::vec2 weight = tracedPos - floorPos;
+					const glm::ivec2 texel0 = glm::ivec2(floorPos);
+					const glm::ivec2 texel1 = texel0 + 1;
+
+					const glm::vec4 top = glm::mix(pixels[getTracedIdx(texel0)], pixels[getTracedIdx(glm::ivec2(texel1.x, texel0.y))], weight.x);
+					const glm::vec4 bottom = glm::mix(pixels[getTracedIdx(glm::ivec2(texel0.x, texel1.y))], pixels[getTracedIdx(texel1)], weight.x);
+
+					pixels[pixelIdx] = glm::vec4(glm::vec3(glm::mix(top, bottom, weight.y)), 0.f);
+					surfaces[pixelIdx] = Reprojection::Surface();
+				}
+			});
+
+		uint32_t numReprojected = 0u;
+		for (uint32_t rowCount : rowNumReprojected)
+			numReprojected += rowCount;
+
+		return numReprojected;
+	}
+}
\ No newline at end of file
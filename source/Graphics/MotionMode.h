@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Reprojection.h"
+
+/*
+	Tracing only one pixel per stride x stride block while the camera moves, ported to resources/shaders/MotionUpsampleCS.hlsl.
+	The traced pixel moves through the block every frame, the pixels in between reproject the last frame's result
+	so the interleaved frames add up to the full resolution.
+*/
+namespace MotionMode
+{
+	// Bayer order, consecutive frames land as far apart as possible within the block
+	// Every pixel of the block is traced once per stride * stride frames, the stride has to be a power of 2
+	glm::uvec2 getInterleavedPixelOffset(uint32_t frameIdx, uint32_t stride);
+
+	inline bool isTracedPixel(glm::uvec2 pixel, uint32_t stride, glm::uvec2 offset)
+	{
+		return pixel.x % stride == offset.x && pixel.y % stride == offset.y;
+	}
+
+	// A pixel that went this many frames without being traced isn't reprojected any further, it should have been traced again long before
+	inline float getMaxHistoryAge(uint32_t stride)
+	{
+		return (float)(stride * stride * 2u);
+	}
+
+	/*
+		Fills in the pixels that weren't traced this frame.
+		Traced pixels hold (colour, 1) and their first hit in surfaces, the others are overwritten.
+		They take the history, the last result reprojected into this view, with alpha = frames since the pixel was traced + 1.
+		Where there is no history they're upsampled from the traced pixels, with alpha = 0 so they don't become history themselves.
+		Returns the number of pixels that took history
+	*/
+	uint32_t resolveFrame(const Reprojection::History& history, const Reprojection::Settings& settings, uint32_t stride, glm::uvec2 offset,
+		glm::uvec2 textureDims, std::span<Reprojection::Surface> surfaces, std::span<glm::vec4> pixels);
+}
\ No newline at end of file
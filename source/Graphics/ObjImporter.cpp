@@ -0,0 +1,817 @@
+#include "Importer.h"
+#include "MappedFile.h"
+#include "Threading.h"
+
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+
+/*
+	OBJ/MTL parser giving the same ObjectDecriptionStr as assimp with the flags in Importer.cpp: one object per 'o' / 'g'
+	and material, left handed (z negated, v = 1 - v and the winding reversed) and assimp's per face tangents.
+	Unlike assimp the corners with the same v/vt/vn indices share a vertex, the tangents of the faces around a vertex are
+	averaged like MikkTSpace does. Polygons are fanned, which is what assimp does for convex ones.
+
+	The file is memory mapped and split into chunks of whole lines that are parsed on their own threads.
+	The indices are resolved once every chunk knows how many v, vt & vn came before it.
+*/
+
+// Marks an index relative to the chunk's first attribute (a negative OBJ index), resolved after parsing
+static const uint32_t CHUNK_RELATIVE_BIT = 1u << 31u;
+static const uint32_t CHUNK_RELATIVE_BIAS = 1u << 30u;
+static const uint32_t OUT_OF_RANGE_IDX = Okay::INVALID_UINT - 1u; // The face using it is skipped
+static const uint64_t MIN_CHUNK_SIZE = 256u * 1024u;
+static const uint32_t VERTEX_JOB_SIZE = 4096u;
+
+struct ObjStatement
+{
+	enum class Type { Object, Group, UseMaterial, MaterialLibrary };
+
+	Type type;
+	std::string name;
+	uint32_t faceIdx; // Number of faces in the chunk before the statement
+};
+
+struct ObjChunk
+{
+	std::string_view text;
+
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec2> uvs;
+	std::vector<glm::vec3> normals;
+
+	std::vector<glm::uvec3> corners;	// v, vt & vn, 0 based and INVALID_UINT when left out
+	std::vector<uint32_t> faceStarts;	// First corner of each face, and one past the last face
+	std::vector<ObjStatement> statements;
+
+	glm::uvec3 firstAttributeIdx = glm::uvec3(0u); // v, vt & vn in the chunks before
+	uint32_t numInvalidLines = 0u;
+};
+
+struct ObjMaterial
+{
+	std::string albedoTexturePath;
+	std::string rougnessTexturePath;
+	std::string metallicTexturePath;
+	std::string specularTexturePath;
+	std::string normalTexturePath;
+	std::string displacementTexturePath;
+};
+
+struct ObjFaceRange
+{
+	uint32_t chunkIdx;
+	uint32_t firstFace;
+	uint32_t endFace;
+};
+
+struct ObjMesh
+{
+	std::string name;
+	uint32_t materialIdx = Okay::INVALID_UINT;
+	std::vector<ObjFaceRange> faceRanges;
+
+	// Built from the faces, in the file's right handed space until the vertices are written out
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec2> uvs;
+	std::vector<glm::vec3> normals;
+	std::vector<glm::uvec3> triangles;
+	uint32_t numGeneratedNormals = 0u; // The vertices without a vn come last
+	bool hasUVs = false;
+
+	// Triangles around each vertex
+	std::vector<uint32_t> adjacencyStarts;
+	std::vector<uint32_t> adjacentTriangles;
+};
+
+static uint64_t hashCorner(const glm::uvec3& corner)
+{
+	uint64_t hash = corner.x * 0x9E3779B97F4A7C15ull ^ corner.y * 0xC2B2AE3D27D4EB4Full ^ corner.z * 0x165667B19E3779F9ull;
+	return hash ^ (hash >> 32u);
+}
+
+static bool isSpace(char character)
+{
+	return character == ' ' || character == '\t' || character == '\r';
+}
+
+static const char* skipSpaces(const char* pText, const char* pEnd)
+{
+	while (pText < pEnd && isSpace(*pText))
+		pText++;
+
+	return pText;
+}
+
+static std::string_view trim(std::string_view text)
+{
+	while (!text.empty() && isSpace(text.front()))
+		text.remove_prefix(1u);
+
+	while (!text.empty() && isSpace(text.back()))
+		text.remove_suffix(1u);
+
+	return text;
+}
+
+// Returns nullptr if there's no number
+static const char* parseFloat(const char* pText, const char* pEnd, float& outValue)
+{
+	pText = skipSpaces(pText, pEnd);
+	if (pText < pEnd && *pText == '+')
+		pText++;
+
+	std::from_chars_result result = std::from_chars(pText, pEnd, outValue);
+	return result.ec == std::errc() ? result.ptr : nullptr;
+}
+
+// Calls function(line) for every line in text, without the line break
+template<typename Function>
+static void forEachLine(std::string_view text, Function function)
+{
+	const char* pText = text.data();
+	const char* pEnd = pText + text.size();
+
+	while (pText < pEnd)
+	{
+		const char* pLineEnd = (const char*)memchr(pText, '\n', pEnd - pText);
+		if (!pLineEnd)
+			pLineEnd = pEnd;
+
+		function(std::string_view(pText, pLineEnd - pText));
+		pText = pLineEnd + 1;
+	}
+}
+
+// Splits a line into its keyword and the trimmed rest
+static std::string_view splitKeyword(std::string_view line, std::string_view& outRest)
+{
+	line = trim(line);
+
+	size_t keywordEnd = 0u;
+	while (keywordEnd < line.size() && !isSpace(line[keywordEnd]))
+		keywordEnd++;
+
+	outRest = trim(line.substr(keywordEnd));
+	return line.substr(0u, keywordEnd);
+}
+
+// The 1 based OBJ index into a 0 based one. Negative indices count back from the attributes read so far, which the chunk
+// only knows locally, so they are stored relative to the chunk's first attribute (biased, it can be before it) and resolved later
+static uint32_t toChunkIndex(int64_t objIdx, uint32_t numInChunk)
+{
+	if (objIdx > 0)
+		return (uint32_t)(objIdx - 1);
+
+	if (objIdx < 0 && (int64_t)numInChunk + objIdx >= -(int64_t)CHUNK_RELATIVE_BIAS)
+		return (uint32_t)((int64_t)numInChunk + objIdx + CHUNK_RELATIVE_BIAS) | CHUNK_RELATIVE_BIT;
+
+	return OUT_OF_RANGE_IDX;
+}
+
+static bool parseFace(std::string_view rest, ObjChunk& chunk)
+{
+	const char* pText = rest.data();
+	const char* pEnd = pText + rest.size();
+
+	const uint32_t faceStart = (uint32_t)chunk.corners.size();
+	const uint32_t numInChunk[3] = { (uint32_t)chunk.positions.size(), (uint32_t)chunk.uvs.size(), (uint32_t)chunk.normals.size() };
+
+	while ((pText = skipSpaces(pText, pEnd)) < pEnd)
+	{
+		glm::uvec3 corner = glm::uvec3(Okay::INVALID_UINT);
+
+		for (uint32_t k = 0; k < 3u; k++)
+		{
+			if (pText < pEnd && *pText == '+')
+				pText++;
+
+			int64_t objIdx = 0;
+			std::from_chars_result result = std::from_chars(pText, pEnd, objIdx);
+
+			if (result.ec == std::errc())
+			{
+				corner[k] = toChunkIndex(objIdx, numInChunk[k]);
+				pText = result.ptr;
+			}
+			else if (k == 0u)
+			{
+				chunk.corners.resize(faceStart);
+				return false;
+			}
+
+			if (pText >= pEnd || *pText != '/')
+				break;
+
+			pText++;
+		}
+
+		chunk.corners.emplace_back(corner);
+
+		while (pText < pEnd && !isSpace(*pText))
+			pText++;
+	}
+
+	// Points and lines are dropped like they are after aiProcess_Triangulate
+	if (chunk.corners.size() - faceStart < 3u)
+	{
+		chunk.corners.resize(faceStart);
+		return true;
+	}
+
+	chunk.faceStarts.emplace_back(faceStart);
+	return true;
+}
+
+static void parseChunk(ObjChunk& chunk)
+{
+	forEachLine(chunk.text, [&](std::string_view line)
+		{
+			std::string_view rest;
+			std::string_view keyword = splitKeyword(line, rest);
+
+			if (keyword.empty() || keyword[0] == '#')
+				return;
+
+			const char* pText = rest.data();
+			const char* pEnd = pText + rest.size();
+			bool valid = true;
+
+			if (keyword == "v")
+			{
+				glm::vec3& position = chunk.positions.emplace_back(0.f);
+				valid = (pText = parseFloat(pText, pEnd, position.x)) && (pText = parseFloat(pText, pEnd, position.y)) && (pText = parseFloat(pText, pEnd, position.z));
+			}
+			else if (keyword == "vt")
+			{
+				glm::vec2& uv = chunk.uvs.emplace_back(0.f);
+				valid = (pText = parseFloat(pText, pEnd, uv.x)) != nullptr;
+
+				if (valid)
+					parseFloat(pText, pEnd, uv.y); // Optional
+			}
+			else if (keyword == "vn")
+			{
+				glm::vec3& normal = chunk.normals.emplace_back(0.f);
+				valid = (pText = parseFloat(pText, pEnd, normal.x)) && (pText = parseFloat(pText, pEnd, normal.y)) && (pText = parseFloat(pText, pEnd, normal.z));
+			}
+			else if (keyword == "f")
+				valid = parseFace(rest, chunk);
+			else if (keyword == "o")
+				chunk.statements.push_back({ ObjStatement::Type::Object, std::string(rest), (uint32_t)chunk.faceStarts.size() });
+			else if (keyword == "g")
+				chunk.statements.push_back({ ObjStatement::Type::Group, std::string(rest), (uint32_t)chunk.faceStarts.size() });
+			else if (keyword == "usemtl")
+				chunk.statements.push_back({ ObjStatement::Type::UseMaterial, std::string(rest), (uint32_t)chunk.faceStarts.size() });
+			else if (keyword == "mtllib")
+				chunk.statements.push_back({ ObjStatement::Type::MaterialLibrary, std::string(rest), (uint32_t)chunk.faceStarts.size() });
+
+			// Everything else (s, l, p, curves...) is ignored, like assimp does
+
+			chunk.numInvalidLines += !valid;
+		});
+
+	chunk.faceStarts.emplace_back((uint32_t)chunk.corners.size());
+}
+
+// Skips the options before a texture's file name, e.g. "map_Kd -s 1 1 1 -bm 0.5 brick.png"
+static std::string_view skipTextureOptions(std::string_view rest)
+{
+	static const std::pair<std::string_view, uint32_t> OPTIONS[] =
+	{
+		{ "-blendu", 1u }, { "-blendv", 1u }, { "-boost", 1u }, { "-cc", 1u }, { "-clamp", 1u }, { "-imfchan", 1u },
+		{ "-texres", 1u }, { "-type", 1u }, { "-bm", 1u }, { "-mm", 2u }, { "-o", 3u }, { "-s", 3u }, { "-t", 3u },
+	};
+
+	while (!rest.empty() && rest[0] == '-')
+	{
+		std::string_view option = splitKeyword(rest, rest);
+
+		uint32_t numArguments = 0u;
+		for (const auto& [optionName, optionArguments] : OPTIONS)
+		{
+			if (option == optionName)
+				numArguments = optionArguments;
+		}
+
+		// -o, -s & -t take one to three numbers
+		const bool optionalArguments = numArguments == 3u;
+
+		for (uint32_t i = 0; i < numArguments && !rest.empty(); i++)
+		{
+			std::string_view nextRest;
+			std::string_view argument = splitKeyword(rest, nextRest);
+
+			float number;
+			if (optionalArguments && i > 0u && !parseFloat(argument.data(), argument.data() + argument.size(), number))
+				break;
+
+			rest = nextRest;
+		}
+	}
+
+	return rest;
+}
+
+static void loadMaterialLibrary(const std::string& path, std::vector<ObjMaterial>& materials, std::unordered_map<std::string, uint32_t>& materialIndices)
+{
+	std::ifstream reader(path, std::ios::binary);
+	if (!reader)
+	{
+		printf("Can't open material library '%s'\n", path.c_str());
+		return;
+	}
+
+	std::stringstream text;
+	text << reader.rdbuf();
+
+	ObjMaterial* pMaterial = nullptr;
+
+	forEachLine(text.str(), [&](std::string_view line)
+		{
+			std::string_view rest;
+			std::string_view keyword = splitKeyword(line, rest);
+
+			if (keyword == "newmtl")
+			{
+				auto [iterator, inserted] = materialIndices.try_emplace(std::string(rest), (uint32_t)materials.size());
+				if (inserted)
+					materials.emplace_back();
+
+				pMaterial = &materials[iterator->second];
+				return;
+			}
+
+			if (!pMaterial)
+				return;
+
+			// The same texture types as assimp's MTL importer, map_bump is a height map and isn't used
+			if (keyword == "map_Kd")
+				pMaterial->albedoTexturePath = skipTextureOptions(rest);
+			else if (keyword == "map_Pr")
+				pMaterial->rougnessTexturePath = skipTextureOptions(rest);
+			else if (keyword == "map_Pm")
+				pMaterial->metallicTexturePath = skipTextureOptions(rest);
+			else if (keyword == "map_Ks")
+				pMaterial->specularTexturePath = skipTextureOptions(rest);
+			else if (keyword == "norm" || keyword == "map_Kn")
+				pMaterial->normalTexturePath = skipTextureOptions(rest);
+			else if (keyword == "disp")
+				pMaterial->displacementTexturePath = skipTextureOptions(rest);
+		});
+}
+
+// The face's vertices from the right handed file, the same as assimp's CalcTangentsProcess
+static void calculateFaceTangent(const ObjMesh& mesh, const glm::uvec3& triangle, glm::vec3& outTangent, glm::vec3& outBitangent)
+{
+	const glm::vec3 v = mesh.positions[triangle.y] - mesh.positions[triangle.x];
+	const glm::vec3 w = mesh.positions[triangle.z] - mesh.positions[triangle.x];
+
+	float sx = mesh.uvs[triangle.y].x - mesh.uvs[triangle.x].x, sy = mesh.uvs[triangle.y].y - mesh.uvs[triangle.x].y;
+	float tx = mesh.uvs[triangle.z].x - mesh.uvs[triangle.x].x, ty = mesh.uvs[triangle.z].y - mesh.uvs[triangle.x].y;
+	const float dirCorrection = (tx * sy - ty * sx) < 0.f ? -1.f : 1.f;
+
+	// All three at the same UV, use the default directions
+	if (sx * ty == sy * tx)
+	{
+		sx = 0.f;
+		sy = 1.f;
+		tx = 1.f;
+		ty = 0.f;
+	}
+
+	outTangent = (w * sy - v * ty) * dirCorrection;
+	outBitangent = (w * sx - v * tx) * dirCorrection;
+}
+
+static glm::vec3 normalizeSafe(const glm::vec3& vector)
+{
+	const float length = glm::length(vector);
+	return length > 0.f ? vector / length : glm::vec3(0.f);
+}
+
+// Writes the vertex in [vertexStart, vertexEnd) into meshData, generating its normal from the faces around it if it had none
+static void finishVerticies(ObjMesh& mesh, uint32_t vertexStart, uint32_t vertexEnd, MeshData& meshData, float scale)
+{
+	const uint32_t firstGeneratedNormal = (uint32_t)mesh.positions.size() - mesh.numGeneratedNormals;
+
+	for (uint32_t vertexIdx = vertexStart; vertexIdx < vertexEnd; vertexIdx++)
+	{
+		const uint32_t* pAdjacentBegin = mesh.adjacentTriangles.data() + mesh.adjacencyStarts[vertexIdx];
+		const uint32_t* pAdjacentEnd = mesh.adjacentTriangles.data() + mesh.adjacencyStarts[vertexIdx + 1u];
+
+		glm::vec3& normal = mesh.normals[vertexIdx];
+
+		// Area weighted, the cross product's length is twice the area
+		if (vertexIdx >= firstGeneratedNormal)
+		{
+			normal = glm::vec3(0.f);
+			for (const uint32_t* pTriIdx = pAdjacentBegin; pTriIdx < pAdjacentEnd; pTriIdx++)
+			{
+				const glm::uvec3& triangle = mesh.triangles[*pTriIdx];
+				normal += glm::cross(mesh.positions[triangle.y] - mesh.positions[triangle.x], mesh.positions[triangle.z] - mesh.positions[triangle.x]);
+			}
+
+			normal = normalizeSafe(normal);
+		}
+
+		Okay::VertexInfo vertexInfo;
+
+		// Projected into the vertex's plane per face like assimp, then averaged over the faces
+		if (mesh.hasUVs)
+		{
+			glm::vec3 tangentSum = glm::vec3(0.f);
+			glm::vec3 bitangentSum = glm::vec3(0.f);
+
+			for (const uint32_t* pTriIdx = pAdjacentBegin; pTriIdx < pAdjacentEnd; pTriIdx++)
+			{
+				glm::vec3 tangent, bitangent;
+				calculateFaceTangent(mesh, mesh.triangles[*pTriIdx], tangent, bitangent);
+
+				const glm::vec3 localTangent = tangent - normal * glm::dot(tangent, normal);
+				const glm::vec3 localBitangent = bitangent - normal * glm::dot(bitangent, normal) - localTangent * glm::dot(bitangent, localTangent);
+
+				tangentSum += normalizeSafe(localTangent);
+				bitangentSum += normalizeSafe(localBitangent);
+			}
+
+			vertexInfo.tangent = normalizeSafe(tangentSum);
+			vertexInfo.bitangent = normalizeSafe(bitangentSum);
+		}
+
+		// To the left handed space, same as aiProcess_ConvertToLeftHanded
+		const glm::vec3 flipZ = glm::vec3(1.f, 1.f, -1.f);
+		const glm::vec3 position = mesh.positions[vertexIdx] * flipZ * scale;
+
+		vertexInfo.normal = normal * flipZ;
+		vertexInfo.tangent *= flipZ;
+		vertexInfo.bitangent *= flipZ;
+		vertexInfo.uv = mesh.hasUVs ? glm::vec2(mesh.uvs[vertexIdx].x, 1.f - mesh.uvs[vertexIdx].y) : glm::vec2(0.f);
+
+		meshData.positions[vertexIdx] = position;
+		meshData.vertexInfo[vertexIdx] = Okay::packVertexInfo(vertexInfo);
+	}
+}
+
+// Shares the corners with the same indices, fans the faces and finds the triangles around each vertex
+static void buildMesh(ObjMesh& mesh, const std::vector<ObjChunk>& chunks, const std::vector<glm::vec3>& positions,
+	const std::vector<glm::vec2>& uvs, const std::vector<glm::vec3>& normals, std::atomic<uint32_t>& numInvalidFaces)
+{
+	uint32_t numCorners = 0u;
+	for (const ObjFaceRange& range : mesh.faceRanges)
+	{
+		const ObjChunk& chunk = chunks[range.chunkIdx];
+		numCorners += chunk.faceStarts[range.endFace] - chunk.faceStarts[range.firstFace];
+	}
+
+	// The corner of each vertex, in the order they're first used
+	std::vector<glm::uvec3> vertexCorners;
+	vertexCorners.reserve(numCorners);
+
+	// Open addressing with linear probing into vertexCorners, at most half full
+	uint64_t tableSize = 16u;
+	while (tableSize < (uint64_t)numCorners * 2u)
+		tableSize *= 2u;
+
+	std::vector<uint32_t> vertexTable(tableSize, Okay::INVALID_UINT);
+	const uint64_t tableMask = tableSize - 1u;
+
+	auto findOrAddVertex = [&](const glm::uvec3& corner)
+		{
+			uint64_t slot = hashCorner(corner) & tableMask;
+			while (vertexTable[slot] != Okay::INVALID_UINT)
+			{
+				if (vertexCorners[vertexTable[slot]] == corner)
+					return vertexTable[slot];
+
+				slot = (slot + 1u) & tableMask;
+			}
+
+			vertexTable[slot] = (uint32_t)vertexCorners.size();
+			vertexCorners.emplace_back(corner);
+			return vertexTable[slot];
+		};
+
+	std::vector<uint32_t> faceVertices;
+	mesh.triangles.reserve(numCorners);
+
+	for (const ObjFaceRange& range : mesh.faceRanges)
+	{
+		const ObjChunk& chunk = chunks[range.chunkIdx];
+
+		for (uint32_t faceIdx = range.firstFace; faceIdx < range.endFace; faceIdx++)
+		{
+			const uint32_t cornerStart = chunk.faceStarts[faceIdx];
+			const uint32_t cornerEnd = chunk.faceStarts[faceIdx + 1u];
+
+			bool valid = true;
+			for (uint32_t cornerIdx = cornerStart; cornerIdx < cornerEnd; cornerIdx++)
+			{
+				const glm::uvec3& corner = chunk.corners[cornerIdx];
+				valid &= corner.x < positions.size() && (corner.y == Okay::INVALID_UINT || corner.y < uvs.size()) &&
+					(corner.z == Okay::INVALID_UINT || corner.z < normals.size());
+			}
+
+			if (!valid)
+			{
+				numInvalidFaces.fetch_add(1u, std::memory_order_relaxed);
+				continue;
+			}
+
+			faceVertices.clear();
+			for (uint32_t cornerIdx = cornerStart; cornerIdx < cornerEnd; cornerIdx++)
+				faceVertices.emplace_back(findOrAddVertex(chunk.corners[cornerIdx]));
+
+			for (uint32_t i = 1; i + 1u < (uint32_t)faceVertices.size(); i++)
+				mesh.triangles.emplace_back(faceVertices[0], faceVertices[i], faceVertices[i + 1u]);
+		}
+	}
+
+	const uint32_t numVerticies = (uint32_t)vertexCorners.size();
+
+	vertexTable = std::vector<uint32_t>();
+
+	// Vertices without a vn last, so the ones needing a generated normal are a range
+	std::vector<uint32_t> remap(numVerticies);
+	uint32_t numWithNormal = 0u;
+	for (uint32_t i = 0; i < numVerticies; i++)
+		numWithNormal += vertexCorners[i].z != Okay::INVALID_UINT;
+
+	mesh.numGeneratedNormals = numVerticies - numWithNormal;
+	mesh.positions.resize(numVerticies);
+	mesh.uvs.resize(numVerticies);
+	mesh.normals.resize(numVerticies);
+
+	uint32_t nextWithNormal = 0u, nextWithoutNormal = numWithNormal;
+	for (uint32_t i = 0; i < numVerticies; i++)
+	{
+		const glm::uvec3& corner = vertexCorners[i];
+		const uint32_t newIdx = corner.z != Okay::INVALID_UINT ? nextWithNormal++ : nextWithoutNormal++;
+		remap[i] = newIdx;
+
+		mesh.positions[newIdx] = positions[corner.x];
+		mesh.uvs[newIdx] = corner.y != Okay::INVALID_UINT ? uvs[corner.y] : glm::vec2(0.f);
+		mesh.normals[newIdx] = corner.z != Okay::INVALID_UINT ? normals[corner.z] : glm::vec3(0.f);
+		mesh.hasUVs |= corner.y != Okay::INVALID_UINT;
+	}
+
+	for (glm::uvec3& triangle : mesh.triangles)
+		triangle = glm::uvec3(remap[triangle.x], remap[triangle.y], remap[triangle.z]);
+
+	mesh.adjacencyStarts.assign(numVerticies + 1u, 0u);
+	for (const glm::uvec3& triangle : mesh.triangles)
+	{
+		mesh.adjacencyStarts[triangle.x + 1u]++;
+		mesh.adjacencyStarts[triangle.y + 1u]++;
+		mesh.adjacencyStarts[triangle.z + 1u]++;
+	}
+
+	for (uint32_t i = 0; i < numVerticies; i++)
+		mesh.adjacencyStarts[i + 1u] += mesh.adjacencyStarts[i];
+
+	mesh.adjacentTriangles.resize(mesh.triangles.size() * 3u);
+	std::vector<uint32_t> adjacencyCursors(mesh.adjacencyStarts.begin(), mesh.adjacencyStarts.end() - 1);
+
+	for (uint32_t triIdx = 0; triIdx < (uint32_t)mesh.triangles.size(); triIdx++)
+	{
+		for (uint32_t k = 0; k < 3u; k++)
+			mesh.adjacentTriangles[adjacencyCursors[mesh.triangles[triIdx][k]]++] = triIdx;
+	}
+}
+
+namespace Importer
+{
+	bool loadObj(std::string_view filePath, std::vector<ObjectDecriptionStr>& outObjects, float scale)
+	{
+		auto parseStart = std::chrono::system_clock::now();
+
+		Okay::MappedFile file;
+		if (!file.open(filePath))
+		{
+			printf("Can't open '%s'\n", filePath.data());
+			return false;
+		}
+
+		const std::string_view text((const char*)file.getData(), (size_t)file.getSize());
+
+		// Chunks of whole lines, a few per thread so uneven chunks balance out
+		const uint64_t maxChunks = (uint64_t)Okay::getNumWorkerThreads() * 4u;
+		const uint64_t numChunks = std::clamp<uint64_t>(text.size() / MIN_CHUNK_SIZE, 1u, maxChunks);
+
+		std::vector<ObjChunk> chunks;
+		chunks.reserve(numChunks);
+
+		size_t chunkStart = 0u;
+		for (uint64_t i = 0; i < numChunks && chunkStart < text.size(); i++)
+		{
+			size_t chunkEnd = i + 1u == numChunks ? text.size() : std::max(chunkStart, (size_t)(text.size() * (i + 1u) / numChunks));
+			chunkEnd = std::min(text.find('\n', chunkEnd), text.size());
+			if (chunkEnd < text.size())
+				chunkEnd++;
+
+			chunks.emplace_back().text = text.substr(chunkStart, chunkEnd - chunkStart);
+			chunkStart = chunkEnd;
+		}
+
+		Okay::parallelFor((uint32_t)chunks.size(), [&](uint32_t i)
+			{
+				parseChunk(chunks[i]);
+			});
+
+		// Every chunk's attributes in one array each, in file order
+		glm::uvec3 numAttributes = glm::uvec3(0u);
+		uint32_t numInvalidLines = 0u;
+		for (ObjChunk& chunk : chunks)
+		{
+			chunk.firstAttributeIdx = numAttributes;
+			numAttributes += glm::uvec3((uint32_t)chunk.positions.size(), (uint32_t)chunk.uvs.size(), (uint32_t)chunk.normals.size());
+			numInvalidLines += chunk.numInvalidLines;
+		}
+
+		std::vector<glm::vec3> positions(numAttributes.x);
+		std::vector<glm::vec2> uvs(numAttributes.y);
+		std::vector<glm::vec3> normals(numAttributes.z);
+
+		Okay::parallelFor((uint32_t)chunks.size(), [&](uint32_t i)
+			{
+				ObjChunk& chunk = chunks[i];
+				std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + chunk.firstAttributeIdx.x);
+				std::copy(chunk.uvs.begin(), chunk.uvs.end(), uvs.begin() + chunk.firstAttributeIdx.y);
+				std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + chunk.firstAttributeIdx.z);
+
+				// Negative indices are resolved against the attributes before the chunk, the rest are already global
+				for (glm::uvec3& corner : chunk.corners)
+				{
+					for (uint32_t k = 0; k < 3u; k++)
+					{
+						if (corner[k] == Okay::INVALID_UINT || corner[k] == OUT_OF_RANGE_IDX || !(corner[k] & CHUNK_RELATIVE_BIT))
+							continue;
+
+						const int64_t globalIdx = (int64_t)chunk.firstAttributeIdx[k] + (int64_t)(corner[k] & ~CHUNK_RELATIVE_BIT) - CHUNK_RELATIVE_BIAS;
+						corner[k] = globalIdx >= 0 ? (uint32_t)globalIdx : OUT_OF_RANGE_IDX;
+					}
+				}
+
+				chunk.positions = std::vector<glm::vec3>();
+				chunk.uvs = std::vector<glm::vec2>();
+				chunk.normals = std::vector<glm::vec3>();
+			});
+
+		// The material libraries first, a usemtl could come before its mtllib
+		std::vector<ObjMaterial> materials;
+		std::unordered_map<std::string, uint32_t> materialIndices;
+
+		const std::filesystem::path directory = std::filesystem::path(filePath).parent_path();
+		for (const ObjChunk& chunk : chunks)
+		{
+			for (const ObjStatement& statement : chunk.statements)
+			{
+				if (statement.type == ObjStatement::Type::MaterialLibrary)
+					loadMaterialLibrary((directory / statement.name).string(), materials, materialIndices);
+			}
+		}
+
+		// Split the faces into meshes, a new one for every object, group and material change
+		std::vector<ObjMesh> meshes;
+		std::string currentName = "defaultobject"; // assimp's name for faces before any 'o' or 'g'
+		uint32_t currentMaterialIdx = Okay::INVALID_UINT;
+		bool newMeshPending = true;
+
+		auto addFaces = [&](uint32_t chunkIdx, uint32_t firstFace, uint32_t endFace)
+			{
+				if (firstFace == endFace)
+					return;
+
+				if (newMeshPending)
+				{
+					ObjMesh& mesh = meshes.emplace_back();
+					mesh.name = currentName;
+					mesh.materialIdx = currentMaterialIdx;
+					newMeshPending = false;
+				}
+
+				meshes.back().faceRanges.push_back({ chunkIdx, firstFace, endFace });
+			};
+
+		for (uint32_t chunkIdx = 0; chunkIdx < (uint32_t)chunks.size(); chunkIdx++)
+		{
+			const ObjChunk& chunk = chunks[chunkIdx];
+			uint32_t faceIdx = 0u;
+
+			for (const ObjStatement& statement : chunk.statements)
+			{
+				addFaces(chunkIdx, faceIdx, statement.faceIdx);
+				faceIdx = statement.faceIdx;
+
+				if (statement.type == ObjStatement::Type::Object || statement.type == ObjStatement::Type::Group)
+				{
+					currentName = statement.name;
+					newMeshPending = true;
+				}
+				else if (statement.type == ObjStatement::Type::UseMaterial)
+				{
+					auto iterator = materialIndices.find(statement.name);
+					currentMaterialIdx = iterator != materialIndices.end() ? iterator->second : Okay::INVALID_UINT;
+
+					if (!meshes.empty() && meshes.back().materialIdx != currentMaterialIdx)
+						newMeshPending = true;
+				}
+			}
+
+			addFaces(chunkIdx, faceIdx, (uint32_t)chunk.faceStarts.size() - 1u);
+		}
+
+		std::chrono::duration<float> parseDuration = std::chrono::system_clock::now() - parseStart;
+		auto conversionStart = std::chrono::system_clock::now();
+
+		std::atomic<uint32_t> numInvalidFaces = 0u;
+		Okay::parallelFor((uint32_t)meshes.size(), [&](uint32_t i)
+			{
+				buildMesh(meshes[i], chunks, positions, uvs, normals, numInvalidFaces);
+			});
+
+		// Meshes left without a valid face are dropped, as assimp does
+		meshes.erase(std::remove_if(meshes.begin(), meshes.end(), [](const ObjMesh& mesh) { return mesh.triangles.empty(); }), meshes.end());
+
+		outObjects.clear();
+		outObjects.resize(meshes.size());
+
+		// The normals and tangents per vertex, spread over every mesh's vertices so a single large mesh is parallel too
+		struct VertexJob
+		{
+			uint32_t meshIdx;
+			uint32_t vertexStart;
+			uint32_t vertexEnd;
+		};
+
+		std::vector<VertexJob> vertexJobs;
+		for (uint32_t meshIdx = 0; meshIdx < (uint32_t)meshes.size(); meshIdx++)
+		{
+			const uint32_t numVerticies = (uint32_t)meshes[meshIdx].positions.size();
+			for (uint32_t vertexStart = 0; vertexStart < numVerticies; vertexStart += VERTEX_JOB_SIZE)
+				vertexJobs.push_back({ meshIdx, vertexStart, std::min(vertexStart + VERTEX_JOB_SIZE, numVerticies) });
+
+			MeshData& meshData = outObjects[meshIdx].meshData;
+			meshData.positions.resize(numVerticies);
+			meshData.vertexInfo.resize(numVerticies);
+		}
+
+		Okay::parallelFor((uint32_t)vertexJobs.size(), [&](uint32_t i)
+			{
+				const VertexJob& job = vertexJobs[i];
+				finishVerticies(meshes[job.meshIdx], job.vertexStart, job.vertexEnd, outObjects[job.meshIdx].meshData, scale);
+			});
+
+		Okay::parallelFor((uint32_t)meshes.size(), [&](uint32_t i)
+			{
+				ObjMesh& mesh = meshes[i];
+				ObjectDecriptionStr& objectDesc = outObjects[i];
+				MeshData& meshData = objectDesc.meshData;
+
+				objectDesc.name = mesh.name;
+
+				meshData.boundingBox.min = glm::vec3(FLT_MAX);
+				meshData.boundingBox.max = glm::vec3(-FLT_MAX);
+				for (const glm::vec3& position : meshData.positions)
+				{
+					meshData.boundingBox.min = glm::min(position, meshData.boundingBox.min);
+					meshData.boundingBox.max = glm::max(position, meshData.boundingBox.max);
+				}
+
+				// Reversed winding for the left handed space
+				meshData.triangles.resize(mesh.triangles.size());
+				for (size_t k = 0; k < mesh.triangles.size(); k++)
+					meshData.triangles[k] = glm::uvec3(mesh.triangles[k].z, mesh.triangles[k].y, mesh.triangles[k].x);
+
+				if (mesh.materialIdx != Okay::INVALID_UINT)
+				{
+					const ObjMaterial& material = materials[mesh.materialIdx];
+					objectDesc.albedoTexturePath = material.albedoTexturePath;
+					objectDesc.rougnessTexturePath = material.rougnessTexturePath;
+					objectDesc.metallicTexturePath = material.metallicTexturePath;
+					objectDesc.specularTexturePath = material.specularTexturePath;
+					objectDesc.normalTexturePath = material.normalTexturePath.empty() ? material.displacementTexturePath : material.normalTexturePath;
+				}
+
+				mesh = ObjMesh();
+			});
+
+		std::chrono::duration<float> conversionDuration = std::chrono::system_clock::now() - conversionStart;
+
+		if (numInvalidLines || numInvalidFaces)
+			printf("'%s': skipped %u invalid lines and %u faces with out of range indices\n", filePath.data(), numInvalidLines, numInvalidFaces.load());
+
+		if (!isQuiet())
+		{
+			printf("Imported '%s', %u meshes\n", filePath.data(), (uint32_t)outObjects.size());
+			printf("Obj parse: %.3fms (%u chunks)\nMesh conversion: %.3fms\n", parseDuration.count() * 1000.f, (uint32_t)chunks.size(), conversionDuration.count() * 1000.f);
+		}
+
+		return true;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,269 @@
+#include "OctTree.h"
+#include "ResourceManager.h"
+#include "Scene/Scene.h"
+#include "Scene/Components.h"
+
+#include <stack>
+
+namespace OctTree
+{
+	static void refitNode(OctTreeNode& node)
+	{
+		node.boundingBox = Okay::AABB();
+
+		for (const EntityAABB& entityAABB : node.entities)
+		{
+			node.boundingBox.growTo(entityAABB.aabb.min);
+			node.boundingBox.growTo(entityAABB.aabb.max);
+		}
+	}
+
+	static Okay::AABB calculateSphereBox(const Sphere& sphere, const Transform& transform)
+	{
+		return Okay::AABB(transform.position - glm::vec3(sphere.radius), transform.position + glm::vec3(sphere.radius));
+	}
+
+	Okay::AABB calculateWorldBox(const Okay::AABB& localBox, const glm::mat4& matrix)
+	{
+		Okay::AABB worldBox;
+		for (uint32_t i = 0; i < 8u; i++)
+		{
+			const glm::vec3 corner(i & 1u ? localBox.max.x : localBox.min.x, i & 2u ? localBox.max.y : localBox.min.y, i & 4u ? localBox.max.z : localBox.min.z);
+			worldBox.growTo(matrix * glm::vec4(corner, 1.f));
+		}
+
+		return worldBox;
+	}
+
+	void build(const Scene& scene, const ResourceManager& resourceManager, uint32_t maxDepth, uint32_t maxLeafObjects, std::vector<OctTreeNode>& outNodes)
+	{
+		outNodes.clear();
+		OctTreeNode& root = outNodes.emplace_back();
+
+		const entt::registry& reg = scene.getRegistry();
+		auto meshView = reg.view<MeshComponent, Transform>();
+		auto sphereView = reg.view<Sphere, Transform>();
+
+		root.entities.reserve(meshView.size_hint() + sphereView.size_hint());
+
+		const uint32_t numMeshes = resourceManager.getCount<Mesh>();
+		for (entt::entity entity : meshView)
+		{
+			auto [meshComponent, transform] = meshView[entity];
+			if ((uint32_t)meshComponent.meshID >= numMeshes)
+				continue;
+
+			const Mesh& mesh = resourceManager.getAsset<Mesh>(meshComponent.meshID);
+			root.entities.emplace_back(entity, calculateWorldBox(mesh.getBoundingBox(), transform.calculateMatrix()));
+		}
+
+		for (entt::entity entity : sphereView)
+		{
+			auto [sphereComp, transform] = sphereView[entity];
+			root.entities.emplace_back(entity, calculateSphereBox(sphereComp, transform));
+		}
+
+		refitNode(root);
+
+		static const glm::vec3 CHILD_BBS_OFFSETS[8] =
+		{
+			glm::vec3(1.f, -1.f, 1.f),
+			glm::vec3(-1.f, -1.f, 1.f),
+			glm::vec3(1.f, 1.f, 1.f),
+			glm::vec3(-1.f, 1.f, 1.f),
+
+			glm::vec3(1.f, -1.f, -1.f),
+			glm::vec3(-1.f, -1.f, -1.f),
+			glm::vec3(1.f, 1.f, -1.f),
+			glm::vec3(-1.f, 1.f, -1.f),
+		};
+
+		struct OctTreeNodeStack
+		{
+			OctTreeNodeStack() = default;
+			OctTreeNodeStack(uint32_t nodeIndex, uint32_t depth)
+				:nodeIndex(nodeIndex), depth(depth)
+			{ }
+
+			uint32_t nodeIndex = Okay::INVALID_UINT;
+			uint32_t depth = Okay::INVALID_UINT;
+		};
+
+		// Indices into the node's entities, so moving them to a child doesn't search & erase one by one
+		std::stack<OctTreeNodeStack> stack;
+		std::vector<uint32_t> childEntities;
+		std::vector<uint32_t> childEntitiesPool;
+		std::vector<uint8_t> movedToChild;
+		OctTreeNodeStack nodeStackData;
+
+		stack.push(OctTreeNodeStack(0u, 0u));
+
+		while (!stack.empty())
+		{
+			nodeStackData = stack.top();
+			stack.pop();
+
+			OctTreeNode* pNode = &outNodes[nodeStackData.nodeIndex];
+
+			if (nodeStackData.depth >= maxDepth || pNode->entities.size() <= maxLeafObjects)
+				continue;
+
+			Okay::AABB defaultChildBB = pNode->boundingBox;
+
+			glm::vec3 bbCenter = (defaultChildBB.max + defaultChildBB.min) * 0.5f;
+
+			defaultChildBB.max -= bbCenter;
+			defaultChildBB.min -= bbCenter;
+
+			defaultChildBB.min *= 0.5f;
+			defaultChildBB.max *= 0.5f;
+
+			defaultChildBB.max += bbCenter;
+			defaultChildBB.min += bbCenter;
+
+			// Entities covering most of the node stay in it
+			childEntitiesPool.clear();
+			float nodeBBArea = pNode->boundingBox.getArea();
+			uint32_t totalChildren = (uint32_t)pNode->entities.size();
+			for (uint32_t k = 0; k < totalChildren; k++)
+			{
+				if (pNode->entities[k].aabb.getArea() / nodeBBArea < 0.75f)
+					childEntitiesPool.emplace_back(k);
+			}
+
+			movedToChild.assign(totalChildren, 0u);
+
+			glm::vec3 defaultChildBBExtents = (defaultChildBB.max - defaultChildBB.min) * 0.5f;
+			for (uint32_t i = 0u; i < 8u; i++)
+			{
+				Okay::AABB childBB = defaultChildBB;
+				for (uint32_t k = 0; k < 3u; k++)
+				{
+					childBB.max[k] += CHILD_BBS_OFFSETS[i][k] * defaultChildBBExtents[k];
+					childBB.min[k] += CHILD_BBS_OFFSETS[i][k] * defaultChildBBExtents[k];
+				}
+
+				// An entity is only tried against the octants up to the first one it touches
+				childEntities.clear();
+				uint32_t poolSize = 0u;
+				for (uint32_t entityIdx : childEntitiesPool)
+				{
+					if (Okay::AABB::intersects(childBB, pNode->entities[entityIdx].aabb))
+						childEntities.emplace_back(entityIdx);
+					else
+						childEntitiesPool[poolSize++] = entityIdx;
+				}
+				childEntitiesPool.resize(poolSize);
+
+				if (!childEntities.size())
+					continue;
+
+				if (childEntities.size() == totalChildren)
+					continue;
+
+				std::vector<EntityAABB> childNodeEntities;
+				childNodeEntities.reserve(childEntities.size());
+				for (uint32_t entityIdx : childEntities)
+				{
+					childNodeEntities.emplace_back(pNode->entities[entityIdx]);
+					movedToChild[entityIdx] = 1u;
+				}
+
+				OctTreeNode& childNode = outNodes.emplace_back();
+				pNode = &outNodes[nodeStackData.nodeIndex]; // Re-get the node incase the 'nodes' vector had to reallocate
+
+				pNode->children[i] = uint32_t(outNodes.size() - 1);
+
+				childNode.entities = std::move(childNodeEntities);
+				refitNode(childNode);
+
+				stack.push(OctTreeNodeStack(pNode->children[i], nodeStackData.depth + 1u));
+			}
+
+			uint32_t numKept = 0u;
+			for (uint32_t k = 0; k < totalChildren; k++)
+			{
+				if (!movedToChild[k])
+					pNode->entities[numKept++] = pNode->entities[k];
+			}
+			pNode->entities.erase(pNode->entities.begin() + numKept, pNode->entities.end());
+		}
+	}
+
+	bool refit(const Scene& scene, const ResourceManager& resourceManager, std::vector<OctTreeNode>& nodes)
+	{
+		const entt::registry& reg = scene.getRegistry();
+		const uint32_t numMeshes = resourceManager.getCount<Mesh>();
+
+		// Children come after their parent, so they're already refitted when it is
+		for (uint32_t i = (uint32_t)nodes.size(); i-- > 0u;)
+		{
+			OctTreeNode& node = nodes[i];
+
+			for (EntityAABB& entityAABB : node.entities)
+			{
+				if (!reg.valid(entityAABB.entity))
+					return false;
+
+				const Transform* pTransform = reg.try_get<Transform>(entityAABB.entity);
+				const MeshComponent* pMeshComp = reg.try_get<MeshComponent>(entityAABB.entity);
+				const Sphere* pSphereComp = reg.try_get<Sphere>(entityAABB.entity);
+
+				if (pTransform && pMeshComp && (uint32_t)pMeshComp->meshID < numMeshes)
+					entityAABB.aabb = calculateWorldBox(resourceManager.getAsset<Mesh>(pMeshComp->meshID).getBoundingBox(), pTransform->calculateMatrix());
+				else if (pTransform && pSphereComp && !pMeshComp)
+					entityAABB.aabb = calculateSphereBox(*pSphereComp, *pTransform);
+				else
+					return false;
+			}
+
+			refitNode(node);
+
+			for (uint32_t childIdx : node.children)
+			{
+				if (childIdx == Okay::INVALID_UINT)
+					continue;
+
+				node.boundingBox.growTo(nodes[childIdx].boundingBox.min);
+				node.boundingBox.growTo(nodes[childIdx].boundingBox.max);
+			}
+		}
+
+		return true;
+	}
+
+	void flatten(const Scene& scene, const std::vector<OctTreeNode>& nodes, std::vector<GPU_OctTreeNode>& outNodes, std::vector<entt::entity>& outMeshEntities)
+	{
+		const entt::registry& reg = scene.getRegistry();
+
+		outNodes.assign(nodes.size(), GPU_OctTreeNode{});
+		outMeshEntities.clear();
+
+		for (uint32_t i = 0; i < (uint32_t)nodes.size(); i++)
+		{
+			const OctTreeNode& node = nodes[i];
+			GPU_OctTreeNode& gpuNode = outNodes[i];
+
+			gpuNode.boundingBox = node.boundingBox;
+
+			for (uint32_t k = 0; k < 8u; k++)
+			{
+				if (node.children[k] == Okay::INVALID_UINT)
+					continue;
+
+				if (gpuNode.firstChildIdx == Okay::INVALID_UINT)
+					gpuNode.firstChildIdx = node.children[k];
+
+				gpuNode.numChildren += 1;
+			}
+
+			gpuNode.meshesStartIdx = (uint32_t)outMeshEntities.size();
+			for (const EntityAABB& entityAABB : node.entities)
+			{
+				if (reg.all_of<MeshComponent>(entityAABB.entity))
+					outMeshEntities.emplace_back(entityAABB.entity);
+			}
+			gpuNode.meshesEndIdx = (uint32_t)outMeshEntities.size();
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "Utilities.h"
+#include "Scene/Entity.h"
+
+#include <vector>
+
+class Scene;
+class ResourceManager;
+
+// The world box of a mesh or sphere entity
+struct EntityAABB
+{
+	EntityAABB(entt::entity entity, Okay::AABB aabb)
+		:entity(entity), aabb(aabb) { }
+
+	entt::entity entity;
+	Okay::AABB aabb;
+};
+
+struct OctTreeNode
+{
+	Okay::AABB boundingBox;
+	std::vector<EntityAABB> entities;
+	uint32_t children[8u]
+	{
+		Okay::INVALID_UINT,
+		Okay::INVALID_UINT,
+		Okay::INVALID_UINT,
+		Okay::INVALID_UINT,
+		Okay::INVALID_UINT,
+		Okay::INVALID_UINT,
+		Okay::INVALID_UINT,
+		Okay::INVALID_UINT,
+	};
+};
+
+// A flattened node, the children of a node are always created next to each other
+struct GPU_OctTreeNode
+{
+	Okay::AABB boundingBox;
+
+	uint32_t meshesStartIdx = Okay::INVALID_UINT;
+	uint32_t meshesEndIdx = Okay::INVALID_UINT;
+
+	uint32_t spheresStartIdx = Okay::INVALID_UINT;
+	uint32_t spheresEndIdx = Okay::INVALID_UINT;
+
+	uint32_t firstChildIdx = Okay::INVALID_UINT;
+	uint32_t numChildren = 0u;
+};
+
+// What the application starts with, the GPU traversal's stack (OCT_MAX_STACK_SIZE) only fits shallow trees
+static const uint32_t DEFAULT_OCT_TREE_MAX_DEPTH = 2u;
+static const uint32_t DEFAULT_OCT_TREE_MAX_LEAF_ENTITIES = 50u;
+
+/*
+	The top level tree over the scene's mesh & sphere entities, used by both the GPU and the CPU tracer.
+	Every entity is stored once, in the deepest node whose octant it fits in without covering most of the node.
+	Children always have a higher index than their parent.
+*/
+namespace OctTree
+{
+	// The box around the 8 corners of localBox moved by matrix
+	Okay::AABB calculateWorldBox(const Okay::AABB& localBox, const glm::mat4& matrix);
+
+	// Meshes with an ID the resource manager doesn't have are left out
+	void build(const Scene& scene, const ResourceManager& resourceManager, uint32_t maxDepth, uint32_t maxLeafObjects, std::vector<OctTreeNode>& outNodes);
+
+	// Recomputes every entity's box from its current transform and the node boxes around them, without moving entities between nodes.
+	// Entities that moved far make the tree slower to traverse, not incorrect.
+	// Returns false if an entity was destroyed or lost its mesh or sphere, the tree has to be built again then
+	bool refit(const Scene& scene, const ResourceManager& resourceManager, std::vector<OctTreeNode>& nodes);
+
+	// The mesh entities in node order, each node's meshes are [meshesStartIdx, meshesEndIdx) in outMeshEntities
+	void flatten(const Scene& scene, const std::vector<OctTreeNode>& nodes, std::vector<GPU_OctTreeNode>& outNodes, std::vector<entt::entity>& outMeshEntities);
+}
\ No newline at end of file
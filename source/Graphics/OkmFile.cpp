@@ -0,0 +1,346 @@
+#include "OkmFile.h"
+#include "MappedFile.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <type_traits>
+
+// "OKMF", little endian
+static const uint32_t OKM_MAGIC = 0x464D4B4F;
+static const uint32_t OKM_VERSION = 1u;
+static const uint64_t OKM_ALIGNMENT = 64u;
+
+static const uint32_t NUM_TEXTURE_PATHS = 5u;
+
+struct OkmHeader
+{
+	uint32_t magic = OKM_MAGIC;
+	uint32_t version = OKM_VERSION;
+	uint32_t headerSize = sizeof(OkmHeader);
+	uint32_t objectRecordSize = 0u;
+	uint32_t numObjects = 0u;
+	float importScale = 1.f;
+	uint64_t fileSize = 0u;
+	uint64_t objectsOffset = 0u;
+	uint8_t padding[24] = {};
+};
+
+struct OkmString
+{
+	uint64_t offset = 0u;
+	uint32_t length = 0u;
+	uint32_t padding = 0u;
+};
+
+// Offsets are from the start of the file
+struct OkmObjectRecord
+{
+	OkmString name;
+	OkmString texturePaths[NUM_TEXTURE_PATHS]; // Albedo, roughness, metallic, specular, normal
+
+	uint64_t positionsOffset = 0u;
+	uint64_t vertexInfoOffset = 0u;
+	uint64_t trianglesOffset = 0u;
+	uint64_t bvhNodesOffset = 0u;
+
+	uint32_t numVertices = 0u;
+	uint32_t numTriangles = 0u;
+	uint32_t numBvhNodes = 0u; // 0 = no prebuilt tree
+	uint32_t bvhMaxLeafTriangles = 0u;
+	uint32_t bvhMaxDepth = 0u;
+	uint32_t padding = 0u;
+
+	Okay::AABB boundingBox;
+};
+
+static_assert(sizeof(OkmHeader) == OKM_ALIGNMENT, "The header fills the first aligned block");
+static_assert(std::is_trivially_copyable<OkmObjectRecord>(), "OkmObjectRecord is written to disk as is");
+static_assert(std::is_trivially_copyable<GPUNode>(), "GPUNode is written to disk as is");
+static_assert(std::is_trivially_copyable<Okay::PackedVertexInfo>(), "PackedVertexInfo is written to disk as is");
+
+static uint64_t alignOffset(uint64_t offset)
+{
+	return (offset + OKM_ALIGNMENT - 1u) & ~(OKM_ALIGNMENT - 1u);
+}
+
+static void writePadding(std::ofstream& writer, uint64_t alignedOffset)
+{
+	static const char ZEROS[OKM_ALIGNMENT] = {};
+	writer.write(ZEROS, alignedOffset - (uint64_t)writer.tellp());
+}
+
+template<typename T>
+static void writeSection(std::ofstream& writer, uint64_t offset, std::span<const T> elements)
+{
+	if (elements.empty())
+		return;
+
+	writePadding(writer, offset);
+	writer.write((const char*)elements.data(), elements.size_bytes());
+}
+
+static const std::string* getTexturePath(const OkmFile::Object& object, uint32_t idx)
+{
+	const std::string* pPaths[NUM_TEXTURE_PATHS] = { &object.albedoTexturePath, &object.rougnessTexturePath,
+		&object.metallicTexturePath, &object.specularTexturePath, &object.normalTexturePath };
+
+	return pPaths[idx];
+}
+
+// The tracers index the vertices and triangles with these without any checks, so a damaged file has to be caught here
+static bool isValidMeshView(const MeshView& view)
+{
+	const uint32_t numVertices = (uint32_t)view.positions.size();
+	const uint32_t numTriangles = (uint32_t)view.triangles.size();
+	const uint32_t numNodes = (uint32_t)view.bvhNodes.size();
+
+	for (const glm::uvec3& triangle : view.triangles)
+	{
+		if (triangle.x >= numVertices || triangle.y >= numVertices || triangle.z >= numVertices)
+			return false;
+	}
+
+	// Children come after their parent like BvhBuilder lays them out, so the depths can be found in one pass and no tree loops
+	std::vector<uint32_t> depths(numNodes, 0u);
+
+	for (uint32_t i = 0; i < numNodes; i++)
+	{
+		const GPUNode& node = view.bvhNodes[i];
+
+		if (depths[i] > view.bvhMaxDepth)
+			return false;
+
+		if (node.firstChildIdx == Okay::INVALID_UINT)
+		{
+			if (node.triStart > node.triEnd || node.triEnd > numTriangles)
+				return false;
+
+			continue;
+		}
+
+		if (node.firstChildIdx <= i || node.firstChildIdx >= numNodes - 1u)
+			return false;
+
+		depths[node.firstChildIdx] = depths[i] + 1u;
+		depths[node.firstChildIdx + 1u] = depths[i] + 1u;
+	}
+
+	return true;
+}
+
+namespace OkmFile
+{
+	std::string getPath(std::string_view sourcePath)
+	{
+		const size_t dotPos = sourcePath.find_last_of('.');
+		const size_t slashPos = sourcePath.find_last_of("/\\");
+
+		const bool hasExtension = dotPos != std::string_view::npos && (slashPos == std::string_view::npos || dotPos > slashPos);
+		return std::string(hasExtension ? sourcePath.substr(0u, dotPos) : sourcePath) + ".okm";
+	}
+
+	bool write(std::string_view path, const std::vector<Object>& objects, float importScale)
+	{
+		OkmHeader header;
+		header.objectRecordSize = sizeof(OkmObjectRecord);
+		header.numObjects = (uint32_t)objects.size();
+		header.importScale = importScale;
+		header.objectsOffset = sizeof(OkmHeader);
+
+		std::vector<OkmObjectRecord> records(objects.size());
+
+		// Lay out the strings right after the records, then every array aligned
+		uint64_t offset = header.objectsOffset + sizeof(OkmObjectRecord) * records.size();
+
+		auto placeString = [&](const std::string& string, OkmString& outString)
+			{
+				outString.offset = offset;
+				outString.length = (uint32_t)string.size();
+				offset += string.size();
+			};
+
+		for (size_t i = 0; i < objects.size(); i++)
+		{
+			placeString(objects[i].mesh.getName(), records[i].name);
+
+			for (uint32_t k = 0; k < NUM_TEXTURE_PATHS; k++)
+				placeString(*getTexturePath(objects[i], k), records[i].texturePaths[k]);
+		}
+
+		// Empty sections take no space, aligning for them would put padding at the end that is never written
+		auto placeSection = [&](size_t sizeInBytes) -> uint64_t
+			{
+				if (!sizeInBytes)
+					return 0u;
+
+				offset = alignOffset(offset);
+				uint64_t sectionOffset = offset;
+				offset += sizeInBytes;
+				return sectionOffset;
+			};
+
+		for (size_t i = 0; i < objects.size(); i++)
+		{
+			const MeshView& view = objects[i].mesh.getView();
+			OkmObjectRecord& record = records[i];
+
+			record.numVertices = (uint32_t)view.positions.size();
+			record.numTriangles = (uint32_t)view.triangles.size();
+			record.numBvhNodes = (uint32_t)view.bvhNodes.size();
+			record.bvhMaxLeafTriangles = view.bvhMaxLeafTriangles;
+			record.bvhMaxDepth = view.bvhMaxDepth;
+			record.boundingBox = view.boundingBox;
+
+			record.positionsOffset = placeSection(view.positions.size_bytes());
+			record.vertexInfoOffset = placeSection(view.vertexInfo.size_bytes());
+			record.trianglesOffset = placeSection(view.triangles.size_bytes());
+			record.bvhNodesOffset = placeSection(view.bvhNodes.size_bytes());
+		}
+
+		header.fileSize = offset;
+
+		std::ofstream writer(path.data(), std::ios::binary);
+		if (!writer)
+			return false;
+
+		auto removePartialFile = [&]()
+			{
+				writer.close();
+
+				std::error_code errorCode;
+				std::filesystem::remove(path, errorCode);
+				return false;
+			};
+
+		writer.write((const char*)&header, sizeof(header));
+		writer.write((const char*)records.data(), sizeof(OkmObjectRecord) * records.size());
+
+		for (const Object& object : objects)
+		{
+			writer.write(object.mesh.getName().data(), object.mesh.getName().size());
+
+			for (uint32_t k = 0; k < NUM_TEXTURE_PATHS; k++)
+				writer.write(getTexturePath(object, k)->data(), getTexturePath(object, k)->size());
+		}
+
+		for (size_t i = 0; i < objects.size(); i++)
+		{
+			const MeshView& view = objects[i].mesh.getView();
+			writeSection(writer, records[i].positionsOffset, view.positions);
+			writeSection(writer, records[i].vertexInfoOffset, view.vertexInfo);
+			writeSection(writer, records[i].trianglesOffset, view.triangles);
+			writeSection(writer, records[i].bvhNodesOffset, view.bvhNodes);
+		}
+
+		if (!writer.good() || (uint64_t)writer.tellp() != header.fileSize)
+			return removePartialFile();
+
+		return true;
+	}
+
+	bool read(std::string_view path, std::vector<Object>& outObjects, float* pOutImportScale)
+	{
+		std::shared_ptr<Okay::MappedFile> pFile = std::make_shared<Okay::MappedFile>();
+		if (!pFile->open(path))
+			return false;
+
+		const uint8_t* pData = pFile->getData();
+		const uint64_t fileSize = pFile->getSize();
+
+		OkmHeader header;
+		if (fileSize >= sizeof(OkmHeader))
+			memcpy(&header, pData, sizeof(OkmHeader));
+
+		if (fileSize < sizeof(OkmHeader) || header.magic != OKM_MAGIC)
+		{
+			printf("'%s' is not an .okm file\n", path.data());
+			return false;
+		}
+
+		if (header.version != OKM_VERSION || header.headerSize != sizeof(OkmHeader) || header.objectRecordSize != sizeof(OkmObjectRecord))
+		{
+			printf("'%s' was written with version %u, expected %u\n", path.data(), header.version, OKM_VERSION);
+			return false;
+		}
+
+		// Every offset and count below comes from the file, each range is checked against the header's size before it is viewed
+		auto isInFile = [&](uint64_t offset, uint64_t sizeInBytes)
+			{
+				return offset <= header.fileSize && sizeInBytes <= header.fileSize - offset;
+			};
+
+		if (header.fileSize != fileSize || !isInFile(header.objectsOffset, (uint64_t)sizeof(OkmObjectRecord) * header.numObjects))
+		{
+			printf("'%s' is truncated\n", path.data());
+			return false;
+		}
+
+		auto isValidSection = [&](uint64_t offset, uint64_t sizeInBytes)
+			{
+				return offset % OKM_ALIGNMENT == 0u && isInFile(offset, sizeInBytes);
+			};
+
+		auto readString = [&](const OkmString& string, std::string& outString)
+			{
+				if (!isInFile(string.offset, string.length))
+					return false;
+
+				outString.assign((const char*)pData + string.offset, string.length);
+				return true;
+			};
+
+		if (pOutImportScale)
+			*pOutImportScale = header.importScale;
+
+		outObjects.clear();
+		outObjects.reserve(header.numObjects);
+
+		for (uint32_t i = 0; i < header.numObjects; i++)
+		{
+			OkmObjectRecord record;
+			memcpy(&record, pData + header.objectsOffset + sizeof(OkmObjectRecord) * i, sizeof(OkmObjectRecord));
+
+			std::string name;
+			std::string texturePaths[NUM_TEXTURE_PATHS];
+			bool valid = readString(record.name, name);
+
+			for (uint32_t k = 0; k < NUM_TEXTURE_PATHS; k++)
+				valid &= readString(record.texturePaths[k], texturePaths[k]);
+
+			valid &= isValidSection(record.positionsOffset, (uint64_t)record.numVertices * sizeof(glm::vec3));
+			valid &= isValidSection(record.vertexInfoOffset, (uint64_t)record.numVertices * sizeof(Okay::PackedVertexInfo));
+			valid &= isValidSection(record.trianglesOffset, (uint64_t)record.numTriangles * sizeof(glm::uvec3));
+			valid &= isValidSection(record.bvhNodesOffset, (uint64_t)record.numBvhNodes * sizeof(GPUNode));
+
+			if (!valid)
+			{
+				printf("'%s' has an invalid object record (%u)\n", path.data(), i);
+				outObjects.clear();
+				return false;
+			}
+
+			MeshView view;
+			view.positions = std::span((const glm::vec3*)(pData + record.positionsOffset), record.numVertices);
+			view.vertexInfo = std::span((const Okay::PackedVertexInfo*)(pData + record.vertexInfoOffset), record.numVertices);
+			view.triangles = std::span((const glm::uvec3*)(pData + record.trianglesOffset), record.numTriangles);
+			view.boundingBox = record.boundingBox;
+			view.bvhNodes = std::span((const GPUNode*)(pData + record.bvhNodesOffset), record.numBvhNodes);
+			view.bvhMaxLeafTriangles = record.bvhMaxLeafTriangles;
+			view.bvhMaxDepth = record.bvhMaxDepth;
+
+			if (!isValidMeshView(view))
+			{
+				printf("'%s' has out of range indices in object %u\n", path.data(), i);
+				outObjects.clear();
+				return false;
+			}
+
+			// Mesh has no default constructor, every member is given so none is left to a missing initializer
+			outObjects.push_back(Object{ Mesh(pFile, view, name), std::move(texturePaths[0]), std::move(texturePaths[1]),
+				std::move(texturePaths[2]), std::move(texturePaths[3]), std::move(texturePaths[4]) });
+		}
+
+		return true;
+	}
+}
\ No newline at end of file
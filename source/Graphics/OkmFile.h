@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Mesh.h"
+
+#include <string_view>
+#include <vector>
+
+/*
+	.okm, the native mesh format. Written by GPU-Raytracer-MeshConverter from anything assimp reads.
+	One file holds every object of a model: its name, geometry, bounds, material texture paths and optionally a BVH.
+	Every array starts on a 64 byte boundary so the meshes read from it view the memory mapped file instead of copying it.
+	Little endian, the version is bumped whenever the layout changes and old files then fall back to importing the source.
+*/
+namespace OkmFile
+{
+	struct Object
+	{
+		Mesh mesh;
+		std::string albedoTexturePath;
+		std::string rougnessTexturePath;
+		std::string metallicTexturePath;
+		std::string specularTexturePath;
+		std::string normalTexturePath;
+	};
+
+	// The path a model file's .okm has, the extension swapped. "meshes/sponza.obj" -> "meshes/sponza.okm"
+	std::string getPath(std::string_view sourcePath);
+
+	// importScale is the scale the geometry was imported with, stored so loading with another scale can be detected
+	bool write(std::string_view path, const std::vector<Object>& objects, float importScale);
+
+	// The meshes keep the file mapped for as long as any of them lives
+	// Fails if any section is out of the file, or any triangle index or BVH node points outside its mesh
+	bool read(std::string_view path, std::vector<Object>& outObjects, float* pOutImportScale = nullptr);
+}
\ No newline at end of file
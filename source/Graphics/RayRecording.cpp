@@ -0,0 +1,73 @@
+#include "RayRecording.h"
+
+#include <fstream>
+#include <type_traits>
+
+// "OKRR", little endian
+static const uint32_t RAY_RECORDING_MAGIC = 0x52524B4F;
+static const uint32_t RAY_RECORDING_VERSION = 1u;
+
+struct RayRecordingHeader
+{
+	uint32_t magic = RAY_RECORDING_MAGIC;
+	uint32_t version = RAY_RECORDING_VERSION;
+	uint32_t recordSize = sizeof(RecordedRay);
+	uint32_t imageWidth = 0u;
+	uint32_t imageHeight = 0u;
+	uint32_t numInstances = 0u;
+	uint32_t numTriangles = 0u;
+	uint32_t padding = 0u;
+	uint64_t numRays = 0u;
+};
+
+static_assert(std::is_trivially_copyable<RecordedRay>(), "RecordedRay is written to disk as is");
+
+bool RayRecording::writeToFile(std::string_view path) const
+{
+	std::ofstream writer(path.data(), std::ios::binary);
+	if (!writer)
+		return false;
+
+	RayRecordingHeader header;
+	header.imageWidth = imageDims.x;
+	header.imageHeight = imageDims.y;
+	header.numInstances = numInstances;
+	header.numTriangles = numTriangles;
+	header.numRays = rays.size();
+
+	writer.write((const char*)&header, sizeof(header));
+	writer.write((const char*)rays.data(), sizeof(RecordedRay) * rays.size());
+
+	return writer.good();
+}
+
+bool RayRecording::readFromFile(std::string_view path)
+{
+	std::ifstream reader(path.data(), std::ios::binary);
+	if (!reader)
+		return false;
+
+	RayRecordingHeader header;
+	reader.read((char*)&header, sizeof(header));
+
+	if (!reader || header.magic != RAY_RECORDING_MAGIC)
+	{
+		printf("'%s' is not a ray recording\n", path.data());
+		return false;
+	}
+
+	if (header.version != RAY_RECORDING_VERSION || header.recordSize != sizeof(RecordedRay))
+	{
+		printf("'%s' was recorded with version %u, expected %u\n", path.data(), header.version, RAY_RECORDING_VERSION);
+		return false;
+	}
+
+	imageDims = glm::uvec2(header.imageWidth, header.imageHeight);
+	numInstances = header.numInstances;
+	numTriangles = header.numTriangles;
+
+	rays.resize(header.numRays);
+	reader.read((char*)rays.data(), sizeof(RecordedRay) * rays.size());
+
+	return reader.good();
+}
\ No newline at end of file
@@ -0,0 +1,46 @@
+#pragma once
+#include "Utilities.h"
+
+#include <string_view>
+#include <vector>
+
+// Same quantities as bbCheckCount & triCheckCount in RaytracerCS.hlsl, the instance boxes count as box tests
+struct TraversalCounters
+{
+	uint32_t numBoxTests = 0u;
+	uint32_t numTriangleTests = 0u;
+};
+
+struct RayHit
+{
+	float distance = FLT_MAX; // FLT_MAX on miss
+	uint32_t instanceIdx = Okay::INVALID_UINT; // In the order of the scene's mesh view, INVALID_UINT on miss
+	TraversalCounters counters;
+};
+
+struct RecordedRay
+{
+	glm::vec3 origin = glm::vec3(0.f);
+	float tMax = FLT_MAX;
+	glm::vec3 direction = glm::vec3(0.f);
+	uint32_t pixelIdx = 0u; // y * width + x
+	uint32_t bounce = 0u;	// 0 = primary ray
+	RayHit hit;				// Found while recording, the reference when replaying
+};
+
+/*
+	Every ray a CPURayTracer traced while recording, in tile order and then in the order each pixel traced them.
+	The sampling is seeded per pixel and sample so the same scene, camera and settings record the same rays.
+	Replaying needs the same scene, the instance and triangle counts are stored to catch the obvious mismatches.
+*/
+struct RayRecording
+{
+	glm::uvec2 imageDims = glm::uvec2(0u);
+	uint32_t numInstances = 0u;
+	uint32_t numTriangles = 0u;
+
+	std::vector<RecordedRay> rays;
+
+	bool writeToFile(std::string_view path) const;
+	bool readFromFile(std::string_view path);
+};
\ No newline at end of file
@@ -4,6 +4,8 @@
 #include "shaders/ShaderResourceRegisters.h"
 #include "ResourceManager.h"
 #include "BvhBuilder.h"
+#include "MotionMode.h"
+#include "Threading.h"
 
 #include "glm/gtc/matrix_transform.hpp"
 #include "glm/gtx/quaternion.hpp"
@@ -11,13 +13,20 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb/stb_image.h"
 
-#include <stack>
 #include <chrono>
-#include <DirectXCollision.h>
+#include <fstream>
+#include <filesystem>
+#include <DirectXPackedVector.h>
 
 RayTracer::RayTracer()
 	:m_pMainRaytracingCS(nullptr), m_pScene(nullptr), m_renderData(), m_pRenderDataBuffer(nullptr),
-	m_pResourceManager(nullptr), m_pTargetTexture(nullptr), m_pEnvironmentMapSRV(nullptr), m_pTextures(nullptr)
+	m_pResourceManager(nullptr), m_pTargetTexture(nullptr), m_pEnvironmentMapSRV(nullptr), m_pTextureAtlasSRVs(),
+	m_pActiveTilesBuffer(nullptr), m_pActiveTilesSRV(nullptr), m_pActiveTilesUAV(nullptr), m_pTileDispatchArgs(nullptr),
+	m_pAdaptiveTilesCS(nullptr), m_pAccumulationResolveCS(nullptr), m_pBlueNoiseSRV(nullptr),
+	m_cameraViewProjectionMatrix(0.f), m_lastCameraViewProjectionMatrix(0.f), m_lastCameraPosition(0.f),
+	m_motionModeEnabled(false), m_motionPixelStride(2u), m_motionFrameIdx(0u), m_pMotionUpsampleCS(nullptr),
+	m_reprojectionEnabled(false), m_pReprojectionCS(nullptr), m_bvhMaxDepth(DEFAULT_BVH_MAX_DEPTH), m_bvhMaxLeafTriangles(DEFAULT_BVH_MAX_LEAF_TRIANGLES),
+	m_numVerticies(0u), m_numTriangles(0u)
 {
 }
 
@@ -42,19 +51,42 @@ void RayTracer::shutdown()
 	m_pointLights.shutdown();
 	m_spotLights.shutdown();
 	m_accumulationTexture.shutdown();
+	m_secondMomentTexture.shutdown();
+	m_motionTexture.shutdown();
+	m_gBufferNormalDepth.shutdown();
+	m_gBufferPositionInstance.shutdown();
+	m_gBufferAlbedo.shutdown();
+	m_prevGBufferNormalDepth.shutdown();
+	m_prevGBufferPositionInstance.shutdown();
+	m_historyAccumulation.shutdown();
+	m_historySecondMoment.shutdown();
 
 	DX11_RELEASE(m_pRenderDataBuffer);
 	DX11_RELEASE(m_pMainRaytracingCS);
 
+	DX11_RELEASE(m_pActiveTilesBuffer);
+	DX11_RELEASE(m_pActiveTilesSRV);
+	DX11_RELEASE(m_pActiveTilesUAV);
+	DX11_RELEASE(m_pTileDispatchArgs);
+	DX11_RELEASE(m_pAdaptiveTilesCS);
+	DX11_RELEASE(m_pAccumulationResolveCS);
+	DX11_RELEASE(m_pMotionUpsampleCS);
+	DX11_RELEASE(m_pReprojectionCS);
+
 	m_pResourceManager = nullptr;
 
-	m_trianglePositions.shutdown();
-	m_triangleInfo.shutdown();
+	m_vertexPositions.shutdown();
+	m_vertexInfo.shutdown();
+	m_triangleIndices.shutdown();
+	m_hitTriangles.shutdown();
 	m_bvhTree.shutdown();
 
-	DX11_RELEASE(m_pTextures);
+	for (ID3D11ShaderResourceView*& pTextureAtlasSRV : m_pTextureAtlasSRVs)
+		DX11_RELEASE(pTextureAtlasSRV);
+	m_textureRecords.shutdown();
 
 	DX11_RELEASE(m_pEnvironmentMapSRV);
+	DX11_RELEASE(m_pBlueNoiseSRV);
 }
 
 void RayTracer::initiate(const RenderTexture& target, const ResourceManager& resourceManager, std::string_view environmentMapPath)
@@ -71,7 +103,20 @@ void RayTracer::initiate(const RenderTexture& target, const ResourceManager& res
 	
 	// Accumulation Texture
 	m_accumulationTexture.initiate(m_renderData.textureDims.x, m_renderData.textureDims.y, TextureFormat::F_32X4, TextureFlags::SHADER_WRITE);
+	m_secondMomentTexture.initiate(m_renderData.textureDims.x, m_renderData.textureDims.y, TextureFormat::F_32X1, TextureFlags::SHADER_WRITE);
+	createAdaptiveSamplingResources();
+
+	// Sized for the smallest pixel stride
+	m_motionTexture.initiate((m_renderData.textureDims.x + 1u) / 2u, (m_renderData.textureDims.y + 1u) / 2u, TextureFormat::F_8X4, TextureFlags::SHADER_WRITE);
 
+	// Reprojection
+	m_gBufferNormalDepth.initiate(m_renderData.textureDims.x, m_renderData.textureDims.y, TextureFormat::F_32X4, TextureFlags::SHADER_WRITE);
+	m_gBufferPositionInstance.initiate(m_renderData.textureDims.x, m_renderData.textureDims.y, TextureFormat::F_32X4, TextureFlags::SHADER_WRITE);
+	m_gBufferAlbedo.initiate(m_renderData.textureDims.x, m_renderData.textureDims.y, TextureFormat::F_32X4, TextureFlags::SHADER_WRITE);
+	m_prevGBufferNormalDepth.initiate(m_renderData.textureDims.x, m_renderData.textureDims.y, TextureFormat::F_32X4, TextureFlags::SHADER_READ);
+	m_prevGBufferPositionInstance.initiate(m_renderData.textureDims.x, m_renderData.textureDims.y, TextureFormat::F_32X4, TextureFlags::SHADER_READ);
+	m_historyAccumulation.initiate(m_renderData.textureDims.x, m_renderData.textureDims.y, TextureFormat::F_32X4, TextureFlags::SHADER_READ);
+	m_historySecondMoment.initiate(m_renderData.textureDims.x, m_renderData.textureDims.y, TextureFormat::F_32X1, TextureFlags::SHADER_READ);
 
 	// Render Data
 	success = Okay::createConstantBuffer(&m_pRenderDataBuffer, &m_renderData, sizeof(RenderData));
@@ -82,6 +127,18 @@ void RayTracer::initiate(const RenderTexture& target, const ResourceManager& res
 	success = Okay::createShader(SHADER_PATH "RayTracerCS.hlsl", &m_pMainRaytracingCS);
 	OKAY_ASSERT(success);
 
+	success = Okay::createShader(SHADER_PATH "AdaptiveTilesCS.hlsl", &m_pAdaptiveTilesCS);
+	OKAY_ASSERT(success);
+
+	success = Okay::createShader(SHADER_PATH "AccumulationResolveCS.hlsl", &m_pAccumulationResolveCS);
+	OKAY_ASSERT(success);
+
+	success = Okay::createShader(SHADER_PATH "MotionUpsampleCS.hlsl", &m_pMotionUpsampleCS);
+	OKAY_ASSERT(success);
+
+	success = Okay::createShader(SHADER_PATH "ReprojectionCS.hlsl", &m_pReprojectionCS);
+	OKAY_ASSERT(success);
+
 
 	// Scene GPU Data
 	const uint32_t SRV_START_SIZE = 10u;
@@ -94,7 +151,8 @@ void RayTracer::initiate(const RenderTexture& target, const ResourceManager& res
 
 	loadTextureData();
 	loadEnvironmentMap(environmentMapPath);
-	loadMeshAndBvhData(30, 5);
+	createBlueNoiseTexture();
+	loadMeshAndBvhData(DEFAULT_BVH_MAX_DEPTH, DEFAULT_BVH_MAX_LEAF_TRIANGLES);
 
 	{ // Basic Sampler
 		D3D11_SAMPLER_DESC simpDesc{};
@@ -126,111 +184,142 @@ void RayTracer::loadMeshAndBvhData(uint32_t maxDepth, uint32_t maxLeafTriangles)
 
 	bvhTreeTimerStart = std::chrono::system_clock::now();
 
+	m_bvhMaxDepth = maxDepth;
+	m_bvhMaxLeafTriangles = maxLeafTriangles;
+
 	const std::vector<Mesh>& meshes = m_pResourceManager->getAll<Mesh>();
 	const uint32_t numMeshes = (uint32_t)meshes.size();
 
 	if (!numMeshes)
 		return;
 
-	auto tryOffsetIdx = [](uint32_t idx, uint32_t offset)
-		{
-			return idx == Okay::INVALID_UINT ? idx : idx + offset;
-		};
-
-	m_meshDescs.resize(numMeshes);
-
-	uint32_t numTotalTriangles = 0u;
-	for (uint32_t i = 0; i < numMeshes; i++)
-	{
-		numTotalTriangles += (uint32_t)meshes[i].getTrianglesPos().size();
-	}
-
-	uint32_t triBufferCurStartIdx = 0;
-	std::vector<Okay::Triangle> gpuTrianglePositions;
-	std::vector<Okay::TriangleInfo> gpuTriangleInfo;
-	gpuTrianglePositions.reserve(numTotalTriangles);
-	gpuTriangleInfo.reserve(numTotalTriangles);
+	std::vector<glm::vec3> gpuVertexPositions;
+	std::vector<Okay::PackedVertexInfo> gpuVertexInfo;
+	std::vector<glm::uvec3> gpuTriangles;
 
-	m_bvhTreeNodes.clear();
-	m_bvhTreeNodes.shrink_to_fit();
 	BvhBuilder bvhBuilder(maxLeafTriangles, maxDepth);
+	bvhBuilder.buildMeshTrees(meshes, m_meshDescs, m_bvhTreeNodes, gpuVertexPositions, gpuVertexInfo, gpuTriangles);
 
-	for (uint32_t i = 0; i < numMeshes; i++)
-	{
-		const Mesh& mesh = meshes[i];
-		const std::vector<Okay::Triangle>& meshTriPos = mesh.getTrianglesPos();
-		const std::vector<Okay::TriangleInfo>& meshTriInfo = mesh.getTrianglesInfo();
+	m_numVerticies = (uint32_t)gpuVertexPositions.size();
+	m_numTriangles = (uint32_t)gpuTriangles.size();
 
-		bvhBuilder.buildTree(mesh);
-		const std::vector<BvhNode>& nodes = bvhBuilder.getTree();
+	// Default usage so appendMeshAndBvhData() can write after what's here
+	m_vertexPositions.initiate(sizeof(glm::vec3), m_numVerticies, gpuVertexPositions.data(), D3D11_USAGE_DEFAULT);
+	m_vertexInfo.initiate(sizeof(Okay::PackedVertexInfo), m_numVerticies, gpuVertexInfo.data(), D3D11_USAGE_DEFAULT);
+	m_triangleIndices.initiate(sizeof(glm::uvec3), m_numTriangles, gpuTriangles.data(), D3D11_USAGE_DEFAULT);
 
-		const uint32_t numNodes = (uint32_t)nodes.size();
-		const uint32_t gpuNodesPrevSize = (uint32_t)m_bvhTreeNodes.size();
+	std::vector<HitTriangle> gpuHitTriangles;
+	BvhBuilder::buildHitTriangles(gpuVertexPositions, gpuTriangles, gpuHitTriangles);
+	m_hitTriangles.initiate(sizeof(HitTriangle), m_numTriangles, gpuHitTriangles.data(), D3D11_USAGE_DEFAULT);
+	m_bvhTree.initiate(sizeof(GPUNode), (uint32_t)m_bvhTreeNodes.size(), m_bvhTreeNodes.data(), D3D11_USAGE_DEFAULT);
 
-		m_bvhTreeNodes.resize(gpuNodesPrevSize + numNodes);
+	std::chrono::duration<float> duration = std::chrono::system_clock::now() - bvhTreeTimerStart;
 
-		uint32_t localTriStart = 0u;
-		for (uint32_t k = 0; k < numNodes; k++)
-		{
-			GPUNode& gpuNode = m_bvhTreeNodes[gpuNodesPrevSize + k];
-			const BvhNode& bvhNode = nodes[k];
+	printf("numNodes: %u\nnumMeshes: %u\n", (uint32_t)m_bvhTreeNodes.size(), numMeshes);
+	printf("numTriangles: %u\nnumVerticies: %u\n", m_numTriangles, m_numVerticies);
+	printf("Bvh Tree build time: %.3fms\n", duration.count() * 1000.f);
+}
 
-			const uint32_t numTriIndicies = (uint32_t)bvhNode.triIndicies.size();
+void RayTracer::appendMeshAndBvhData(std::span<const AssetID> replacedMeshes)
+{
+	// Nothing to append to
+	if (m_meshDescs.empty())
+	{
+		loadMeshAndBvhData(m_bvhMaxDepth, m_bvhMaxLeafTriangles);
+		return;
+	}
 
-			gpuNode.boundingBox = bvhNode.boundingBox;
-			gpuNode.firstChildIdx = tryOffsetIdx(bvhNode.firstChildIdx, gpuNodesPrevSize);
+	const std::vector<Mesh>& meshes = m_pResourceManager->getAll<Mesh>();
+	const uint32_t numLoadedMeshes = (uint32_t)m_meshDescs.size();
 
-			if (!bvhNode.isLeaf())
-				continue;
+	std::vector<uint32_t> meshIndices;
+	for (AssetID meshId : replacedMeshes)
+	{
+		if ((uint32_t)meshId < numLoadedMeshes)
+			meshIndices.emplace_back(meshId);
+	}
 
-			gpuNode.triStart = triBufferCurStartIdx + localTriStart;
-			gpuNode.triEnd = gpuNode.triStart + numTriIndicies;
+	for (uint32_t i = numLoadedMeshes; i < (uint32_t)meshes.size(); i++)
+		meshIndices.emplace_back(i);
 
-			localTriStart += numTriIndicies;
+	if (meshIndices.empty())
+		return;
 
-			for (uint32_t j = 0; j < numTriIndicies; j++)
-			{
-				const Okay::Triangle& triPos = meshTriPos[bvhNode.triIndicies[j]];
-				const Okay::TriangleInfo& triInfo = meshTriInfo[bvhNode.triIndicies[j]];
+	auto appendStart = std::chrono::system_clock::now();
 
-				gpuTrianglePositions.emplace_back(triPos);
-				gpuTriangleInfo.emplace_back(triInfo);
-			}
-		}
+	const uint32_t firstNodeIdx = (uint32_t)m_bvhTreeNodes.size();
 
-		m_meshDescs[i].numBvhNodes = numNodes;
-		m_meshDescs[i].bvhTreeStartIdx = gpuNodesPrevSize;
-		m_meshDescs[i].startIdx = triBufferCurStartIdx;
-		m_meshDescs[i].endIdx = triBufferCurStartIdx + (uint32_t)meshTriPos.size();
+	std::vector<GPUNode> gpuNodes;
+	std::vector<glm::vec3> gpuVertexPositions;
+	std::vector<Okay::PackedVertexInfo> gpuVertexInfo;
+	std::vector<glm::uvec3> gpuTriangles;
+	std::vector<HitTriangle> gpuHitTriangles;
 
-		triBufferCurStartIdx += (uint32_t)meshTriPos.size();
-	}
+	BvhBuilder bvhBuilder(m_bvhMaxLeafTriangles, m_bvhMaxDepth);
+	bvhBuilder.appendMeshTrees(meshes, meshIndices, m_numVerticies, m_numTriangles, firstNodeIdx, m_meshDescs, gpuNodes, gpuVertexPositions, gpuVertexInfo, gpuTriangles);
+	BvhBuilder::buildHitTriangles(gpuVertexPositions, gpuTriangles, gpuHitTriangles, m_numVerticies);
 
-	m_trianglePositions.initiate(sizeof(Okay::Triangle), numTotalTriangles, gpuTrianglePositions.data());
-	m_triangleInfo.initiate(sizeof(Okay::TriangleInfo), numTotalTriangles, gpuTriangleInfo.data());
-	m_bvhTree.initiate(sizeof(GPUNode), (uint32_t)m_bvhTreeNodes.size(), m_bvhTreeNodes.data());
+	const uint32_t numNewVerticies = (uint32_t)gpuVertexPositions.size();
+	const uint32_t numNewTriangles = (uint32_t)gpuTriangles.size();
 
-	std::chrono::duration<float> duration = std::chrono::system_clock::now() - bvhTreeTimerStart;
+	m_vertexPositions.write(m_numVerticies, numNewVerticies, gpuVertexPositions.data());
+	m_vertexInfo.write(m_numVerticies, numNewVerticies, gpuVertexInfo.data());
+	m_triangleIndices.write(m_numTriangles, numNewTriangles, gpuTriangles.data());
+	m_hitTriangles.write(m_numTriangles, numNewTriangles, gpuHitTriangles.data());
+	m_bvhTree.write(firstNodeIdx, (uint32_t)gpuNodes.size(), gpuNodes.data());
 
-	printf("numNodes: %u\nnumMeshes: %u\n", (uint32_t)m_bvhTreeNodes.size(), numMeshes);
-	printf("Bvh Tree build time: %.3fms\n", duration.count() * 1000.f);
+	m_bvhTreeNodes.insert(m_bvhTreeNodes.end(), gpuNodes.begin(), gpuNodes.end());
+	m_numVerticies += numNewVerticies;
+	m_numTriangles += numNewTriangles;
+
+	std::chrono::duration<float> appendDuration = std::chrono::system_clock::now() - appendStart;
+	printf("Bvh Tree append: %u meshes (%u replaced), %u nodes, %u triangles: %.3fms\n", (uint32_t)meshIndices.size(), (uint32_t)meshIndices.size() - ((uint32_t)meshes.size() - numLoadedMeshes),
+		(uint32_t)gpuNodes.size(), numNewTriangles, appendDuration.count() * 1000.f);
 }
 
 void RayTracer::render()
 {
 	calculateProjectionData();
+	const bool cameraMoved = updateCameraHistory();
+	const bool motionFrame = updateMotionMode(cameraMoved);
+	const bool reprojectionFrame = cameraMoved && !motionFrame && m_reprojectionEnabled && m_renderData.accumulationEnabled;
+
+	// Camera movement restarts the accumulation, with reprojection the old one is kept as history first
+	// Motion frames reproject the last motion frame, which is in the accumulation and G-buffers
+	if (motionFrame)
+	{
+		storeHistory();
+	}
+	else if (cameraMoved)
+	{
+		if (reprojectionFrame)
+			storeHistory();
+
+		resetAccumulation();
+	}
+
 	updateBuffers();
 
 	ID3D11DeviceContext* pDevCon = Okay::getDeviceContext();
 
+	const bool adaptiveSampling = !motionFrame && m_renderData.accumulationEnabled && m_renderData.adaptiveSamplingEnabled;
+
 	// Clear
 	static const float CLEAR_COLOUR[4]{ 0.2f, 0.4f, 0.6f, 1.f };
 	pDevCon->ClearUnorderedAccessViewFloat(*m_pTargetTexture->getUAV(), CLEAR_COLOUR);
 
+	// The first frame after a reset always updates, so every tile is active until it has enough samples
+	if (adaptiveSampling && (m_renderData.numAccumulationFrames - 1u) % glm::max(m_renderData.adaptiveUpdateInterval, 1u) == 0u)
+		updateActiveTiles();
+
 	ID3D11ShaderResourceView* srvs[NUM_T_REGISTERS]{};
-	srvs[TRIANGLE_POS_SLOT] = m_trianglePositions.getSRV();
-	srvs[TRIANGLE_INFO_SLOT] = m_triangleInfo.getSRV();
-	srvs[TEXTURES_SLOT] = m_pTextures;
+	srvs[VERTEX_POS_SLOT] = m_vertexPositions.getSRV();
+	srvs[VERTEX_INFO_SLOT] = m_vertexInfo.getSRV();
+	srvs[TRIANGLE_INDEX_SLOT] = m_triangleIndices.getSRV();
+	srvs[HIT_TRIANGLE_SLOT] = m_hitTriangles.getSRV();
+	srvs[TEXTURE_RECORDS_SLOT] = m_textureRecords.getSRV();
+	for (uint32_t i = 0; i < NUM_TEXTURE_ATLAS_CLASSES; i++)
+		srvs[TEXTURE_ATLAS_SLOT + i] = m_pTextureAtlasSRVs[i];
 	srvs[BVH_TREE_SLOT] = m_bvhTree.getSRV();
 	srvs[ENVIRONMENT_MAP_SLOT] = m_pEnvironmentMapSRV;
 	srvs[OCT_TREE_CPU_SLOT] = m_octTree.getSRV();
@@ -239,6 +328,12 @@ void RayTracer::render()
 	srvs[DIRECTIONAL_LIGHT_DATA_SLOT] = m_directionalLights.getSRV();
 	srvs[POINT_LIGHT_DATA_SLOT] = m_pointLights.getSRV();
 	srvs[SPOT_LIGHT_DATA_SLOT] = m_spotLights.getSRV();
+	srvs[ACTIVE_TILES_SLOT] = m_pActiveTilesSRV;
+	srvs[BLUE_NOISE_SLOT] = m_pBlueNoiseSRV;
+	srvs[HISTORY_ACCUMULATION_SLOT] = *m_historyAccumulation.getSRV();
+	srvs[HISTORY_SECOND_MOMENT_SLOT] = *m_historySecondMoment.getSRV();
+	srvs[PREV_GBUFFER_NORMAL_DEPTH_SLOT] = *m_prevGBufferNormalDepth.getSRV();
+	srvs[PREV_GBUFFER_POSITION_INSTANCE_SLOT] = *m_prevGBufferPositionInstance.getSRV();
 
 	pDevCon->VSSetShaderResources(0u, NUM_T_REGISTERS, srvs);
 	pDevCon->PSSetShaderResources(0u, NUM_T_REGISTERS, srvs);
@@ -250,21 +345,151 @@ void RayTracer::render()
 	pDevCon->CSSetShader(m_pMainRaytracingCS, nullptr, 0u);
 	pDevCon->CSSetUnorderedAccessViews(RESULT_BUFFER_SLOT, 1u, m_pTargetTexture->getUAV(), nullptr);
 	pDevCon->CSSetUnorderedAccessViews(ACCUMULATION_BUFFER_SLOT, 1u, m_accumulationTexture.getUAV(), nullptr);
+	pDevCon->CSSetUnorderedAccessViews(SECOND_MOMENT_BUFFER_SLOT, 1u, m_secondMomentTexture.getUAV(), nullptr);
+	pDevCon->CSSetUnorderedAccessViews(MOTION_BUFFER_SLOT, 1u, m_motionTexture.getUAV(), nullptr);
+	pDevCon->CSSetUnorderedAccessViews(GBUFFER_NORMAL_DEPTH_SLOT, 1u, m_gBufferNormalDepth.getUAV(), nullptr);
+	pDevCon->CSSetUnorderedAccessViews(GBUFFER_POSITION_INSTANCE_SLOT, 1u, m_gBufferPositionInstance.getUAV(), nullptr);
+	pDevCon->CSSetUnorderedAccessViews(GBUFFER_ALBEDO_SLOT, 1u, m_gBufferAlbedo.getUAV(), nullptr);
 	pDevCon->CSSetConstantBuffers(RENDER_DATA_SLOT, 1u, &m_pRenderDataBuffer);
 
 	// Dispatch and unbind
-	pDevCon->Dispatch(m_renderData.textureDims.x / 16u, m_renderData.textureDims.y / 9u, 1u);
+	if (motionFrame)
+	{
+		const uint32_t stride = m_renderData.motionPixelStride;
+		const glm::uvec2 motionDims = (m_renderData.textureDims + stride - 1u) / stride;
+		pDevCon->Dispatch((motionDims.x + THREAD_GROUP_SIZE_X - 1u) / THREAD_GROUP_SIZE_X, (motionDims.y + THREAD_GROUP_SIZE_Y - 1u) / THREAD_GROUP_SIZE_Y, 1u);
+
+		pDevCon->CSSetShader(m_pMotionUpsampleCS, nullptr, 0u);
+		pDevCon->Dispatch(m_renderData.textureDims.x / THREAD_GROUP_SIZE_X, m_renderData.textureDims.y / THREAD_GROUP_SIZE_Y, 1u);
+	}
+	else if (adaptiveSampling)
+	{
+		pDevCon->DispatchIndirect(m_pTileDispatchArgs, 0u);
+
+		// Converged tiles aren't traced, so every pixel is resolved from the accumulation buffer
+		pDevCon->CSSetShader(m_pAccumulationResolveCS, nullptr, 0u);
+		pDevCon->Dispatch(m_renderData.textureDims.x / THREAD_GROUP_SIZE_X, m_renderData.textureDims.y / THREAD_GROUP_SIZE_Y, 1u);
+	}
+	else
+	{
+		pDevCon->Dispatch(m_renderData.textureDims.x / THREAD_GROUP_SIZE_X, m_renderData.textureDims.y / THREAD_GROUP_SIZE_Y, 1u);
+	}
+
+	if (reprojectionFrame)
+	{
+		pDevCon->CSSetShader(m_pReprojectionCS, nullptr, 0u);
+		pDevCon->Dispatch(m_renderData.textureDims.x / THREAD_GROUP_SIZE_X, m_renderData.textureDims.y / THREAD_GROUP_SIZE_Y, 1u);
+	}
 
 	static ID3D11UnorderedAccessView* nullUAV = nullptr;
 	pDevCon->CSSetUnorderedAccessViews(0u, 1u, &nullUAV, nullptr);
 }
 
+void RayTracer::createAdaptiveSamplingResources()
+{
+	DX11_RELEASE(m_pActiveTilesBuffer);
+	DX11_RELEASE(m_pActiveTilesSRV);
+	DX11_RELEASE(m_pActiveTilesUAV);
+	DX11_RELEASE(m_pTileDispatchArgs);
+
+	const uint32_t numTiles = (m_renderData.textureDims.x / THREAD_GROUP_SIZE_X) * (m_renderData.textureDims.y / THREAD_GROUP_SIZE_Y);
+	bool success = false;
+
+	success = Okay::createRWStructuredBuffer(&m_pActiveTilesBuffer, &m_pActiveTilesSRV, &m_pActiveTilesUAV, sizeof(uint32_t), numTiles, true);
+	OKAY_ASSERT(success);
+
+	// Only the X-value is overwritten, by the number of active tiles
+	const uint32_t dispatchArgs[3] = { numTiles, 1u, 1u };
+	success = Okay::createIndirectArgsBuffer(&m_pTileDispatchArgs, dispatchArgs, sizeof(dispatchArgs));
+	OKAY_ASSERT(success);
+}
+
+void RayTracer::updateActiveTiles()
+{
+	ID3D11DeviceContext* pDevCon = Okay::getDeviceContext();
+
+	// m_pActiveTilesBuffer can't be bound as both SRV and UAV
+	static ID3D11ShaderResourceView* nullSRV = nullptr;
+	pDevCon->CSSetShaderResources(ACTIVE_TILES_SLOT, 1u, &nullSRV);
+
+	ID3D11UnorderedAccessView* uavs[3] = { *m_accumulationTexture.getUAV(), *m_secondMomentTexture.getUAV(), m_pActiveTilesUAV };
+	const uint32_t initialCounts[3] = { Okay::INVALID_UINT, Okay::INVALID_UINT, 0u }; // Resets the append counter
+
+	pDevCon->CSSetShader(m_pAdaptiveTilesCS, nullptr, 0u);
+	pDevCon->CSSetUnorderedAccessViews(ACCUMULATION_BUFFER_SLOT, 3u, uavs, initialCounts);
+	pDevCon->CSSetConstantBuffers(RENDER_DATA_SLOT, 1u, &m_pRenderDataBuffer);
+
+	pDevCon->Dispatch(m_renderData.textureDims.x / THREAD_GROUP_SIZE_X, m_renderData.textureDims.y / THREAD_GROUP_SIZE_Y, 1u);
+	pDevCon->CopyStructureCount(m_pTileDispatchArgs, 0u, m_pActiveTilesUAV);
+
+	static ID3D11UnorderedAccessView* nullUAVs[3]{};
+	pDevCon->CSSetUnorderedAccessViews(ACCUMULATION_BUFFER_SLOT, 3u, nullUAVs, nullptr);
+}
+
 void RayTracer::reloadShaders()
 {
 	Okay::reloadShader(SHADER_PATH "RayTracerCS.hlsl", &m_pMainRaytracingCS);
+	Okay::reloadShader(SHADER_PATH "AdaptiveTilesCS.hlsl", &m_pAdaptiveTilesCS);
+	Okay::reloadShader(SHADER_PATH "AccumulationResolveCS.hlsl", &m_pAccumulationResolveCS);
+	Okay::reloadShader(SHADER_PATH "MotionUpsampleCS.hlsl", &m_pMotionUpsampleCS);
+	Okay::reloadShader(SHADER_PATH "ReprojectionCS.hlsl", &m_pReprojectionCS);
 	resetAccumulation();
 }
 
+bool RayTracer::updateCameraHistory()
+{
+	// The first frame has no camera to have moved from
+	if (m_lastCameraViewProjectionMatrix == glm::mat4(0.f))
+	{
+		m_lastCameraViewProjectionMatrix = m_cameraViewProjectionMatrix;
+		m_lastCameraPosition = m_renderData.cameraPosition;
+	}
+
+	const bool cameraMoved = m_cameraViewProjectionMatrix != m_lastCameraViewProjectionMatrix;
+
+	// Last frame's camera, used to reproject the accumulation
+	m_renderData.previousViewProjectionMatrix = glm::transpose(m_lastCameraViewProjectionMatrix);
+	m_renderData.previousCameraPosition = m_lastCameraPosition;
+
+	m_lastCameraViewProjectionMatrix = m_cameraViewProjectionMatrix;
+	m_lastCameraPosition = m_renderData.cameraPosition;
+
+	return cameraMoved;
+}
+
+bool RayTracer::updateMotionMode(bool cameraMoved)
+{
+	if (!m_motionModeEnabled || !cameraMoved)
+	{
+		// Camera stopped, refine from a clean full resolution accumulation
+		if (m_renderData.motionPixelStride != 1u)
+			resetAccumulation();
+
+		m_renderData.motionPixelStride = 1u;
+		m_renderData.motionPixelOffset = glm::uvec2(0u);
+		return false;
+	}
+
+	// The accumulation holds a still camera's samples, MotionUpsampleCS can't use them as history
+	if (m_renderData.motionPixelStride == 1u)
+		resetAccumulation();
+
+	m_renderData.motionPixelStride = m_motionPixelStride;
+	m_renderData.motionPixelOffset = MotionMode::getInterleavedPixelOffset(m_motionFrameIdx++, m_motionPixelStride);
+	m_renderData.motionFrameIdx = m_motionFrameIdx; // Same as CPURayTracer::traceTile()
+	return true;
+}
+
+void RayTracer::storeHistory()
+{
+	ID3D11DeviceContext* pDevCon = Okay::getDeviceContext();
+
+	pDevCon->CopyResource(*m_historyAccumulation.getBuffer(), *m_accumulationTexture.getBuffer());
+	pDevCon->CopyResource(*m_historySecondMoment.getBuffer(), *m_secondMomentTexture.getBuffer());
+	pDevCon->CopyResource(*m_prevGBufferNormalDepth.getBuffer(), *m_gBufferNormalDepth.getBuffer());
+	pDevCon->CopyResource(*m_prevGBufferPositionInstance.getBuffer(), *m_gBufferPositionInstance.getBuffer());
+}
+
 void RayTracer::calculateProjectionData()
 {
 	const Entity camera = m_pScene->getFirstCamera();
@@ -292,8 +517,8 @@ void RayTracer::calculateProjectionData()
 	m_renderData.cameraNearZ = camData.nearZ;
 
 	// Inverse Projection Matrix // Only used in Cherno way
-	m_renderData.cameraInverseProjectionMatrix = glm::transpose(glm::inverse(
-		glm::perspectiveFovLH(glm::radians(camData.fov), windowDimsVec.x, windowDimsVec.y, camData.nearZ, camData.farZ)));
+	const glm::mat4 projectionMatrix = glm::perspectiveFovLH(glm::radians(camData.fov), windowDimsVec.x, windowDimsVec.y, camData.nearZ, camData.farZ);
+	m_renderData.cameraInverseProjectionMatrix = glm::transpose(glm::inverse(projectionMatrix));
 
 	// View vectors
 	glm::vec3 camForward = camTra.getForwardVec();
@@ -303,108 +528,306 @@ void RayTracer::calculateProjectionData()
 	m_renderData.cameraUpDir = camUp;
 
 	// Inverse View Matrix
-	m_renderData.cameraInverseViewMatrix = glm::transpose(glm::inverse(
-		glm::lookAtLH(camTra.position, camTra.position + camForward, glm::vec3(0.f, 1.f, 0.f))));
+	const glm::mat4 viewMatrix = glm::lookAtLH(camTra.position, camTra.position + camForward, glm::vec3(0.f, 1.f, 0.f));
+	m_renderData.cameraInverseViewMatrix = glm::transpose(glm::inverse(viewMatrix));
+
+	m_cameraViewProjectionMatrix = projectionMatrix * viewMatrix;
+}
+
+// Textures larger than the biggest pages are resampled into scaledTextures keeping their aspect ratio, which has to have room for it
+static const Texture* getAtlasTexture(const Texture& texture, std::vector<Texture>& scaledTextures)
+{
+	const uint32_t maxSide = glm::max(texture.getWidth(), texture.getHeight());
+	if (maxSide <= TEXTURE_ATLAS_MAX_PAGE_SIZE)
+		return &texture;
+
+	OKAY_ASSERT(scaledTextures.size() < scaledTextures.capacity());
+
+	const uint32_t newWidth = glm::max(uint32_t((uint64_t)texture.getWidth() * TEXTURE_ATLAS_MAX_PAGE_SIZE / maxSide), 1u);
+	const uint32_t newHeight = glm::max(uint32_t((uint64_t)texture.getHeight() * TEXTURE_ATLAS_MAX_PAGE_SIZE / maxSide), 1u);
+	return &scaledTextures.emplace_back(Okay::scaleTexture(texture, newWidth, newHeight));
 }
 
 void RayTracer::loadTextureData()
 {
+	for (ID3D11ShaderResourceView*& pTextureAtlasSRV : m_pTextureAtlasSRVs)
+		DX11_RELEASE(pTextureAtlasSRV);
+
+	m_textureRecords.shutdown();
+	m_textureAtlasRecords.clear();
+	m_textureAtlasPacker = TextureAtlasPacker();
+
 	const std::vector<Texture>& textures = m_pResourceManager->getAll<Texture>();
 	uint32_t numTextures = (uint32_t)textures.size();
 
 	if (!numTextures)
 		return;
 
-	uint32_t totArea = 0;
-	for (const Texture& texture : textures)
-	{
-		totArea += texture.getWidth() * texture.getHeight();
-	}
-
-	uint32_t newSize = uint32_t(glm::sqrt(totArea / textures.size()));
+	auto atlasStart = std::chrono::system_clock::now();
 
+	// The scaled copies are freed on return
 	std::vector<Texture> scaledTextures;
 	scaledTextures.reserve(numTextures);
 
+	std::vector<const Texture*> atlasTextures;
+	atlasTextures.reserve(numTextures);
+
+	uint64_t textureBytes = 0u;
 	for (const Texture& texture : textures)
 	{
-		scaledTextures.emplace_back(texture.getTextureData(), texture.getWidth(), texture.getHeight(), "");
-		Okay::scaleTexture(scaledTextures.back(), newSize, newSize);
+		textureBytes += texture.getByteSize();
+		atlasTextures.emplace_back(getAtlasTexture(texture, scaledTextures));
 	}
 
-	Okay::createTextureArray(&m_pTextures, scaledTextures, newSize, newSize);
+	TextureAtlas atlas;
+	buildTextureAtlas(atlasTextures, atlas, &m_textureAtlasPacker);
 
-	for (const Texture& scaledTexture : scaledTextures)
+	// Default usage so appendTextureData() can pack more textures into the pages
+	std::vector<const unsigned char*> pages;
+	for (uint32_t i = 0; i < NUM_TEXTURE_ATLAS_CLASSES; i++)
 	{
-		unsigned char* pTextureData = scaledTexture.getTextureData();
-		OKAY_DELETE_ARRAY(pTextureData);
+		const TextureAtlas::SizeClass& sizeClass = atlas.sizeClasses[i];
+		if (sizeClass.pages.empty())
+			continue;
+
+		pages.clear();
+		for (const Okay::PixelBuffer& page : sizeClass.pages)
+			pages.emplace_back(page.getData());
+
+		Okay::createTextureArray(&m_pTextureAtlasSRVs[i], pages, sizeClass.pageSize, sizeClass.pageSize, D3D11_USAGE_DEFAULT);
 	}
+
+	m_textureAtlasRecords = std::move(atlas.records);
+	m_textureRecords.initiate(sizeof(TextureAtlasRecord), numTextures, m_textureAtlasRecords.data(), D3D11_USAGE_DEFAULT);
+
+	std::chrono::duration<float> atlasDuration = std::chrono::system_clock::now() - atlasStart;
+	printf("Texture atlas: %u textures (%u scaled down) in %u pages, %.3fMB for %.3fMB of textures: %.3fms\n", numTextures, (uint32_t)scaledTextures.size(),
+		atlas.getNumPages(), atlas.getByteSize() / (1024.0 * 1024.0), textureBytes / (1024.0 * 1024.0), atlasDuration.count() * 1000.f);
 }
 
-void RayTracer::loadEnvironmentMap(std::string_view path)
+void RayTracer::appendTextureData(std::span<const AssetID> replacedTextures)
 {
-	int imgWidth, imgHeight, channels = STBI_rgb_alpha;
-	uint32_t* pImageData = (uint32_t*)stbi_load(path.data(), &imgWidth, &imgHeight, nullptr, channels);
+	// Nothing to append to
+	if (m_textureAtlasRecords.empty())
+	{
+		loadTextureData();
+		return;
+	}
 
-	if (!pImageData)
+	const std::vector<Texture>& textures = m_pResourceManager->getAll<Texture>();
+	const uint32_t numLoadedTextures = (uint32_t)m_textureAtlasRecords.size();
+
+	std::vector<uint32_t> textureIndices;
+	for (AssetID textureId : replacedTextures)
+	{
+		if ((uint32_t)textureId < numLoadedTextures)
+			textureIndices.emplace_back(textureId);
+	}
+
+	for (uint32_t i = numLoadedTextures; i < (uint32_t)textures.size(); i++)
+		textureIndices.emplace_back(i);
+
+	if (textureIndices.empty())
 		return;
 
-	uint32_t width = imgWidth / 4u;
-	uint32_t height = imgHeight / 3u;
-	uint32_t byteWidth = width * height * channels;
+	auto atlasStart = std::chrono::system_clock::now();
 
-	D3D11_SUBRESOURCE_DATA data[6]{};
-	for (uint32_t i = 0; i < 6u; i++)
+	uint32_t numPages[NUM_TEXTURE_ATLAS_CLASSES]{};
+	for (uint32_t i = 0; i < NUM_TEXTURE_ATLAS_CLASSES; i++)
+		numPages[i] = m_textureAtlasPacker.getNumPages(i);
+
+	std::vector<Texture> scaledTextures;
+	scaledTextures.reserve(textureIndices.size());
+
+	std::vector<const Texture*> atlasTextures;
+	atlasTextures.reserve(textureIndices.size());
+
+	// Everything is packed first so a size class' array only grows once
+	m_textureAtlasRecords.resize(textures.size());
+	for (uint32_t textureIdx : textureIndices)
 	{
-		data[i].pSysMem = new char[byteWidth] {};
-		data[i].SysMemPitch = width * channels;
-		data[i].SysMemSlicePitch = 0u;
+		const Texture* pTexture = atlasTextures.emplace_back(getAtlasTexture(textures[textureIdx], scaledTextures));
+		m_textureAtlasRecords[textureIdx] = m_textureAtlasPacker.pack(pTexture->getWidth(), pTexture->getHeight());
+	}
+
+	for (uint32_t i = 0; i < NUM_TEXTURE_ATLAS_CLASSES; i++)
+	{
+		if (m_textureAtlasPacker.getNumPages(i) != numPages[i])
+			Okay::resizeTextureArray(&m_pTextureAtlasSRVs[i], TEXTURE_ATLAS_MIN_PAGE_SIZE << i, TEXTURE_ATLAS_MIN_PAGE_SIZE << i, m_textureAtlasPacker.getNumPages(i));
 	}
 
-	// The coursor points to the location of each side
-	uint32_t* coursor = nullptr;
+	// Only the new records' texels are written, the rest of the pages are left as they are
+	ID3D11DeviceContext* pDevCon = Okay::getDeviceContext();
+	for (uint32_t i = 0; i < (uint32_t)textureIndices.size(); i++)
+	{
+		const TextureAtlasRecord& record = m_textureAtlasRecords[textureIndices[i]];
+
+		ID3D11Resource* pTextureArray = nullptr;
+		m_pTextureAtlasSRVs[record.sizeClass]->GetResource(&pTextureArray);
+
+		const D3D11_BOX box{ record.offset.x, record.offset.y, 0u, record.offset.x + record.size.x, record.offset.y + record.size.y, 1u };
+		pDevCon->UpdateSubresource(pTextureArray, D3D11CalcSubresource(0u, record.page, 1u), &box, atlasTextures[i]->getTextureData(), record.size.x * 4u, 0u);
 
-	auto copyImgSection = [&](uint32_t* pTarget)
+		DX11_RELEASE(pTextureArray);
+	}
+
+	// The replaced records are patched in place, the new ones go after them
+	for (uint32_t textureIdx : textureIndices)
+	{
+		if (textureIdx < numLoadedTextures)
+			m_textureRecords.write(textureIdx, 1u, &m_textureAtlasRecords[textureIdx]);
+	}
+
+	const uint32_t numNewTextures = (uint32_t)textures.size() - numLoadedTextures;
+	m_textureRecords.write(numLoadedTextures, numNewTextures, m_textureAtlasRecords.data() + numLoadedTextures);
+
+	std::chrono::duration<float> atlasDuration = std::chrono::system_clock::now() - atlasStart;
+	printf("Texture atlas append: %u textures (%u replaced, %u scaled down): %.3fms\n", (uint32_t)textureIndices.size(), (uint32_t)textureIndices.size() - numNewTextures,
+		(uint32_t)scaledTextures.size(), atlasDuration.count() * 1000.f);
+}
+
+/*
+	HDR environment maps are expected as equirectangular images and are resampled into 6 float16 cube faces.
+	The conversion is cached next to the source image (path + ENV_CACHE_FILE_ENDING) and reused as long as the source file is unchanged.
+*/
+static const char* ENV_CACHE_FILE_ENDING = ".okcube";
+static const uint32_t ENV_CACHE_MAGIC = 0x45434B4F; // "OKCE"
+static const uint32_t ENV_CACHE_VERSION = 1u;
+
+struct EnvironmentCacheHeader
+{
+	uint32_t magic = ENV_CACHE_MAGIC;
+	uint32_t version = ENV_CACHE_VERSION;
+	uint32_t faceSize = 0u;
+	uint32_t pad0 = 0u;
+	uint64_t sourceFileSize = 0u;
+	int64_t sourceWriteTime = 0;
+};
+
+// On success expectedHeader.faceSize is set to the face size stored in the cache
+static bool readEnvironmentCache(const std::string& cachePath, EnvironmentCacheHeader& expectedHeader, std::vector<DirectX::PackedVector::XMHALF4>& outFaces)
+{
+	std::ifstream reader(cachePath, std::ios::binary);
+	if (!reader)
+		return false;
+
+	EnvironmentCacheHeader header;
+	reader.read((char*)&header, sizeof(EnvironmentCacheHeader));
+
+	if (!reader || header.magic != expectedHeader.magic || header.version != expectedHeader.version ||
+		header.sourceFileSize != expectedHeader.sourceFileSize || header.sourceWriteTime != expectedHeader.sourceWriteTime)
+		return false;
+
+	// The face size comes from the file, it has to describe exactly the faces the file holds before anything is allocated for them
+	std::error_code errorCode;
+	const uint64_t fileSize = (uint64_t)std::filesystem::file_size(cachePath, errorCode);
+	const uint64_t facesByteSize = (uint64_t)header.faceSize * header.faceSize * 6u * sizeof(DirectX::PackedVector::XMHALF4);
+
+	if (errorCode || header.faceSize == 0u || header.faceSize > D3D11_REQ_TEXTURECUBE_DIMENSION ||
+		fileSize != sizeof(EnvironmentCacheHeader) + facesByteSize)
+		return false;
+
+	outFaces.resize((size_t)header.faceSize * header.faceSize * 6u);
+	reader.read((char*)outFaces.data(), outFaces.size() * sizeof(DirectX::PackedVector::XMHALF4));
+
+	if (!reader)
+		return false;
+
+	expectedHeader.faceSize = header.faceSize;
+	return true;
+}
+
+static void writeEnvironmentCache(const std::string& cachePath, const EnvironmentCacheHeader& header, const std::vector<DirectX::PackedVector::XMHALF4>& faces)
+{
+	std::ofstream writer(cachePath, std::ios::binary);
+	if (!writer)
+		return;
+
+	writer.write((const char*)&header, sizeof(EnvironmentCacheHeader));
+	writer.write((const char*)faces.data(), faces.size() * sizeof(DirectX::PackedVector::XMHALF4));
+}
+
+static void equirectToCubeFaces(const glm::vec4* pImage, uint32_t imgWidth, uint32_t imgHeight, uint32_t faceSize, DirectX::PackedVector::XMHALF4* pOutFaces)
+{
+	using namespace DirectX;
+
+	// Per face: direction = sAxis * s + tAxis * t + center, with s & t in [-1, 1]. Matches the D3D11 cube face layout
+	static const glm::vec3 FACE_S_AXIS[6] = { {0.f, 0.f, -1.f}, {0.f, 0.f, 1.f}, {1.f, 0.f, 0.f}, {1.f, 0.f, 0.f}, {1.f, 0.f, 0.f}, {-1.f, 0.f, 0.f} };
+	static const glm::vec3 FACE_T_AXIS[6] = { {0.f, -1.f, 0.f}, {0.f, -1.f, 0.f}, {0.f, 0.f, 1.f}, {0.f, 0.f, -1.f}, {0.f, -1.f, 0.f}, {0.f, -1.f, 0.f} };
+	static const glm::vec3 FACE_CENTER[6] = { {1.f, 0.f, 0.f}, {-1.f, 0.f, 0.f}, {0.f, 1.f, 0.f}, {0.f, -1.f, 0.f}, {0.f, 0.f, 1.f}, {0.f, 0.f, -1.f} };
+
+	const float invFaceSize = 1.f / (float)faceSize;
+	const XMVECTOR imgDims = XMVectorSet((float)imgWidth, (float)imgHeight, 0.f, 0.f);
+
+	auto fetchTexel = [&](int x, int y) -> XMVECTOR
 		{
-			for (uint32_t i = 0; i < height; i++)
-			{
-				memcpy(pTarget, coursor, (size_t)width * channels);
-				pTarget += width;
-				coursor += imgWidth;
-			}
+			x = (x % (int)imgWidth + (int)imgWidth) % (int)imgWidth;	// Wrap horizontally
+			y = glm::clamp(y, 0, (int)imgHeight - 1);					// Clamp at the poles
+			return XMLoadFloat4((const XMFLOAT4*)&pImage[(size_t)y * imgWidth + x]);
 		};
 
-	// Positive X
-	coursor = pImageData + imgWidth * height + width * 2u;
-	copyImgSection((uint32_t*)data[0].pSysMem);
+	// Every row of every face is converted independently
+	Okay::parallelFor(faceSize * 6u, [&](uint32_t rowIdx)
+		{
+			const uint32_t face = rowIdx / faceSize;
+			const uint32_t y = rowIdx % faceSize;
 
-	// Negative X
-	coursor = pImageData + imgWidth * height;
-	copyImgSection((uint32_t*)data[1].pSysMem);
+			const float t = ((float)y + 0.5f) * invFaceSize * 2.f - 1.f;
+			const glm::vec3 rowOffset = FACE_T_AXIS[face] * t + FACE_CENTER[face];
+			const glm::vec3& sAxis = FACE_S_AXIS[face];
 
-	// Positive Y
-	coursor = pImageData + width;
-	copyImgSection((uint32_t*)data[2].pSysMem);
+			PackedVector::XMHALF4* pOutRow = pOutFaces + (size_t)rowIdx * faceSize;
 
-	// Negative Y
-	coursor = pImageData + imgWidth * height * 2u + width;
-	copyImgSection((uint32_t*)data[3].pSysMem);
+			// Directions & UVs are calculated for 4 texels at once
+			for (uint32_t x = 0; x < faceSize; x += 4u)
+			{
+				XMVECTOR s = XMVectorSet((float)x, (float)x + 1.f, (float)x + 2.f, (float)x + 3.f);
+				s = XMVectorMultiplyAdd(XMVectorAdd(s, XMVectorReplicate(0.5f)), XMVectorReplicate(invFaceSize * 2.f), XMVectorReplicate(-1.f));
 
-	// Positive Z
-	coursor = pImageData + imgWidth * height + width;
-	copyImgSection((uint32_t*)data[4].pSysMem);
+				XMVECTOR dirX = XMVectorMultiplyAdd(s, XMVectorReplicate(sAxis.x), XMVectorReplicate(rowOffset.x));
+				XMVECTOR dirY = XMVectorMultiplyAdd(s, XMVectorReplicate(sAxis.y), XMVectorReplicate(rowOffset.y));
+				XMVECTOR dirZ = XMVectorMultiplyAdd(s, XMVectorReplicate(sAxis.z), XMVectorReplicate(rowOffset.z));
 
-	// Negative Z
-	coursor = pImageData + imgWidth * height + width * 3u;
-	copyImgSection((uint32_t*)data[5].pSysMem);
+				XMVECTOR invLength = XMVectorReciprocalSqrt(XMVectorMultiplyAdd(dirX, dirX, XMVectorMultiplyAdd(dirY, dirY, XMVectorMultiply(dirZ, dirZ))));
+				dirX = XMVectorMultiply(dirX, invLength);
+				dirY = XMVectorClamp(XMVectorMultiply(dirY, invLength), XMVectorReplicate(-1.f), XMVectorReplicate(1.f));
+				dirZ = XMVectorMultiply(dirZ, invLength);
 
-	stbi_image_free(pImageData);
+				// u = atan2(x, z) / 2PI + 0.5, v = acos(y) / PI
+				XMVECTOR u = XMVectorMultiplyAdd(XMVectorATan2(dirX, dirZ), XMVectorReplicate(XM_1DIV2PI), XMVectorReplicate(0.5f));
+				XMVECTOR v = XMVectorMultiply(XMVectorACos(dirY), XMVectorReplicate(XM_1DIVPI));
+
+				XMFLOAT4 pixelX, pixelY;
+				XMStoreFloat4(&pixelX, XMVectorMultiplyAdd(u, XMVectorSplatX(imgDims), XMVectorReplicate(-0.5f)));
+				XMStoreFloat4(&pixelY, XMVectorMultiplyAdd(v, XMVectorSplatY(imgDims), XMVectorReplicate(-0.5f)));
+
+				const float* pPixelX = &pixelX.x;
+				const float* pPixelY = &pixelY.x;
+				const uint32_t numTexels = glm::min(4u, faceSize - x);
+
+				for (uint32_t k = 0; k < numTexels; k++)
+				{
+					const float floorX = glm::floor(pPixelX[k]);
+					const float floorY = glm::floor(pPixelY[k]);
+					const int x0 = (int)floorX;
+					const int y0 = (int)floorY;
+
+					XMVECTOR top = XMVectorLerp(fetchTexel(x0, y0), fetchTexel(x0 + 1, y0), pPixelX[k] - floorX);
+					XMVECTOR bottom = XMVectorLerp(fetchTexel(x0, y0 + 1), fetchTexel(x0 + 1, y0 + 1), pPixelX[k] - floorX);
 
+					PackedVector::XMStoreHalf4(&pOutRow[x + k], XMVectorLerp(top, bottom, pPixelY[k] - floorY));
+				}
+			}
+		});
+}
+
+static void createEnvironmentCube(DXGI_FORMAT format, uint32_t width, uint32_t height, const D3D11_SUBRESOURCE_DATA* pFaces, ID3D11ShaderResourceView** ppSRV)
+{
 	D3D11_TEXTURE2D_DESC texDesc{};
 	texDesc.ArraySize = 6u;
 	texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
 	texDesc.CPUAccessFlags = 0u;
-	texDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	texDesc.Format = format;
 	texDesc.Height = height;
 	texDesc.Width = width;
 	texDesc.MipLevels = 1u;
@@ -413,22 +836,169 @@ void RayTracer::loadEnvironmentMap(std::string_view path)
 	texDesc.MiscFlags = D3D11_RESOURCE_MISC_TEXTURECUBE;
 
 	ID3D11Device* pDevice = Okay::getDevice();
-	ID3D11DeviceContext* pDeviceContext = Okay::getDeviceContext();
 	bool success = false;
 
 	ID3D11Texture2D* pTextureCube = nullptr;
-	success = SUCCEEDED(pDevice->CreateTexture2D(&texDesc, data, &pTextureCube));
+	success = SUCCEEDED(pDevice->CreateTexture2D(&texDesc, pFaces, &pTextureCube));
+	OKAY_ASSERT(success);
+
+	success = SUCCEEDED(pDevice->CreateShaderResourceView(pTextureCube, nullptr, ppSRV));
+	DX11_RELEASE(pTextureCube);
+	OKAY_ASSERT(success);
+}
+
+void RayTracer::loadEnvironmentMap(std::string_view path)
+{
+	if (stbi_is_hdr(path.data()))
+	{
+		loadHdrEnvironmentMap(path);
+		return;
+	}
+
+	int imgWidth, imgHeight, channels = STBI_rgb_alpha;
+	uint32_t* pImageData = (uint32_t*)stbi_load(path.data(), &imgWidth, &imgHeight, nullptr, channels);
+
+	if (!pImageData)
+		return;
+
+	uint32_t width = imgWidth / 4u;
+	uint32_t height = imgHeight / 3u;
+
+	// The faces are read straight out of the 4x3 cross, the pitch skips over the rest of the image
+	D3D11_SUBRESOURCE_DATA data[6]{};
+	for (uint32_t i = 0; i < 6u; i++)
+	{
+		data[i].SysMemPitch = imgWidth * channels;
+		data[i].SysMemSlicePitch = 0u;
+	}
+
+	data[0].pSysMem = pImageData + imgWidth * height + width * 2u;		// Positive X
+	data[1].pSysMem = pImageData + imgWidth * height;					// Negative X
+	data[2].pSysMem = pImageData + width;								// Positive Y
+	data[3].pSysMem = pImageData + imgWidth * height * 2u + width;		// Negative Y
+	data[4].pSysMem = pImageData + imgWidth * height + width;			// Positive Z
+	data[5].pSysMem = pImageData + imgWidth * height + width * 3u;		// Negative Z
+
+	createEnvironmentCube(DXGI_FORMAT_R8G8B8A8_UNORM, width, height, data, &m_pEnvironmentMapSRV);
+
+	stbi_image_free(pImageData);
+}
+
+void RayTracer::loadHdrEnvironmentMap(std::string_view path)
+{
+	std::chrono::time_point<std::chrono::system_clock> timerStart = std::chrono::system_clock::now();
 
-	for (uint32_t i = 0; i < 6; i++)
+	std::error_code errorCode;
+	EnvironmentCacheHeader header;
+	header.sourceFileSize = (uint64_t)std::filesystem::file_size(path, errorCode);
+	header.sourceWriteTime = (int64_t)std::filesystem::last_write_time(path, errorCode).time_since_epoch().count();
+
+	const std::string cachePath = std::string(path) + ENV_CACHE_FILE_ENDING;
+	std::vector<DirectX::PackedVector::XMHALF4> faces;
+
+	bool loadedFromCache = readEnvironmentCache(cachePath, header, faces);
+
+	if (!loadedFromCache)
 	{
-		delete[] data[i].pSysMem;
+		int imgWidth, imgHeight;
+		glm::vec4* pImageData = (glm::vec4*)stbi_loadf(path.data(), &imgWidth, &imgHeight, nullptr, STBI_rgb_alpha);
+
+		if (!pImageData)
+			return;
+
+		// Each face covers 90 degrees of the 360 degree wide image
+		header.faceSize = glm::max((uint32_t)imgWidth / 4u, 1u);
+		faces.resize((size_t)header.faceSize * header.faceSize * 6u);
+
+		equirectToCubeFaces(pImageData, (uint32_t)imgWidth, (uint32_t)imgHeight, header.faceSize, faces.data());
+		stbi_image_free(pImageData);
+
+		writeEnvironmentCache(cachePath, header, faces);
 	}
 
+	const size_t faceTexels = (size_t)header.faceSize * header.faceSize;
+
+	D3D11_SUBRESOURCE_DATA data[6]{};
+	for (uint32_t i = 0; i < 6u; i++)
+	{
+		data[i].pSysMem = faces.data() + faceTexels * i;
+		data[i].SysMemPitch = header.faceSize * sizeof(DirectX::PackedVector::XMHALF4);
+		data[i].SysMemSlicePitch = 0u;
+	}
+
+	createEnvironmentCube(DXGI_FORMAT_R16G16B16A16_FLOAT, header.faceSize, header.faceSize, data, &m_pEnvironmentMapSRV);
+
+	std::chrono::duration<float> duration = std::chrono::system_clock::now() - timerStart;
+	printf("\nEnvironment map '%s' (%ux%u per face, %s): %.3fms\n", path.data(), header.faceSize, header.faceSize,
+		loadedFromCache ? "cached" : "converted", duration.count() * 1000.f);
+}
+
+void RayTracer::createBlueNoiseTexture()
+{
+	auto startTime = std::chrono::system_clock::now();
+
+	std::vector<float> blueNoise;
+	Sampler::generateBlueNoise(BLUE_NOISE_TILE_SIZE, blueNoise);
+
+	D3D11_TEXTURE2D_DESC texDesc{};
+	texDesc.ArraySize = 1u;
+	texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	texDesc.CPUAccessFlags = 0u;
+	texDesc.Format = DXGI_FORMAT_R32_FLOAT;
+	texDesc.Height = BLUE_NOISE_TILE_SIZE;
+	texDesc.Width = BLUE_NOISE_TILE_SIZE;
+	texDesc.MipLevels = 1u;
+	texDesc.SampleDesc.Count = 1u;
+	texDesc.SampleDesc.Quality = 0u;
+	texDesc.MiscFlags = 0u;
+	texDesc.Usage = D3D11_USAGE_IMMUTABLE;
+
+	D3D11_SUBRESOURCE_DATA data{};
+	data.pSysMem = blueNoise.data();
+	data.SysMemPitch = BLUE_NOISE_TILE_SIZE * sizeof(float);
+
+	ID3D11Device* pDevice = Okay::getDevice();
+	bool success = false;
+
+	ID3D11Texture2D* pTexture = nullptr;
+	success = SUCCEEDED(pDevice->CreateTexture2D(&texDesc, &data, &pTexture));
 	OKAY_ASSERT(success);
 
-	success = SUCCEEDED(pDevice->CreateShaderResourceView(pTextureCube, nullptr, &m_pEnvironmentMapSRV));
-	DX11_RELEASE(pTextureCube);
+	success = SUCCEEDED(pDevice->CreateShaderResourceView(pTexture, nullptr, &m_pBlueNoiseSRV));
+	DX11_RELEASE(pTexture);
 	OKAY_ASSERT(success);
+
+	std::chrono::duration<float> duration = std::chrono::system_clock::now() - startTime;
+	printf("\nBlue noise generation time: %.3fms\n", duration.count() * 1000.f);
+}
+
+void RayTracer::readAccumulation(std::vector<glm::vec4>& outPixels) const
+{
+	glm::vec4* pAccumulation = nullptr;
+	Okay::getCPUTextureData(*m_accumulationTexture.getBuffer(), (void**)&pAccumulation);
+
+	const uint32_t numPixels = m_renderData.textureDims.x * m_renderData.textureDims.y;
+	outPixels.resize(numPixels);
+
+	for (uint32_t i = 0; i < numPixels; i++)
+		outPixels[i] = pAccumulation[i].w > 0.f ? pAccumulation[i] / pAccumulation[i].w : glm::vec4(0.f);
+
+	OKAY_DELETE_ARRAY(pAccumulation);
+}
+
+void RayTracer::readAuxiliaryBuffers(std::vector<glm::vec4>& outAlbedo, std::vector<glm::vec4>& outNormalDepth) const
+{
+	glm::vec4* pAlbedo = nullptr;
+	glm::vec4* pNormalDepth = nullptr;
+	Okay::getCPUTextureData(*m_gBufferAlbedo.getBuffer(), (void**)&pAlbedo);
+	Okay::getCPUTextureData(*m_gBufferNormalDepth.getBuffer(), (void**)&pNormalDepth);
+
+	const uint32_t numPixels = m_renderData.textureDims.x * m_renderData.textureDims.y;
+	outAlbedo.assign(pAlbedo, pAlbedo + numPixels);
+	outNormalDepth.assign(pNormalDepth, pNormalDepth + numPixels);
+
+	OKAY_DELETE_ARRAY(pAlbedo);
+	OKAY_DELETE_ARRAY(pNormalDepth);
 }
 
 void RayTracer::updateBuffers()
@@ -486,7 +1056,7 @@ void RayTracer::updateBuffers()
 	m_renderData.numDirLights = (uint32_t)dirLightView.size_hint();
 	m_renderData.numPointLights = (uint32_t)pointLightView.size_hint();
 	m_renderData.numSpotLights = (uint32_t)spotLightView.size_hint();
-	m_renderData.numAccumulationFrames += m_renderData.accumulationEnabled;
+	m_renderData.numAccumulationFrames += m_renderData.accumulationEnabled && m_renderData.motionPixelStride == 1u;
 
 	Okay::updateBuffer(m_pRenderDataBuffer, &m_renderData, sizeof(RenderData));
 }
@@ -497,27 +1067,19 @@ void RayTracer::onResize()
 
 	m_renderData.textureDims = newDims;
 	m_accumulationTexture.resize(newDims.x, newDims.y);
+	m_secondMomentTexture.resize(newDims.x, newDims.y);
+	m_motionTexture.resize((newDims.x + 1u) / 2u, (newDims.y + 1u) / 2u);
+	m_gBufferNormalDepth.resize(newDims.x, newDims.y);
+	m_gBufferPositionInstance.resize(newDims.x, newDims.y);
+	m_gBufferAlbedo.resize(newDims.x, newDims.y);
+	m_prevGBufferNormalDepth.resize(newDims.x, newDims.y);
+	m_prevGBufferPositionInstance.resize(newDims.x, newDims.y);
+	m_historyAccumulation.resize(newDims.x, newDims.y);
+	m_historySecondMoment.resize(newDims.x, newDims.y);
+	createAdaptiveSamplingResources();
 	resetAccumulation();
 }
 
-void RayTracer::refitOctTreeNode(OctTreeNode& node)
-{
-	node.boundingBox = Okay::AABB();
-	const entt::registry& reg = m_pScene->getRegistry();
-
-	for (const EntityAABB& entityAABB : node.entities)
-	{
-		const MeshComponent* pMeshComp = reg.try_get<MeshComponent>(entityAABB.entity);
-		const Sphere* pSphereComp = reg.try_get<Sphere>(entityAABB.entity);
-
-		if (pMeshComp || pSphereComp)
-		{
-			node.boundingBox.growTo(entityAABB.aabb.min);
-			node.boundingBox.growTo(entityAABB.aabb.max);
-		}
-	}
-}
-
 static std::chrono::time_point<std::chrono::system_clock> octTreeTimerStart;
 
 void RayTracer::createOctTree(const Scene& scene, uint32_t maxDepth, uint32_t maxLeafObjects)
@@ -528,177 +1090,7 @@ void RayTracer::createOctTree(const Scene& scene, uint32_t maxDepth, uint32_t ma
 	octTreeTimerStart = std::chrono::system_clock::now();
 
 	std::vector<OctTreeNode> nodes;
-	OctTreeNode& root = nodes.emplace_back();
-
-	const entt::registry& reg = scene.getRegistry();
-	auto meshView = reg.view<MeshComponent, Transform>();
-	auto sphereView = reg.view<Sphere, Transform>();
-
-	root.entities.reserve(meshView.size_hint() + sphereView.size_hint());
-
-	for (entt::entity entity : meshView)
-	{
-		auto [meshComponent, transform] = meshView[entity];
-		const Mesh& mesh = m_pResourceManager->getAsset<Mesh>(meshComponent.meshID);
-
-		Okay::AABB meshBB = mesh.getBoundingBox();
-		glm::vec3 center = (meshBB.min + meshBB.max) * 0.5f;
-		glm::vec3 extents = (meshBB.min - meshBB.max) * 0.5f;
-
-		DirectX::BoundingBox box;
-		box.Center = DirectX::XMFLOAT3(center.x, center.y, center.z);
-		box.Extents = DirectX::XMFLOAT3(extents.x, extents.y, extents.z);
-
-		glm::vec3 verticies[8u]{};
-		box.GetCorners((DirectX::XMFLOAT3*)verticies); // lmao
-
-		glm::mat4x4 matrix = transform.calculateMatrix();
-
-		for (const glm::vec3& vertex : verticies)
-		{
-			root.boundingBox.growTo(matrix * glm::vec4(vertex.x, vertex.y, vertex.z, 1.f));
-		}
-
-		root.entities.emplace_back(entity, meshBB);
-	}
-
-	for (entt::entity entity : sphereView)
-	{
-		auto [sphereComp, transform] = sphereView[entity];
-
-		Okay::AABB sphereBB = Okay::AABB(glm::vec3(-sphereComp.radius), glm::vec3(sphereComp.radius));
-		sphereBB.min += transform.position;
-		sphereBB.max += transform.position;
-
-		root.boundingBox.growTo(sphereBB.min);
-		root.boundingBox.growTo(sphereBB.max);
-
-		root.entities.emplace_back(entity, sphereBB);
-	}
-
-	const glm::vec3 CHILD_BBS_OFFSETS[8] =
-	{
-		glm::vec3(1.f, -1.f, 1.f),
-		glm::vec3(-1.f, -1.f, 1.f),
-		glm::vec3(1.f, 1.f, 1.f),
-		glm::vec3(-1.f, 1.f, 1.f),
-
-		glm::vec3(1.f, -1.f, -1.f),
-		glm::vec3(-1.f, -1.f, -1.f),
-		glm::vec3(1.f, 1.f, -1.f),
-		glm::vec3(-1.f, 1.f, -1.f),
-	};
-
-	struct OctTreeNodeStack
-	{
-		OctTreeNodeStack() = default;
-		OctTreeNodeStack(uint32_t parentNodeIndex, uint32_t nodeIndex, uint32_t depth)
-			:parentNodeIndex(parentNodeIndex), nodeIndex(nodeIndex), depth(depth)
-		{ }
-
-		uint32_t parentNodeIndex = Okay::INVALID_UINT;
-		uint32_t nodeIndex = Okay::INVALID_UINT;
-		uint32_t depth = Okay::INVALID_UINT;
-	};
-
-	std::stack<OctTreeNodeStack> stack;
-	std::vector<EntityAABB> childEntities;
-	std::vector<EntityAABB> childEntitiesPool;
-	OctTreeNodeStack nodeStackData;
-
-	stack.push(OctTreeNodeStack(Okay::INVALID_UINT, 0u, 0u));
-
-	while (!stack.empty())
-	{
-		nodeStackData = stack.top();
-		stack.pop();
-
-		OctTreeNode* pNode = &nodes[nodeStackData.nodeIndex];
-
-		if (nodeStackData.depth >= maxDepth || pNode->entities.size() <= maxLeafObjects)
-			continue;
-
-		Okay::AABB defaultChildBB = pNode->boundingBox;
-
-		glm::vec3 bbCenter = (defaultChildBB.max + defaultChildBB.min) * 0.5f;
-
-		defaultChildBB.max -= bbCenter;
-		defaultChildBB.min -= bbCenter;
-
-		defaultChildBB.min *= 0.5f;
-		defaultChildBB.max *= 0.5f;
-
-		defaultChildBB.max += bbCenter;
-		defaultChildBB.min += bbCenter;
-
-		childEntitiesPool.clear();
-		float nodeBBArea = pNode->boundingBox.getArea();
-		uint32_t totalChildren = pNode->entities.size();
-		for (int k = pNode->entities.size() - 1; k >= 0; k--)
-		{
-			if (pNode->entities[k].aabb.getArea() / nodeBBArea < 0.75f)
-			{
-				childEntitiesPool.emplace_back(pNode->entities[k]);
-			}
-		}
-
-		glm::vec3 defaultChildBBExtents = (defaultChildBB.max - defaultChildBB.min) * 0.5f;
-		for (uint32_t i = 0u; i < 8u; i++)
-		{
-			Okay::AABB childBB = defaultChildBB;
-			for (uint32_t k = 0; k < 3u; k++)
-			{
-				childBB.max[k] += CHILD_BBS_OFFSETS[i][k] * defaultChildBBExtents[k];
-				childBB.min[k] += CHILD_BBS_OFFSETS[i][k] * defaultChildBBExtents[k];
-			}
-
-			childEntities.clear();
-
-			for (int k = (int)childEntitiesPool.size() - 1; k >= 0; k--)
-			{
-				const EntityAABB& entityAABB = childEntitiesPool[k];
-
-				if (!Okay::AABB::intersects(childBB, entityAABB.aabb))
-					continue;
-
-				//glm::vec3 boxCenter = (entityAABB.aabb.max + entityAABB.aabb.min) * 0.5f;
-				//if (!Okay::AABB::intersects(childBB, boxCenter))
-				//	continue;
-
-				childEntities.emplace_back(entityAABB);
-				childEntitiesPool.erase(childEntitiesPool.begin() + k);
-			}
-
-			if (!childEntities.size())
-				continue;
-
-			if (childEntities.size() == totalChildren)
-				continue;
-
-			for (uint32_t k = 0; k < childEntities.size(); k++)
-			{
-				for (uint32_t j = 0; j < pNode->entities.size(); j++)
-				{
-					if (childEntities[k].entity != pNode->entities[j].entity)
-						continue;
-
-					pNode->entities.erase(pNode->entities.begin() + j);
-					break;
-				}
-			}
-
-			OctTreeNode& childNode = nodes.emplace_back();
-			pNode = &nodes[nodeStackData.nodeIndex]; // Re-get the node incase the 'nodes' vector had to reallocate
-
-			pNode->children[i] = uint32_t(nodes.size() - 1);
-
-			childNode.entities = std::move(childEntities);
-			//childNode.boundingBox = childBBs[i];
-			refitOctTreeNode(childNode);
-
-			stack.push(OctTreeNodeStack(nodeStackData.nodeIndex, pNode->children[i], nodeStackData.depth + 1u));
-		}
-	}
+	OctTree::build(scene, *m_pResourceManager, maxDepth, maxLeafObjects, nodes);
 
 	loadOctTree(nodes);
 }
@@ -707,71 +1099,36 @@ void RayTracer::loadOctTree(const std::vector<OctTreeNode>& nodes)
 {
 	const entt::registry& reg = m_pScene->getRegistry();
 
-	m_octTreeNodes.assign(nodes.size(), GPU_OctTreeNode{});
+	std::vector<entt::entity> meshEntities;
+	OctTree::flatten(*m_pScene, nodes, m_octTreeNodes, meshEntities);
+
 	m_gpuMeshes.clear();
+	m_gpuMeshes.reserve(meshEntities.size());
 
-	for (uint32_t i = 0; i < (uint32_t)nodes.size(); i++)
+	for (entt::entity entity : meshEntities)
 	{
-		const OctTreeNode& node = nodes[i];
-		GPU_OctTreeNode& gpuNode = m_octTreeNodes[i];
-
-		gpuNode.boundingBox = node.boundingBox;
-
-		for (uint32_t k = 0; k < 8u; k ++)
-		{
-			if (node.children[k] == Okay::INVALID_UINT)
-				continue;
-
-			if (gpuNode.firstChildIdx == Okay::INVALID_UINT)
-				gpuNode.firstChildIdx = node.children[k];
-			
-			gpuNode.numChildren += 1;
-		}
-
-		uint32_t numMeshes = 0u;
-		for (const EntityAABB& entityAABB : node.entities)
-		{
-			const MeshComponent* pMeshComp = reg.try_get<MeshComponent>(entityAABB.entity);
-			if (!pMeshComp)
-				continue;
+		const MeshComponent& meshComp = reg.get<MeshComponent>(entity);
+		const Transform& transform = reg.get<Transform>(entity);
 
-			GPU_MeshComponent& gpuMesh = m_gpuMeshes.emplace_back();
+		GPU_MeshComponent& gpuMesh = m_gpuMeshes.emplace_back();
 
-			const Transform& transform = reg.get<Transform>(entityAABB.entity);
+		gpuMesh.triStart = m_meshDescs[meshComp.meshID].startIdx;
+		gpuMesh.triEnd = m_meshDescs[meshComp.meshID].endIdx;
 
-			gpuMesh.triStart = m_meshDescs[pMeshComp->meshID].startIdx;
-			gpuMesh.triEnd = m_meshDescs[pMeshComp->meshID].endIdx;
+		gpuMesh.boundingBox = m_pResourceManager->getAsset<Mesh>(meshComp.meshID).getBoundingBox();
 
-			gpuMesh.boundingBox = m_pResourceManager->getAsset<Mesh>(pMeshComp->meshID).getBoundingBox();
+		glm::mat4 transformMatrix = glm::transpose(transform.calculateMatrix());
+		gpuMesh.transformMatrix = transformMatrix;
+		gpuMesh.inverseTransformMatrix = glm::inverse(transformMatrix);
 
-			glm::mat4 transformMatrix = glm::transpose(transform.calculateMatrix());
-			gpuMesh.transformMatrix = transformMatrix;
-			gpuMesh.inverseTransformMatrix = glm::inverse(transformMatrix);
-
-			gpuMesh.material = pMeshComp->material;
-			gpuMesh.bvhNodeStartIdx = m_meshDescs[pMeshComp->meshID].bvhTreeStartIdx;
-
-			numMeshes++;
-		}
-
-		//for (entt::entity entity : sphereView)
-		//{
-		//	auto [sphere, transform] = sphereView[entity];
-		//
-		//	memcpy(pMappedBufferData, &transform.position, sizeof(glm::vec3));
-		//	pMappedBufferData += sizeof(glm::vec3);
-		//
-		//	memcpy(pMappedBufferData, &sphere, sizeof(Sphere));
-		//	pMappedBufferData += sizeof(Sphere);
-		//}
-
-		gpuNode.meshesStartIdx = (uint32_t)m_gpuMeshes.size() - numMeshes;
-		gpuNode.meshesEndIdx = gpuNode.meshesStartIdx + numMeshes;
-
-		//gpuNode.spheresStartIdx = (uint32_t)m_gpuMeshes.size();
-		//gpuNode.spheresEndIdx = gpuNode.spheresStartIdx + (uint32_t)node.entities.size();
+		gpuMesh.material = meshComp.material;
+		gpuMesh.bvhNodeStartIdx = m_meshDescs[meshComp.meshID].bvhTreeStartIdx;
+	}
 
-		printf("nodeIdx: %u, numChildren: %u, numEntities: %u\n", i, gpuNode.numChildren, numMeshes);
+	for (uint32_t i = 0; i < (uint32_t)m_octTreeNodes.size(); i++)
+	{
+		const GPU_OctTreeNode& gpuNode = m_octTreeNodes[i];
+		printf("nodeIdx: %u, numChildren: %u, numEntities: %u\n", i, gpuNode.numChildren, gpuNode.meshesEndIdx - gpuNode.meshesStartIdx);
 	}
 
 	m_meshData.updateRaw((uint32_t)m_gpuMeshes.size(), m_gpuMeshes.data());
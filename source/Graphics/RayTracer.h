@@ -4,70 +4,17 @@
 #include "Scene/Entity.h"
 #include "Scene/Components.h"
 #include "GPUStorage.h"
+#include "BvhBuilder.h"
+#include "OctTree.h"
 #include "DirectX/RenderTexture.h"
+#include "Sampler.h"
+#include "TextureAtlas.h"
 
 #include "glm/glm.hpp"
 
 class Scene;
 class ResourceManager;
 
-// Defines the start & end triangle index for a mesh in the vertex buffer, as well as the index of the root node in m_bvhTree
-struct MeshDesc
-{
-	uint32_t startIdx;
-	uint32_t endIdx;
-	uint32_t bvhTreeStartIdx;
-	uint32_t numBvhNodes;
-};
-
-struct GPUNode
-{
-	Okay::AABB boundingBox;
-	uint32_t triStart = Okay::INVALID_UINT;
-	uint32_t triEnd = Okay::INVALID_UINT;
-	uint32_t firstChildIdx = Okay::INVALID_UINT;
-};
-
-struct EntityAABB
-{
-	EntityAABB(entt::entity entity, Okay::AABB aabb)
-		:entity(entity), aabb(aabb) { }
-
-	entt::entity entity;
-	Okay::AABB aabb;
-};
-
-struct OctTreeNode
-{
-	Okay::AABB boundingBox;
-	std::vector<EntityAABB> entities;
-	uint32_t children[8u]
-	{
-		Okay::INVALID_UINT,
-		Okay::INVALID_UINT,
-		Okay::INVALID_UINT,
-		Okay::INVALID_UINT,
-		Okay::INVALID_UINT,
-		Okay::INVALID_UINT,
-		Okay::INVALID_UINT,
-		Okay::INVALID_UINT,
-	};
-};
-
-struct GPU_OctTreeNode
-{
-	Okay::AABB boundingBox;
-
-	uint32_t meshesStartIdx = Okay::INVALID_UINT;
-	uint32_t meshesEndIdx = Okay::INVALID_UINT;
-
-	uint32_t spheresStartIdx = Okay::INVALID_UINT;
-	uint32_t spheresEndIdx = Okay::INVALID_UINT;
-
-	uint32_t firstChildIdx = Okay::INVALID_UINT;
-	uint32_t numChildren = 0u;
-};
-
 class RayTracer
 {
 public:
@@ -87,14 +34,25 @@ public:
 	void initiate(const RenderTexture& target, const ResourceManager& resourceManager, std::string_view environmentMapPath = "");
 
 	void loadMeshAndBvhData(uint32_t maxDepth, uint32_t maxLeafTriangles);
+	void loadTextureData(); // Repacks the texture atlas from the ResourceManager's textures
+
+	// Only upload what was added to the ResourceManager since the last load, and the placeholders that were replaced by what they stood in for.
+	// Meshes are built with the last load's BVH settings. The replaced data stays in the buffers & atlas unused, until the next full load
+	void appendMeshAndBvhData(std::span<const AssetID> replacedMeshes);
+	void appendTextureData(std::span<const AssetID> replacedTextures);
 	void createOctTree(const Scene& scene, uint32_t maxDepth, uint32_t maxLeafObjects);
 
 	inline const std::vector<MeshDesc>& getMeshDescriptors() const;
 	inline const std::vector<GPUNode>& getBvhTreeNodes() const;
 	inline const std::vector<GPU_OctTreeNode>& getOctTreeNodes() const;
 
-	inline const GPUStorage& getTrianglesPos() const;
-	inline const GPUStorage& getTrianglesInfo() const;
+	inline const GPUStorage& getVertexPositions() const;
+	inline const GPUStorage& getVertexInfo() const;
+	inline const GPUStorage& getTriangleIndices() const;
+
+	// NUM_TEXTURE_ATLAS_CLASSES arrays, bound from TEXTURE_ATLAS_SLOT. Null for classes without textures
+	inline ID3D11ShaderResourceView* const* getTextureAtlasSRVs() const;
+	inline const GPUStorage& getTextureRecords() const;
 
 	uint32_t getGlobalNodeIdx(const MeshComponent& meshComp, uint32_t localNodeIdx) const;
 
@@ -110,6 +68,34 @@ public:
 	inline float& getDOFStrength();
 	inline float& getDOFDistance();
 
+	inline uint32_t& getMaxBounces();
+	inline void toggleRussianRoulette(bool enable);
+	inline uint32_t& getRussianRouletteStartBounce();
+
+	inline void toggleAdaptiveSampling(bool enable);
+	inline uint32_t& getAdaptiveMinSamples();
+	inline float& getAdaptiveErrorThreshold();
+	inline uint32_t& getAdaptiveUpdateInterval();
+
+	inline void setSamplerType(Sampler::Type type);
+
+	// Traces 1 / (pixelStride^2) of the pixels while the camera moves, the others are reprojected from the last frame. See MotionMode.h
+	inline void toggleMotionMode(bool enable);
+	inline void setMotionPixelStride(uint32_t pixelStride);
+	inline bool isMotionFrame() const; // True if the last frame only traced some of the pixels
+
+	// Keeps the accumulation when the camera moves by reprojecting it into the new view
+	inline void toggleReprojection(bool enable);
+	inline float& getMaxHistorySamples();
+	inline float& getReprojectionNormalThreshold();
+	inline float& getReprojectionDepthTolerance();
+
+	// Reads back the averaged accumulation, one float4 per pixel
+	void readAccumulation(std::vector<glm::vec4>& outPixels) const;
+
+	// Reads back the first hit G-buffers for the denoiser, normal & distance in outNormalDepth (distance <= 0 on miss)
+	void readAuxiliaryBuffers(std::vector<glm::vec4>& outAlbedo, std::vector<glm::vec4>& outNormalDepth) const;
+
 	void onResize();
 
 	inline void setDebugMode(DebugDisplayMode mode);
@@ -120,10 +106,10 @@ private: // Scene & Resources
 	const ResourceManager* m_pResourceManager;
 
 	void calculateProjectionData();
-	void loadTextureData();
 	void loadEnvironmentMap(std::string_view path);
+	void loadHdrEnvironmentMap(std::string_view path);
+	void createBlueNoiseTexture();
 	void loadOctTree(const std::vector<OctTreeNode>& nodes);
-	void refitOctTreeNode(OctTreeNode& node);
 
 private: // Main DX11
 	struct RenderData // Aligned 16
@@ -153,30 +139,109 @@ private: // Main DX11
 		float dofDistance = 0.f;
 
 		uint32_t debugMaxCount = 500;
-		glm::vec3 pad0;
+		uint32_t maxBounces = 1u;
+		uint32_t russianRouletteEnabled = 1u;
+		uint32_t russianRouletteStartBounce = 2u;
+
+		uint32_t adaptiveSamplingEnabled = 0u;
+		uint32_t adaptiveMinSamples = 16u;
+		float adaptiveErrorThreshold = 0.02f;
+		uint32_t adaptiveUpdateInterval = 8u;
+
+		Sampler::Type samplerType = Sampler::Type::Random;
+		uint32_t motionPixelStride = 1u; // 1 = Full resolution, 2 = 1/4 of the pixels, 4 = 1/16
+		glm::uvec2 motionPixelOffset{};
+
+		glm::mat4 previousViewProjectionMatrix = glm::mat4(0.f);
+		glm::vec3 previousCameraPosition{};
+		float maxHistorySamples = 64.f;
+
+		float reprojectionNormalThreshold = 0.9f;
+		float reprojectionDepthTolerance = 0.05f;
+		uint32_t motionFrameIdx = 0u; // Sample index of motion frames, the accumulation alpha is the pixel's age on them
+		float pad0 = 0.f;
 	};
 
 	void updateBuffers();
 
 	const RenderTexture* m_pTargetTexture;
 	RenderTexture m_accumulationTexture;
+	RenderTexture m_secondMomentTexture; // Sum of squared luminance per pixel, used for the variance in adaptive sampling
 
 	RenderData m_renderData;
 	ID3D11Buffer* m_pRenderDataBuffer;
 
 	ID3D11ComputeShader* m_pMainRaytracingCS;
 
+private: // Adaptive sampling
+	void createAdaptiveSamplingResources();
+	void updateActiveTiles();
+
+	// Indices of the tiles that haven't converged, the count is copied into m_pTileDispatchArgs for DispatchIndirect
+	ID3D11Buffer* m_pActiveTilesBuffer;
+	ID3D11ShaderResourceView* m_pActiveTilesSRV;
+	ID3D11UnorderedAccessView* m_pActiveTilesUAV;
+	ID3D11Buffer* m_pTileDispatchArgs;
+
+	ID3D11ComputeShader* m_pAdaptiveTilesCS;
+	ID3D11ComputeShader* m_pAccumulationResolveCS;
+
+private: // Camera motion
+	bool updateCameraHistory();
+	bool updateMotionMode(bool cameraMoved);
+
+	glm::mat4 m_cameraViewProjectionMatrix;
+	glm::mat4 m_lastCameraViewProjectionMatrix;
+	glm::vec3 m_lastCameraPosition;
+
+	bool m_motionModeEnabled;
+	uint32_t m_motionPixelStride;
+	uint32_t m_motionFrameIdx;
+
+	// Low resolution, holds the pixels traced this frame
+	// While the camera moves the accumulation holds one colour per pixel instead, the alpha channel is its age
+	RenderTexture m_motionTexture;
+	ID3D11ComputeShader* m_pMotionUpsampleCS;
+
+private: // Temporal reprojection
+	void storeHistory();
+
+	bool m_reprojectionEnabled;
+
+	// First hit of every pixel, written by RaytracerCS. Instance IDs are stored as floats after the world position, -1 on miss
+	RenderTexture m_gBufferNormalDepth;
+	RenderTexture m_gBufferPositionInstance;
+	RenderTexture m_gBufferAlbedo; // White on miss
+
+	// Copies from before the camera moved
+	RenderTexture m_prevGBufferNormalDepth;
+	RenderTexture m_prevGBufferPositionInstance;
+	RenderTexture m_historyAccumulation;
+	RenderTexture m_historySecondMoment;
+
+	ID3D11ComputeShader* m_pReprojectionCS;
+
 private: // DX11 Resources
-	GPUStorage m_trianglePositions;
-	GPUStorage m_triangleInfo;
+	GPUStorage m_vertexPositions;
+	GPUStorage m_vertexInfo;
+	GPUStorage m_triangleIndices;
+	GPUStorage m_hitTriangles; // Only read while traversing, the rest is only read for the closest hit
 
 	GPUStorage m_bvhTree;
 	std::vector<GPUNode> m_bvhTreeNodes;
+	uint32_t m_bvhMaxDepth;
+	uint32_t m_bvhMaxLeafTriangles;
+	uint32_t m_numVerticies; // Used in m_vertexPositions & m_vertexInfo, they're only kept on the GPU
+	uint32_t m_numTriangles;
 
-	// The order of m_textureAtlasData & m_meshDescs matches the respective std::vector in ResourceManager.
-	ID3D11ShaderResourceView* m_pTextures;
+	// The order of m_textureRecords & m_meshDescs matches the respective std::vector in ResourceManager.
+	ID3D11ShaderResourceView* m_pTextureAtlasSRVs[NUM_TEXTURE_ATLAS_CLASSES];
+	GPUStorage m_textureRecords;
+	std::vector<TextureAtlasRecord> m_textureAtlasRecords;
+	TextureAtlasPacker m_textureAtlasPacker;
 
 	ID3D11ShaderResourceView* m_pEnvironmentMapSRV;
+	ID3D11ShaderResourceView* m_pBlueNoiseSRV;
 
 	std::vector<MeshDesc> m_meshDescs;
 	std::vector<GPU_MeshComponent> m_gpuMeshes;
@@ -206,6 +271,7 @@ inline void RayTracer::resetAccumulation()
 
 	static const float CLEAR_COLOUR[4] = { 0.f, 0.f, 0.f, 0.f };
 	Okay::getDeviceContext()->ClearUnorderedAccessViewFloat(*m_accumulationTexture.getUAV(), CLEAR_COLOUR);
+	Okay::getDeviceContext()->ClearUnorderedAccessViewFloat(*m_secondMomentTexture.getUAV(), CLEAR_COLOUR);
 }
 
 inline uint32_t RayTracer::getNumAccumulationFrames() const { return m_renderData.numAccumulationFrames; }
@@ -213,6 +279,40 @@ inline uint32_t RayTracer::getNumAccumulationFrames() const { return m_renderDat
 inline float& RayTracer::getDOFStrength() { return m_renderData.dofStrength; }
 inline float& RayTracer::getDOFDistance() { return m_renderData.dofDistance; }
 
+inline uint32_t& RayTracer::getMaxBounces() { return m_renderData.maxBounces; }
+inline void RayTracer::toggleRussianRoulette(bool enable) { m_renderData.russianRouletteEnabled = (uint32_t)enable; }
+inline uint32_t& RayTracer::getRussianRouletteStartBounce() { return m_renderData.russianRouletteStartBounce; }
+
+inline void RayTracer::toggleAdaptiveSampling(bool enable)
+{
+	m_renderData.adaptiveSamplingEnabled = (uint32_t)enable;
+	resetAccumulation();
+}
+
+inline uint32_t& RayTracer::getAdaptiveMinSamples() { return m_renderData.adaptiveMinSamples; }
+inline float& RayTracer::getAdaptiveErrorThreshold() { return m_renderData.adaptiveErrorThreshold; }
+inline uint32_t& RayTracer::getAdaptiveUpdateInterval() { return m_renderData.adaptiveUpdateInterval; }
+
+inline void RayTracer::setSamplerType(Sampler::Type type)
+{
+	m_renderData.samplerType = type;
+	resetAccumulation();
+}
+
+inline void RayTracer::toggleMotionMode(bool enable) { m_motionModeEnabled = enable; }
+inline bool RayTracer::isMotionFrame() const { return m_renderData.motionPixelStride > 1u; }
+
+inline void RayTracer::setMotionPixelStride(uint32_t pixelStride)
+{
+	OKAY_ASSERT(pixelStride == 2u || pixelStride == 4u);
+	m_motionPixelStride = pixelStride;
+}
+
+inline void RayTracer::toggleReprojection(bool enable) { m_reprojectionEnabled = enable; }
+inline float& RayTracer::getMaxHistorySamples() { return m_renderData.maxHistorySamples; }
+inline float& RayTracer::getReprojectionNormalThreshold() { return m_renderData.reprojectionNormalThreshold; }
+inline float& RayTracer::getReprojectionDepthTolerance() { return m_renderData.reprojectionDepthTolerance; }
+
 inline void RayTracer::setDebugMode(RayTracer::DebugDisplayMode mode) { m_renderData.debugMode = mode; }
 inline uint32_t& RayTracer::getDebugMaxCount() { return m_renderData.debugMaxCount; }
 
@@ -220,8 +320,12 @@ inline const std::vector<MeshDesc>& RayTracer::getMeshDescriptors() const { retu
 inline const std::vector<GPUNode>& RayTracer::getBvhTreeNodes() const { return m_bvhTreeNodes; }
 inline const std::vector<GPU_OctTreeNode>& RayTracer::getOctTreeNodes() const { return m_octTreeNodes; }
 
-inline const GPUStorage& RayTracer::getTrianglesPos() const { return m_trianglePositions; }
-inline const GPUStorage& RayTracer::getTrianglesInfo() const { return m_triangleInfo; }
+inline const GPUStorage& RayTracer::getVertexPositions() const { return m_vertexPositions; }
+inline const GPUStorage& RayTracer::getVertexInfo() const { return m_vertexInfo; }
+inline const GPUStorage& RayTracer::getTriangleIndices() const { return m_triangleIndices; }
+
+inline ID3D11ShaderResourceView* const* RayTracer::getTextureAtlasSRVs() const { return m_pTextureAtlasSRVs; }
+inline const GPUStorage& RayTracer::getTextureRecords() const { return m_textureRecords; }
 
 inline uint32_t RayTracer::getGlobalNodeIdx(const MeshComponent& meshComp, uint32_t localNodeIdx) const
 {
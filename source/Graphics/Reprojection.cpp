@@ -0,0 +1,84 @@
+#include "Reprojection.h"
+#include "Threading.h"
+
+namespace Reprojection
+{
+	bool worldToPixel(const glm::mat4& viewProjection, const glm::vec3& worldPosition, glm::uvec2 textureDims, glm::vec2& outPixel)
+	{
+		const glm::vec4 clip = viewProjection * glm::vec4(worldPosition, 1.f);
+		if (clip.w <= 0.f)
+			return false;
+
+		outPixel.x = (clip.x / clip.w + 1.f) * 0.5f * (float)textureDims.x;
+		outPixel.y = (1.f - clip.y / clip.w) * 0.5f * (float)textureDims.y;
+		return true;
+	}
+
+	bool findHistoryPixel(const Surface& surface, const History& history, const Settings& settings, glm::uvec2& outPixel)
+	{
+		if (surface.instanceId < 0.f)
+			return false;
+
+		glm::vec2 pixelPos;
+		if (!worldToPixel(history.viewProjection, surface.worldPosition, history.textureDims, pixelPos))
+			return false;
+
+		const glm::vec2 roundedPixel = glm::floor(pixelPos + 0.5f);
+		if (roundedPixel.x < 0.f || roundedPixel.y < 0.f || roundedPixel.x >= (float)history.textureDims.x || roundedPixel.y >= (float)history.textureDims.y)
+			return false;
+
+		outPixel = glm::uvec2(roundedPixel);
+		const Surface& historySurface = history.surfaces[(size_t)outPixel.y * history.textureDims.x + outPixel.x];
+
+		// Both distances are from the previous camera, something in front of the surface means it was occluded
+		const float distance = glm::length(surface.worldPosition - history.cameraPosition);
+		const float historyDistance = glm::length(historySurface.worldPosition - history.cameraPosition);
+
+		return historySurface.instanceId == surface.instanceId &&
+			glm::dot(surface.normal, historySurface.normal) >= settings.normalThreshold &&
+			glm::abs(historyDistance - distance) <= settings.depthTolerance * distance;
+	}
+
+	float getHistoryWeight(float historySamples, float maxHistorySamples)
+	{
+		return historySamples > maxHistorySamples ? maxHistorySamples / historySamples : 1.f;
+	}
+
+	uint32_t reprojectAccumulation(const History& history, std::span<const Surface> surfaces, const Settings& settings,
+		std::span<glm::vec4> accumulation, std::span<float> secondMoment)
+	{
+		const size_t numPixels = (size_t)history.textureDims.x * history.textureDims.y;
+		if (surfaces.size() != numPixels || accumulation.size() != numPixels || secondMoment.size() != numPixels ||
+			history.accumulation.size() != numPixels || history.secondMoment.size() != numPixels || history.surfaces.size() != numPixels)
+			return 0u;
+
+		// Counted per row so the rows don't share a counter
+		std::vector<uint32_t> rowNumReprojected(history.textureDims.y, 0u);
+
+		Okay::parallelFor(history.textureDims.y, [&](uint32_t y)
+			{
+				for (uint32_t x = 0; x < history.textureDims.x; x++)
+				{
+					const size_t pixelIdx = (size_t)y * history.textureDims.x + x;
+
+					glm::uvec2 historyPixel;
+					if (!findHistoryPixel(surfaces[pixelIdx], history, settings, historyPixel))
+						continue;
+
+					const size_t historyIdx = (size_t)historyPixel.y * history.textureDims.x + historyPixel.x;
+					const glm::vec4& historyAccumulation = history.accumulation[historyIdx];
+					const float historyWeight = getHistoryWeight(historyAccumulation.w, settings.maxHistorySamples);
+
+					accumulation[pixelIdx] += historyAccumulation * historyWeight;
+					secondMoment[pixelIdx] += history.secondMoment[historyIdx] * historyWeight;
+					rowNumReprojected[y]++;
+				}
+			});
+
+		uint32_t numReprojected = 0u;
+		for (uint32_t rowCount : rowNumReprojected)
+			numReprojected += rowCount;
+
+		return numReprojected;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "glm/glm.hpp"
+
+#include <span>
+#include <vector>
+
+// Reprojection of accumulated samples between two camera views, ported to resources/shaders/ReprojectionCS.hlsl
+namespace Reprojection
+{
+	// First hit of a pixel, what the G-buffers store
+	struct Surface
+	{
+		glm::vec3 worldPosition = glm::vec3(0.f); // Where the traced ray hit, so it stays right with AA jitter and DOF
+		glm::vec3 normal = glm::vec3(0.f);
+		float instanceId = -1.f; // < 0 on miss
+	};
+
+	struct Settings
+	{
+		float maxHistorySamples = 64.f;
+		float normalThreshold = 0.9f;
+		float depthTolerance = 0.05f; // Relative to the distance from the previous camera
+	};
+
+	// An accumulation together with the camera and first hits it was traced with
+	struct History
+	{
+		glm::mat4 viewProjection = glm::mat4(1.f);
+		glm::vec3 cameraPosition = glm::vec3(0.f);
+		glm::uvec2 textureDims = glm::uvec2(0u);
+
+		std::vector<glm::vec4> accumulation; // The alpha channel holds the number of samples
+		std::vector<float> secondMoment;
+		std::vector<Surface> surfaces;
+	};
+
+	// Finds where worldPosition lands in a view. Whole numbers are the pixels createRay shoots through (before AA jitter)
+	// Returns false if worldPosition is behind the camera
+	bool worldToPixel(const glm::mat4& viewProjection, const glm::vec3& worldPosition, glm::uvec2 textureDims, glm::vec2& outPixel);
+
+	// Disocclusion test, the history is only valid if its pixel saw the same surface
+	bool findHistoryPixel(const Surface& surface, const History& history, const Settings& settings, glm::uvec2& outPixel);
+
+	// Caps how many samples the history counts as, so shading changes from the new view still come through
+	float getHistoryWeight(float historySamples, float maxHistorySamples);
+
+	// Adds the history to an accumulation traced from the new view, surfaces are that view's first hits
+	// Returns the number of pixels that kept their history
+	uint32_t reprojectAccumulation(const History& history, std::span<const Surface> surfaces, const Settings& settings,
+		std::span<glm::vec4> accumulation, std::span<float> secondMoment);
+}
\ No newline at end of file
@@ -1,39 +1,385 @@
 #include "ResourceManager.h"
+#include "BvhBuilder.h"
 #include "Importer.h"
+#include "MeshProcessing.h"
+#include "OkmFile.h"
+#include "Threading.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb/stb_image.h"
 
+// A converted .okm next to the model file is mapped instead of importing the model, see OkmFile.h
+static bool tryReadOkm(std::string_view filePath, float scale, std::vector<OkmFile::Object>& outObjects)
+{
+	const std::string okmPath = OkmFile::getPath(filePath);
+
+	std::error_code errorCode;
+	if (!std::filesystem::exists(okmPath, errorCode))
+		return false;
+
+	// An .okm older than its model was converted before the model last changed. Without the model the .okm is all there is
+	const std::filesystem::file_time_type okmWriteTime = std::filesystem::last_write_time(okmPath, errorCode);
+	if (!errorCode && std::filesystem::exists(filePath, errorCode))
+	{
+		const std::filesystem::file_time_type sourceWriteTime = std::filesystem::last_write_time(filePath, errorCode);
+		if (!errorCode && sourceWriteTime > okmWriteTime)
+		{
+			printf("'%s' is older than '%s', importing '%s' instead\n", okmPath.c_str(), filePath.data(), filePath.data());
+			return false;
+		}
+	}
+
+	auto readStart = std::chrono::system_clock::now();
+
+	float okmScale = 1.f;
+	if (!OkmFile::read(okmPath, outObjects, &okmScale))
+	{
+		printf("Failed reading '%s', importing '%s' instead\n", okmPath.c_str(), filePath.data());
+		return false;
+	}
+
+	if (okmScale != scale)
+	{
+		printf("'%s' was converted with scale %.3f, importing '%s' with scale %.3f instead\n", okmPath.c_str(), okmScale, filePath.data(), scale);
+		outObjects.clear();
+		return false;
+	}
+
+	std::chrono::duration<float> readDuration = std::chrono::system_clock::now() - readStart;
+	if (!Importer::isQuiet())
+		printf("Okm read: %.3fms\n", readDuration.count() * 1000.f);
+
+	return true;
+}
+
+// Texture slots per object: albedo, roughness, metallic, specular & normal
+static const uint32_t NUM_TEXTURE_SLOTS = 5u;
+
+// Textures referenced as "textures/../textures/a.png" and "textures\\a.png" are the same file and get the same key
+static std::string normalizePath(std::string_view path)
+{
+	std::string genericPath(path);
+	std::replace(genericPath.begin(), genericPath.end(), '\\', '/');
+
+	return std::filesystem::path(genericPath).lexically_normal().generic_string();
+}
+
+// A small cube standing in for a mesh that's still loading
+static Mesh createPlaceholderMesh(std::string_view name)
+{
+	static const float HALF_SIZE = 0.5f;
+
+	MeshData meshData;
+
+	for (uint32_t axis = 0; axis < 3u; axis++)
+	{
+		for (float side : { -1.f, 1.f })
+		{
+			glm::vec3 normal = glm::vec3(0.f);
+			glm::vec3 tangent = glm::vec3(0.f);
+			normal[axis] = side;
+			tangent[(axis + 1u) % 3u] = 1.f;
+
+			Okay::VertexInfo vertexInfo;
+			vertexInfo.normal = normal;
+			vertexInfo.tangent = tangent;
+			vertexInfo.bitangent = glm::cross(normal, tangent);
+
+			const uint32_t firstVertex = (uint32_t)meshData.positions.size();
+
+			for (uint32_t corner = 0; corner < 4u; corner++)
+			{
+				vertexInfo.uv = glm::vec2(float(corner & 1u), float(corner >> 1u));
+
+				const glm::vec2 faceCoord = vertexInfo.uv * 2.f - 1.f;
+				meshData.positions.emplace_back((normal + vertexInfo.tangent * faceCoord.x + vertexInfo.bitangent * faceCoord.y) * HALF_SIZE);
+				meshData.vertexInfo.emplace_back(Okay::packVertexInfo(vertexInfo));
+				meshData.boundingBox.growTo(meshData.positions.back());
+			}
+
+			meshData.triangles.emplace_back(firstVertex, firstVertex + 2u, firstVertex + 1u);
+			meshData.triangles.emplace_back(firstVertex + 1u, firstVertex + 2u, firstVertex + 3u);
+		}
+	}
+
+	return Mesh(std::move(meshData), std::string(name));
+}
+
+// The geometry of an import, deduplicated but not added yet
+struct ResourceManager::ImportedMeshes
+{
+	std::vector<Importer::ObjectDecriptionStr> objects; // Names & texture paths, the MeshData is moved into the meshes
+	std::vector<Mesh> uniqueMeshes;
+
+	// Per object, which of the unique meshes it uses and where it's placed
+	std::vector<uint32_t> objectMeshIndices;
+	std::vector<glm::vec3> objectPositions;
+};
+
+struct ResourceManager::PendingTextures
+{
+	struct DecodedTexture
+	{
+		std::string path;
+		std::string key; // Normalized path, decoded from like in loadTexture()
+		Okay::PixelBuffer pixels; // Empty if the decode failed
+		int width = 0, height = 0;
+		float decodeTime = 0.f;
+		AssetID assetId;
+	};
+
+	// Unique paths that aren't loaded yet, in the order they first appear
+	std::vector<DecodedTexture> textures;
+
+	// Per path given to collectTextures(), the texture's AssetID once added. Paths still to be added are marked by their index in textures
+	std::vector<AssetID> textureIds;
+	std::vector<uint32_t> pendingIndices;
+};
+
+/*
+	Runs the loading part of the async requests on its own thread, in the order they were made.
+	The results are queued until processCompletedLoads() adds them on the main thread, the assets are never touched from here.
+*/
+struct ResourceManager::AsyncLoader
+{
+	enum class JobType
+	{
+		Mesh,
+		Texture,
+		Import,
+	};
+
+	struct Job
+	{
+		JobType type = JobType::Mesh;
+		std::string path;
+		std::string texturePath;
+		float scale = 1.f;
+		AssetID assetId; // The placeholder of mesh & texture loads
+		ImportSettings settings;
+		ImportCallback onImported;
+	};
+
+	struct Result
+	{
+		Job job;
+		bool success = false;
+		std::optional<Mesh> mesh;
+		ImportedMeshes imported;
+		PendingTextures textures;
+
+		// Move only, the decoded pixels can't be copied when the results grow
+		Result() = default;
+		Result(Result&&) noexcept = default;
+		Result& operator=(Result&&) noexcept = default;
+	};
+
+	AsyncLoader()
+		:thread(&AsyncLoader::run, this)
+	{ }
+
+	~AsyncLoader()
+	{
+		{
+			std::lock_guard lock(mutex);
+			stopping = true;
+		}
+
+		jobAdded.notify_one();
+		thread.join();
+	}
+
+	void push(Job&& job)
+	{
+		{
+			std::lock_guard lock(mutex);
+			jobs.emplace_back(std::move(job));
+			numPending++;
+		}
+
+		jobAdded.notify_one();
+	}
+
+	void run()
+	{
+		while (true)
+		{
+			Result result;
+
+			{
+				std::unique_lock lock(mutex);
+				jobAdded.wait(lock, [&]() { return stopping || !jobs.empty(); });
+
+				if (stopping)
+					return;
+
+				result.job = std::move(jobs.front());
+				jobs.pop_front();
+			}
+
+			load(result);
+
+			std::lock_guard lock(mutex);
+			results.emplace_back(std::move(result));
+		}
+	}
+
+	static void load(Result& result);
+
+	mutable std::mutex mutex;
+	std::condition_variable jobAdded;
+	std::deque<Job> jobs;
+	std::vector<Result> results;
+	uint32_t numPending = 0u;
+	bool stopping = false;
+
+	std::thread thread; // Last, the other members are constructed before it starts
+};
+
+// Prebuilds the trees in parallel when the settings ask for it
+static void prebuildBvhs(std::vector<Mesh>& meshes, const ResourceManager::ImportSettings& settings)
+{
+	if (!settings.bvhMaxLeafTriangles || !settings.bvhMaxDepth)
+		return;
+
+	auto buildStart = std::chrono::system_clock::now();
+
+	Okay::parallelFor((uint32_t)meshes.size(), [&](uint32_t i)
+		{
+			if (meshes[i].getPrebuiltBvh(settings.bvhMaxLeafTriangles, settings.bvhMaxDepth).empty())
+				meshes[i] = BvhBuilder(settings.bvhMaxLeafTriangles, settings.bvhMaxDepth).buildPrebuiltMesh(meshes[i]);
+		});
+
+	std::chrono::duration<float> buildDuration = std::chrono::system_clock::now() - buildStart;
+	if (!Importer::isQuiet())
+		printf("Bvh prebuild: %u meshes: %.3fms\n", (uint32_t)meshes.size(), buildDuration.count() * 1000.f);
+}
+
+void ResourceManager::AsyncLoader::load(Result& result)
+{
+	Job& job = result.job;
+
+	switch (job.type)
+	{
+	case JobType::Mesh:
+	{
+		std::vector<OkmFile::Object> okmObjects;
+		if (tryReadOkm(job.path, 1.f, okmObjects) && !okmObjects.empty())
+		{
+			result.mesh.emplace(std::move(okmObjects[0].mesh));
+		}
+		else
+		{
+			std::string name;
+			MeshData meshData;
+
+			if (!Importer::loadMesh(job.path, meshData, &name))
+				return;
+
+			result.mesh.emplace(std::move(meshData), name);
+		}
+
+		if (job.settings.bvhMaxLeafTriangles && job.settings.bvhMaxDepth)
+			result.mesh = BvhBuilder(job.settings.bvhMaxLeafTriangles, job.settings.bvhMaxDepth).buildPrebuiltMesh(*result.mesh);
+		break;
+	}
+
+	case JobType::Texture:
+	{
+		const std::string paths[1] = { job.path };
+		collectTextures(paths, nullptr, result.textures);
+		decodeTextures(result.textures);
+		break;
+	}
+
+	case JobType::Import:
+	{
+		if (!importMeshes(job.path, job.scale, job.settings, result.imported))
+			return;
+
+		prebuildBvhs(result.imported.uniqueMeshes, job.settings);
+
+		// Textures that are loaded by the time the result is added are freed again, the loaded ones can't be looked at from here
+		std::vector<std::string> texturePaths;
+		getTexturePaths(result.imported, job.texturePath, texturePaths);
+		collectTextures(texturePaths, nullptr, result.textures);
+		decodeTextures(result.textures);
+		break;
+	}
+	}
+
+	result.success = true;
+}
+
+ResourceManager::ResourceManager() = default;
+
+ResourceManager::~ResourceManager() = default;
+
+ResourceManager::ResourceManager(ResourceManager&& other) noexcept = default;
+
+ResourceManager& ResourceManager::operator=(ResourceManager&& other) noexcept = default;
+
 AssetID ResourceManager::loadMesh(std::string_view filePath)
 {
+	std::vector<OkmFile::Object> okmObjects;
+	if (tryReadOkm(filePath, 1.f, okmObjects) && !okmObjects.empty())
+	{
+		m_meshes.emplace_back(std::move(okmObjects[0].mesh));
+		return indexLastAsset<Mesh>(m_meshes.back().getName());
+	}
+
 	std::string name;
 	MeshData meshData;
 
 	bool success = Importer::loadMesh(filePath, meshData, &name);
 	OKAY_ASSERT(success);
 
-	m_meshes.emplace_back(meshData, name);
-	return AssetID(m_meshes.size() - 1);
+	m_meshes.emplace_back(std::move(meshData), name);
+	return indexLastAsset<Mesh>(name);
+}
+
+AssetID ResourceManager::addMesh(MeshData&& meshData, std::string_view name)
+{
+	m_meshes.emplace_back(std::move(meshData), std::string(name));
+	return indexLastAsset<Mesh>(name);
 }
 
 AssetID ResourceManager::loadTexture(std::string_view path)
 {
+	// Loaded through the normalized path, model files written on Windows use backslashes
+	const std::string key = normalizePath(path);
+
 	int width, height;
-	unsigned char* pData = stbi_load(path.data(), &width, &height, nullptr, STBI_rgb_alpha);
+	unsigned char* pData = stbi_load(key.c_str(), &width, &height, nullptr, STBI_rgb_alpha);
 
 	OKAY_ASSERT(pData);
 
-	std::string_view name = Okay::getFileName(path);
+	std::string_view name = Okay::getFileName(key);
 
 	m_textures.emplace_back(pData, (uint32_t)width, (uint32_t)height, name);
+	stbi_image_free(pData);
 
-	return AssetID(m_textures.size() - 1);
+	return indexLastAsset<Texture>(key);
 }
 
 AssetID ResourceManager::findOrLoadTexture(std::string_view path)
 {
-	std::string_view name = Okay::getFileName(path);
-	AssetID assetId = getAssetID<Texture>(name);
+	// Paths are usually already normal, only a miss pays for normalizing
+	AssetID assetId = getAssetID<Texture>(path);
+
+	if (!assetId)
+		assetId = getAssetID<Texture>(normalizePath(path));
 
 	if (assetId)
 		return assetId;
@@ -41,41 +387,493 @@ AssetID ResourceManager::findOrLoadTexture(std::string_view path)
 	return loadTexture(path);
 }
 
-bool ResourceManager::importAssets(std::string_view filePath, std::vector<ObjectDecription>& outObjects, std::string_view texturePath, float scale)
+void ResourceManager::findOrLoadTextures(std::span<const std::string> paths, std::vector<AssetID>& outTextureIds)
 {
-	std::vector<Importer::ObjectDecriptionStr> outAssets;
+	PendingTextures pending;
+	collectTextures(paths, &m_textureIndex, pending);
+	decodeTextures(pending);
+	addDecodedTextures(pending);
 
-	if (!Importer::loadObjects(filePath, outAssets, scale))
-		return false;
+	outTextureIds = std::move(pending.textureIds);
+}
+
+void ResourceManager::collectTextures(std::span<const std::string> paths, const AssetIndex* pLoadedTextures, PendingTextures& outPending)
+{
+	auto findLoaded = [&](std::string_view key)
+		{
+			if (!pLoadedTextures)
+				return AssetID();
+
+			auto iterator = pLoadedTextures->find(key);
+			return iterator != pLoadedTextures->end() ? iterator->second : AssetID();
+		};
 
-	outObjects.resize(outAssets.size());
+	outPending.textureIds.assign(paths.size(), AssetID());
+	outPending.pendingIndices.assign(paths.size(), Okay::INVALID_UINT);
+	outPending.textures.reserve(paths.size());
 
-	std::string texturePathStr = texturePath.data();
+	std::unordered_map<std::string_view, uint32_t> pendingLookup; // Views the keys, reserved above so they never move
 
-	for (uint32_t i = 0; i < outAssets.size(); i++)
+	for (uint32_t i = 0; i < (uint32_t)paths.size(); i++)
 	{
-		ObjectDecription& outObjectDesc = outObjects[i];
+		const std::string& path = paths[i];
+		if (path.empty())
+			continue;
+
+		if ((outPending.textureIds[i] = findLoaded(path)))
+			continue;
+
+		std::string key = normalizePath(path);
+		if ((outPending.textureIds[i] = findLoaded(key)))
+			continue;
+
+		auto iterator = pendingLookup.find(key);
+		if (iterator != pendingLookup.end())
+		{
+			outPending.pendingIndices[i] = iterator->second;
+			continue;
+		}
+
+		outPending.pendingIndices[i] = (uint32_t)outPending.textures.size();
+
+		PendingTextures::DecodedTexture& texture = outPending.textures.emplace_back();
+		texture.path = path;
+		texture.key = std::move(key);
+		pendingLookup.emplace(texture.key, outPending.pendingIndices[i]);
+	}
+}
+
+void ResourceManager::decodeTextures(PendingTextures& pending)
+{
+	if (pending.textures.empty())
+		return;
+
+	auto decodeStart = std::chrono::system_clock::now();
+
+	Okay::parallelFor((uint32_t)pending.textures.size(), [&](uint32_t i)
+		{
+			PendingTextures::DecodedTexture& texture = pending.textures[i];
+
+			auto textureStart = std::chrono::system_clock::now();
+
+			// Copied into the texture arena right away, stb's own allocation doesn't outlive the decode
+			if (unsigned char* pData = stbi_load(texture.key.c_str(), &texture.width, &texture.height, nullptr, STBI_rgb_alpha))
+			{
+				texture.pixels = Okay::PixelBuffer(pData, (uint64_t)texture.width * texture.height * 4u);
+				stbi_image_free(pData);
+			}
+
+			std::chrono::duration<float> textureDuration = std::chrono::system_clock::now() - textureStart;
+			texture.decodeTime = textureDuration.count() * 1000.f;
+		});
+
+	std::chrono::duration<float> decodeDuration = std::chrono::system_clock::now() - decodeStart;
+
+	if (Importer::isQuiet())
+		return;
 
-		Importer::ObjectDecriptionStr& objectDescStr = outAssets[i];
+	std::vector<float> decodeTimes;
+	decodeTimes.reserve(pending.textures.size());
 
-		m_meshes.emplace_back(objectDescStr.meshData, objectDescStr.name);
-		outObjectDesc.meshId = AssetID(m_meshes.size() - 1);
+	float decodeTimeSum = 0.f;
+	for (const PendingTextures::DecodedTexture& texture : pending.textures)
+	{
+		decodeTimes.emplace_back(texture.decodeTime);
+		decodeTimeSum += texture.decodeTime;
+	}
+
+	std::sort(decodeTimes.begin(), decodeTimes.end());
+
+	printf("Texture decode: %u textures: %.3fms (per texture min %.3fms, median %.3fms, p90 %.3fms, max %.3fms, sum %.3fms)\n",
+		(uint32_t)decodeTimes.size(), decodeDuration.count() * 1000.f, decodeTimes.front(), decodeTimes[decodeTimes.size() / 2u],
+		decodeTimes[decodeTimes.size() * 9u / 10u], decodeTimes.back(), decodeTimeSum);
+}
 
-		if (objectDescStr.albedoTexturePath != "")
-			outObjectDesc.albedoTextureId = findOrLoadTexture(texturePathStr == "" ? objectDescStr.albedoTexturePath : texturePathStr + objectDescStr.albedoTexturePath);
+uint32_t ResourceManager::addDecodedTextures(PendingTextures& pending)
+{
+	// Added in order so the AssetIDs don't depend on which decode finished first
+	m_textures.reserve(m_textures.size() + pending.textures.size());
+
+	uint32_t numAdded = 0u;
+
+	for (PendingTextures::DecodedTexture& texture : pending.textures)
+	{
+		// Left without a texture, like a material that never had one
+		if (!texture.pixels.getData())
+		{
+			printf("Failed to load texture '%s'\n", texture.path.c_str());
+			continue;
+		}
 
-		if (objectDescStr.rougnessTexturePath != "")
-			outObjectDesc.rougnessTextureId = findOrLoadTexture(texturePathStr == "" ? objectDescStr.rougnessTexturePath : texturePathStr + objectDescStr.rougnessTexturePath);
+		// Decoded on the loader thread while it was loaded here, the decoded pixels are freed with the pending textures
+		if ((texture.assetId = getAssetID<Texture>(texture.key)))
+			continue;
 
-		if (objectDescStr.metallicTexturePath != "")
-			outObjectDesc.metallicTextureId = findOrLoadTexture(texturePathStr == "" ? objectDescStr.metallicTexturePath : texturePathStr + objectDescStr.metallicTexturePath);
+		m_textures.emplace_back(std::move(texture.pixels), (uint32_t)texture.width, (uint32_t)texture.height, Okay::getFileName(texture.key));
+		texture.assetId = indexLastAsset<Texture>(texture.key);
 
-		if (objectDescStr.specularTexturePath != "")
-			outObjectDesc.specularTextureId = findOrLoadTexture(texturePathStr == "" ? objectDescStr.specularTexturePath : texturePathStr + objectDescStr.specularTexturePath);
+		numAdded++;
+	}
 
-		if (objectDescStr.normalTexturePath != "")
-			outObjectDesc.normalTextureId = findOrLoadTexture(texturePathStr == "" ? objectDescStr.normalTexturePath : texturePathStr + objectDescStr.normalTexturePath);
+	for (uint32_t i = 0; i < (uint32_t)pending.textureIds.size(); i++)
+	{
+		if (pending.pendingIndices[i] != Okay::INVALID_UINT)
+			pending.textureIds[i] = pending.textures[pending.pendingIndices[i]].assetId;
+	}
+
+	return numAdded;
+}
+
+bool ResourceManager::importMeshes(std::string_view filePath, float scale, const ImportSettings& settings, ImportedMeshes& outImported)
+{
+	std::vector<Importer::ObjectDecriptionStr>& outAssets = outImported.objects;
+	std::vector<OkmFile::Object> okmObjects;
+
+	std::vector<std::optional<Mesh>> importedMeshes;
+
+	if (tryReadOkm(filePath, scale, okmObjects))
+	{
+		// The meshes view the mapped file, only the texture paths are taken out for the loop below
+		outAssets.resize(okmObjects.size());
+		importedMeshes.resize(okmObjects.size());
+
+		for (uint32_t i = 0; i < (uint32_t)okmObjects.size(); i++)
+		{
+			OkmFile::Object& okmObject = okmObjects[i];
+			Importer::ObjectDecriptionStr& objectDescStr = outAssets[i];
+
+			objectDescStr.name = okmObject.mesh.getName();
+			objectDescStr.albedoTexturePath = std::move(okmObject.albedoTexturePath);
+			objectDescStr.rougnessTexturePath = std::move(okmObject.rougnessTexturePath);
+			objectDescStr.metallicTexturePath = std::move(okmObject.metallicTexturePath);
+			objectDescStr.specularTexturePath = std::move(okmObject.specularTexturePath);
+			objectDescStr.normalTexturePath = std::move(okmObject.normalTexturePath);
+
+			importedMeshes[i].emplace(std::move(okmObject.mesh));
+		}
+	}
+	else
+	{
+		if (!Importer::loadObjects(filePath, outAssets, scale))
+			return false;
+
+		// Built in parallel, then kept in import order so the AssetIDs don't depend on the thread timings
+		// The MeshData is moved into the meshes, the imported geometry is never copied
+		auto meshBuildStart = std::chrono::system_clock::now();
+
+		const float weldEpsilon = settings.weldEpsilon;
+		std::atomic<uint32_t> numWeldedVerticies = 0u;
+
+		importedMeshes.resize(outAssets.size());
+		Okay::parallelFor((uint32_t)outAssets.size(), [&](uint32_t i)
+			{
+				if (weldEpsilon >= 0.f)
+					numWeldedVerticies += MeshProcessing::weldVertices(outAssets[i].meshData, weldEpsilon);
+
+				importedMeshes[i].emplace(std::move(outAssets[i].meshData), outAssets[i].name);
+			});
+
+		std::chrono::duration<float> meshBuildDuration = std::chrono::system_clock::now() - meshBuildStart;
+		if (!Importer::isQuiet())
+			printf("Mesh build: %.3fms (%u vertices welded)\n", meshBuildDuration.count() * 1000.f, numWeldedVerticies.load());
+	}
+
+	outImported.objectMeshIndices.resize(importedMeshes.size());
+	outImported.objectPositions.assign(importedMeshes.size(), glm::vec3(0.f));
+
+	std::vector<uint32_t>& objectMeshIndices = outImported.objectMeshIndices;
+	std::vector<glm::vec3>& objectPositions = outImported.objectPositions;
+	uint32_t numUniqueMeshes = 0u;
+
+	if (settings.deduplicateMeshes)
+	{
+		auto dedupeStart = std::chrono::system_clock::now();
+
+		std::vector<uint64_t> hashes(importedMeshes.size());
+		Okay::parallelFor((uint32_t)importedMeshes.size(), [&](uint32_t i)
+			{
+				hashes[i] = MeshProcessing::hashGeometry(*importedMeshes[i]);
+			});
+
+		// Index into importedMeshes of every unique mesh, per hash. Different meshes can share a hash, so it's only a shortlist
+		std::unordered_map<uint64_t, std::vector<uint32_t>> uniqueMeshes;
+		uniqueMeshes.reserve(importedMeshes.size());
+
+		std::vector<uint32_t> uniqueIndices(importedMeshes.size());
+
+		for (uint32_t i = 0; i < (uint32_t)importedMeshes.size(); i++)
+		{
+			std::vector<uint32_t>& candidates = uniqueMeshes[hashes[i]];
+
+			bool isCopy = false;
+			for (uint32_t candidate : candidates)
+			{
+				glm::vec3 translation = glm::vec3(0.f);
+				if (MeshProcessing::isTranslatedCopy(*importedMeshes[candidate], *importedMeshes[i], translation))
+				{
+					objectMeshIndices[i] = uniqueIndices[candidate];
+					objectPositions[i] = translation;
+					importedMeshes[i].reset();
+					isCopy = true;
+					break;
+				}
+			}
+
+			if (isCopy)
+				continue;
+
+			candidates.emplace_back(i);
+			uniqueIndices[i] = numUniqueMeshes;
+			objectMeshIndices[i] = numUniqueMeshes++;
+		}
+
+		std::chrono::duration<float> dedupeDuration = std::chrono::system_clock::now() - dedupeStart;
+		if (!Importer::isQuiet())
+			printf("Mesh dedupe: %u of %u meshes shared: %.3fms\n", (uint32_t)importedMeshes.size() - numUniqueMeshes, (uint32_t)importedMeshes.size(), dedupeDuration.count() * 1000.f);
+	}
+	else
+	{
+		for (uint32_t i = 0; i < (uint32_t)importedMeshes.size(); i++)
+			objectMeshIndices[i] = numUniqueMeshes++;
+	}
+
+	outImported.uniqueMeshes.reserve(numUniqueMeshes);
+
+	for (std::optional<Mesh>& mesh : importedMeshes)
+	{
+		if (mesh)
+			outImported.uniqueMeshes.emplace_back(std::move(*mesh));
 	}
 
 	return true;
 }
+
+void ResourceManager::getTexturePaths(const ImportedMeshes& imported, std::string_view texturePath, std::vector<std::string>& outPaths)
+{
+	// Every object's texture slots in one list, so the new textures are decoded together
+	const std::string texturePathStr = texturePath.data();
+	outPaths.assign(imported.objects.size() * NUM_TEXTURE_SLOTS, "");
+
+	for (uint32_t i = 0; i < (uint32_t)imported.objects.size(); i++)
+	{
+		const Importer::ObjectDecriptionStr& objectDescStr = imported.objects[i];
+		std::string* pSlotPaths = outPaths.data() + i * NUM_TEXTURE_SLOTS;
+
+		const std::string* pTexturePaths[NUM_TEXTURE_SLOTS] = { &objectDescStr.albedoTexturePath, &objectDescStr.rougnessTexturePath,
+			&objectDescStr.metallicTexturePath, &objectDescStr.specularTexturePath, &objectDescStr.normalTexturePath };
+
+		for (uint32_t j = 0; j < NUM_TEXTURE_SLOTS; j++)
+		{
+			if (*pTexturePaths[j] != "")
+				pSlotPaths[j] = texturePathStr == "" ? *pTexturePaths[j] : texturePathStr + *pTexturePaths[j];
+		}
+	}
+}
+
+void ResourceManager::addImportedAssets(ImportedMeshes& imported, PendingTextures& textures, std::vector<ObjectDecription>& outObjects)
+{
+	const uint32_t firstMeshIdx = (uint32_t)m_meshes.size();
+	m_meshes.reserve(m_meshes.size() + imported.uniqueMeshes.size());
+
+	for (const Mesh& mesh : imported.uniqueMeshes)
+	{
+		m_meshes.emplace_back(mesh);
+		indexLastAsset<Mesh>(mesh.getName());
+	}
+
+	addDecodedTextures(textures);
+
+	outObjects.resize(imported.objects.size());
+
+	for (uint32_t i = 0; i < (uint32_t)imported.objects.size(); i++)
+	{
+		ObjectDecription& outObjectDesc = outObjects[i];
+		const AssetID* pSlotIds = textures.textureIds.data() + i * NUM_TEXTURE_SLOTS;
+
+		outObjectDesc.name = imported.objects[i].name;
+		outObjectDesc.meshId = AssetID(firstMeshIdx + imported.objectMeshIndices[i]);
+		outObjectDesc.position = imported.objectPositions[i];
+
+		outObjectDesc.albedoTextureId = pSlotIds[0];
+		outObjectDesc.rougnessTextureId = pSlotIds[1];
+		outObjectDesc.metallicTextureId = pSlotIds[2];
+		outObjectDesc.specularTextureId = pSlotIds[3];
+		outObjectDesc.normalTextureId = pSlotIds[4];
+	}
+}
+
+bool ResourceManager::importAssets(std::string_view filePath, std::vector<ObjectDecription>& outObjects, std::string_view texturePath, float scale)
+{
+	ImportedMeshes imported;
+	if (!importMeshes(filePath, scale, m_importSettings, imported))
+		return false;
+
+	std::vector<std::string> texturePaths;
+	getTexturePaths(imported, texturePath, texturePaths);
+
+	PendingTextures textures;
+	collectTextures(texturePaths, &m_textureIndex, textures);
+	decodeTextures(textures);
+
+	addImportedAssets(imported, textures, outObjects);
+
+	return true;
+}
+
+ResourceManager::AsyncLoader& ResourceManager::getAsyncLoader()
+{
+	if (!m_pAsyncLoader)
+		m_pAsyncLoader = std::make_unique<AsyncLoader>();
+
+	return *m_pAsyncLoader;
+}
+
+AssetID ResourceManager::loadMeshAsync(std::string_view path)
+{
+	m_meshes.emplace_back(createPlaceholderMesh(Okay::getFileName(path)));
+	const AssetID assetId = AssetID(m_meshes.size() - 1);
+
+	AsyncLoader::Job job;
+	job.type = AsyncLoader::JobType::Mesh;
+	job.path = path;
+	job.assetId = assetId;
+	job.settings = m_importSettings;
+
+	getAsyncLoader().push(std::move(job));
+
+	return assetId;
+}
+
+AssetID ResourceManager::loadTextureAsync(std::string_view path)
+{
+	const std::string key = normalizePath(path);
+
+	if (AssetID assetId = getAssetID<Texture>(key))
+		return assetId;
+
+	// Mid grey, replaced by the decoded texture once it's done
+	static const unsigned char PLACEHOLDER_PIXEL[4] = { 128u, 128u, 128u, 255u };
+	m_textures.emplace_back(PLACEHOLDER_PIXEL, 1u, 1u, Okay::getFileName(key));
+
+	// Indexed right away so the texture isn't requested twice
+	const AssetID assetId = indexLastAsset<Texture>(key);
+
+	AsyncLoader::Job job;
+	job.type = AsyncLoader::JobType::Texture;
+	job.path = path;
+	job.assetId = assetId;
+
+	getAsyncLoader().push(std::move(job));
+
+	return assetId;
+}
+
+void ResourceManager::importAssetsAsync(std::string_view filePath, ImportCallback onImported, std::string_view texturePath, float scale)
+{
+	AsyncLoader::Job job;
+	job.type = AsyncLoader::JobType::Import;
+	job.path = filePath;
+	job.texturePath = texturePath;
+	job.scale = scale;
+	job.settings = m_importSettings;
+	job.onImported = std::move(onImported);
+
+	getAsyncLoader().push(std::move(job));
+}
+
+ResourceManager::CompletedLoads ResourceManager::processCompletedLoads()
+{
+	CompletedLoads completedLoads;
+
+	if (!m_pAsyncLoader)
+		return completedLoads;
+
+	std::vector<AsyncLoader::Result> results;
+	{
+		std::lock_guard lock(m_pAsyncLoader->mutex);
+		results.swap(m_pAsyncLoader->results);
+		m_pAsyncLoader->numPending -= (uint32_t)results.size();
+	}
+
+	for (AsyncLoader::Result& result : results)
+	{
+		AsyncLoader::Job& job = result.job;
+
+		if (!result.success)
+		{
+			printf("Failed to load '%s', %s\n", job.path.c_str(), job.type == AsyncLoader::JobType::Import ? "nothing was added" : "keeping the placeholder");
+			continue;
+		}
+
+		switch (job.type)
+		{
+		case AsyncLoader::JobType::Mesh:
+			m_meshes[job.assetId] = *result.mesh;
+			getIndex<Mesh>().try_emplace(result.mesh->getName(), job.assetId);
+			completedLoads.replacedMeshes.emplace_back(job.assetId);
+			completedLoads.numMeshes++;
+			break;
+
+		case AsyncLoader::JobType::Texture:
+		{
+			PendingTextures::DecodedTexture& texture = result.textures.textures[0];
+			if (!texture.pixels.getData())
+			{
+				printf("Failed to load texture '%s', keeping the placeholder\n", texture.path.c_str());
+				break;
+			}
+
+			// The move frees the placeholder's pixels
+			m_textures[job.assetId] = Texture(std::move(texture.pixels), (uint32_t)texture.width, (uint32_t)texture.height, Okay::getFileName(texture.key));
+			completedLoads.replacedTextures.emplace_back(job.assetId);
+			completedLoads.numTextures++;
+			break;
+		}
+
+		case AsyncLoader::JobType::Import:
+		{
+			const uint32_t numTextures = (uint32_t)m_textures.size();
+
+			std::vector<ObjectDecription> objects;
+			addImportedAssets(result.imported, result.textures, objects);
+
+			completedLoads.numMeshes += (uint32_t)result.imported.uniqueMeshes.size();
+			completedLoads.numTextures += (uint32_t)m_textures.size() - numTextures;
+			completedLoads.numImports++;
+
+			if (job.onImported)
+				job.onImported(objects);
+			break;
+		}
+		}
+	}
+
+	return completedLoads;
+}
+
+bool ResourceManager::hasCompletedLoads() const
+{
+	if (!m_pAsyncLoader)
+		return false;
+
+	std::lock_guard lock(m_pAsyncLoader->mutex);
+	return !m_pAsyncLoader->results.empty();
+}
+
+uint32_t ResourceManager::getNumPendingLoads() const
+{
+	if (!m_pAsyncLoader)
+		return 0u;
+
+	std::lock_guard lock(m_pAsyncLoader->mutex);
+	return m_pAsyncLoader->numPending;
+}
+
+bool ResourceManager::isLoading() const
+{
+	if (!m_pAsyncLoader)
+		return false;
+
+	std::lock_guard lock(m_pAsyncLoader->mutex);
+	return m_pAsyncLoader->numPending > (uint32_t)m_pAsyncLoader->results.size();
+}
@@ -5,7 +5,11 @@
 #include "Mesh.h"
 #include "Texture.h"
 
+#include <functional>
+#include <memory>
+#include <span>
 #include <string_view>
+#include <unordered_map>
 #include <vector>
 
 class ResourceManager
@@ -20,26 +24,81 @@ public:
 		AssetID metallicTextureId;
 		AssetID specularTextureId;
 		AssetID normalTextureId;
+
+		// Where the mesh is placed, non-zero when the object shares the mesh of an earlier translated copy
+		glm::vec3 position = glm::vec3(0.f);
+	};
+
+	struct ImportSettings
+	{
+		float weldEpsilon = 0.f; // Vertices closer than this are merged, 0 only merges exact duplicates, negative turns it off
+		bool deduplicateMeshes = true; // Translated copies of a mesh share one Mesh (and BLAS), the copies become positions
+
+		// Async loads build the tree of every mesh on the loader thread with these settings (see Mesh::getPrebuiltBvh),
+		// the tracers then reuse them instead of building them when the meshes are added. 0 turns it off
+		uint32_t bvhMaxLeafTriangles = 0u;
+		uint32_t bvhMaxDepth = 0u;
+	};
+
+	// Called by processCompletedLoads() with the objects of an async import
+	using ImportCallback = std::function<void(const std::vector<ObjectDecription>& objects)>;
+
+	// What a processCompletedLoads() call changed
+	struct CompletedLoads
+	{
+		uint32_t numMeshes = 0u; // Replaced placeholders and meshes added by imports
+		uint32_t numTextures = 0u;
+		uint32_t numImports = 0u;
+
+		// The placeholders that were swapped for what they stood in for, the imported assets are added after the existing ones instead
+		std::vector<AssetID> replacedMeshes;
+		std::vector<AssetID> replacedTextures;
 	};
 
 public:
-	ResourceManager() = default;
-	~ResourceManager() = default;
+	ResourceManager();
+	~ResourceManager();
+
+	ResourceManager(ResourceManager&& other) noexcept;
+	ResourceManager& operator=(ResourceManager&& other) noexcept;
 
 	AssetID loadMesh(std::string_view path);
+	AssetID addMesh(MeshData&& meshData, std::string_view name); // For meshes built in code
 	AssetID loadTexture(std::string_view path);
-	AssetID findOrLoadTexture(std::string_view path);
+	AssetID findOrLoadTexture(std::string_view path); // Textures are keyed on their normalized path, the same file is only loaded once
+
+	// findOrLoadTexture for every path, the new textures are decoded in parallel and added in the order they first appear.
+	// Empty paths get an invalid AssetID
+	void findOrLoadTextures(std::span<const std::string> paths, std::vector<AssetID>& outTextureIds);
 
 	bool importAssets(std::string_view filePath, std::vector<ObjectDecription>& outObjects, std::string_view texturePath = "", float scale = 1.f);
 
+	inline ImportSettings& getImportSettings();
+
+	/*
+		Async loading, the calls return at once and the loading is done on a background thread one request at a time.
+		loadMeshAsync & loadTextureAsync return the AssetID right away, a small placeholder asset stands in until it's loaded.
+		Nothing changes until processCompletedLoads() is called, so the assets can be used from any thread in between.
+	*/
+	AssetID loadMeshAsync(std::string_view path);
+	AssetID loadTextureAsync(std::string_view path);
+	void importAssetsAsync(std::string_view filePath, ImportCallback onImported, std::string_view texturePath = "", float scale = 1.f);
+
+	// Call once per frame. Swaps in what finished loading since the last call, in the order it was requested, and calls the import callbacks
+	CompletedLoads processCompletedLoads();
+	bool hasCompletedLoads() const;
+	uint32_t getNumPendingLoads() const; // Requested but not swapped in yet
+	bool isLoading() const; // Requests are still being loaded, the completed ones waiting for processCompletedLoads() don't count
+
 	template<typename Asset>
 	inline Asset& getAsset(AssetID id);
 
 	template<typename Asset>
 	inline const Asset& getAsset(AssetID id) const;
 
+	// Meshes are found by name, textures by their normalized path (see findOrLoadTexture). The first asset added with a key is returned
 	template<typename Asset>
-	inline AssetID getAssetID(std::string_view name);
+	inline AssetID getAssetID(std::string_view key);
 
 	template<typename Asset>
 	inline uint32_t getCount() const;
@@ -48,9 +107,45 @@ public:
 	inline const std::vector<Asset>& getAll() const;
 
 private:
+	// Transparent so lookups take a string_view without building a std::string
+	struct StringHash
+	{
+		using is_transparent = void;
+		inline size_t operator()(std::string_view string) const { return std::hash<std::string_view>()(string); }
+	};
+
+	using AssetIndex = std::unordered_map<std::string, AssetID, StringHash, std::equal_to<>>;
+
 	std::vector<Mesh> m_meshes;
 	std::vector<Texture> m_textures;
 
+	AssetIndex m_meshIndex;
+	AssetIndex m_textureIndex;
+
+	ImportSettings m_importSettings;
+
+	struct AsyncLoader;
+	struct ImportedMeshes;
+	struct PendingTextures;
+
+	std::unique_ptr<AsyncLoader> m_pAsyncLoader; // Started by the first async request
+	AsyncLoader& getAsyncLoader();
+
+	// The parts of importAssets() and findOrLoadTextures() that don't touch the assets also run on the loader thread
+	static bool importMeshes(std::string_view filePath, float scale, const ImportSettings& settings, ImportedMeshes& outImported);
+	static void getTexturePaths(const ImportedMeshes& imported, std::string_view texturePath, std::vector<std::string>& outPaths);
+	static void collectTextures(std::span<const std::string> paths, const AssetIndex* pLoadedTextures, PendingTextures& outPending);
+	static void decodeTextures(PendingTextures& pending);
+
+	uint32_t addDecodedTextures(PendingTextures& pending); // Returns the number of new textures
+	void addImportedAssets(ImportedMeshes& imported, PendingTextures& textures, std::vector<ObjectDecription>& outObjects);
+
+	// Adds the latest asset of the type to the index
+	template<typename Asset>
+	inline AssetID indexLastAsset(std::string_view key);
+
+	template<typename Asset>
+	inline AssetIndex& getIndex();
 
 	template<typename Asset>
 	inline std::vector<Asset>& getAssets();
@@ -65,6 +160,11 @@ static_assert(std::is_same<Asset, Mesh>() || \
 			  "Invalid Asset type")
 
 // Public:
+inline ResourceManager::ImportSettings& ResourceManager::getImportSettings()
+{
+	return m_importSettings;
+}
+
 template<typename Asset>
 inline Asset& ResourceManager::getAsset(AssetID id)
 {
@@ -86,22 +186,13 @@ inline const Asset& ResourceManager::getAsset(AssetID id) const
 }
 
 template<typename Asset>
-inline AssetID ResourceManager::getAssetID(std::string_view name)
+inline AssetID ResourceManager::getAssetID(std::string_view key)
 {
 	STATIC_ASSERT_ASSET_TYPE();
-	std::vector<Asset>& assets = getAssets<Asset>();
+	AssetIndex& index = getIndex<Asset>();
 
-	for (uint32_t i = 0; i < (uint32_t)assets.size(); i++)
-	{
-		const Asset& asset = assets[i];
-
-		if (asset.getName() == name)
-		{
-			return AssetID(i);
-		}
-	}
-
-	return AssetID();
+	auto iterator = index.find(key);
+	return iterator != index.end() ? iterator->second : AssetID();
 }
 
 template<typename Asset>
@@ -137,4 +228,29 @@ inline const std::vector<Asset>& ResourceManager::getAssetsConst() const
 {
 	STATIC_ASSERT_ASSET_TYPE();
 	return const_cast<ResourceManager*>(this)->getAssets<Asset>();
+}
+
+template<typename Asset>
+inline AssetID ResourceManager::indexLastAsset(std::string_view key)
+{
+	STATIC_ASSERT_ASSET_TYPE();
+	AssetID assetId = AssetID(getAssets<Asset>().size() - 1);
+
+	AssetIndex& index = getIndex<Asset>();
+	if (index.find(key) == index.end())
+		index.emplace(key, assetId);
+
+	return assetId;
+}
+
+template<typename Asset>
+inline ResourceManager::AssetIndex& ResourceManager::getIndex()
+{
+	STATIC_ASSERT_ASSET_TYPE();
+
+	if constexpr (std::is_same<Asset, Mesh>())
+		return m_meshIndex;
+
+	else if constexpr (std::is_same<Asset, Texture>())
+		return m_textureIndex;
 }
\ No newline at end of file
@@ -0,0 +1,257 @@
+#include "Sampler.h"
+#include "shaders/ShaderResourceRegisters.h"
+
+#include "glm/gtc/constants.hpp"
+
+#include <cfloat>
+
+static uint32_t pcgHash(uint32_t& seed)
+{
+	// Same as pcg_hash in GPU-Utilities.hlsli
+	seed *= 747796405u + 2891336453u;
+	seed = ((seed >> ((seed >> 28u) + 4u)) ^ seed) * 277803737u;
+	seed = (seed >> 22u) ^ seed;
+	return seed;
+}
+
+static uint32_t pcgHash2(uint32_t seed)
+{
+	return pcgHash(seed);
+}
+
+static uint32_t reverseBits(uint32_t x)
+{
+	x = ((x >> 1u) & 0x55555555u) | ((x & 0x55555555u) << 1u);
+	x = ((x >> 2u) & 0x33333333u) | ((x & 0x33333333u) << 2u);
+	x = ((x >> 4u) & 0x0F0F0F0Fu) | ((x & 0x0F0F0F0Fu) << 4u);
+	x = ((x >> 8u) & 0x00FF00FFu) | ((x & 0x00FF00FFu) << 8u);
+	return (x >> 16u) | (x << 16u);
+}
+
+// Ty Burley, "Practical Hash-based Owen Scrambling"
+static uint32_t laineKarrasPermutation(uint32_t x, uint32_t seed)
+{
+	x += seed;
+	x ^= x * 0x6c50b47cu;
+	x ^= x * 0xb82f1e52u;
+	x ^= x * 0xc7afe638u;
+	x ^= x * 0x8d22f6e6u;
+	return x;
+}
+
+static uint32_t nestedUniformScramble(uint32_t x, uint32_t seed)
+{
+	return reverseBits(laineKarrasPermutation(reverseBits(x), seed));
+}
+
+// The first Sobol dimension is just reverseBits(index), the second one has direction numbers v[i+1] = v[i] ^ (v[i] >> 1)
+static uint32_t sobolSecondDimension(uint32_t index)
+{
+	uint32_t result = 0u;
+	uint32_t direction = 1u << 31u;
+
+	for (; index; index >>= 1u)
+	{
+		if (index & 1u)
+			result ^= direction;
+
+		direction ^= direction >> 1u;
+	}
+
+	return result;
+}
+
+static float toUnitFloat(uint32_t bits)
+{
+	// Top 24 bits so the result never rounds up to 1
+	return (bits >> 8u) * (1.f / 16777216.f);
+}
+
+Sampler::Sampler(Type type, glm::uvec2 pixel, uint32_t width, uint32_t sampleIdx, const float* pBlueNoise)
+	:m_type(type), m_pixel(pixel), m_seed(0u), m_sampleIdx(sampleIdx), m_dimension(0u), m_pBlueNoise(pBlueNoise)
+{
+	if (m_type == Type::Random)
+		m_seed = pixel.x + (pixel.y + 74813u) * width * (sampleIdx + 1u);
+	else
+		m_seed = pcgHash2(pixel.x + pixel.y * width);
+}
+
+float Sampler::next()
+{
+	float value = 0.f;
+
+	switch (m_type)
+	{
+	case Type::Random:
+		value = pcgHash(m_seed) / (float)UINT32_MAX;
+		break;
+
+	case Type::Sobol:
+	{
+		// Every pair of dimensions gets its own shuffled & scrambled 2D Sobol sequence
+		const uint32_t component = m_dimension & 1u;
+		const uint32_t pairSeed = pcgHash2(m_seed ^ pcgHash2(m_dimension >> 1u));
+		const uint32_t index = nestedUniformScramble(m_sampleIdx, pairSeed);
+
+		uint32_t bits = component ? sobolSecondDimension(index) : reverseBits(index);
+		bits = nestedUniformScramble(bits, pcgHash2(pairSeed + component + 1u));
+
+		value = toUnitFloat(bits);
+		break;
+	}
+
+	case Type::BlueNoise:
+	{
+		// R2 sequence offsets the tile per dimension, golden ratio rotation per sample
+		const float offsetX = (m_dimension * 0xC13FA9A9u) * (1.f / 4294967296.f);
+		const float offsetY = (m_dimension * 0x91E10DA5u) * (1.f / 4294967296.f);
+		const uint32_t x = (m_pixel.x + uint32_t(offsetX * BLUE_NOISE_TILE_SIZE)) % BLUE_NOISE_TILE_SIZE;
+		const uint32_t y = (m_pixel.y + uint32_t(offsetY * BLUE_NOISE_TILE_SIZE)) % BLUE_NOISE_TILE_SIZE;
+
+		const float rotation = toUnitFloat(m_sampleIdx * 0x9E3779B9u);
+		value = glm::fract(m_pBlueNoise[y * BLUE_NOISE_TILE_SIZE + x] + rotation);
+		break;
+	}
+	}
+
+	m_dimension++;
+	return value;
+}
+
+glm::vec2 Sampler::pointInCircle()
+{
+	float angle = next() * 2.f * glm::pi<float>();
+	float radius = glm::sqrt(next());
+	return glm::vec2(glm::cos(angle), glm::sin(angle)) * radius;
+}
+
+glm::vec3 Sampler::unitVector()
+{
+	// Two dimensions instead of three normal distributions keeps the low discrepancy samplers well stratified
+	float z = 1.f - 2.f * next();
+	float angle = next() * 2.f * glm::pi<float>();
+	float radius = glm::sqrt(glm::max(1.f - z * z, 0.f));
+	return glm::vec3(glm::cos(angle) * radius, glm::sin(angle) * radius, z);
+}
+
+void Sampler::generateBlueNoise(uint32_t size, std::vector<float>& outValues)
+{
+	const uint32_t count = size * size;
+	const float SIGMA = 1.5f;
+
+	// Gaussian energy kernel that wraps around the edges, so the tile repeats without seams
+	std::vector<float> kernel(count);
+	for (uint32_t y = 0; y < size; y++)
+	{
+		for (uint32_t x = 0; x < size; x++)
+		{
+			float dx = (float)glm::min(x, size - x);
+			float dy = (float)glm::min(y, size - y);
+			kernel[y * size + x] = glm::exp(-(dx * dx + dy * dy) / (2.f * SIGMA * SIGMA));
+		}
+	}
+
+	std::vector<uint8_t> pattern(count, 0u);
+	std::vector<float> energy(count, 0.f);
+
+	auto splat = [&](uint32_t idx, float sign)
+		{
+			const uint32_t pointX = idx % size;
+			const uint32_t pointY = idx / size;
+
+			for (uint32_t y = 0; y < size; y++)
+			{
+				const uint32_t kernelRow = ((y + size - pointY) % size) * size;
+				for (uint32_t x = 0; x < size; x++)
+					energy[y * size + x] += sign * kernel[kernelRow + (x + size - pointX) % size];
+			}
+		};
+
+	auto findTightestCluster = [&]()
+		{
+			uint32_t bestIdx = 0u;
+			float maxEnergy = -FLT_MAX;
+			for (uint32_t i = 0; i < count; i++)
+			{
+				if (pattern[i] && energy[i] > maxEnergy)
+				{
+					maxEnergy = energy[i];
+					bestIdx = i;
+				}
+			}
+			return bestIdx;
+		};
+
+	auto findLargestVoid = [&]()
+		{
+			uint32_t bestIdx = 0u;
+			float minEnergy = FLT_MAX;
+			for (uint32_t i = 0; i < count; i++)
+			{
+				if (!pattern[i] && energy[i] < minEnergy)
+				{
+					minEnergy = energy[i];
+					bestIdx = i;
+				}
+			}
+			return bestIdx;
+		};
+
+	// Initial pattern, 10% random points which are moved from the tightest cluster to the largest void until stable
+	// Fixed seed so the texture is the same every run
+	const uint32_t numInitialPoints = glm::max(count / 10u, 1u);
+	uint32_t seed = 1337u;
+	for (uint32_t numPlaced = 0; numPlaced < numInitialPoints;)
+	{
+		uint32_t idx = pcgHash(seed) % count;
+		if (pattern[idx])
+			continue;
+
+		pattern[idx] = 1u;
+		splat(idx, 1.f);
+		numPlaced++;
+	}
+
+	for (uint32_t i = 0; i < count; i++) // Capped in case it never settles
+	{
+		uint32_t cluster = findTightestCluster();
+		pattern[cluster] = 0u;
+		splat(cluster, -1.f);
+
+		uint32_t largestVoid = findLargestVoid();
+		pattern[largestVoid] = 1u;
+		splat(largestVoid, 1.f);
+
+		if (largestVoid == cluster)
+			break;
+	}
+
+	std::vector<uint32_t> ranks(count, 0u);
+	const std::vector<uint8_t> initialPattern = pattern;
+	const std::vector<float> initialEnergy = energy;
+
+	// Phase 1, rank the initial points by removing the tightest clusters
+	for (uint32_t rank = numInitialPoints; rank-- > 0u;)
+	{
+		uint32_t cluster = findTightestCluster();
+		pattern[cluster] = 0u;
+		splat(cluster, -1.f);
+		ranks[cluster] = rank;
+	}
+
+	// Phase 2 & 3, fill the largest voids until every pixel is ranked
+	// Past the halfway point the tightest cluster of empty pixels is the same pixel as the largest void, so one loop covers both
+	pattern = initialPattern;
+	energy = initialEnergy;
+	for (uint32_t rank = numInitialPoints; rank < count; rank++)
+	{
+		uint32_t largestVoid = findLargestVoid();
+		pattern[largestVoid] = 1u;
+		splat(largestVoid, 1.f);
+		ranks[largestVoid] = rank;
+	}
+
+	outValues.resize(count);
+	for (uint32_t i = 0; i < count; i++)
+		outValues[i] = ranks[i] / (float)count;
+}
\ No newline at end of file
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "glm/glm.hpp"
+
+#include <stdint.h>
+#include <vector>
+
+// CPU side of resources/shaders/Sampling.hlsli, both produce the same sequences
+class Sampler
+{
+public:
+	enum Type : uint32_t
+	{
+		Random = 0,		// pcg_hash, uncorrelated white noise
+		Sobol = 1,		// Owen-scrambled 2D Sobol, padded across dimensions
+		BlueNoise = 2,	// Blue noise tile, offset per dimension and rotated per sample
+	};
+
+public:
+	// pBlueNoise needs to point at a BLUE_NOISE_TILE_SIZE^2 tile when using Type::BlueNoise
+	Sampler(Type type, glm::uvec2 pixel, uint32_t width, uint32_t sampleIdx, const float* pBlueNoise = nullptr);
+	~Sampler() = default;
+
+	// Uniform sample in [0, 1), every call moves on to the next dimension
+	float next();
+
+	glm::vec2 pointInCircle();
+	glm::vec3 unitVector();
+
+	// Generates a tileable blue noise texture with the void-and-cluster method, values are the normalized ranks in [0, 1)
+	static void generateBlueNoise(uint32_t size, std::vector<float>& outValues);
+
+private:
+	Type m_type;
+	glm::uvec2 m_pixel;
+	uint32_t m_seed;
+	uint32_t m_sampleIdx;
+	uint32_t m_dimension;
+	const float* m_pBlueNoise;
+};
\ No newline at end of file
@@ -1,55 +1,48 @@
 #pragma once
-#include "DirectX/DX11.h"
 #include "Utilities.h"
+#include "TextureMemory.h"
 
-/*
-	Textures are not primarily responsible for allocating/deallocating its data.
-	They'll only deallocate its old data during move.
-*/
+#include <string>
 
+// RGBA8 pixels, owned by the texture and freed with it. Move only, copies of the pixels are made explicitly
 class Texture
 {
 public:
-	Texture(unsigned char* pTextureData, uint32_t width, uint32_t height, std::string_view name)
-		:m_pTextureData(pTextureData), m_width(width), m_height(height), m_name(name.data())
+	Texture(Okay::PixelBuffer&& pixels, uint32_t width, uint32_t height, std::string_view name)
+		:m_name(name), m_width(width), m_height(height), m_pixels(std::move(pixels))
 	{
-		OKAY_ASSERT(pTextureData);
+		OKAY_ASSERT(m_pixels.getData());
+		OKAY_ASSERT(m_pixels.getSize() == getByteSize());
 	}
-	~Texture() = default;
-
-	Texture(const Texture& other) = default;
-
-	Texture& operator=(Texture&& other) noexcept
-	{
-		OKAY_DELETE_ARRAY(m_pTextureData);
 
-		m_pTextureData = other.m_pTextureData;
-		other.m_pTextureData = nullptr;
+	// Copies the pixels, the caller keeps ownership of pTextureData
+	Texture(const unsigned char* pTextureData, uint32_t width, uint32_t height, std::string_view name)
+		:Texture(Okay::PixelBuffer(pTextureData, (uint64_t)width * height * 4u), width, height, name)
+	{ }
 
-		m_width = other.m_width;
-		m_height = other.m_height;
-
-		other.m_width = other.m_height = 0u;
+	~Texture() = default;
 
-		m_name = other.m_name;
-		other.m_name = "";
+	Texture(Texture&& other) noexcept = default;
+	Texture& operator=(Texture&& other) noexcept = default;
 
-		return *this;
-	}
+	Texture(const Texture& other) = delete;
+	Texture& operator=(const Texture& other) = delete;
 
 	inline const std::string& getName() const;
 	inline uint32_t getWidth() const;
 	inline uint32_t getHeight() const;
-	inline unsigned char* getTextureData() const;
+	inline uint64_t getByteSize() const;
+	inline const unsigned char* getTextureData() const;
 
 
 private:
 	std::string m_name;
 	uint32_t m_width, m_height;
-	unsigned char* m_pTextureData;
+	Okay::PixelBuffer m_pixels;
 };
 
 inline const std::string& Texture::getName() const { return m_name; }
 inline uint32_t Texture::getWidth() const { return m_width; }
 inline uint32_t Texture::getHeight() const { return m_height; }
-inline unsigned char* Texture::getTextureData() const { return m_pTextureData; }
\ No newline at end of file
+inline uint64_t Texture::getByteSize() const { return (uint64_t)m_width * m_height * 4u; }
+inline const unsigned char* Texture::getTextureData() const { return m_pixels.getData(); }
\ No newline at end of file
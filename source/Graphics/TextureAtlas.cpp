@@ -0,0 +1,228 @@
+#include "TextureAtlas.h"
+#include "Threading.h"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+/*
+	Bottom left skyline packer for one page. The skyline is the top edge of everything placed so far as segments from left to right,
+	a rect goes where the skyline under it is lowest and becomes a new segment on top of it.
+*/
+class SkylinePage
+{
+public:
+	SkylinePage(uint32_t size)
+		:m_size(size)
+	{
+		m_skyline.push_back({ 0u, 0u, size });
+	}
+
+	bool insert(uint32_t width, uint32_t height, glm::uvec2& outPosition)
+	{
+		uint32_t bestIdx = Okay::INVALID_UINT;
+		uint32_t bestY = Okay::INVALID_UINT;
+
+		for (uint32_t i = 0; i < (uint32_t)m_skyline.size(); i++)
+		{
+			if (m_skyline[i].x + width > m_size)
+				break;
+
+			// Resting on the highest segment under [x, x + width)
+			uint32_t y = 0u;
+			uint32_t remainingWidth = width;
+			for (uint32_t j = i; remainingWidth; j++)
+			{
+				y = std::max(y, m_skyline[j].y);
+				remainingWidth -= std::min(remainingWidth, m_skyline[j].width);
+			}
+
+			if (y + height <= m_size && y < bestY)
+			{
+				bestIdx = i;
+				bestY = y;
+			}
+		}
+
+		if (bestIdx == Okay::INVALID_UINT)
+			return false;
+
+		const uint32_t x = m_skyline[bestIdx].x;
+		const uint32_t endX = x + width;
+		outPosition = glm::uvec2(x, bestY);
+
+		// Cut the covered part out of the segments, the last one covered may only be partially
+		uint32_t i = bestIdx;
+		while (i < (uint32_t)m_skyline.size() && m_skyline[i].x < endX)
+		{
+			Segment& segment = m_skyline[i];
+			const uint32_t segmentEndX = segment.x + segment.width;
+
+			if (segmentEndX <= endX)
+			{
+				m_skyline.erase(m_skyline.begin() + i);
+				continue;
+			}
+
+			segment.width = segmentEndX - endX;
+			segment.x = endX;
+			break;
+		}
+
+		m_skyline.insert(m_skyline.begin() + bestIdx, { x, bestY + height, width });
+
+		for (i = 0; i + 1u < (uint32_t)m_skyline.size();)
+		{
+			if (m_skyline[i].y == m_skyline[i + 1u].y)
+			{
+				m_skyline[i].width += m_skyline[i + 1u].width;
+				m_skyline.erase(m_skyline.begin() + i + 1u);
+			}
+			else
+			{
+				i++;
+			}
+		}
+
+		return true;
+	}
+
+private:
+	struct Segment
+	{
+		uint32_t x = 0u;
+		uint32_t y = 0u;
+		uint32_t width = 0u;
+	};
+
+	uint32_t m_size;
+	std::vector<Segment> m_skyline;
+};
+
+TextureAtlasPacker::TextureAtlasPacker() = default;
+TextureAtlasPacker::~TextureAtlasPacker() = default;
+
+TextureAtlasPacker::TextureAtlasPacker(TextureAtlasPacker&& other) noexcept = default;
+TextureAtlasPacker& TextureAtlasPacker::operator=(TextureAtlasPacker&& other) noexcept = default;
+
+TextureAtlasRecord TextureAtlasPacker::pack(uint32_t width, uint32_t height)
+{
+	OKAY_ASSERT(width <= TEXTURE_ATLAS_MAX_PAGE_SIZE && height <= TEXTURE_ATLAS_MAX_PAGE_SIZE);
+
+	TextureAtlasRecord record;
+	record.sizeClass = getTextureAtlasClass(width, height);
+	record.size = glm::uvec2(width, height);
+
+	std::vector<SkylinePage>& classPages = m_pages[record.sizeClass];
+
+	// A new page always fits since the class was picked by the texture's size
+	record.page = Okay::INVALID_UINT;
+	for (uint32_t i = 0; i < (uint32_t)classPages.size() && record.page == Okay::INVALID_UINT; i++)
+	{
+		if (classPages[i].insert(record.size.x, record.size.y, record.offset))
+			record.page = i;
+	}
+
+	if (record.page == Okay::INVALID_UINT)
+	{
+		record.page = (uint32_t)classPages.size();
+		classPages.emplace_back(TEXTURE_ATLAS_MIN_PAGE_SIZE << record.sizeClass).insert(record.size.x, record.size.y, record.offset);
+	}
+
+	return record;
+}
+
+uint32_t TextureAtlasPacker::getNumPages(uint32_t sizeClass) const
+{
+	return (uint32_t)m_pages[sizeClass].size();
+}
+
+uint64_t TextureAtlas::getByteSize() const
+{
+	uint64_t byteSize = 0u;
+	for (const SizeClass& sizeClass : sizeClasses)
+	{
+		for (const Okay::PixelBuffer& page : sizeClass.pages)
+			byteSize += page.getSize();
+	}
+
+	return byteSize;
+}
+
+uint32_t TextureAtlas::getNumPages() const
+{
+	uint32_t numPages = 0u;
+	for (const SizeClass& sizeClass : sizeClasses)
+		numPages += (uint32_t)sizeClass.pages.size();
+
+	return numPages;
+}
+
+uint32_t getTextureAtlasClass(uint32_t width, uint32_t height)
+{
+	const uint32_t maxSide = std::max(width, height);
+
+	uint32_t sizeClass = 0u;
+	while (sizeClass + 1u < NUM_TEXTURE_ATLAS_CLASSES && (TEXTURE_ATLAS_MIN_PAGE_SIZE << sizeClass) < maxSide)
+		sizeClass++;
+
+	return sizeClass;
+}
+
+void buildTextureAtlas(std::span<const Texture* const> textures, TextureAtlas& outAtlas, TextureAtlasPacker* pOutPacker)
+{
+	const uint32_t numTextures = (uint32_t)textures.size();
+
+	outAtlas = TextureAtlas();
+	outAtlas.records.resize(numTextures);
+
+	for (uint32_t i = 0; i < NUM_TEXTURE_ATLAS_CLASSES; i++)
+		outAtlas.sizeClasses[i].pageSize = TEXTURE_ATLAS_MIN_PAGE_SIZE << i;
+
+	// Tallest first packs the skyline the tightest
+	std::vector<uint32_t> packOrder(numTextures);
+	std::iota(packOrder.begin(), packOrder.end(), 0u);
+	std::sort(packOrder.begin(), packOrder.end(), [&](uint32_t a, uint32_t b)
+		{
+			if (textures[a]->getHeight() != textures[b]->getHeight())
+				return textures[a]->getHeight() > textures[b]->getHeight();
+
+			return textures[a]->getWidth() > textures[b]->getWidth();
+		});
+
+	TextureAtlasPacker packer;
+
+	for (uint32_t textureIdx : packOrder)
+		outAtlas.records[textureIdx] = packer.pack(textures[textureIdx]->getWidth(), textures[textureIdx]->getHeight());
+
+	for (uint32_t i = 0; i < NUM_TEXTURE_ATLAS_CLASSES; i++)
+	{
+		TextureAtlas::SizeClass& sizeClass = outAtlas.sizeClasses[i];
+		const uint64_t pageByteSize = (uint64_t)sizeClass.pageSize * sizeClass.pageSize * 4u;
+		const uint32_t numPages = packer.getNumPages(i);
+
+		sizeClass.pages.reserve(numPages);
+		for (uint32_t j = 0; j < numPages; j++)
+			sizeClass.pages.emplace_back(pageByteSize);
+	}
+
+	// The records don't overlap so every texture can be copied in on its own
+	Okay::parallelFor(numTextures, [&](uint32_t i)
+		{
+			const TextureAtlasRecord& record = outAtlas.records[i];
+			TextureAtlas::SizeClass& sizeClass = outAtlas.sizeClasses[record.sizeClass];
+
+			const unsigned char* pSource = textures[i]->getTextureData();
+			unsigned char* pTarget = sizeClass.pages[record.page].getData();
+
+			const uint64_t rowByteSize = (uint64_t)record.size.x * 4u;
+			for (uint32_t y = 0; y < record.size.y; y++)
+			{
+				const uint64_t targetOffset = ((uint64_t)(record.offset.y + y) * sizeClass.pageSize + record.offset.x) * 4u;
+				memcpy(pTarget + targetOffset, pSource + y * rowByteSize, rowByteSize);
+			}
+		});
+
+	if (pOutPacker)
+		*pOutPacker = std::move(packer);
+}
\ No newline at end of file
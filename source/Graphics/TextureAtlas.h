@@ -0,0 +1,68 @@
+#pragma once
+#include "Texture.h"
+#include "shaders/ShaderResourceRegisters.h"
+
+#include "glm/glm.hpp"
+
+#include <span>
+#include <vector>
+
+// Pages of size class i are (TEXTURE_ATLAS_MIN_PAGE_SIZE << i) texels wide and high
+static const uint32_t TEXTURE_ATLAS_MAX_PAGE_SIZE = TEXTURE_ATLAS_MIN_PAGE_SIZE << (NUM_TEXTURE_ATLAS_CLASSES - 1u);
+
+// Where a texture was packed, in texels. Same layout as TextureAtlasRecord in GPU-Structs.hlsli
+struct TextureAtlasRecord
+{
+	uint32_t sizeClass = 0u;
+	uint32_t page = 0u;
+	glm::uvec2 offset = glm::uvec2(0u);
+	glm::uvec2 size = glm::uvec2(0u);
+};
+
+/*
+	Textures packed as they are into square pages, no resampling. Every texture goes to the smallest size class whose pages fit it,
+	so a class' pages can be one texture array and small textures share pages instead of each taking a whole slice.
+	Texels outside of the records are left uninitialized, the shaders wrap within a record and never read them.
+*/
+struct TextureAtlas
+{
+	struct SizeClass
+	{
+		uint32_t pageSize = 0u;
+		std::vector<Okay::PixelBuffer> pages; // RGBA8
+	};
+
+	SizeClass sizeClasses[NUM_TEXTURE_ATLAS_CLASSES];
+
+	// Per texture, in the order they were given
+	std::vector<TextureAtlasRecord> records;
+
+	uint64_t getByteSize() const;
+	uint32_t getNumPages() const;
+};
+
+uint32_t getTextureAtlasClass(uint32_t width, uint32_t height);
+
+class SkylinePage;
+
+// Places textures into pages without copying any texels. Keeping one after building an atlas lets more textures be packed around the ones in it
+class TextureAtlasPacker
+{
+public:
+	TextureAtlasPacker();
+	~TextureAtlasPacker();
+
+	TextureAtlasPacker(TextureAtlasPacker&& other) noexcept;
+	TextureAtlasPacker& operator=(TextureAtlasPacker&& other) noexcept;
+
+	// First fit into the pages of the texture's size class, a page is added when none fit
+	TextureAtlasRecord pack(uint32_t width, uint32_t height);
+	uint32_t getNumPages(uint32_t sizeClass) const;
+
+private:
+	std::vector<SkylinePage> m_pages[NUM_TEXTURE_ATLAS_CLASSES];
+};
+
+// Textures have to fit a TEXTURE_ATLAS_MAX_PAGE_SIZE page, larger ones are scaled down by the caller.
+// pOutPacker gets where the packing ended, to pack more textures into the same pages later
+void buildTextureAtlas(std::span<const Texture* const> textures, TextureAtlas& outAtlas, TextureAtlasPacker* pOutPacker = nullptr);
\ No newline at end of file
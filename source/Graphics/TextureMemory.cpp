@@ -0,0 +1,266 @@
+#include "TextureMemory.h"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+namespace Okay
+{
+	// Blocks are whole pages, textures of the same dimensions then fit exactly into each others freed blocks
+	static const uint64_t BLOCK_ALIGNMENT = 4096u;
+	static const uint64_t CHUNK_SIZE = 64ull * 1024ull * 1024ull;
+
+	static uint64_t alignUp(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1u) / alignment * alignment;
+	}
+
+#ifdef _WIN32
+
+	// Large pages need the "Lock pages in memory" privilege, without it the first attempt fails and normal pages are used from then on
+	static unsigned char* allocateChunkMemory(uint64_t& size, bool& outLargePages)
+	{
+		static bool largePagesFailed = false;
+
+		const SIZE_T largePageSize = GetLargePageMinimum();
+		if (largePageSize && !largePagesFailed)
+		{
+			const uint64_t largePageChunkSize = alignUp(size, largePageSize);
+			if (void* pMemory = VirtualAlloc(nullptr, largePageChunkSize, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE))
+			{
+				size = largePageChunkSize;
+				outLargePages = true;
+				return (unsigned char*)pMemory;
+			}
+
+			largePagesFailed = true;
+		}
+
+		outLargePages = false;
+		return (unsigned char*)VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+	}
+
+	static void freeChunkMemory(unsigned char* pMemory, uint64_t)
+	{
+		VirtualFree(pMemory, 0u, MEM_RELEASE);
+	}
+
+#else
+
+	// Transparent huge pages are only a hint, the kernel may still back the chunk with normal pages
+	static unsigned char* allocateChunkMemory(uint64_t& size, bool& outLargePages)
+	{
+		void* pMemory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (pMemory == MAP_FAILED)
+			return nullptr;
+
+		outLargePages = false;
+#ifdef MADV_HUGEPAGE
+		outLargePages = madvise(pMemory, size, MADV_HUGEPAGE) == 0;
+#endif
+
+		return (unsigned char*)pMemory;
+	}
+
+	static void freeChunkMemory(unsigned char* pMemory, uint64_t size)
+	{
+		munmap(pMemory, size);
+	}
+
+#endif
+
+	struct TextureArena
+	{
+		struct Chunk
+		{
+			unsigned char* pBase = nullptr;
+			uint64_t size = 0u;
+			uint64_t usedBytes = 0u;
+			bool largePages = false;
+
+			// Sorted by address so a freed block can be merged with its neighbours
+			std::map<unsigned char*, uint64_t> freeBlocks;
+		};
+
+		std::mutex mutex;
+		std::vector<Chunk> chunks;
+		uint64_t allocatedBytes = 0u;
+		uint32_t numBuffers = 0u;
+
+		unsigned char* allocate(uint64_t byteSize)
+		{
+			const uint64_t blockSize = alignUp(byteSize, BLOCK_ALIGNMENT);
+
+			std::lock_guard lock(mutex);
+
+			// Best fit over all chunks, there are only ever a few free blocks per chunk
+			Chunk* pChunk = nullptr;
+			std::map<unsigned char*, uint64_t>::iterator blockIt;
+
+			for (Chunk& chunk : chunks)
+			{
+				for (auto it = chunk.freeBlocks.begin(); it != chunk.freeBlocks.end(); ++it)
+				{
+					if (it->second >= blockSize && (!pChunk || it->second < blockIt->second))
+					{
+						pChunk = &chunk;
+						blockIt = it;
+					}
+				}
+			}
+
+			if (!pChunk)
+			{
+				Chunk newChunk;
+				newChunk.size = std::max(CHUNK_SIZE, blockSize);
+				newChunk.pBase = allocateChunkMemory(newChunk.size, newChunk.largePages);
+				if (!newChunk.pBase)
+					return nullptr;
+
+				newChunk.freeBlocks.emplace(newChunk.pBase, newChunk.size);
+
+				pChunk = &chunks.emplace_back(std::move(newChunk));
+				blockIt = pChunk->freeBlocks.begin();
+			}
+
+			unsigned char* pData = blockIt->first;
+			const uint64_t remainingSize = blockIt->second - blockSize;
+
+			pChunk->freeBlocks.erase(blockIt);
+			if (remainingSize)
+				pChunk->freeBlocks.emplace(pData + blockSize, remainingSize);
+
+			pChunk->usedBytes += blockSize;
+			allocatedBytes += byteSize;
+			numBuffers++;
+
+			return pData;
+		}
+
+		void free(unsigned char* pData, uint64_t byteSize)
+		{
+			const uint64_t blockSize = alignUp(byteSize, BLOCK_ALIGNMENT);
+
+			std::lock_guard lock(mutex);
+
+			auto chunkIt = std::find_if(chunks.begin(), chunks.end(), [&](const Chunk& chunk)
+				{
+					return pData >= chunk.pBase && pData < chunk.pBase + chunk.size;
+				});
+
+			if (chunkIt == chunks.end())
+				return;
+
+			Chunk& chunk = *chunkIt;
+			auto blockIt = chunk.freeBlocks.emplace(pData, blockSize).first;
+
+			auto nextIt = std::next(blockIt);
+			if (nextIt != chunk.freeBlocks.end() && blockIt->first + blockIt->second == nextIt->first)
+			{
+				blockIt->second += nextIt->second;
+				chunk.freeBlocks.erase(nextIt);
+			}
+
+			if (blockIt != chunk.freeBlocks.begin())
+			{
+				auto previousIt = std::prev(blockIt);
+				if (previousIt->first + previousIt->second == blockIt->first)
+				{
+					previousIt->second += blockIt->second;
+					chunk.freeBlocks.erase(blockIt);
+				}
+			}
+
+			chunk.usedBytes -= blockSize;
+			allocatedBytes -= byteSize;
+			numBuffers--;
+
+			// Empty chunks go back to the OS, except the last one so reloading textures doesn't map it again
+			if (!chunk.usedBytes && chunks.size() > 1u)
+			{
+				freeChunkMemory(chunk.pBase, chunk.size);
+				chunks.erase(chunkIt);
+			}
+		}
+	};
+
+	// Never destroyed, textures held by static objects may still be freed during exit
+	static TextureArena& getArena()
+	{
+		static TextureArena* pArena = new TextureArena();
+		return *pArena;
+	}
+
+	TextureMemoryStats getTextureMemoryStats()
+	{
+		TextureArena& arena = getArena();
+		std::lock_guard lock(arena.mutex);
+
+		TextureMemoryStats stats;
+		stats.allocatedBytes = arena.allocatedBytes;
+		stats.numBuffers = arena.numBuffers;
+		stats.numChunks = (uint32_t)arena.chunks.size();
+
+		for (const TextureArena::Chunk& chunk : arena.chunks)
+		{
+			stats.reservedBytes += chunk.size;
+			stats.largePages |= chunk.largePages;
+		}
+
+		return stats;
+	}
+
+	PixelBuffer::PixelBuffer(uint64_t byteSize)
+	{
+		if (!byteSize)
+			return;
+
+		m_pData = getArena().allocate(byteSize);
+		m_size = m_pData ? byteSize : 0u;
+	}
+
+	PixelBuffer::PixelBuffer(const void* pSource, uint64_t byteSize)
+		:PixelBuffer(byteSize)
+	{
+		if (m_pData)
+			memcpy(m_pData, pSource, byteSize);
+	}
+
+	PixelBuffer::~PixelBuffer()
+	{
+		if (m_pData)
+			getArena().free(m_pData, m_size);
+	}
+
+	PixelBuffer::PixelBuffer(PixelBuffer&& other) noexcept
+		:m_pData(other.m_pData), m_size(other.m_size)
+	{
+		other.m_pData = nullptr;
+		other.m_size = 0u;
+	}
+
+	PixelBuffer& PixelBuffer::operator=(PixelBuffer&& other) noexcept
+	{
+		if (this == &other)
+			return *this;
+
+		if (m_pData)
+			getArena().free(m_pData, m_size);
+
+		m_pData = other.m_pData;
+		m_size = other.m_size;
+
+		other.m_pData = nullptr;
+		other.m_size = 0u;
+
+		return *this;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace Okay
+{
+	struct TextureMemoryStats
+	{
+		uint64_t allocatedBytes = 0u; // Pixels of every live PixelBuffer, loaded textures as well as temporary copies
+		uint64_t reservedBytes = 0u; // Taken from the OS for the arena
+		uint32_t numBuffers = 0u;
+		uint32_t numChunks = 0u;
+		bool largePages = false;
+	};
+
+	TextureMemoryStats getTextureMemoryStats();
+
+	/*
+		Owning storage for texture pixels. The memory is carved out of an arena of large chunks (large pages where the OS allows it)
+		shared by all textures, freed blocks are merged and handed to later textures so loads and scaled copies don't go through the heap.
+	*/
+	class PixelBuffer
+	{
+	public:
+		PixelBuffer() = default;
+		explicit PixelBuffer(uint64_t byteSize);
+		PixelBuffer(const void* pSource, uint64_t byteSize);
+		~PixelBuffer();
+
+		PixelBuffer(PixelBuffer&& other) noexcept;
+		PixelBuffer& operator=(PixelBuffer&& other) noexcept;
+
+		PixelBuffer(const PixelBuffer&) = delete;
+		PixelBuffer& operator=(const PixelBuffer&) = delete;
+
+		inline unsigned char* getData();
+		inline const unsigned char* getData() const;
+		inline uint64_t getSize() const;
+
+	private:
+		unsigned char* m_pData = nullptr;
+		uint64_t m_size = 0u;
+	};
+
+	inline unsigned char* PixelBuffer::getData()				{ return m_pData; }
+	inline const unsigned char* PixelBuffer::getData() const	{ return m_pData; }
+	inline uint64_t PixelBuffer::getSize() const				{ return m_size; }
+}
\ No newline at end of file
@@ -0,0 +1,241 @@
+#include "TileScheduler.h"
+#include "Threading.h"
+#include "shaders/ShaderResourceRegisters.h"
+
+#include <algorithm>
+
+// Spreads the lower 16 bits of value out to the even bits
+static uint32_t separateBits(uint32_t value)
+{
+	value &= 0x0000ffff;
+	value = (value | (value << 8u)) & 0x00ff00ff;
+	value = (value | (value << 4u)) & 0x0f0f0f0f;
+	value = (value | (value << 2u)) & 0x33333333;
+	value = (value | (value << 1u)) & 0x55555555;
+	return value;
+}
+
+static uint32_t getMortonCode(uint32_t x, uint32_t y)
+{
+	return separateBits(x) | (separateBits(y) << 1u);
+}
+
+TileScheduler::TileScheduler(uint32_t numWorkers)
+	:m_imageDims(0u), m_numTiles(0u), m_frameIdx(0u), m_numBusyWorkers(0u), m_shutdown(false),
+	m_running(false), m_cancelled(false), m_lastFrameTime(0.f)
+{
+	if (!numWorkers)
+		numWorkers = Okay::getNumWorkerThreads();
+
+	m_queues = std::make_unique<WorkerQueue[]>(numWorkers);
+
+	m_workers.reserve(numWorkers);
+	for (uint32_t i = 0; i < numWorkers; i++)
+		m_workers.emplace_back(&TileScheduler::workerLoop, this, i);
+}
+
+TileScheduler::~TileScheduler()
+{
+	cancel();
+
+	{
+		std::lock_guard<std::mutex> lock(m_frameMutex);
+		m_shutdown = true;
+	}
+	m_frameStartCV.notify_all();
+
+	for (std::thread& worker : m_workers)
+		worker.join();
+}
+
+void TileScheduler::start(glm::uvec2 imageDims, TileFunction function, std::span<const uint8_t> activeTiles)
+{
+	cancel();
+
+	if (imageDims != m_imageDims)
+		createTiles(imageDims);
+
+	OKAY_ASSERT(activeTiles.empty() || activeTiles.size() == m_tiles.size());
+
+	m_tileFunction = std::move(function);
+	m_tileStats.assign(m_tiles.size(), TileStats());
+
+	// Skipped tiles are left out before splitting, so the workers still get even runs of what is traced
+	const std::vector<uint32_t>* pOrder = &m_mortonOrder;
+	if (!activeTiles.empty())
+	{
+		m_activeMortonOrder.clear();
+		for (uint32_t tileIdx : m_mortonOrder)
+		{
+			if (activeTiles[tileIdx])
+				m_activeMortonOrder.emplace_back(tileIdx);
+		}
+
+		pOrder = &m_activeMortonOrder;
+	}
+
+	// Contiguous runs of the Morton order, the first workers get one extra tile if it doesn't divide evenly
+	const uint32_t numWorkers = getNumWorkers();
+	const uint32_t numTiles = (uint32_t)pOrder->size();
+	uint32_t orderIdx = 0u;
+
+	for (uint32_t i = 0; i < numWorkers; i++)
+	{
+		const uint32_t numWorkerTiles = numTiles / numWorkers + (i < numTiles % numWorkers ? 1u : 0u);
+
+		std::lock_guard<std::mutex> lock(m_queues[i].mutex);
+		m_queues[i].tileIndices.assign(pOrder->begin() + orderIdx, pOrder->begin() + orderIdx + numWorkerTiles);
+		orderIdx += numWorkerTiles;
+	}
+
+	m_cancelled = false;
+	m_running = true;
+	m_frameStartTime = std::chrono::system_clock::now();
+
+	{
+		std::lock_guard<std::mutex> lock(m_frameMutex);
+		m_numBusyWorkers = numWorkers;
+		m_frameIdx++;
+	}
+	m_frameStartCV.notify_all();
+}
+
+void TileScheduler::wait()
+{
+	std::unique_lock<std::mutex> lock(m_frameMutex);
+	m_frameDoneCV.wait(lock, [&]() { return m_numBusyWorkers == 0u; });
+}
+
+void TileScheduler::cancel()
+{
+	m_cancelled = true;
+	wait();
+}
+
+uint64_t TileScheduler::getTotalRays() const
+{
+	uint64_t numRays = 0u;
+	for (const TileStats& stats : m_tileStats)
+		numRays += stats.numRays;
+
+	return numRays;
+}
+
+uint32_t TileScheduler::getNumStolenTiles() const
+{
+	return (uint32_t)std::count_if(m_tileStats.begin(), m_tileStats.end(), [](const TileStats& stats) { return stats.stolen; });
+}
+
+void TileScheduler::workerLoop(uint32_t workerIdx)
+{
+	uint64_t lastFrameIdx = 0u;
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_frameMutex);
+			m_frameStartCV.wait(lock, [&]() { return m_shutdown || m_frameIdx != lastFrameIdx; });
+
+			if (m_shutdown)
+				return;
+
+			lastFrameIdx = m_frameIdx;
+		}
+
+		uint32_t tileIdx = 0u;
+		bool stolen = false;
+
+		while (!isCancelled() && popTile(workerIdx, tileIdx, stolen))
+		{
+			auto tileStartTime = std::chrono::system_clock::now();
+
+			TileStats& stats = m_tileStats[tileIdx];
+			stats.workerIdx = workerIdx;
+			stats.stolen = stolen;
+
+			m_tileFunction(m_tiles[tileIdx], stats);
+
+			std::chrono::duration<float> duration = std::chrono::system_clock::now() - tileStartTime;
+			stats.renderTime = duration.count() * 1000.f;
+		}
+
+		std::lock_guard<std::mutex> lock(m_frameMutex);
+		if (--m_numBusyWorkers == 0u)
+		{
+			std::chrono::duration<float> duration = std::chrono::system_clock::now() - m_frameStartTime;
+			m_lastFrameTime = duration.count() * 1000.f;
+			m_running = false;
+
+			m_frameDoneCV.notify_all();
+		}
+	}
+}
+
+bool TileScheduler::popTile(uint32_t workerIdx, uint32_t& outTileIdx, bool& outStolen)
+{
+	{
+		WorkerQueue& queue = m_queues[workerIdx];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+
+		if (!queue.tileIndices.empty())
+		{
+			outTileIdx = queue.tileIndices.front();
+			queue.tileIndices.pop_front();
+			outStolen = false;
+			return true;
+		}
+	}
+
+	// Steal, starting with the next worker so the thieves spread out over the victims
+	const uint32_t numWorkers = getNumWorkers();
+	for (uint32_t i = 1; i < numWorkers; i++)
+	{
+		WorkerQueue& queue = m_queues[(workerIdx + i) % numWorkers];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+
+		if (!queue.tileIndices.empty())
+		{
+			outTileIdx = queue.tileIndices.back();
+			queue.tileIndices.pop_back();
+			outStolen = true;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+glm::uvec2 TileScheduler::calculateNumTiles(glm::uvec2 imageDims)
+{
+	const glm::uvec2 tileSize(THREAD_GROUP_SIZE_X, THREAD_GROUP_SIZE_Y);
+	return (imageDims + tileSize - 1u) / tileSize;
+}
+
+void TileScheduler::createTiles(glm::uvec2 imageDims)
+{
+	const glm::uvec2 tileSize(THREAD_GROUP_SIZE_X, THREAD_GROUP_SIZE_Y);
+
+	m_imageDims = imageDims;
+	m_numTiles = calculateNumTiles(imageDims);
+
+	const uint32_t numTiles = m_numTiles.x * m_numTiles.y;
+	m_tiles.resize(numTiles);
+	m_mortonOrder.resize(numTiles);
+
+	for (uint32_t i = 0; i < numTiles; i++)
+	{
+		const glm::uvec2 tileCoord(i % m_numTiles.x, i / m_numTiles.x);
+
+		Tile& tile = m_tiles[i];
+		tile.min = tileCoord * tileSize;
+		tile.max = glm::min(tile.min + tileSize, imageDims);
+		tile.idx = i;
+
+		m_mortonOrder[i] = i;
+	}
+
+	std::sort(m_mortonOrder.begin(), m_mortonOrder.end(), [&](uint32_t a, uint32_t b)
+		{
+			return getMortonCode(a % m_numTiles.x, a / m_numTiles.x) < getMortonCode(b % m_numTiles.x, b / m_numTiles.x);
+		});
+}
\ No newline at end of file
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "Utilities.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+/*
+	Splits an image into tiles of THREAD_GROUP_SIZE_X * THREAD_GROUP_SIZE_Y pixels, the same as a thread group in RaytracerCS,
+	and runs them on a pool of worker threads.
+	The tiles are sorted in Morton order and every worker gets a contiguous run of them, so a worker stays in one part of the image.
+	Workers that run out of tiles steal from the back of another worker's queue, the tiles furthest away from what that worker is on.
+	A frame can be cancelled at any time, tiles already started are finished unless the tile function polls isCancelled().
+	Tiles can be left out of a frame, adaptive sampling skips the ones that have converged.
+*/
+class TileScheduler
+{
+public:
+	struct Tile
+	{
+		glm::uvec2 min; // Inclusive
+		glm::uvec2 max; // Exclusive, clamped to the image
+		uint32_t idx;	// Row major
+	};
+
+	struct TileStats
+	{
+		uint64_t numRays = 0u;	// Counted by the tile function
+		float renderTime = 0.f;	// Milliseconds
+		uint32_t workerIdx = Okay::INVALID_UINT;
+		bool stolen = false;
+	};
+
+	using TileFunction = std::function<void(const Tile& tile, TileStats& stats)>;
+
+public:
+	TileScheduler(uint32_t numWorkers = 0u); // 0 = one per hardware thread
+	~TileScheduler();
+
+	// Hands out the tiles to the workers and returns right away, cancels the previous frame if it's still running
+	// activeTiles is row major, tiles with a 0 are skipped and keep empty stats. Empty runs every tile
+	void start(glm::uvec2 imageDims, TileFunction function, std::span<const uint8_t> activeTiles = {});
+	void wait();
+	void cancel();
+
+	inline bool isRunning() const;
+	inline bool isCancelled() const;
+
+	// Row major, only complete once the frame is done
+	inline const std::vector<TileStats>& getTileStats() const;
+	inline glm::uvec2 getNumTiles() const;
+	inline uint32_t getNumWorkers() const;
+	inline float getLastFrameTime() const; // Milliseconds
+
+	static glm::uvec2 calculateNumTiles(glm::uvec2 imageDims);
+
+	uint64_t getTotalRays() const;
+	uint32_t getNumStolenTiles() const;
+
+private:
+	struct WorkerQueue
+	{
+		std::mutex mutex;
+		std::deque<uint32_t> tileIndices;
+	};
+
+	void workerLoop(uint32_t workerIdx);
+	bool popTile(uint32_t workerIdx, uint32_t& outTileIdx, bool& outStolen);
+	void createTiles(glm::uvec2 imageDims);
+
+	std::vector<std::thread> m_workers;
+	std::unique_ptr<WorkerQueue[]> m_queues; // std::mutex can't be moved, so no std::vector
+
+	std::vector<Tile> m_tiles;
+	std::vector<uint32_t> m_mortonOrder; // Tile indices
+	std::vector<uint32_t> m_activeMortonOrder; // The Morton order of the current frame, without the skipped tiles
+	std::vector<TileStats> m_tileStats;
+	glm::uvec2 m_imageDims;
+	glm::uvec2 m_numTiles;
+	TileFunction m_tileFunction;
+
+	std::mutex m_frameMutex;
+	std::condition_variable m_frameStartCV;
+	std::condition_variable m_frameDoneCV;
+	uint64_t m_frameIdx;
+	uint32_t m_numBusyWorkers;
+	bool m_shutdown;
+
+	std::atomic<bool> m_running;
+	std::atomic<bool> m_cancelled;
+
+	std::chrono::time_point<std::chrono::system_clock> m_frameStartTime;
+	float m_lastFrameTime;
+};
+
+inline bool TileScheduler::isRunning() const	{ return m_running.load(); }
+inline bool TileScheduler::isCancelled() const	{ return m_cancelled.load(std::memory_order_relaxed); }
+
+inline const std::vector<TileScheduler::TileStats>& TileScheduler::getTileStats() const { return m_tileStats; }
+inline glm::uvec2 TileScheduler::getNumTiles() const	{ return m_numTiles; }
+inline uint32_t TileScheduler::getNumWorkers() const	{ return (uint32_t)m_workers.size(); }
+inline float TileScheduler::getLastFrameTime() const	{ return m_lastFrameTime; }
\ No newline at end of file
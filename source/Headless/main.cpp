@@ -0,0 +1,370 @@
+#include "Graphics/CPURayTracer.h"
+#include "Graphics/ImageWriter.h"
+#include "Graphics/ResourceManager.h"
+#include "Scene/Scene.h"
+#include "Scene/Entity.h"
+#include "Scene/Components.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+/*
+	Renders a scene with the CPU tracer and writes it to disk, no window or GPU needed.
+	Everything not given on the command line gets the same default as the application.
+*/
+
+struct RenderOptions
+{
+	std::string scenePath;
+	std::string texturesPath;
+	float sceneScale = 1.f;
+	std::string environmentMapPath;
+
+	glm::vec3 cameraPosition = glm::vec3(60.f, 0.f, 0.f);
+	glm::vec3 cameraRotation = glm::vec3(0.f, -90.f, 0.f);
+	float cameraFov = 90.f;
+
+	glm::uvec2 resolution = glm::uvec2(1600u, 900u);
+	uint32_t samplesPerPixel = 64u;
+	uint32_t numThreads = 0u;
+	CPURayTracer::Settings settings;
+
+	std::string outputPath = "render.png";
+
+	// Ray recording, see RayRecording.h. The BVH settings pick the layout the rays are replayed against
+	std::string recordRaysPath;
+	std::string replayRaysPath;
+	uint32_t bvhMaxDepth = DEFAULT_BVH_MAX_DEPTH;
+	uint32_t bvhMaxLeafTriangles = DEFAULT_BVH_MAX_LEAF_TRIANGLES;
+};
+
+static void printUsage()
+{
+	printf("Usage: GPU-Raytracer-Headless --scene <file> [options]\n"
+		"  --scene <file>          Model file loaded as the scene, one entity per mesh\n"
+		"  --textures <dir>        Directory the scene's texture paths are relative to\n"
+		"  --scale <s>             Scene import scale (1)\n"
+		"  --env <file>            Environment map, .hdr equirectangular or a 4x3 cube cross\n"
+		"  --camera <x,y,z>        Camera position (60,0,0)\n"
+		"  --rotation <x,y,z>      Camera rotation in degrees (0,-90,0)\n"
+		"  --fov <degrees>         Camera field of view (90)\n"
+		"  --res <width>x<height>  Output resolution (1600x900)\n"
+		"  --spp <n>               Samples per pixel (64)\n"
+		"  --bounces <n>           Max bounces (1)\n"
+		"  --sampler <name>        random, sobol or bluenoise (random)\n"
+		"  --dof <strength,dist>   Depth of field (0,0)\n"
+		"  --no-rr                 Disable russian roulette\n"
+		"  --threads <n>           Worker threads, 0 = one per hardware thread (0)\n"
+		"  --out <file>            Output image, .png or .exr (render.png)\n"
+		"  --record-rays <file>    Also write every traced ray and its hit to a ray recording\n"
+		"  --replay-rays <file>    Trace a ray recording instead of rendering and compare against its hits\n"
+		"  --bvh-leaf <n>          Max triangles per BVH leaf (%u)\n"
+		"  --bvh-depth <n>         Max BVH depth (%u)\n", DEFAULT_BVH_MAX_LEAF_TRIANGLES, DEFAULT_BVH_MAX_DEPTH);
+}
+
+static bool parseVec3(const char* pText, glm::vec3& outValue)
+{
+	return sscanf(pText, "%f,%f,%f", &outValue.x, &outValue.y, &outValue.z) == 3;
+}
+
+static bool parseOptions(int argc, char** argv, RenderOptions& outOptions)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		const char* pArg = argv[i];
+		const char* pValue = i + 1 < argc ? argv[i + 1] : nullptr;
+
+		// Flags without a value
+		if (!strcmp(pArg, "--no-rr"))
+		{
+			outOptions.settings.russianRouletteEnabled = false;
+			continue;
+		}
+
+		if (!strcmp(pArg, "--help") || !strcmp(pArg, "-h"))
+			return false;
+
+		if (!pValue)
+		{
+			printf("Missing value for '%s'\n", pArg);
+			return false;
+		}
+
+		bool valid = true;
+		i++;
+
+		if (!strcmp(pArg, "--scene"))
+			outOptions.scenePath = pValue;
+		else if (!strcmp(pArg, "--textures"))
+			outOptions.texturesPath = pValue;
+		else if (!strcmp(pArg, "--scale"))
+			outOptions.sceneScale = (float)atof(pValue);
+		else if (!strcmp(pArg, "--env"))
+			outOptions.environmentMapPath = pValue;
+		else if (!strcmp(pArg, "--camera"))
+			valid = parseVec3(pValue, outOptions.cameraPosition);
+		else if (!strcmp(pArg, "--rotation"))
+			valid = parseVec3(pValue, outOptions.cameraRotation);
+		else if (!strcmp(pArg, "--fov"))
+			outOptions.cameraFov = (float)atof(pValue);
+		else if (!strcmp(pArg, "--res"))
+			valid = sscanf(pValue, "%ux%u", &outOptions.resolution.x, &outOptions.resolution.y) == 2 && outOptions.resolution.x && outOptions.resolution.y;
+		else if (!strcmp(pArg, "--spp"))
+			outOptions.samplesPerPixel = (uint32_t)atoi(pValue);
+		else if (!strcmp(pArg, "--bounces"))
+			outOptions.settings.maxBounces = (uint32_t)atoi(pValue);
+		else if (!strcmp(pArg, "--dof"))
+			valid = sscanf(pValue, "%f,%f", &outOptions.settings.dofStrength, &outOptions.settings.dofDistance) == 2;
+		else if (!strcmp(pArg, "--threads"))
+			outOptions.numThreads = (uint32_t)atoi(pValue);
+		else if (!strcmp(pArg, "--out"))
+			outOptions.outputPath = pValue;
+		else if (!strcmp(pArg, "--record-rays"))
+			outOptions.recordRaysPath = pValue;
+		else if (!strcmp(pArg, "--replay-rays"))
+			outOptions.replayRaysPath = pValue;
+		else if (!strcmp(pArg, "--bvh-leaf"))
+			valid = (outOptions.bvhMaxLeafTriangles = (uint32_t)atoi(pValue)) > 0u;
+		else if (!strcmp(pArg, "--bvh-depth"))
+			valid = (outOptions.bvhMaxDepth = (uint32_t)atoi(pValue)) > 0u;
+		else if (!strcmp(pArg, "--sampler"))
+		{
+			if (!strcmp(pValue, "random"))
+				outOptions.settings.samplerType = Sampler::Type::Random;
+			else if (!strcmp(pValue, "sobol"))
+				outOptions.settings.samplerType = Sampler::Type::Sobol;
+			else if (!strcmp(pValue, "bluenoise"))
+				outOptions.settings.samplerType = Sampler::Type::BlueNoise;
+			else
+				valid = false;
+		}
+		else
+		{
+			printf("Unknown option '%s'\n", pArg);
+			return false;
+		}
+
+		if (!valid)
+		{
+			printf("Invalid value '%s' for '%s'\n", pValue, pArg);
+			return false;
+		}
+	}
+
+	if (outOptions.scenePath.empty())
+	{
+		printf("No scene given\n");
+		return false;
+	}
+
+	return true;
+}
+
+// Same as Application::loadMeshesAsEntities()
+static bool loadScene(const RenderOptions& options, Scene& scene, ResourceManager& resourceManager)
+{
+	std::vector<ResourceManager::ObjectDecription> objectDescriptions;
+	if (!resourceManager.importAssets(options.scenePath, objectDescriptions, options.texturesPath, options.sceneScale))
+		return false;
+
+	for (const ResourceManager::ObjectDecription& objectDesc : objectDescriptions)
+	{
+		Entity entity = scene.createEntity();
+		MeshComponent& meshComp = entity.addComponent<MeshComponent>();
+		Material& material = meshComp.material;
+
+		meshComp.meshID = objectDesc.meshId;
+		material.albedo.textureId = objectDesc.albedoTextureId;
+		material.roughness.textureId = objectDesc.rougnessTextureId;
+		material.metallic.textureId = objectDesc.metallicTextureId;
+		material.specular.textureId = objectDesc.specularTextureId;
+		material.normalMapIdx = objectDesc.normalTextureId;
+
+		entity.getComponent<Transform>().position = objectDesc.position;
+	}
+
+	Entity camera = scene.createEntity();
+	camera.addComponent<Camera>(options.cameraFov, 0.1f);
+
+	Transform& cameraTransform = camera.getComponent<Transform>();
+	cameraTransform.position = options.cameraPosition;
+	cameraTransform.rotation = options.cameraRotation;
+
+	return true;
+}
+
+// Hits are equivalent if both missed, or both hit the same instance at the same distance give or take float error
+static bool isEquivalentHit(const RayHit& reference, const RayHit& hit)
+{
+	static const float RELATIVE_DISTANCE_TOLERANCE = 1e-4f;
+
+	if (reference.instanceIdx != hit.instanceIdx)
+		return false;
+
+	return reference.instanceIdx == Okay::INVALID_UINT ||
+		glm::abs(reference.distance - hit.distance) <= RELATIVE_DISTANCE_TOLERANCE * glm::max(reference.distance, 1.f);
+}
+
+static bool replayRays(const RenderOptions& options, CPURayTracer& rayTracer)
+{
+	struct ReplayStats
+	{
+		uint64_t numRays = 0u;
+		uint64_t numMismatches = 0u;
+		TraversalCounters referenceCounters;
+		TraversalCounters counters;
+	};
+
+	RayRecording recording;
+	if (!recording.readFromFile(options.replayRaysPath))
+	{
+		printf("Failed to read '%s'\n", options.replayRaysPath.c_str());
+		return false;
+	}
+
+	auto startTime = std::chrono::system_clock::now();
+
+	std::vector<RayHit> hits;
+	if (!rayTracer.replayRays(recording, hits))
+		return false;
+
+	std::chrono::duration<float> duration = std::chrono::system_clock::now() - startTime;
+	const float seconds = duration.count();
+
+	// Primary and bounce rays separately, they behave very differently
+	ReplayStats stats[2];
+	uint64_t firstMismatchIdx = UINT64_MAX;
+
+	for (size_t i = 0; i < hits.size(); i++)
+	{
+		const RecordedRay& recordedRay = recording.rays[i];
+		ReplayStats& rayStats = stats[recordedRay.bounce ? 1 : 0];
+
+		rayStats.numRays++;
+		rayStats.referenceCounters.numBoxTests += recordedRay.hit.counters.numBoxTests;
+		rayStats.referenceCounters.numTriangleTests += recordedRay.hit.counters.numTriangleTests;
+		rayStats.counters.numBoxTests += hits[i].counters.numBoxTests;
+		rayStats.counters.numTriangleTests += hits[i].counters.numTriangleTests;
+
+		if (!isEquivalentHit(recordedRay.hit, hits[i]))
+		{
+			rayStats.numMismatches++;
+			firstMismatchIdx = glm::min(firstMismatchIdx, (uint64_t)i);
+		}
+	}
+
+	printf("\nReplayed %zu rays: %.3fms (%.2f MRays/s)\n", hits.size(), seconds * 1000.f, seconds > 0.f ? hits.size() / (seconds * 1000000.f) : 0.f);
+	printf("%-8s %12s %12s %24s %24s\n", "", "Rays", "Mismatches", "Box tests/ray (ref)", "Tri tests/ray (ref)");
+
+	const char* pNames[2] = { "Primary", "Bounce" };
+	for (uint32_t i = 0; i < 2u; i++)
+	{
+		const ReplayStats& rayStats = stats[i];
+		const double numRays = (double)glm::max(rayStats.numRays, (uint64_t)1u);
+
+		printf("%-8s %12llu %12llu %14.2f (%6.2f) %14.2f (%6.2f)\n", pNames[i], (unsigned long long)rayStats.numRays, (unsigned long long)rayStats.numMismatches,
+			rayStats.counters.numBoxTests / numRays, rayStats.referenceCounters.numBoxTests / numRays,
+			rayStats.counters.numTriangleTests / numRays, rayStats.referenceCounters.numTriangleTests / numRays);
+	}
+
+	if (firstMismatchIdx != UINT64_MAX)
+	{
+		const RecordedRay& recordedRay = recording.rays[firstMismatchIdx];
+		printf("First mismatch: ray %llu, pixel %u, bounce %u, instance %d at %f, expected instance %d at %f\n", (unsigned long long)firstMismatchIdx,
+			recordedRay.pixelIdx, recordedRay.bounce, (int)hits[firstMismatchIdx].instanceIdx, hits[firstMismatchIdx].distance,
+			(int)recordedRay.hit.instanceIdx, recordedRay.hit.distance);
+	}
+
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	RenderOptions options;
+	if (!parseOptions(argc, argv, options))
+	{
+		printUsage();
+		return 1;
+	}
+
+	auto loadStartTime = std::chrono::system_clock::now();
+
+	Scene scene;
+	ResourceManager resourceManager;
+	if (!loadScene(options, scene, resourceManager))
+	{
+		printf("Failed to load scene '%s'\n", options.scenePath.c_str());
+		return 1;
+	}
+
+	CPURayTracer rayTracer(options.numThreads);
+	rayTracer.getSettings() = options.settings;
+	rayTracer.initiate(resourceManager, options.resolution, options.environmentMapPath);
+	rayTracer.setScene(scene);
+
+	// initiate built the trees with the defaults
+	if (options.bvhMaxDepth != DEFAULT_BVH_MAX_DEPTH || options.bvhMaxLeafTriangles != DEFAULT_BVH_MAX_LEAF_TRIANGLES)
+		rayTracer.loadMeshAndBvhData(options.bvhMaxDepth, options.bvhMaxLeafTriangles);
+
+	std::chrono::duration<float> loadDuration = std::chrono::system_clock::now() - loadStartTime;
+	printf("\nLoaded '%s' (%u meshes, %u textures): %.3fms\n", options.scenePath.c_str(),
+		resourceManager.getCount<Mesh>(), resourceManager.getCount<Texture>(), loadDuration.count() * 1000.f);
+
+	const Okay::TextureMemoryStats textureMemory = Okay::getTextureMemoryStats();
+	printf("Texture memory: %.3fMB in %u buffers (%.3fMB reserved in %u chunks%s)\n", textureMemory.allocatedBytes / (1024.0 * 1024.0),
+		textureMemory.numBuffers, textureMemory.reservedBytes / (1024.0 * 1024.0), textureMemory.numChunks, textureMemory.largePages ? ", large pages" : "");
+
+	if (!options.replayRaysPath.empty())
+		return replayRays(options, rayTracer) ? 0 : 1;
+
+	RayRecording recording;
+	if (!options.recordRaysPath.empty())
+		rayTracer.setRayRecording(&recording);
+
+	printf("Rendering %ux%u, %u spp on %u threads\n", options.resolution.x, options.resolution.y,
+		options.samplesPerPixel, rayTracer.getScheduler().getNumWorkers());
+
+	auto renderStartTime = std::chrono::system_clock::now();
+	uint64_t totalRays = 0u;
+
+	// One sample at a time so there's progress to print
+	for (uint32_t i = 0; i < options.samplesPerPixel; i++)
+	{
+		rayTracer.renderSamples(1u);
+		totalRays += rayTracer.getLastFrameStats().numRays;
+
+		printf("\rSample %u / %u", i + 1u, options.samplesPerPixel);
+		fflush(stdout);
+	}
+
+	std::chrono::duration<float> renderDuration = std::chrono::system_clock::now() - renderStartTime;
+	const float renderSeconds = renderDuration.count();
+
+	printf("\nRender: %.3fms (%.2f MRays/s)\n", renderSeconds * 1000.f, renderSeconds > 0.f ? totalRays / (renderSeconds * 1000000.f) : 0.f);
+
+	if (!ImageWriter::write(options.outputPath, rayTracer.getResolvedPixels().data(), options.resolution.x, options.resolution.y))
+	{
+		printf("Failed to write '%s'\n", options.outputPath.c_str());
+		return 1;
+	}
+
+	printf("Wrote '%s'\n", options.outputPath.c_str());
+
+	if (!options.recordRaysPath.empty())
+	{
+		rayTracer.setRayRecording(nullptr);
+
+		if (!recording.writeToFile(options.recordRaysPath))
+		{
+			printf("Failed to write '%s'\n", options.recordRaysPath.c_str());
+			return 1;
+		}
+
+		printf("Wrote '%s' (%zu rays, %.1fMB)\n", options.recordRaysPath.c_str(), recording.rays.size(), recording.rays.size() * sizeof(RecordedRay) / (1024.f * 1024.f));
+	}
+
+	return 0;
+}
\ No newline at end of file
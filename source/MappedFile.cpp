@@ -0,0 +1,118 @@
+#include "MappedFile.h"
+
+#include <string>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Okay
+{
+	MappedFile::~MappedFile()
+	{
+		close();
+	}
+
+#ifdef _WIN32
+
+	bool MappedFile::open(std::string_view path)
+	{
+		close();
+
+		HANDLE fileHandle = CreateFileA(std::string(path).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (fileHandle == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0)
+		{
+			CloseHandle(fileHandle);
+			return false;
+		}
+
+		HANDLE mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!mappingHandle)
+		{
+			CloseHandle(fileHandle);
+			return false;
+		}
+
+		void* pData = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+		if (!pData)
+		{
+			CloseHandle(mappingHandle);
+			CloseHandle(fileHandle);
+			return false;
+		}
+
+		m_fileHandle = fileHandle;
+		m_mappingHandle = mappingHandle;
+		m_pData = (const uint8_t*)pData;
+		m_size = (uint64_t)fileSize.QuadPart;
+
+		return true;
+	}
+
+	void MappedFile::close()
+	{
+		if (m_pData)
+			UnmapViewOfFile(m_pData);
+
+		if (m_mappingHandle)
+			CloseHandle(m_mappingHandle);
+
+		if (m_fileHandle)
+			CloseHandle(m_fileHandle);
+
+		m_pData = nullptr;
+		m_size = 0u;
+		m_fileHandle = nullptr;
+		m_mappingHandle = nullptr;
+	}
+
+#else
+
+	bool MappedFile::open(std::string_view path)
+	{
+		close();
+
+		int fileDescriptor = ::open(std::string(path).c_str(), O_RDONLY);
+		if (fileDescriptor == -1)
+			return false;
+
+		struct stat fileStats;
+		if (fstat(fileDescriptor, &fileStats) != 0 || fileStats.st_size == 0)
+		{
+			::close(fileDescriptor);
+			return false;
+		}
+
+		// The mapping stays valid after the descriptor is closed
+		void* pData = mmap(nullptr, (size_t)fileStats.st_size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+		::close(fileDescriptor);
+
+		if (pData == MAP_FAILED)
+			return false;
+
+		m_pData = (const uint8_t*)pData;
+		m_size = (uint64_t)fileStats.st_size;
+
+		return true;
+	}
+
+	void MappedFile::close()
+	{
+		if (m_pData)
+			munmap((void*)m_pData, (size_t)m_size);
+
+		m_pData = nullptr;
+		m_size = 0u;
+	}
+
+#endif
+}
\ No newline at end of file
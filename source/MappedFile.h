@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdint.h>
+#include <string_view>
+
+namespace Okay
+{
+	// A whole file mapped read only, the pages are loaded by the OS on first touch. The mapping is page aligned
+	class MappedFile
+	{
+	public:
+		MappedFile() = default;
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		bool open(std::string_view path);
+		void close();
+
+		inline const uint8_t* getData() const;
+		inline uint64_t getSize() const;
+
+	private:
+		const uint8_t* m_pData = nullptr;
+		uint64_t m_size = 0u;
+
+#ifdef _WIN32
+		void* m_fileHandle = nullptr;
+		void* m_mappingHandle = nullptr;
+#endif
+	};
+
+	inline const uint8_t* MappedFile::getData() const	{ return m_pData; }
+	inline uint64_t MappedFile::getSize() const			{ return m_size; }
+}
\ No newline at end of file
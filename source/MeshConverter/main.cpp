@@ -0,0 +1,167 @@
+#include "Graphics/BvhBuilder.h"
+#include "Graphics/Importer.h"
+#include "Graphics/MeshProcessing.h"
+#include "Graphics/OkmFile.h"
+#include "Threading.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <string>
+
+/*
+	Converts anything assimp reads into an .okm file, see OkmFile.h.
+	ResourceManager picks the .okm up instead of the model when it is next to it, so by default it is written there.
+	The BVH defaults are the ones the tracers start with, a tree built with other settings is ignored when loading.
+*/
+
+struct ConvertOptions
+{
+	std::string inputPath;
+	std::string outputPath;
+	float scale = 1.f;
+	float weldEpsilon = 0.f; // Same as ResourceManager::ImportSettings, the .okm is loaded without welding again
+
+	bool buildBvh = true;
+	uint32_t bvhMaxDepth = DEFAULT_BVH_MAX_DEPTH;
+	uint32_t bvhMaxLeafTriangles = DEFAULT_BVH_MAX_LEAF_TRIANGLES;
+};
+
+static void printUsage()
+{
+	printf("Usage: GPU-Raytracer-MeshConverter --in <file> [options]\n"
+		"  --in <file>             Model file, any format assimp reads\n"
+		"  --out <file>            Output .okm (the input with its extension swapped)\n"
+		"  --scale <s>             Import scale, the same as given when loading the scene (1)\n"
+		"  --weld <eps>            Merge vertices closer than eps, negative to keep them all (0, exact duplicates)\n"
+		"  --no-bvh                Don't store prebuilt BVHs\n"
+		"  --bvh-leaf <n>          Max triangles per BVH leaf (%u)\n"
+		"  --bvh-depth <n>         Max BVH depth (%u)\n", DEFAULT_BVH_MAX_LEAF_TRIANGLES, DEFAULT_BVH_MAX_DEPTH);
+}
+
+static bool parseOptions(int argc, char** argv, ConvertOptions& outOptions)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		const char* pArg = argv[i];
+		const char* pValue = i + 1 < argc ? argv[i + 1] : nullptr;
+
+		// Flags without a value
+		if (!strcmp(pArg, "--no-bvh"))
+		{
+			outOptions.buildBvh = false;
+			continue;
+		}
+
+		if (!strcmp(pArg, "--help") || !strcmp(pArg, "-h"))
+			return false;
+
+		if (!pValue)
+		{
+			printf("Missing value for '%s'\n", pArg);
+			return false;
+		}
+
+		bool valid = true;
+		i++;
+
+		if (!strcmp(pArg, "--in"))
+			outOptions.inputPath = pValue;
+		else if (!strcmp(pArg, "--out"))
+			outOptions.outputPath = pValue;
+		else if (!strcmp(pArg, "--scale"))
+			valid = (outOptions.scale = (float)atof(pValue)) != 0.f;
+		else if (!strcmp(pArg, "--weld"))
+			outOptions.weldEpsilon = (float)atof(pValue);
+		else if (!strcmp(pArg, "--bvh-leaf"))
+			valid = (outOptions.bvhMaxLeafTriangles = (uint32_t)atoi(pValue)) > 0u;
+		else if (!strcmp(pArg, "--bvh-depth"))
+			valid = (outOptions.bvhMaxDepth = (uint32_t)atoi(pValue)) > 0u;
+		else
+		{
+			printf("Unknown option '%s'\n", pArg);
+			return false;
+		}
+
+		if (!valid)
+		{
+			printf("Invalid value '%s' for '%s'\n", pValue, pArg);
+			return false;
+		}
+	}
+
+	if (outOptions.inputPath.empty())
+	{
+		printf("No input given\n");
+		return false;
+	}
+
+	if (outOptions.outputPath.empty())
+		outOptions.outputPath = OkmFile::getPath(outOptions.inputPath);
+
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	ConvertOptions options;
+	if (!parseOptions(argc, argv, options))
+	{
+		printUsage();
+		return 1;
+	}
+
+	auto startTime = std::chrono::system_clock::now();
+
+	std::vector<Importer::ObjectDecriptionStr> importedObjects;
+	if (!Importer::loadObjects(options.inputPath, importedObjects, options.scale))
+	{
+		printf("Failed to import '%s'\n", options.inputPath.c_str());
+		return 1;
+	}
+
+	std::vector<std::optional<OkmFile::Object>> convertedObjects(importedObjects.size());
+
+	Okay::parallelFor((uint32_t)importedObjects.size(), [&](uint32_t i)
+		{
+			Importer::ObjectDecriptionStr& importedObject = importedObjects[i];
+
+			if (options.weldEpsilon >= 0.f)
+				MeshProcessing::weldVertices(importedObject.meshData, options.weldEpsilon);
+
+			Mesh mesh(std::move(importedObject.meshData), importedObject.name);
+
+			// Built the same way the tracers build it
+			if (options.buildBvh)
+				mesh = BvhBuilder(options.bvhMaxLeafTriangles, options.bvhMaxDepth).buildPrebuiltMesh(mesh);
+
+			convertedObjects[i].emplace(OkmFile::Object{ std::move(mesh),
+				std::move(importedObject.albedoTexturePath), std::move(importedObject.rougnessTexturePath),
+				std::move(importedObject.metallicTexturePath), std::move(importedObject.specularTexturePath),
+				std::move(importedObject.normalTexturePath) });
+		});
+
+	std::vector<OkmFile::Object> objects;
+	objects.reserve(convertedObjects.size());
+
+	uint32_t numTriangles = 0u;
+	for (std::optional<OkmFile::Object>& object : convertedObjects)
+	{
+		numTriangles += object->mesh.getNumTriangles();
+		objects.emplace_back(std::move(*object));
+	}
+
+	if (!OkmFile::write(options.outputPath, objects, options.scale))
+	{
+		printf("Failed to write '%s'\n", options.outputPath.c_str());
+		return 1;
+	}
+
+	std::chrono::duration<float> duration = std::chrono::system_clock::now() - startTime;
+	printf("Wrote '%s' (%u objects, %u triangles%s): %.3fms\n", options.outputPath.c_str(), (uint32_t)objects.size(), numTriangles,
+		options.buildBvh ? ", with BVHs" : "", duration.count() * 1000.f);
+
+	return 0;
+}
\ No newline at end of file
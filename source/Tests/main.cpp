@@ -0,0 +1,208 @@
+#include "Graphics/Reprojection.h"
+
+#include "glm/gtc/matrix_transform.hpp"
+
+#include <cstdio>
+#include <vector>
+
+/*
+	Checks of the core's reprojection math, run by ctest. The reprojection benchmarks check it against traced frames,
+	these use hand built views and surfaces so each case, disocclusions included, is tested on its own.
+	Exits with 1 if a check failed.
+*/
+
+static uint32_t numChecks = 0u;
+static uint32_t numFailedChecks = 0u;
+
+#define CHECK(condition) do { numChecks++; if (!(condition)) { printf("CHECK FAILED: %s  |  LINE: %d\n", #condition, __LINE__); numFailedChecks++; } } while (false)
+
+static const glm::uvec2 TEXTURE_DIMS = glm::uvec2(16u, 8u);
+static const float FOV_Y = glm::radians(90.f);
+static const float PLANE_DISTANCE = 10.f;
+
+// At the origin looking down -z
+static glm::mat4 createViewProjection(const glm::vec3& cameraPosition)
+{
+	const glm::mat4 view = glm::lookAt(cameraPosition, cameraPosition + glm::vec3(0.f, 0.f, -1.f), glm::vec3(0.f, 1.f, 0.f));
+	const glm::mat4 projection = glm::perspective(FOV_Y, (float)TEXTURE_DIMS.x / (float)TEXTURE_DIMS.y, 0.1f, 100.f);
+	return projection * view;
+}
+
+// Where the ray through the whole number pixel hits a plane facing the camera at the origin
+static glm::vec3 calculatePlanePosition(glm::vec2 pixel, float distance)
+{
+	const float tanHalfFov = glm::tan(FOV_Y * 0.5f);
+	const float aspectRatio = (float)TEXTURE_DIMS.x / (float)TEXTURE_DIMS.y;
+
+	const glm::vec2 ndc = glm::vec2(pixel.x / (float)TEXTURE_DIMS.x * 2.f - 1.f, 1.f - pixel.y / (float)TEXTURE_DIMS.y * 2.f);
+	return glm::vec3(ndc.x * tanHalfFov * aspectRatio * distance, ndc.y * tanHalfFov * distance, -distance);
+}
+
+// Every pixel sees the plane, the history was traced from the origin
+static Reprojection::History createPlaneHistory()
+{
+	Reprojection::History history;
+	history.viewProjection = createViewProjection(glm::vec3(0.f));
+	history.cameraPosition = glm::vec3(0.f);
+	history.textureDims = TEXTURE_DIMS;
+
+	const size_t numPixels = (size_t)TEXTURE_DIMS.x * TEXTURE_DIMS.y;
+	history.accumulation.assign(numPixels, glm::vec4(1.f, 0.5f, 0.25f, 4.f));
+	history.secondMoment.assign(numPixels, 2.f);
+	history.surfaces.resize(numPixels);
+
+	for (uint32_t y = 0; y < TEXTURE_DIMS.y; y++)
+	{
+		for (uint32_t x = 0; x < TEXTURE_DIMS.x; x++)
+		{
+			Reprojection::Surface& surface = history.surfaces[(size_t)y * TEXTURE_DIMS.x + x];
+			surface.worldPosition = calculatePlanePosition(glm::vec2((float)x, (float)y), PLANE_DISTANCE);
+			surface.normal = glm::vec3(0.f, 0.f, 1.f);
+			surface.instanceId = 0.f;
+		}
+	}
+
+	return history;
+}
+
+static void testWorldToPixel()
+{
+	const glm::mat4 viewProjection = createViewProjection(glm::vec3(0.f));
+	glm::vec2 pixel;
+
+	// Straight ahead is the middle of the texture, the frustum's corners are the texture's
+	CHECK(Reprojection::worldToPixel(viewProjection, glm::vec3(0.f, 0.f, -PLANE_DISTANCE), TEXTURE_DIMS, pixel));
+	CHECK(glm::all(glm::lessThan(glm::abs(pixel - glm::vec2(TEXTURE_DIMS) * 0.5f), glm::vec2(1e-4f))));
+
+	CHECK(Reprojection::worldToPixel(viewProjection, calculatePlanePosition(glm::vec2(0.f), PLANE_DISTANCE), TEXTURE_DIMS, pixel));
+	CHECK(glm::all(glm::lessThan(glm::abs(pixel), glm::vec2(1e-4f))));
+
+	CHECK(Reprojection::worldToPixel(viewProjection, calculatePlanePosition(glm::vec2(TEXTURE_DIMS), PLANE_DISTANCE), TEXTURE_DIMS, pixel));
+	CHECK(glm::all(glm::lessThan(glm::abs(pixel - glm::vec2(TEXTURE_DIMS)), glm::vec2(1e-4f))));
+
+	// Every pixel lands on itself, at any distance
+	for (uint32_t y = 0; y < TEXTURE_DIMS.y; y++)
+	{
+		for (uint32_t x = 0; x < TEXTURE_DIMS.x; x++)
+		{
+			const glm::vec2 expectedPixel = glm::vec2((float)x, (float)y);
+			CHECK(Reprojection::worldToPixel(viewProjection, calculatePlanePosition(expectedPixel, 3.f), TEXTURE_DIMS, pixel));
+			CHECK(glm::all(glm::lessThan(glm::abs(pixel - expectedPixel), glm::vec2(1e-3f))));
+		}
+	}
+
+	// Behind the camera
+	CHECK(!Reprojection::worldToPixel(viewProjection, glm::vec3(0.f, 0.f, PLANE_DISTANCE), TEXTURE_DIMS, pixel));
+}
+
+static void testFindHistoryPixel()
+{
+	const Reprojection::History history = createPlaneHistory();
+	const Reprojection::Settings settings;
+	glm::uvec2 historyPixel;
+
+	// The surfaces the history was traced with all find their own pixel
+	uint32_t numFound = 0u;
+	for (uint32_t y = 0; y < TEXTURE_DIMS.y; y++)
+	{
+		for (uint32_t x = 0; x < TEXTURE_DIMS.x; x++)
+		{
+			const Reprojection::Surface& surface = history.surfaces[(size_t)y * TEXTURE_DIMS.x + x];
+			if (Reprojection::findHistoryPixel(surface, history, settings, historyPixel) && historyPixel == glm::uvec2(x, y))
+				numFound++;
+		}
+	}
+	CHECK(numFound == TEXTURE_DIMS.x * TEXTURE_DIMS.y);
+
+	const glm::uvec2 pixel = glm::uvec2(5u, 3u);
+	const Reprojection::Surface& historySurface = history.surfaces[(size_t)pixel.y * TEXTURE_DIMS.x + pixel.x];
+
+	// Sub pixel offsets round to the nearest pixel
+	Reprojection::Surface surface = historySurface;
+	surface.worldPosition = calculatePlanePosition(glm::vec2(pixel) + glm::vec2(0.4f, -0.4f), PLANE_DISTANCE);
+	CHECK(Reprojection::findHistoryPixel(surface, history, settings, historyPixel) && historyPixel == pixel);
+
+	// Within the depth tolerance
+	surface = historySurface;
+	surface.worldPosition = calculatePlanePosition(glm::vec2(pixel), PLANE_DISTANCE * (1.f + settings.depthTolerance * 0.5f));
+	CHECK(Reprojection::findHistoryPixel(surface, history, settings, historyPixel) && historyPixel == pixel);
+
+	// Disoccluded: the history pixel saw the plane in front of the surface
+	surface = historySurface;
+	surface.worldPosition = calculatePlanePosition(glm::vec2(pixel), PLANE_DISTANCE * 2.f);
+	CHECK(!Reprojection::findHistoryPixel(surface, history, settings, historyPixel));
+
+	// Disoccluded: something new in front of what the history pixel saw
+	surface = historySurface;
+	surface.worldPosition = calculatePlanePosition(glm::vec2(pixel), PLANE_DISTANCE * 0.5f);
+	CHECK(!Reprojection::findHistoryPixel(surface, history, settings, historyPixel));
+
+	// Another instance at the same position
+	surface = historySurface;
+	surface.instanceId = 1.f;
+	CHECK(!Reprojection::findHistoryPixel(surface, history, settings, historyPixel));
+
+	// Facing another way
+	surface = historySurface;
+	surface.normal = glm::normalize(glm::vec3(1.f, 0.f, 1.f));
+	CHECK(!Reprojection::findHistoryPixel(surface, history, settings, historyPixel));
+
+	// Misses have no history
+	surface = historySurface;
+	surface.instanceId = -1.f;
+	CHECK(!Reprojection::findHistoryPixel(surface, history, settings, historyPixel));
+
+	// Outside of the history's view, and behind its camera
+	surface = historySurface;
+	surface.worldPosition = calculatePlanePosition(glm::vec2(-2.f, 3.f), PLANE_DISTANCE);
+	CHECK(!Reprojection::findHistoryPixel(surface, history, settings, historyPixel));
+
+	surface.worldPosition = calculatePlanePosition(glm::vec2(3.f, (float)TEXTURE_DIMS.y + 1.f), PLANE_DISTANCE);
+	CHECK(!Reprojection::findHistoryPixel(surface, history, settings, historyPixel));
+
+	surface.worldPosition = glm::vec3(0.f, 0.f, PLANE_DISTANCE);
+	CHECK(!Reprojection::findHistoryPixel(surface, history, settings, historyPixel));
+}
+
+static void testGetHistoryWeight()
+{
+	CHECK(Reprojection::getHistoryWeight(0.f, 64.f) == 1.f);
+	CHECK(Reprojection::getHistoryWeight(16.f, 64.f) == 1.f);
+	CHECK(Reprojection::getHistoryWeight(64.f, 64.f) == 1.f);
+
+	// Above the cap the history counts as exactly the cap
+	CHECK(Reprojection::getHistoryWeight(128.f, 64.f) == 0.5f);
+	CHECK(glm::abs(Reprojection::getHistoryWeight(1000.f, 64.f) * 1000.f - 64.f) < 1e-3f);
+}
+
+static void testReprojectAccumulation()
+{
+	const Reprojection::History history = createPlaneHistory();
+	const Reprojection::Settings settings;
+
+	// The same view, with one pixel seeing another instance
+	std::vector<Reprojection::Surface> surfaces = history.surfaces;
+	surfaces[9].instanceId = 1.f;
+
+	std::vector<glm::vec4> accumulation(surfaces.size(), glm::vec4(0.f, 0.f, 0.f, 1.f));
+	std::vector<float> secondMoment(surfaces.size(), 1.f);
+
+	CHECK(Reprojection::reprojectAccumulation(history, surfaces, settings, accumulation, secondMoment) == (uint32_t)surfaces.size() - 1u);
+	CHECK(accumulation[0] == glm::vec4(1.f, 0.5f, 0.25f, 5.f) && secondMoment[0] == 3.f);
+	CHECK(accumulation[9] == glm::vec4(0.f, 0.f, 0.f, 1.f) && secondMoment[9] == 1.f);
+
+	// Mismatched sizes are left alone
+	surfaces.pop_back();
+	CHECK(Reprojection::reprojectAccumulation(history, surfaces, settings, accumulation, secondMoment) == 0u);
+}
+
+int main()
+{
+	testWorldToPixel();
+	testFindHistoryPixel();
+	testGetHistoryWeight();
+	testReprojectAccumulation();
+
+	printf("%u of %u checks failed\n", numFailedChecks, numChecks);
+	return numFailedChecks ? 1 : 0;
+}
\ No newline at end of file
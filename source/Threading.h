@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace Okay
+{
+	inline uint32_t getNumWorkerThreads()
+	{
+		uint32_t numThreads = std::thread::hardware_concurrency();
+		return numThreads ? numThreads : 1u;
+	}
+
+	// Calls function(i) for every i in [0, count) spread over all hardware threads.
+	// Indices are handed out one at a time through an atomic counter so uneven work balances itself out.
+	template<typename Function>
+	void parallelFor(uint32_t count, Function function)
+	{
+		const uint32_t numThreads = std::min(getNumWorkerThreads(), count);
+
+		if (numThreads <= 1u)
+		{
+			for (uint32_t i = 0; i < count; i++)
+				function(i);
+
+			return;
+		}
+
+		std::atomic<uint32_t> nextIdx = 0u;
+
+		auto worker = [&]()
+			{
+				uint32_t idx;
+				while ((idx = nextIdx.fetch_add(1u, std::memory_order_relaxed)) < count)
+					function(idx);
+			};
+
+		std::vector<std::thread> threads;
+		threads.reserve(numThreads - 1u);
+
+		for (uint32_t i = 0; i < numThreads - 1u; i++)
+			threads.emplace_back(worker);
+
+		worker(); // Calling thread helps out as well
+
+		for (std::thread& thread : threads)
+			thread.join();
+	}
+}
\ No newline at end of file
@@ -1,15 +1,27 @@
 #pragma once
 #include "glm/glm.hpp"
+#include "glm/gtc/packing.hpp"
 
 #include <cassert>
+#include <cfloat>
+#include <cstdio>
 #include <stdint.h>
 #include <memory>
 #include <fstream>
+#include <string>
+#include <string_view>
+
+#ifdef _MSC_VER
+#define OKAY_DEBUG_BREAK() __debugbreak()
+#else
+#include <csignal>
+#define OKAY_DEBUG_BREAK() raise(SIGTRAP)
+#endif
 
 #ifdef DIST
 #define OKAY_ASSERT(condition) 
 #else
-#define OKAY_ASSERT(condition) if (!(condition)) {printf("ASSERTION FAILED: %s  |  FILE: %s  |  LINE: %d\n", #condition, __FILE__, __LINE__); __debugbreak(); }0
+#define OKAY_ASSERT(condition) if (!(condition)) {printf("ASSERTION FAILED: %s  |  FILE: %s  |  LINE: %d\n", #condition, __FILE__, __LINE__); OKAY_DEBUG_BREAK(); }0
 #endif
 
 #define DX11_RELEASE(X)		 if (X) {(X)->Release(); } (X) = nullptr
@@ -113,11 +125,63 @@ namespace Okay
 		glm::vec3 bitangent = glm::vec3(0.f);
 	};
 
-	struct TriangleInfo
+	// VertexInfo as it's stored and uploaded, 12 bytes instead of 44. Decoded by unpackVertexInfo here and in GPU-Utilities.hlsli
+	// Worst case error: ~0.01 degrees for the directions, 2^-11 relative for the UVs (so UVs far outside [0, 1] lose precision)
+	struct PackedVertexInfo
 	{
-		VertexInfo vertexInfo[3];
+		uint32_t normal = 0u;	// Octahedral, 2x 16 bit snorm
+		uint32_t tangent = 0u;	// Octahedral, 2x 16 bit snorm. The lowest bit is the bitangent sign, set means cross(normal, tangent) is flipped
+		uint32_t uv = 0u;		// 2x half
 	};
 
+	// Maps a unit vector onto the octahedron and unfolds it into [-1, 1]^2
+	inline glm::vec2 octahedralEncode(const glm::vec3& direction)
+	{
+		const float manhattanLength = glm::abs(direction.x) + glm::abs(direction.y) + glm::abs(direction.z);
+		if (manhattanLength == 0.f)
+			return glm::vec2(0.f); // Decodes to +z, zero vectors (e.g. missing tangents) have no direction to keep
+
+		const glm::vec3 octahedron = direction / manhattanLength;
+		if (octahedron.z >= 0.f)
+			return glm::vec2(octahedron.x, octahedron.y);
+
+		const glm::vec2 signs = glm::vec2(octahedron.x >= 0.f ? 1.f : -1.f, octahedron.y >= 0.f ? 1.f : -1.f);
+		return (1.f - glm::abs(glm::vec2(octahedron.y, octahedron.x))) * signs;
+	}
+
+	inline glm::vec3 octahedralDecode(const glm::vec2& encoded)
+	{
+		glm::vec3 direction = glm::vec3(encoded.x, encoded.y, 1.f - glm::abs(encoded.x) - glm::abs(encoded.y));
+		const float fold = glm::max(-direction.z, 0.f);
+		direction.x += direction.x >= 0.f ? -fold : fold;
+		direction.y += direction.y >= 0.f ? -fold : fold;
+
+		return glm::normalize(direction);
+	}
+
+	inline PackedVertexInfo packVertexInfo(const VertexInfo& vertexInfo)
+	{
+		const bool flippedBitangent = glm::dot(glm::cross(vertexInfo.normal, vertexInfo.tangent), vertexInfo.bitangent) < 0.f;
+
+		PackedVertexInfo packed;
+		packed.normal = glm::packSnorm2x16(octahedralEncode(vertexInfo.normal));
+		packed.tangent = (glm::packSnorm2x16(octahedralEncode(vertexInfo.tangent)) & ~1u) | (flippedBitangent ? 1u : 0u);
+		packed.uv = glm::packHalf2x16(vertexInfo.uv);
+
+		return packed;
+	}
+
+	inline VertexInfo unpackVertexInfo(const PackedVertexInfo& packed)
+	{
+		VertexInfo vertexInfo;
+		vertexInfo.normal = octahedralDecode(glm::unpackSnorm2x16(packed.normal));
+		vertexInfo.tangent = octahedralDecode(glm::unpackSnorm2x16(packed.tangent));
+		vertexInfo.bitangent = glm::cross(vertexInfo.normal, vertexInfo.tangent) * ((packed.tangent & 1u) ? -1.f : 1.f);
+		vertexInfo.uv = glm::unpackHalf2x16(packed.uv);
+
+		return vertexInfo;
+	}
+
 	struct Plane
 	{
 		glm::vec3 position;